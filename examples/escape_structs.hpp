@@ -2,8 +2,9 @@
 
 #include <cstdint>
 #include <string>
-#include <vector>
 #include <variant>
+#include <vector>
+#include <ulog_cpp/struct_description.hpp>
 #include <ulog_cpp/zz_data_log.hpp>
 
 struct MyData1 {
@@ -14,21 +15,28 @@ struct MyData1 {
     int8_t counter;
     int32_t array[6];
 
-    static std::string messageName()  { return "MyData1"; }
-
-    static std::vector<ulog_cpp::Field> fields()  {
-        // clang-format off
-        return {
-            {"uint64_t", "timestamp"},
-            {"float", "debug_array", 4},
-            {"float", "cpuload"},
-            {"float", "temperature"},
-            {"int32_t", "array", 6},
-            {"int8_t", "counter"},
-        };
-        // clang-format on
-    }
+    static const std::string& messageName();
+    static const std::vector<ulog_cpp::Field>& fields();
+};
+
+namespace ulog_cpp {
+template <>
+struct StructDescription<MyData1> {
+    static constexpr const char* kName = "MyData1";
+    static constexpr FieldDescription kFields[] = {
+        ULOG_CPP_FIELD(MyData1, timestamp),
+        ULOG_CPP_FIELD(MyData1, debug_array),
+        ULOG_CPP_FIELD(MyData1, cpuload),
+        ULOG_CPP_FIELD(MyData1, temperature),
+        ULOG_CPP_FIELD(MyData1, counter),
+        ULOG_CPP_FIELD(MyData1, array),
+    };
 };
+}  // namespace ulog_cpp
+static_assert(ulog_cpp::hasValidLayout<MyData1>(), "MyData1: fields do not match the struct layout");
+
+inline const std::string& MyData1::messageName() { return ulog_cpp::describedMessageName<MyData1>(); }
+inline const std::vector<ulog_cpp::Field>& MyData1::fields() { return ulog_cpp::describedFields<MyData1>(); }
 
 struct MyData2 {
     uint64_t timestamp;
@@ -37,21 +45,28 @@ struct MyData2 {
     float temperature;
     int8_t counter;
 
-    static std::string messageName()  { return "MyData2"; }
-
-    static std::vector<ulog_cpp::Field> fields()  {
-        // clang-format off
-        return {
-            {"uint64_t", "timestamp"},
-            {"float", "debug_array", 4},
-            {"float", "cpuload"},
-            {"float", "temperature"},
-            {"int8_t", "counter"},
-        };
-        // clang-format on
-    }
+    static const std::string& messageName();
+    static const std::vector<ulog_cpp::Field>& fields();
 };
 
+namespace ulog_cpp {
+template <>
+struct StructDescription<MyData2> {
+    static constexpr const char* kName = "MyData2";
+    static constexpr FieldDescription kFields[] = {
+        ULOG_CPP_FIELD(MyData2, timestamp),
+        ULOG_CPP_FIELD(MyData2, debug_array),
+        ULOG_CPP_FIELD(MyData2, cpuload),
+        ULOG_CPP_FIELD(MyData2, temperature),
+        ULOG_CPP_FIELD(MyData2, counter),
+    };
+};
+}  // namespace ulog_cpp
+static_assert(ulog_cpp::hasValidLayout<MyData2>(), "MyData2: fields do not match the struct layout");
+
+inline const std::string& MyData2::messageName() { return ulog_cpp::describedMessageName<MyData2>(); }
+inline const std::vector<ulog_cpp::Field>& MyData2::fields() { return ulog_cpp::describedFields<MyData2>(); }
+
 struct MyData3 {
     uint64_t timestamp;
     float debug_array[4];
@@ -59,21 +74,28 @@ struct MyData3 {
     float temperature;
     int8_t counter;
 
-    static std::string messageName()  { return "MyData3"; }
-
-    static std::vector<ulog_cpp::Field> fields()  {
-        // clang-format off
-        return {
-            {"uint64_t", "timestamp"},
-            {"float", "debug_array", 4},
-            {"float", "cpuload"},
-            {"float", "temperature"},
-            {"int8_t", "counter"},
-        };
-        // clang-format on
-    }
+    static const std::string& messageName();
+    static const std::vector<ulog_cpp::Field>& fields();
 };
 
+namespace ulog_cpp {
+template <>
+struct StructDescription<MyData3> {
+    static constexpr const char* kName = "MyData3";
+    static constexpr FieldDescription kFields[] = {
+        ULOG_CPP_FIELD(MyData3, timestamp),
+        ULOG_CPP_FIELD(MyData3, debug_array),
+        ULOG_CPP_FIELD(MyData3, cpuload),
+        ULOG_CPP_FIELD(MyData3, temperature),
+        ULOG_CPP_FIELD(MyData3, counter),
+    };
+};
+}  // namespace ulog_cpp
+static_assert(ulog_cpp::hasValidLayout<MyData3>(), "MyData3: fields do not match the struct layout");
+
+inline const std::string& MyData3::messageName() { return ulog_cpp::describedMessageName<MyData3>(); }
+inline const std::vector<ulog_cpp::Field>& MyData3::fields() { return ulog_cpp::describedFields<MyData3>(); }
+
 // Disable editing of DataVariant variable names
 using DataVariant = std::variant<MyData1, MyData2, MyData3>;
 
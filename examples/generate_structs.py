@@ -20,58 +20,35 @@ with open(input_file_path, 'r') as input_file:
     for struct_name, struct_content in struct_matches:
         struct_definitions.append((struct_name.strip(), struct_content.strip()))
 
-# Generate output file content with static methods
-output_file_content = f'#pragma once\n\n#include <cstdint>\n#include <string>\n#include <vector>\n#include <variant>\n#include <ulog_cpp/zz_data_log.hpp>\n\n'
+# Generate output file content. The field list is a compile-time description in declaration order
+# (ulog_cpp::StructDescription), with types, offsets and sizes taken from the members themselves.
+output_file_content = '#pragma once\n\n#include <cstdint>\n#include <string>\n#include <variant>\n#include <vector>\n#include <ulog_cpp/struct_description.hpp>\n#include <ulog_cpp/zz_data_log.hpp>\n\n'
 
 # Loop through struct definitions
 for struct_name, struct_content in struct_definitions:
     output_file_content += f'struct {struct_name} {{\n'
     output_file_content += f'    {struct_content}\n\n'
-    output_file_content += f'    static std::string messageName()  {{ return "{struct_name}"; }}\n\n'
-    output_file_content += '    static std::vector<ulog_cpp::Field> fields()  {\n'
-    output_file_content += '        // clang-format off\n'
-
-    # Extract field names, types, and array sizes from struct_content
-    field_matches = re.findall(r'(\w+)\s+(\w+)\s*(?:\[(\d+)\])?\s*;', struct_content)
-
-    # Calculate field type size and add to field_matches as tuple (field_type, field_name, array_size, type_size)
-    # Define field type size dictionary
-    field_size = {
-        "int8_t": 1,
-        "uint8_t": 1,
-        "int16_t": 2,
-        "uint16_t": 2,
-        "int32_t": 4,
-        "uint32_t": 4,
-        "int64_t": 8,
-        "uint64_t": 8,
-        "float": 4,
-        "double": 8,
-        "bool": 1,
-        "char": 1,
-        # Add more types and their sizes if needed
-    }
-    field_matches_with_size = [
-        (field_type, field_name, array_size, field_size.get(field_type, 0))
-        for field_type, field_name, array_size in field_matches
-    ]
-
-    # Sort fields based on data type size in descending order
-    field_matches_with_size.sort(key=lambda x: x[3], reverse=True)
-
-    output_file_content += '        return {\n'
-    for field_type, field_name, array_size, _ in field_matches_with_size:
-        if array_size:
-            output_file_content += f'            {{"{field_type}", "{field_name}", {array_size}}},\n'
-        else:
-            output_file_content += f'            {{"{field_type}", "{field_name}"}},\n'
-
-    output_file_content += '        };\n'
-    output_file_content += '        // clang-format on\n'
-    output_file_content += '    }\n'
+    output_file_content += '    static const std::string& messageName();\n'
+    output_file_content += '    static const std::vector<ulog_cpp::Field>& fields();\n'
     output_file_content += '};\n\n'
 
+    # Extract field names (in declaration order)
+    field_matches = re.findall(r'(\w+)\s+(\w+)\s*(?:\[(\d+)\])?\s*;', struct_content)
 
+    output_file_content += 'namespace ulog_cpp {\n'
+    output_file_content += 'template <>\n'
+    output_file_content += f'struct StructDescription<{struct_name}> {{\n'
+    output_file_content += f'    static constexpr const char* kName = "{struct_name}";\n'
+    output_file_content += '    static constexpr FieldDescription kFields[] = {\n'
+    for _, field_name, _ in field_matches:
+        output_file_content += f'        ULOG_CPP_FIELD({struct_name}, {field_name}),\n'
+    output_file_content += '    };\n'
+    output_file_content += '};\n'
+    output_file_content += '}  // namespace ulog_cpp\n'
+    output_file_content += f'static_assert(ulog_cpp::hasValidLayout<{struct_name}>(), "{struct_name}: fields do not match the struct layout");\n\n'
+
+    output_file_content += f'inline const std::string& {struct_name}::messageName() {{ return ulog_cpp::describedMessageName<{struct_name}>(); }}\n'
+    output_file_content += f'inline const std::vector<ulog_cpp::Field>& {struct_name}::fields() {{ return ulog_cpp::describedFields<{struct_name}>(); }}\n\n'
 
 # Generate vector containing instances of each struct
 output_file_content += '// Disable editing of DataVariant variable names\n'
@@ -24,6 +24,10 @@ void PrintStruct(const MyData1& s) {
 void threadFunc1(int Id) {
     std::cout << "Thread " << Id << " is running." << std::endl;
     printf("MyData1 size: %ld\n", sizeof(MyData1));
+#if IF_ELSE
+    // Resolve the topic once, instead of for every write
+    auto topic_writer = zz_data_log::GetInstance()->topicWriter<MyData1>();
+#endif
     for (int K = 0; K < 10; K++) {
         float cpuload = 25.423F;
         for (int i = 0; i < 10; ++i) {
@@ -40,7 +44,7 @@ void threadFunc1(int Id) {
             }
             PrintStruct(data);
 #if IF_ELSE
-            zz_data_log::GetInstance()->Write(data);
+            topic_writer.Write(data);
             printf("%s %d\n", __func__, __LINE__);
 #else
             zz_data_log::GetInstance()->writeData(Id, data);                                    // 必须
@@ -57,6 +61,10 @@ void threadFunc1(int Id) {
 void threadFunc2(int Id) {
     std::cout << "Thread " << Id << " is running." << std::endl;
     printf("MyData2 size: %ld\n", sizeof(MyData2));
+#if IF_ELSE
+    // Resolve the topic once, instead of for every write
+    auto topic_writer = zz_data_log::GetInstance()->topicWriter<MyData2>();
+#endif
     for (int K = 0; K < 10; K++) {
         float cpuload2 = 50.846F;
         for (int i = 0; i < 10; ++i) {
@@ -69,7 +77,7 @@ void threadFunc2(int Id) {
             }
 
 #if IF_ELSE
-            zz_data_log::GetInstance()->Write(data);
+            topic_writer.Write(data);
             printf("%s %d\n", __func__, __LINE__);
 #else
             zz_data_log::GetInstance()->writeData(Id, data);                                    // 必须
@@ -86,6 +94,10 @@ void threadFunc2(int Id) {
 void threadFunc3(int Id) {
     std::cout << "Thread " << Id << " is running." << std::endl;
     printf("MyData3 size: %ld\n", sizeof(MyData3));
+#if IF_ELSE
+    // Resolve the topic once, instead of for every write
+    auto topic_writer = zz_data_log::GetInstance()->topicWriter<MyData3>();
+#endif
     for (int K = 0; K < 10; K++) {
         float cpuload2 = 50.846F;
         for (int i = 0; i < 10; ++i) {
@@ -97,7 +109,7 @@ void threadFunc3(int Id) {
                 data.debug_array[j] = i + j + 6;
             }
 #if IF_ELSE
-            zz_data_log::GetInstance()->Write(data);
+            topic_writer.Write(data);
             printf("%s %d\n", __func__, __LINE__);
 #else
             zz_data_log::GetInstance()->writeData(Id, data);                                    // 必须
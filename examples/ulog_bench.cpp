@@ -0,0 +1,708 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+// Microbenchmarks for the reader and writer hot paths.
+// Every result is printed as a single JSON object per line, so runs can be collected and compared.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <ulog_cpp/data_container.hpp>
+#include <ulog_cpp/file_sink.hpp>
+#include <ulog_cpp/reader.hpp>
+#include <ulog_cpp/simple_writer.hpp>
+#include <ulog_cpp/workload_generator.hpp>
+#include <ulog_cpp/zz_data_log.hpp>
+#include <vector>
+
+bool ZzDataLogOn = true;
+
+namespace {
+
+struct Options {
+  std::string log_dir{"test/log_files"};
+  std::string tmp_dir{"/tmp"};
+  std::string output;    ///< empty: stdout
+  std::string workload;  ///< spec file for the generated log, empty: default workload
+  uint64_t generated_size_mb{256};
+  uint64_t sink_size_mb{512};
+  int max_threads{4};
+  int samples_per_thread{100000};
+  int repetitions{3};
+};
+
+struct BenchSample {
+  uint64_t timestamp;
+  float values[8];
+  uint32_t counter;
+
+  static std::string messageName() { return "bench_sample"; }
+
+  static std::vector<ulog_cpp::Field> fields()
+  {
+    return {
+        {"uint64_t", "timestamp"},
+        {"float", "values", 8},
+        {"uint32_t", "counter"},
+    };
+  }
+};
+
+class JsonLine {
+ public:
+  explicit JsonLine(const std::string& bench) { add("bench", bench); }
+
+  JsonLine& add(const std::string& key, const std::string& value)
+  {
+    addKey(key);
+    _stream << '"' << value << '"';
+    return *this;
+  }
+  JsonLine& add(const std::string& key, double value)
+  {
+    addKey(key);
+    _stream << value;
+    return *this;
+  }
+  JsonLine& add(const std::string& key, uint64_t value)
+  {
+    addKey(key);
+    _stream << value;
+    return *this;
+  }
+  JsonLine& add(const std::string& key, int value)
+  {
+    addKey(key);
+    _stream << value;
+    return *this;
+  }
+
+  std::string str() const { return _stream.str() + "}"; }
+
+ private:
+  void addKey(const std::string& key)
+  {
+    _stream << (_stream.tellp() == 0 ? "{" : ",") << '"' << key << "\":";
+  }
+  std::ostringstream _stream;
+};
+
+class Output {
+ public:
+  explicit Output(const std::string& filename)
+  {
+    if (!filename.empty()) {
+      _file = fopen(filename.c_str(), "w");
+      if (!_file) {
+        throw std::runtime_error("Failed to open " + filename);
+      }
+    }
+  }
+  ~Output()
+  {
+    if (_file) {
+      fclose(_file);
+    }
+  }
+
+  void print(const JsonLine& line)
+  {
+    fprintf(_file ? _file : stdout, "%s\n", line.str().c_str());
+    fflush(_file ? _file : stdout);
+  }
+
+ private:
+  FILE* _file{nullptr};
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double mbPerSecond(uint64_t bytes, double seconds)
+{
+  return seconds > 0. ? static_cast<double>(bytes) / 1e6 / seconds : 0.;
+}
+
+uint64_t fileSize(const std::string& filename)
+{
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (!file) {
+    return 0;
+  }
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fclose(file);
+  return size < 0 ? 0 : size;
+}
+
+// Streaming handlers: only count the payload, so the measurement is dominated by the parser
+struct VirtualCountingHandler : public ulog_cpp::DataHandlerInterface {
+  void data(const ulog_cpp::Data& data) override { num_bytes += data.data().size(); }
+  void error(const std::string& msg, bool is_recoverable) override { ++num_errors; }
+  uint64_t num_bytes{0};
+  int num_errors{0};
+};
+
+struct FinalCountingHandler final : public ulog_cpp::DataHandlerInterface {
+  void data(const ulog_cpp::Data& data) override { num_bytes += data.data().size(); }
+  void error(const std::string& msg, bool is_recoverable) override { ++num_errors; }
+  uint64_t num_bytes{0};
+  int num_errors{0};
+};
+
+template <typename ReaderT>
+bool readFile(const std::string& filename, ReaderT& reader)
+{
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  std::vector<uint8_t> buffer(64 * 1024);
+  size_t bytes_read;
+  while (!reader.stopped() && (bytes_read = fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+    reader.readChunk(buffer.data(), bytes_read);
+  }
+  fclose(file);
+  return true;
+}
+
+/**
+ * Parse a file with the different handler types. The fastest of the repetitions is reported
+ * (the first one usually also reads the file into the page cache).
+ */
+void benchParse(const Options& options, Output& output, const std::string& filename,
+                bool with_container)
+{
+  const uint64_t size = fileSize(filename);
+  // header: StorageConfig::Header, header_stop: additionally stop reading after the header
+  const std::vector<std::string> handlers{"container", "virtual", "template", "header",
+                                          "header_stop"};
+  for (const auto& handler : handlers) {
+    if (handler == "container" && !with_container) {
+      continue;
+    }
+    double best = 1e30;
+    int num_errors = 0;
+    for (int i = 0; i < options.repetitions; ++i) {
+      const auto start = std::chrono::steady_clock::now();
+      if (handler == "container") {
+        const auto data_container = std::make_shared<ulog_cpp::DataContainer>(
+            ulog_cpp::DataContainer::StorageConfig::FullLog);
+        ulog_cpp::Reader reader{data_container};
+        readFile(filename, reader);
+        num_errors = data_container->parsingErrors().size();
+      } else if (handler == "header" || handler == "header_stop") {
+        const auto data_container = std::make_shared<ulog_cpp::DataContainer>(
+            ulog_cpp::DataContainer::StorageConfig::Header);
+        ulog_cpp::Reader reader{data_container};
+        reader.setStopAfterHeader(handler == "header_stop");
+        readFile(filename, reader);
+        num_errors = data_container->parsingErrors().size();
+      } else if (handler == "virtual") {
+        const auto counting_handler = std::make_shared<VirtualCountingHandler>();
+        ulog_cpp::Reader reader{counting_handler};
+        readFile(filename, reader);
+        num_errors = counting_handler->num_errors;
+      } else {
+        FinalCountingHandler counting_handler;
+        ulog_cpp::BasicReader<FinalCountingHandler> reader{counting_handler};
+        readFile(filename, reader);
+        num_errors = counting_handler.num_errors;
+      }
+      best = std::min(best, secondsSince(start));
+    }
+    const auto slash = filename.rfind('/');
+    output.print(JsonLine("parse")
+                     .add("input", slash == std::string::npos ? filename : filename.substr(slash + 1))
+                     .add("handler", handler)
+                     .add("bytes", size)
+                     .add("seconds", best)
+                     .add("mb_per_s", mbPerSecond(size, best))
+                     .add("errors", num_errors));
+  }
+}
+
+BenchSample makeSample(uint64_t timestamp, uint32_t counter)
+{
+  BenchSample sample{};
+  sample.timestamp = timestamp;
+  for (int i = 0; i < 8; ++i) {
+    sample.values[i] = static_cast<float>(counter % 1000) * 0.1F + static_cast<float>(i);
+  }
+  sample.counter = counter;
+  return sample;
+}
+
+void writeHeader(ulog_cpp::SimpleWriter& writer)
+{
+  writer.writeInfo("sys_name", "ulog_bench");
+  writer.writeMessageFormat(BenchSample::messageName(), BenchSample::fields());
+  writer.headerComplete();
+}
+
+/**
+ * Generate the log from --workload, or a default workload with 100 topics of --size-mb
+ */
+std::string generateLog(const Options& options)
+{
+  ulog_cpp::WorkloadSpec spec;
+  if (options.workload.empty()) {
+    spec.duration_s = 1e9;
+    spec.max_bytes = options.generated_size_mb * 1024 * 1024;
+    spec.addRandomTopics(100, 10., 1000., 2, 16);
+  } else {
+    std::ifstream spec_file(options.workload);
+    if (!spec_file) {
+      throw std::runtime_error("Failed to open " + options.workload);
+    }
+    spec = ulog_cpp::WorkloadSpec::parse(spec_file);
+  }
+  const std::string filename = options.tmp_dir + "/ulog_bench_generated.ulg";
+  FILE* file = fopen(filename.c_str(), "wb");
+  if (!file) {
+    throw std::runtime_error("Failed to open " + filename);
+  }
+  ulog_cpp::WorkloadGenerator(spec).generate(
+      [file](const uint8_t* data, int length) { fwrite(data, 1, length, file); });
+  fclose(file);
+  return filename;
+}
+
+void printLatency(Output& output, const std::string& bench, int num_threads,
+                  std::vector<uint32_t>& latencies_ns)
+{
+  if (latencies_ns.empty()) {
+    return;
+  }
+  std::sort(latencies_ns.begin(), latencies_ns.end());
+  auto percentile = [&](double p) {
+    const size_t index = static_cast<size_t>(p * static_cast<double>(latencies_ns.size() - 1));
+    return static_cast<int>(latencies_ns[index]);
+  };
+  output.print(JsonLine(bench)
+                   .add("threads", num_threads)
+                   .add("samples", static_cast<uint64_t>(latencies_ns.size()))
+                   .add("p50_ns", percentile(0.5))
+                   .add("p90_ns", percentile(0.9))
+                   .add("p99_ns", percentile(0.99))
+                   .add("p999_ns", percentile(0.999))
+                   .add("max_ns", static_cast<int>(latencies_ns.back())));
+}
+
+/**
+ * SimpleWriter is not thread-safe: each thread writes its own file
+ */
+void benchSimpleWriter(const Options& options, Output& output, int num_threads)
+{
+  std::vector<std::thread> threads;
+  std::vector<std::string> filenames;
+  for (int t = 0; t < num_threads; ++t) {
+    filenames.push_back(options.tmp_dir + "/ulog_bench_simple_writer_" + std::to_string(t) + ".ulg");
+  }
+  const auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&options, &filenames, t]() {
+      ulog_cpp::SimpleWriter writer(filenames[t], 0);
+      writeHeader(writer);
+      const uint16_t msg_id = writer.writeAddLoggedMessage(BenchSample::messageName());
+      for (int i = 0; i < options.samples_per_thread; ++i) {
+        writer.writeData(msg_id, makeSample(i * 1000, i));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const double seconds = secondsSince(start);
+  uint64_t bytes = 0;
+  for (const auto& filename : filenames) {
+    bytes += fileSize(filename);
+    remove(filename.c_str());
+  }
+  const uint64_t num_samples = static_cast<uint64_t>(options.samples_per_thread) * num_threads;
+  output.print(JsonLine("write_simple_writer")
+                   .add("threads", num_threads)
+                   .add("samples", num_samples)
+                   .add("bytes", bytes)
+                   .add("seconds", seconds)
+                   .add("mb_per_s", mbPerSecond(bytes, seconds))
+                   .add("samples_per_s", static_cast<double>(num_samples) / seconds));
+}
+
+/**
+ * zz_data_log is shared between all threads (as the singleton would be). Includes the periodic
+ * fsync() and file rotation.
+ * @param topic_writer write via TopicWriter handles instead of Write()
+ * @param sink_type file sink of the logger, the name gets a suffix if not stdio
+ */
+void benchZzDataLog(const Options& options, Output& output, int num_threads, bool topic_writer,
+                    ulog_cpp::FileSinkType sink_type = ulog_cpp::FileSinkType::Stdio)
+{
+  std::string name = topic_writer ? "write_zz_data_log_topic_writer" : "write_zz_data_log";
+  if (sink_type != ulog_cpp::FileSinkType::Stdio) {
+    name += std::string("_") + ulog_cpp::fileSinkTypeName(sink_type);
+  }
+  const std::string filename = options.tmp_dir + "/ulog_bench_zz.ulg";
+  std::vector<std::vector<uint32_t>> latencies_ns(num_threads);
+  double seconds;
+  ulog_cpp::DataLogStats stats;
+  {
+    ulog_cpp::FileSinkConfig sink_config;
+    sink_config.type = sink_type;
+    zz_data_log logger(filename, sink_config);
+    InitParams init_params;
+    init_params.file_name = filename;
+    init_params.key = "sys_name";
+    init_params.key_value = "ulog_bench";
+    init_params.all_structs.push_back({BenchSample::messageName(), BenchSample::fields()});
+    logger.Init(init_params);
+
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num_threads; ++t) {
+      latencies_ns[t].reserve(options.samples_per_thread);
+      threads.emplace_back([&options, &logger, &latencies_ns, t, topic_writer]() {
+        const auto handle = logger.topicWriter<BenchSample>();
+        for (int i = 0; i < options.samples_per_thread; ++i) {
+          const BenchSample sample = makeSample(currentTimeUs(), i);
+          const auto write_start = std::chrono::steady_clock::now();
+          if (topic_writer) {
+            handle.Write(sample);
+          } else {
+            logger.Write(sample);
+          }
+          latencies_ns[t].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::steady_clock::now() - write_start)
+                                        .count());
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    seconds = secondsSince(start);
+    stats = logger.stats();
+  }
+
+  // Remove the file and all rotated files
+  uint64_t bytes = fileSize(filename);
+  remove(filename.c_str());
+  for (int i = 1;; ++i) {
+    const std::string rotated = options.tmp_dir + "/ulog_bench_zz." + std::to_string(i) + ".ulg";
+    const uint64_t size = fileSize(rotated);
+    if (size == 0) {
+      break;
+    }
+    bytes += size;
+    remove(rotated.c_str());
+  }
+
+  const uint64_t num_samples = static_cast<uint64_t>(options.samples_per_thread) * num_threads;
+  output.print(JsonLine(name)
+                   .add("threads", num_threads)
+                   .add("samples", num_samples)
+                   .add("bytes", bytes)
+                   .add("seconds", seconds)
+                   .add("mb_per_s", mbPerSecond(bytes, seconds))
+                   .add("samples_per_s", static_cast<double>(num_samples) / seconds)
+                   .add("rotations", stats.rotations)
+                   .add("fsync_count", stats.fsync.count)
+                   .add("fsync_mean_ns", stats.fsync.meanNs())
+                   .add("fsync_max_ns", stats.fsync.max_ns)
+                   .add("mutex_wait_p99_ns", stats.mutex_wait.percentileNs(0.99))
+                   .add("max_waiting_writers", static_cast<int>(stats.max_waiting_writers)));
+
+  std::vector<uint32_t> all_latencies_ns;
+  for (const auto& thread_latencies : latencies_ns) {
+    all_latencies_ns.insert(all_latencies_ns.end(), thread_latencies.begin(),
+                            thread_latencies.end());
+  }
+  printLatency(output, name + "_latency", num_threads, all_latencies_ns);
+}
+
+/**
+ * Per-sample cost of batch writes (batch_size 0: one writeData()/Write() call per sample), without
+ * file I/O: the serialized data is discarded.
+ */
+void benchBatch(const Options& options, Output& output, int batch_size)
+{
+  const int num_samples = options.samples_per_thread;
+  std::vector<BenchSample> samples;
+  for (int i = 0; i < num_samples; ++i) {
+    samples.push_back(makeSample(i * 1000, i));
+  }
+  uint64_t bytes = 0;
+  const auto discard = [&bytes](const uint8_t* /*data*/, int length) { bytes += length; };
+
+  const auto print = [&](const char* writer, double seconds) {
+    output.print(JsonLine("write_batch")
+                     .add("writer", writer)
+                     .add("batch_size", batch_size)
+                     .add("samples", static_cast<uint64_t>(num_samples))
+                     .add("bytes", bytes)
+                     .add("ns_per_sample", seconds * 1e9 / num_samples));
+  };
+
+  {
+    ulog_cpp::SimpleWriter writer(discard, 0);
+    writeHeader(writer);
+    const uint16_t msg_id = writer.writeAddLoggedMessage(BenchSample::messageName());
+    bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    if (batch_size == 0) {
+      for (const auto& sample : samples) {
+        writer.writeData(msg_id, sample);
+      }
+    } else {
+      for (int i = 0; i < num_samples; i += batch_size) {
+        writer.writeDataBatch(msg_id, samples.data() + i, std::min(batch_size, num_samples - i));
+      }
+    }
+    print("simple_writer", secondsSince(start));
+  }
+  {
+    zz_data_log logger(discard, 0);
+    InitParams init_params;
+    init_params.key = "sys_name";
+    init_params.key_value = "ulog_bench";
+    init_params.all_structs.push_back({BenchSample::messageName(), BenchSample::fields()});
+    logger.Init(init_params);
+    bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    if (batch_size == 0) {
+      for (const auto& sample : samples) {
+        logger.Write(sample);
+      }
+    } else {
+      for (int i = 0; i < num_samples; i += batch_size) {
+        logger.WriteBatch(samples.data() + i, std::min(batch_size, num_samples - i));
+      }
+    }
+    print("zz_data_log", secondsSince(start));
+  }
+}
+
+/**
+ * Text messages: formatted with snprintf and written with writeTextMessage(), versus deferred
+ * formatting with writeDeferredText()
+ */
+void benchText(const Options& options, Output& output)
+{
+  const int num_messages = options.samples_per_thread;
+  uint64_t bytes = 0;
+  const auto discard = [&bytes](const uint8_t* /*data*/, int length) { bytes += length; };
+  const auto print = [&](const char* mode, double seconds) {
+    output.print(JsonLine("write_text")
+                     .add("mode", mode)
+                     .add("messages", static_cast<uint64_t>(num_messages))
+                     .add("bytes", bytes)
+                     .add("ns_per_message", seconds * 1e9 / num_messages));
+  };
+  const char* format = "sensor %i: value %.3f out of range [%.1f, %.1f], state %s";
+
+  {
+    ulog_cpp::SimpleWriter writer(discard, 0);
+    writer.headerComplete();
+    bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    char buffer[256];
+    for (int i = 0; i < num_messages; ++i) {
+      snprintf(buffer, sizeof(buffer), format, i % 8, 0.001 * i, -1., 1., "active");
+      writer.writeTextMessage(ulog_cpp::Logging::Level::Warning, buffer, i);
+    }
+    print("formatted", secondsSince(start));
+  }
+  {
+    ulog_cpp::SimpleWriter writer(discard, 0);
+    writer.headerComplete();
+    const auto text_format = writer.registerTextFormat<int, double, double, double, const char*>(
+        ulog_cpp::Logging::Level::Warning, format);
+    bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_messages; ++i) {
+      writer.writeDeferredText(text_format, i, i % 8, 0.001 * i, -1., 1., "active");
+    }
+    print("deferred", secondsSince(start));
+  }
+}
+
+/**
+ * Sustained write throughput of a FileSink, with message-sized writes and an fsync every 16MB.
+ * The latency is the time the producer is blocked in write() or sync().
+ */
+void benchFileSink(const Options& options, Output& output, ulog_cpp::FileSinkType type)
+{
+  const std::string filename = options.tmp_dir + "/ulog_bench_sink.ulg";
+  static constexpr int kChunkSize = 100;
+  static constexpr uint64_t kSyncInterval = 16 * 1024 * 1024;
+  const uint64_t num_chunks = options.sink_size_mb * 1024 * 1024 / kChunkSize;
+  std::vector<uint8_t> chunk(kChunkSize);
+  for (int i = 0; i < kChunkSize; ++i) {
+    chunk[i] = static_cast<uint8_t>(i);
+  }
+  std::vector<uint32_t> latencies_ns;
+  latencies_ns.reserve(num_chunks);
+
+  ulog_cpp::FileSinkConfig config;
+  config.type = type;
+  const auto start = std::chrono::steady_clock::now();
+  ulog_cpp::FileSinkType used_type;
+  {
+    auto sink = ulog_cpp::createFileSink(filename, config);
+    used_type = sink->type();
+    uint64_t bytes_since_sync = 0;
+    for (uint64_t i = 0; i < num_chunks; ++i) {
+      const auto write_start = std::chrono::steady_clock::now();
+      sink->write(chunk.data(), kChunkSize);
+      bytes_since_sync += kChunkSize;
+      if (bytes_since_sync >= kSyncInterval) {
+        bytes_since_sync = 0;
+        sink->sync();
+      }
+      latencies_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - write_start)
+                                 .count());
+    }
+    sink->sync();
+  }  // includes waiting for outstanding writes
+  const double seconds = secondsSince(start);
+  const uint64_t bytes = fileSize(filename);
+  remove(filename.c_str());
+
+  const std::string name = std::string("write_sink_") + ulog_cpp::fileSinkTypeName(type);
+  output.print(JsonLine(name)
+                   .add("used_sink", ulog_cpp::fileSinkTypeName(used_type))
+                   .add("bytes", bytes)
+                   .add("seconds", seconds)
+                   .add("mb_per_s", mbPerSecond(bytes, seconds)));
+  printLatency(output, name + "_latency", 1, latencies_ns);
+}
+
+/**
+ * 1, 2, 4, ... up to (and including) max_threads
+ */
+std::vector<int> threadCounts(int max_threads)
+{
+  std::vector<int> counts;
+  for (int num_threads = 1; num_threads < max_threads; num_threads *= 2) {
+    counts.push_back(num_threads);
+  }
+  counts.push_back(max_threads);
+  return counts;
+}
+
+std::vector<std::string> listLogFiles(const std::string& directory)
+{
+  std::vector<std::string> files;
+  DIR* dir = opendir(directory.c_str());
+  if (!dir) {
+    return files;
+  }
+  while (const dirent* entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name.size() > 4 && name.substr(name.size() - 4) == ".ulg") {
+      files.push_back(directory + "/" + name);
+    }
+  }
+  closedir(dir);
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+void printUsage(const char* name)
+{
+  printf("Usage: %s [options]\n", name);
+  printf("  --log-dir <dir>       directory with .ulg files to parse (default: test/log_files)\n");
+  printf("  --tmp-dir <dir>       directory for generated and written files (default: /tmp)\n");
+  printf("  --size-mb <n>         size of the generated log, 0 to skip (default: 256)\n");
+  printf("  --workload <file>     workload spec for the generated log (see ulog_generate)\n");
+  printf("  --sink-mb <n>         data written per file sink type, 0 to skip (default: 512)\n");
+  printf("  --threads <n>         maximum number of writer threads (default: 4)\n");
+  printf("  --samples <n>         samples written per thread (default: 100000)\n");
+  printf("  --repetitions <n>     parse repetitions, the fastest is reported (default: 3)\n");
+  printf("  --output <file>       write the JSON lines to a file instead of stdout\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      printUsage(argv[0]);
+      return arg == "-h" || arg == "--help" ? 0 : -1;
+    }
+    const std::string value = argv[++i];
+    if (arg == "--log-dir") {
+      options.log_dir = value;
+    } else if (arg == "--tmp-dir") {
+      options.tmp_dir = value;
+    } else if (arg == "--size-mb") {
+      options.generated_size_mb = std::stoull(value);
+    } else if (arg == "--sink-mb") {
+      options.sink_size_mb = std::stoull(value);
+    } else if (arg == "--workload") {
+      options.workload = value;
+    } else if (arg == "--threads") {
+      options.max_threads = std::max(1, std::stoi(value));
+    } else if (arg == "--samples") {
+      options.samples_per_thread = std::max(1, std::stoi(value));
+    } else if (arg == "--repetitions") {
+      options.repetitions = std::max(1, std::stoi(value));
+    } else if (arg == "--output") {
+      options.output = value;
+    } else {
+      printUsage(argv[0]);
+      return -1;
+    }
+  }
+
+  Output output(options.output);
+
+  for (const auto& filename : listLogFiles(options.log_dir)) {
+    benchParse(options, output, filename, true);
+  }
+
+  if (options.generated_size_mb > 0 || !options.workload.empty()) {
+    const std::string generated = generateLog(options);
+    // Keeping a multi-GB log in a DataContainer would mostly measure memory allocation
+    benchParse(options, output, generated, fileSize(generated) <= 512 * 1024 * 1024);
+    remove(generated.c_str());
+  }
+
+  if (options.sink_size_mb > 0) {
+    for (const auto type : {ulog_cpp::FileSinkType::Stdio, ulog_cpp::FileSinkType::IoUring,
+                            ulog_cpp::FileSinkType::Direct, ulog_cpp::FileSinkType::Mmap}) {
+      benchFileSink(options, output, type);
+    }
+  }
+
+  for (int num_threads : threadCounts(options.max_threads)) {
+    benchSimpleWriter(options, output, num_threads);
+  }
+  for (int batch_size : {0, 1, 8, 64, 512}) {
+    benchBatch(options, output, batch_size);
+  }
+  benchText(options, output);
+  for (int num_threads : threadCounts(options.max_threads)) {
+    benchZzDataLog(options, output, num_threads, false);
+    benchZzDataLog(options, output, num_threads, true);
+    benchZzDataLog(options, output, num_threads, false, ulog_cpp::FileSinkType::IoUring);
+    benchZzDataLog(options, output, num_threads, false, ulog_cpp::FileSinkType::Direct);
+    benchZzDataLog(options, output, num_threads, false, ulog_cpp::FileSinkType::Mmap);
+  }
+  return 0;
+}
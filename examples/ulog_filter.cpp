@@ -0,0 +1,121 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <ulog_cpp/basic_reader.hpp>
+#include <ulog_cpp/log_filter.hpp>
+#include <vector>
+
+// Copies a log with a subset of the topics, a time range and/or without text messages. Messages
+// are copied without decoding them.
+
+namespace {
+
+std::vector<std::string> splitList(const std::string& list)
+{
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+void printUsage(const char* name)
+{
+  printf("Usage: %s [options] <input.ulg> <output.ulg>\n", name);
+  printf(" --topics a,b,c    only keep these topics\n");
+  printf(" --exclude a,b,c   drop these topics\n");
+  printf(" --start-us T      drop data and text messages before timestamp T [us]\n");
+  printf(" --end-us T        drop data and text messages after timestamp T [us]\n");
+  printf(" --no-text         drop text messages\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  ulog_cpp::LogFilterConfig config;
+  std::vector<const char*> filenames;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--topics" && has_value) {
+      config.topics = splitList(argv[++i]);
+    } else if (arg == "--exclude" && has_value) {
+      config.exclude_topics = splitList(argv[++i]);
+    } else if (arg == "--start-us" && has_value) {
+      config.start_timestamp = std::stoull(argv[++i]);
+    } else if (arg == "--end-us" && has_value) {
+      config.end_timestamp = std::stoull(argv[++i]);
+    } else if (arg == "--no-text") {
+      config.drop_text = true;
+    } else if (arg.rfind("--", 0) == 0) {
+      printUsage(argv[0]);
+      return -1;
+    } else {
+      filenames.push_back(argv[i]);
+    }
+  }
+  if (filenames.size() != 2) {
+    printUsage(argv[0]);
+    return -1;
+  }
+
+  FILE* input = fopen(filenames[0], "rb");
+  if (!input) {
+    printf("opening %s failed\n", filenames[0]);
+    return -1;
+  }
+  FILE* output = fopen(filenames[1], "wb");
+  if (!output) {
+    printf("opening %s failed\n", filenames[1]);
+    fclose(input);
+    return -1;
+  }
+  std::vector<char> output_buffer(1024 * 1024);
+  setvbuf(output, output_buffer.data(), _IOFBF, output_buffer.size());
+
+  ulog_cpp::LogFilter filter(
+      [output](const uint8_t* data, int length) { fwrite(data, 1, length, output); }, config);
+  ulog_cpp::BasicReader<ulog_cpp::LogFilter> reader{filter};
+  reader.setRawMode(true);
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<uint8_t> buffer(1024 * 1024);
+  uint64_t bytes_in = 0;
+  size_t bytes_read;
+  while ((bytes_read = fread(buffer.data(), 1, buffer.size(), input)) > 0) {
+    reader.readChunk(buffer.data(), bytes_read);
+    bytes_in += bytes_read;
+  }
+  fclose(input);
+  const bool write_failed = ferror(output) != 0;
+  fclose(output);
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  for (const auto& error : filter.errors()) {
+    printf("Parsing error: %s\n", error.c_str());
+  }
+  if (write_failed) {
+    printf("writing %s failed\n", filenames[1]);
+    return -1;
+  }
+  const ulog_cpp::LogFilterStats& stats = filter.stats();
+  printf("Messages: %llu of %llu kept\n", static_cast<unsigned long long>(stats.messages_out),
+         static_cast<unsigned long long>(stats.messages_in));
+  printf("Size: %llu -> %llu bytes (%.1f MB/s)\n", static_cast<unsigned long long>(bytes_in),
+         static_cast<unsigned long long>(stats.bytes_out),
+         seconds > 0. ? static_cast<double>(bytes_in) / seconds / 1e6 : 0.);
+  return 0;
+}
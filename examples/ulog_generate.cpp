@@ -0,0 +1,61 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <ulog_cpp/workload_generator.hpp>
+
+// Example spec (see WorkloadSpec::parse() for all settings):
+//   seed 42
+//   duration 600
+//   max_size_mb 2048
+//   topic vehicle_attitude 250 float[4]:q float:rollspeed float:pitchspeed float:yawspeed
+//   random_topics 1000 1 100 2 20
+//   dropout 0.0001 50
+//   corruption 0.00001 bitflip,garbage,truncate
+
+int main(int argc, char** argv)
+{
+  if (argc < 3) {
+    printf("Usage: %s <workload_spec.txt|-> <output.ulg>\n", argv[0]);
+    return -1;
+  }
+  ulog_cpp::WorkloadSpec spec;
+  try {
+    if (std::string(argv[1]) == "-") {
+      spec = ulog_cpp::WorkloadSpec::parse(std::cin);
+    } else {
+      std::ifstream spec_file(argv[1]);
+      if (!spec_file) {
+        printf("opening spec file failed\n");
+        return -1;
+      }
+      spec = ulog_cpp::WorkloadSpec::parse(spec_file);
+    }
+  } catch (const ulog_cpp::UsageException& error) {
+    printf("%s\n", error.what());
+    return -1;
+  }
+
+  FILE* file = fopen(argv[2], "wb");
+  if (!file) {
+    printf("opening output file failed\n");
+    return -1;
+  }
+  const ulog_cpp::WorkloadGenerator generator(spec);
+  const ulog_cpp::WorkloadStats stats = generator.generate(
+      [file](const uint8_t* data, int length) { fwrite(data, 1, length, file); });
+  fclose(file);
+
+  printf("Topics: %zu\n", spec.topics.size());
+  printf("Bytes: %llu\n", static_cast<unsigned long long>(stats.num_bytes));
+  printf("Samples: %llu\n", static_cast<unsigned long long>(stats.num_samples));
+  printf("Logging messages: %llu\n", static_cast<unsigned long long>(stats.num_logging));
+  printf("Dropouts: %llu\n", static_cast<unsigned long long>(stats.num_dropouts));
+  printf("Corrupted messages: %llu\n", static_cast<unsigned long long>(stats.num_corruptions));
+  return 0;
+}
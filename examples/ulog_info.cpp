@@ -4,6 +4,7 @@
  ****************************************************************************/
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <numeric>
@@ -11,14 +12,49 @@
 #include <ulog_cpp/data_container.hpp>
 #include <ulog_cpp/reader.hpp>
 #include <variant>
+#include <vector>
+
+namespace {
+
+// Size of the trailing section read in header mode
+constexpr long kTailSize = 64 * 1024;
+
+/**
+ * Header mode: keeps the definitions, and the last timestamp and text messages of the tail
+ */
+class HeaderContainer : public ulog_cpp::DataContainer {
+ public:
+  HeaderContainer() : DataContainer(StorageConfig::Header) {}
+
+  void data(const ulog_cpp::Data& data) override
+  {
+    uint64_t timestamp;
+    if (data.data().size() >= sizeof(timestamp)) {
+      memcpy(&timestamp, data.data().data(), sizeof(timestamp));
+      last_timestamp = std::max(last_timestamp, timestamp);
+    }
+  }
+  void logging(ulog_cpp::Logging&& logging) override
+  {
+    last_timestamp = std::max(last_timestamp, logging.timestamp());
+    tail_logging.push_back(std::move(logging));
+  }
+
+  uint64_t last_timestamp{0};
+  std::vector<ulog_cpp::Logging> tail_logging;
+};
+
+}  // namespace
 
 int main(int argc, char** argv)
 {
-  if (argc < 2) {
-    printf("Usage: %s <file.ulg>\n", argv[0]);
+  const bool header_mode = argc == 3 && std::string(argv[1]) == "--header";
+  if (argc < 2 || (argc == 3 && !header_mode) || argc > 3) {
+    printf("Usage: %s [--header] <file.ulg>\n", argv[0]);
+    printf(" --header: only read the definitions section and the end of the file\n");
     return -1;
   }
-  FILE* file = fopen(argv[1], "rb");
+  FILE* file = fopen(argv[argc - 1], "rb");
   if (!file) {
     printf("opening file failed\n");
     return -1;
@@ -26,14 +62,32 @@ int main(int argc, char** argv)
   uint8_t buffer[4048];
   int bytes_read;
   // 创建一个DataContainer对象，用于存储从ULog文件解析的数据。
-  const auto data_container =
-      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  std::shared_ptr<HeaderContainer> header_container;
+  std::shared_ptr<ulog_cpp::DataContainer> data_container;
+  if (header_mode) {
+    header_container = std::make_shared<HeaderContainer>();
+    data_container = header_container;
+  } else {
+    data_container =
+        std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  }
   // 创建一个Reader对象，并从输入文件中读取数据块到缓冲区。
   ulog_cpp::Reader reader{data_container};
+  reader.setStopAfterHeader(header_mode);
   // 将每个数据块传递给Reader进行解析
-  while ((bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+  while (!reader.stopped() && (bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
     reader.readChunk(buffer, bytes_read);
   }
+  if (reader.stopped()) {
+    fseek(file, 0, SEEK_END);
+    const long file_size = ftell(file);
+    const long tail_start = std::max<long>(reader.dataSectionOffset(), file_size - kTailSize);
+    std::vector<uint8_t> tail(file_size - tail_start);
+    fseek(file, tail_start, SEEK_SET);
+    if (fread(tail.data(), 1, tail.size(), file) == tail.size()) {
+      reader.readTail(tail.data(), tail.size(), tail_start);
+    }
+  }
   fclose(file);
   // 在读取完所有数据后，检查是否有解析错误，并打印错误信息（如果有）。
   // Check for errors
@@ -57,6 +111,13 @@ int main(int argc, char** argv)
       dropouts.begin(), dropouts.end(), 0,
       [](int sum, const ulog_cpp::Dropout& curr) { return sum + curr.durationMs(); });
   printf("Dropouts: %zu, total duration: %i ms\n", dropouts.size(), total_dropouts_ms);
+  if (header_container) {
+    const uint64_t start_timestamp = data_container->fileHeader().header().timestamp;
+    printf("Last timestamp: %lu (duration %.1f s)\n", header_container->last_timestamp,
+           header_container->last_timestamp > start_timestamp
+               ? (header_container->last_timestamp - start_timestamp) * 1e-6
+               : 0.);
+  }
 
   auto print_value = [](const std::string& name, const ulog_cpp::Value& value) {
     if (const auto* const str_ptr(std::get_if<std::string>(&value.data())); str_ptr) {
@@ -130,6 +191,17 @@ int main(int argc, char** argv)
     printf(" %s<%s> %lu %s\n", tag_str.c_str(), logging.logLevelStr().c_str(), logging.timestamp(),
            logging.message().c_str());
   }
+  if (header_container) {
+    for (const auto& logging : header_container->tail_logging) {
+      printf(" <%s> %lu %s\n", logging.logLevelStr().c_str(), logging.timestamp(),
+             logging.message().c_str());
+    }
+  }
+  for (const auto& deferred : data_container->deferredLogging()) {
+    const ulog_cpp::Logging logging = data_container->deferredFormatter().expand(deferred);
+    printf(" <%s> %lu %s\n", logging.logLevelStr().c_str(), logging.timestamp(),
+           logging.message().c_str());
+  }
 
 // 打印关于默认参数和初始参数的信息。
   // Params (init, after, defaults)
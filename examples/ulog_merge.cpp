@@ -0,0 +1,90 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <ulog_cpp/exception.hpp>
+#include <ulog_cpp/log_merger.hpp>
+#include <vector>
+
+// Merges the logs of several processes into one log, ordered by time.
+
+namespace {
+
+void printUsage(const char* name)
+{
+  printf("Usage: %s [options] -o <output.ulg> <input.ulg>...\n", name);
+  printf(" --read-ahead-mb N   data buffered per input [MB] (default 4)\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  ulog_cpp::LogMergerConfig config;
+  const char* output_filename = nullptr;
+  std::vector<std::string> filenames;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "-o" && has_value) {
+      output_filename = argv[++i];
+    } else if (arg == "--read-ahead-mb" && has_value) {
+      config.read_ahead_bytes = std::stoul(argv[++i]) * 1024 * 1024;
+    } else if (arg.rfind("-", 0) == 0) {
+      printUsage(argv[0]);
+      return -1;
+    } else {
+      filenames.push_back(arg);
+    }
+  }
+  if (!output_filename || filenames.empty()) {
+    printUsage(argv[0]);
+    return -1;
+  }
+
+  FILE* output = fopen(output_filename, "wb");
+  if (!output) {
+    printf("opening %s failed\n", output_filename);
+    return -1;
+  }
+  std::vector<char> output_buffer(1024 * 1024);
+  setvbuf(output, output_buffer.data(), _IOFBF, output_buffer.size());
+
+  const auto start = std::chrono::steady_clock::now();
+  ulog_cpp::LogMerger merger(filenames, config);
+  try {
+    merger.merge([output](const uint8_t* data, int length) { fwrite(data, 1, length, output); });
+  } catch (const ulog_cpp::ExceptionBase& exception) {
+    printf("Merging failed: %s\n", exception.what());
+    fclose(output);
+    remove(output_filename);
+    return -1;
+  }
+  const bool write_failed = ferror(output) != 0;
+  fclose(output);
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  for (const auto& error : merger.errors()) {
+    printf("Parsing error: %s\n", error.c_str());
+  }
+  if (write_failed) {
+    printf("writing %s failed\n", output_filename);
+    return -1;
+  }
+  const ulog_cpp::LogMergerStats& stats = merger.stats();
+  printf("Merged %zu logs: %u subscriptions, %llu messages, %llu bytes (%.1f MB/s)\n",
+         filenames.size(), stats.subscriptions,
+         static_cast<unsigned long long>(stats.messages_out),
+         static_cast<unsigned long long>(stats.bytes_out),
+         seconds > 0. ? static_cast<double>(stats.bytes_out) / seconds / 1e6 : 0.);
+  if (stats.dropped_data > 0) {
+    printf("Dropped %llu data messages of unknown subscriptions\n",
+           static_cast<unsigned long long>(stats.dropped_data));
+  }
+  return 0;
+}
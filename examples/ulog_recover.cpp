@@ -0,0 +1,52 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <ulog_cpp/exception.hpp>
+#include <ulog_cpp/log_recovery.hpp>
+
+// Finalizes a log that was not closed properly (e.g. the logging process crashed): truncates it
+// after the last complete message.
+
+int main(int argc, char** argv)
+{
+  bool dry_run = false;
+  const char* filename = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--dry-run") == 0) {
+      dry_run = true;
+    } else {
+      filename = argv[i];
+    }
+  }
+  if (!filename) {
+    printf("Usage: %s [--dry-run] <file.ulg>\n", argv[0]);
+    return -1;
+  }
+
+  ulog_cpp::RecoveryResult result;
+  try {
+    result = ulog_cpp::recoverLog(filename, !dry_run);
+  } catch (const ulog_cpp::ExceptionBase& exception) {
+    printf("Recovery failed: %s\n", exception.what());
+    return -1;
+  }
+
+  printf("File size: %llu bytes\n", static_cast<unsigned long long>(result.file_size));
+  if (result.commit_marker) {
+    printf("Commit marker: %llu bytes\n", static_cast<unsigned long long>(result.committed_size));
+  } else {
+    printf("Commit marker: none\n");
+  }
+  printf("Complete messages: %llu\n", static_cast<unsigned long long>(result.num_messages));
+  printf("Valid size: %llu bytes\n", static_cast<unsigned long long>(result.valid_size));
+  if (result.valid_size < result.file_size) {
+    printf("%s %llu bytes\n", dry_run ? "Would remove" : "Removed",
+           static_cast<unsigned long long>(result.file_size - result.valid_size));
+  }
+  return 0;
+}
@@ -0,0 +1,162 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <ulog_cpp/basic_reader.hpp>
+#include <unordered_map>
+#include <vector>
+
+// Prints which topics and message types take up the space in a log. The log is streamed, only the
+// topic names are kept in memory, so this also works for very large files.
+
+namespace {
+
+class TopicNameHandler final : public ulog_cpp::DataHandlerInterface {
+ public:
+  void error(const std::string& msg, bool is_recoverable) override
+  {
+    if (!is_recoverable || errors.empty()) {
+      errors.push_back(msg);
+    }
+  }
+  void addLoggedMessage(const ulog_cpp::AddLoggedMessage& add_logged_message) override
+  {
+    names[add_logged_message.msgId()] = add_logged_message.messageName() + "(" +
+                                         std::to_string(add_logged_message.multiId()) + ")";
+  }
+
+  std::unordered_map<uint16_t, std::string> names;
+  std::vector<std::string> errors;
+};
+
+const char* messageTypeName(uint8_t type)
+{
+  switch (static_cast<ulog_cpp::ULogMessageType>(type)) {
+    case ulog_cpp::ULogMessageType::FORMAT:
+      return "FORMAT";
+    case ulog_cpp::ULogMessageType::DATA:
+      return "DATA";
+    case ulog_cpp::ULogMessageType::INFO:
+      return "INFO";
+    case ulog_cpp::ULogMessageType::INFO_MULTIPLE:
+      return "INFO_MULTIPLE";
+    case ulog_cpp::ULogMessageType::PARAMETER:
+      return "PARAMETER";
+    case ulog_cpp::ULogMessageType::PARAMETER_DEFAULT:
+      return "PARAMETER_DEFAULT";
+    case ulog_cpp::ULogMessageType::ADD_LOGGED_MSG:
+      return "ADD_LOGGED_MSG";
+    case ulog_cpp::ULogMessageType::REMOVE_LOGGED_MSG:
+      return "REMOVE_LOGGED_MSG";
+    case ulog_cpp::ULogMessageType::SYNC:
+      return "SYNC";
+    case ulog_cpp::ULogMessageType::DROPOUT:
+      return "DROPOUT";
+    case ulog_cpp::ULogMessageType::LOGGING:
+      return "LOGGING";
+    case ulog_cpp::ULogMessageType::LOGGING_TAGGED:
+      return "LOGGING_TAGGED";
+    case ulog_cpp::ULogMessageType::LOGGING_DEFERRED:
+      return "LOGGING_DEFERRED";
+    case ulog_cpp::ULogMessageType::FLAG_BITS:
+      return "FLAG_BITS";
+    case ulog_cpp::ULogMessageType::DATA_ENCODED:
+      return "DATA_ENCODED";
+  }
+  return "unknown";
+}
+
+double percent(uint64_t value, uint64_t total)
+{
+  return total > 0 ? 100. * static_cast<double>(value) / static_cast<double>(total) : 0.;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    printf("Usage: %s <file.ulg> [max_topics]\n", argv[0]);
+    return -1;
+  }
+  const size_t max_topics = argc > 2 ? std::stoul(argv[2]) : 50;
+  FILE* file = fopen(argv[1], "rb");
+  if (!file) {
+    printf("opening file failed\n");
+    return -1;
+  }
+  TopicNameHandler handler;
+  ulog_cpp::BasicReader<TopicNameHandler> reader{handler};
+  reader.enableStats();
+  std::vector<uint8_t> buffer(64 * 1024);
+  uint64_t file_size = 0;
+  size_t bytes_read;
+  while ((bytes_read = fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+    reader.readChunk(buffer.data(), bytes_read);
+    file_size += bytes_read;
+  }
+  fclose(file);
+
+  for (const auto& error : handler.errors) {
+    printf("Parsing error: %s\n", error.c_str());
+  }
+
+  const ulog_cpp::ReaderStats& stats = reader.stats();
+  printf("File size: %llu bytes\n", static_cast<unsigned long long>(file_size));
+  printf("File header: %llu bytes\n", static_cast<unsigned long long>(stats.file_header_bytes));
+  printf("Discarded (corrupt): %llu bytes, %llu recovery events\n",
+         static_cast<unsigned long long>(stats.discarded_bytes),
+         static_cast<unsigned long long>(stats.recovery_events));
+  printf("Largest message: %u bytes\n", stats.largest_message);
+
+  // Message types, sorted by size
+  std::vector<int> types;
+  for (int type = 0; type < static_cast<int>(stats.per_type.size()); ++type) {
+    if (stats.per_type[type].messages > 0) {
+      types.push_back(type);
+    }
+  }
+  std::sort(types.begin(), types.end(),
+            [&stats](int a, int b) { return stats.per_type[a].bytes > stats.per_type[b].bytes; });
+  printf("\nMessage types:\n");
+  printf("  %-20s %12s %14s %7s\n", "type", "messages", "bytes", "%");
+  for (int type : types) {
+    const auto& counter = stats.per_type[type];
+    printf("  %-20s %12llu %14llu %6.2f%%\n", messageTypeName(type),
+           static_cast<unsigned long long>(counter.messages),
+           static_cast<unsigned long long>(counter.bytes), percent(counter.bytes, file_size));
+  }
+
+  // Topics, sorted by size
+  std::vector<uint16_t> msg_ids;
+  for (size_t msg_id = 0; msg_id < stats.per_msg_id.size(); ++msg_id) {
+    if (stats.per_msg_id[msg_id].messages > 0) {
+      msg_ids.push_back(msg_id);
+    }
+  }
+  std::sort(msg_ids.begin(), msg_ids.end(), [&stats](uint16_t a, uint16_t b) {
+    return stats.per_msg_id[a].bytes > stats.per_msg_id[b].bytes;
+  });
+  printf("\nTopics (%zu):\n", msg_ids.size());
+  printf("  %-40s %6s %12s %14s %9s %7s\n", "topic", "msg_id", "messages", "bytes", "avg size",
+         "%");
+  for (size_t i = 0; i < msg_ids.size() && i < max_topics; ++i) {
+    const uint16_t msg_id = msg_ids[i];
+    const auto& counter = stats.per_msg_id[msg_id];
+    const auto name_iter = handler.names.find(msg_id);
+    const std::string name = name_iter == handler.names.end() ? "<unknown>" : name_iter->second;
+    printf("  %-40s %6u %12llu %14llu %9.1f %6.2f%%\n", name.c_str(), msg_id,
+           static_cast<unsigned long long>(counter.messages),
+           static_cast<unsigned long long>(counter.bytes),
+           static_cast<double>(counter.bytes) / static_cast<double>(counter.messages),
+           percent(counter.bytes, file_size));
+  }
+  if (msg_ids.size() > max_topics) {
+    printf("  ... %zu more\n", msg_ids.size() - max_topics);
+  }
+  return 0;
+}
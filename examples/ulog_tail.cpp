@@ -0,0 +1,153 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <ulog_cpp/deferred_logging.hpp>
+#include <ulog_cpp/exception.hpp>
+#include <ulog_cpp/log_follower.hpp>
+#include <ulog_cpp/socket_stream.hpp>
+
+// Follows a log while it is being written (including zz_data_log rotation), or receives a live log
+// from a SocketSink, and prints subscriptions and text messages as they arrive.
+
+namespace {
+
+ulog_cpp::LogFollower* g_follower = nullptr;
+ulog_cpp::SocketReceiver* g_receiver = nullptr;
+volatile std::sig_atomic_t g_stop = 0;
+
+void handleSignal(int /*signal*/)
+{
+  g_stop = 1;
+  if (g_follower) {
+    g_follower->interrupt();
+  }
+  if (g_receiver) {
+    g_receiver->interrupt();
+  }
+}
+
+class TailPrinter : public ulog_cpp::DataHandlerInterface {
+ public:
+  void messageInfo(const ulog_cpp::MessageInfo& message_info) override
+  {
+    _formatter.addFormat(message_info);
+  }
+  void addLoggedMessage(const ulog_cpp::AddLoggedMessage& add_logged_message) override
+  {
+    printf("+ %s (%i)\n", add_logged_message.messageName().c_str(),
+           add_logged_message.multiId());
+  }
+  void logging(const ulog_cpp::Logging& logging) override { print(logging); }
+  void deferredLogging(const ulog_cpp::DeferredLogging& logging) override
+  {
+    print(_formatter.expand(logging));
+  }
+  void data(const ulog_cpp::Data& data) override { ++_num_samples; }
+  void error(const std::string& msg, bool is_recoverable) override
+  {
+    printf("Parsing error: %s\n", msg.c_str());
+  }
+
+  uint64_t numSamples() const { return _num_samples; }
+
+ private:
+  void print(const ulog_cpp::Logging& logging)
+  {
+    printf("[%.6f] %s: %s\n", static_cast<double>(logging.timestamp()) / 1e6,
+           logging.logLevelStr().c_str(), logging.message().c_str());
+  }
+
+  ulog_cpp::DeferredFormatter _formatter;
+  uint64_t _num_samples{0};
+};
+
+int followFile(const char* filename, bool exit_on_close,
+               const std::shared_ptr<TailPrinter>& printer)
+{
+  ulog_cpp::LogFollower follower(filename, printer);
+  g_follower = &follower;
+  uint32_t segment = 0;
+  while (!g_stop) {
+    follower.poll(std::chrono::seconds(1));
+    if (follower.segment() != segment) {
+      segment = follower.segment();
+      printf("--- %s\n", follower.filename().c_str());
+    }
+    fflush(stdout);
+    if (exit_on_close && follower.closed()) {
+      break;
+    }
+  }
+  g_follower = nullptr;
+  printf("%llu bytes, %llu samples\n", static_cast<unsigned long long>(follower.bytesRead()),
+         static_cast<unsigned long long>(printer->numSamples()));
+  return 0;
+}
+
+int receiveStream(const char* path, bool exit_on_close,
+                  const std::shared_ptr<TailPrinter>& printer)
+{
+  ulog_cpp::SocketReceiver receiver(path, printer);
+  g_receiver = &receiver;
+  uint32_t connections = 0;
+  while (!g_stop) {
+    receiver.poll(std::chrono::seconds(1));
+    if (receiver.connections() != connections) {
+      connections = receiver.connections();
+      printf("--- connection %u\n", connections);
+    }
+    fflush(stdout);
+    if (exit_on_close && connections > 0 && !receiver.connected()) {
+      break;
+    }
+  }
+  g_receiver = nullptr;
+  printf("%llu bytes, %llu samples\n", static_cast<unsigned long long>(receiver.bytesRead()),
+         static_cast<unsigned long long>(printer->numSamples()));
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  bool exit_on_close = false;
+  bool socket = false;
+  const char* filename = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--exit-on-close") {
+      exit_on_close = true;
+    } else if (arg == "--socket") {
+      socket = true;
+    } else if (!filename && arg.rfind("-", 0) != 0) {
+      filename = argv[i];
+    } else {
+      filename = nullptr;
+      break;
+    }
+  }
+  if (!filename) {
+    printf("Usage: %s [--exit-on-close] <file.ulg>\n", argv[0]);
+    printf("       %s --socket [--exit-on-close] <socket path>  (receive from a SocketSink)\n",
+           argv[0]);
+    return -1;
+  }
+
+  signal(SIGINT, handleSignal);
+  signal(SIGTERM, handleSignal);
+  const auto printer = std::make_shared<TailPrinter>();
+  try {
+    return socket ? receiveStream(filename, exit_on_close, printer)
+                  : followFile(filename, exit_on_close, printer);
+  } catch (const ulog_cpp::ExceptionBase& exception) {
+    printf("Following failed: %s\n", exception.what());
+    return -1;
+  }
+}
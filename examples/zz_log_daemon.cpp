@@ -0,0 +1,89 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <ulog_cpp/exception.hpp>
+#include <ulog_cpp/shm_log_daemon.hpp>
+
+// Logging daemon: writes the logs of all processes using zz_data_log in shared memory mode
+// (zz_data_log::CreateShmInstance()) into one file, until interrupted.
+
+namespace {
+
+std::atomic<bool> g_stop{false};
+
+void handleSignal(int /*signal*/)
+{
+  g_stop.store(true);
+}
+
+void printUsage(const char* name)
+{
+  printf("Usage: %s [options] -o <output.ulg>\n", name);
+  printf(" --name NAME          shared memory name (default /zz_data_log)\n");
+  printf(" --max-producers N    (default 64)\n");
+  printf(" --poll-ms N          read interval [ms] (default 10)\n");
+  printf(" --startup-ms N       wait for producers before writing the first file [ms] "
+         "(default 200)\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  ulog_cpp::ShmTransportConfig transport_config;
+  ulog_cpp::ShmLogDaemon::Config config;
+  config.filename.clear();
+  int poll_ms = 10;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "-o" && has_value) {
+      config.filename = argv[++i];
+    } else if (arg == "--name" && has_value) {
+      transport_config.name = argv[++i];
+    } else if (arg == "--max-producers" && has_value) {
+      transport_config.max_producers = std::stoul(argv[++i]);
+    } else if (arg == "--poll-ms" && has_value) {
+      poll_ms = std::stoi(argv[++i]);
+    } else if (arg == "--startup-ms" && has_value) {
+      config.startup_wait_ms = std::stoul(argv[++i]);
+    } else {
+      printUsage(argv[0]);
+      return -1;
+    }
+  }
+  if (config.filename.empty()) {
+    printUsage(argv[0]);
+    return -1;
+  }
+
+  signal(SIGINT, handleSignal);
+  signal(SIGTERM, handleSignal);
+  try {
+    ulog_cpp::ShmLogDaemon daemon(transport_config, config);
+    printf("Waiting for producers on %s\n", transport_config.name.c_str());
+    daemon.run(g_stop, std::chrono::milliseconds(poll_ms));
+
+    for (const auto& error : daemon.errors()) {
+      printf("Error: %s\n", error.c_str());
+    }
+    const ulog_cpp::ShmLogDaemon::Stats& stats = daemon.stats();
+    const ulog_cpp::LogCombinerStats& combiner_stats = daemon.combinerStats();
+    printf("%u producers (%u rejected), %u files, last: %s\n", stats.producers_total,
+           stats.rejected_producers, stats.files, daemon.filename().c_str());
+    printf("%llu messages, %llu bytes written\n",
+           static_cast<unsigned long long>(combiner_stats.messages_out),
+           static_cast<unsigned long long>(combiner_stats.bytes_out));
+  } catch (const ulog_cpp::ExceptionBase& exception) {
+    printf("Logging failed: %s\n", exception.what());
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,45 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ulog_cpp {
+
+/**
+ * Bump allocator for byte buffers. Memory is taken from large blocks, and only released all at
+ * once when the arena is destroyed. Allocations are not aligned.
+ * Pointers stay valid when the arena is moved.
+ */
+class ByteArena {
+ public:
+  static constexpr size_t kInitialBlockSize = 4096;
+  static constexpr size_t kMaxBlockSize = 1024 * 1024;
+
+  ByteArena() = default;
+  ByteArena(ByteArena&&) = default;
+  ByteArena& operator=(ByteArena&&) = default;
+  ByteArena(const ByteArena&) = delete;
+  ByteArena& operator=(const ByteArena&) = delete;
+
+  uint8_t* allocate(size_t size);
+
+  /**
+   * Total number of bytes allocated from the system
+   */
+  size_t capacity() const { return _capacity; }
+
+ private:
+  std::vector<std::unique_ptr<uint8_t[]>> _blocks;
+  uint8_t* _current{nullptr};
+  size_t _remaining{0};
+  size_t _next_block_size{kInitialBlockSize};
+  size_t _capacity{0};
+};
+
+}  // namespace ulog_cpp
@@ -0,0 +1,819 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "data_encoding.hpp"
+#include "data_handler_interface.hpp"
+#include "raw_messages.hpp"
+
+#if 0
+#define ULOG_CPP_READER_DBG_PRINTF(...) printf(__VA_ARGS__)
+#else
+#define ULOG_CPP_READER_DBG_PRINTF(...)
+#endif
+
+namespace ulog_cpp {
+
+/**
+ * Parsing statistics, collected by the reader if enabled (@see BasicReader::enableStats())
+ */
+struct ReaderStats {
+  struct Counter {
+    uint64_t messages{0};
+    uint64_t bytes{0};  ///< including the message header
+  };
+
+  std::array<Counter, 256> per_type{};  ///< indexed by the message type (ULogMessageType)
+  std::vector<Counter> per_msg_id;      ///< DATA and DATA_ENCODED messages, indexed by msg_id
+  uint64_t file_header_bytes{0};        ///< magic and flag bits
+  uint64_t discarded_bytes{0};          ///< skipped due to corruption
+  uint64_t recovery_events{0};          ///< number of detected corruptions
+  uint32_t largest_message{0};          ///< size of the largest message, including the header
+
+  uint64_t messageBytes() const
+  {
+    uint64_t bytes = 0;
+    for (const auto& counter : per_type) {
+      bytes += counter.bytes;
+    }
+    return bytes;
+  }
+};
+
+/**
+ * Class to deserialize an ULog file. Parsed messages are passed back to a handler of type Handler.
+ *
+ * Handler must provide the methods of DataHandlerInterface. The handler type is known at compile
+ * time, so if it is a final class (or does not use virtual methods), the calls are not virtual and
+ * small handlers (counters, filters) can be inlined into the parser loop.
+ * Use Reader for a handler behind the (virtual) DataHandlerInterface.
+ *
+ * The handler is not owned and must outlive the reader.
+ */
+template <typename Handler>
+class BasicReader {
+ public:
+  explicit BasicReader(Handler& handler);
+  ~BasicReader();
+
+  BasicReader(const BasicReader&) = delete;
+  BasicReader& operator=(const BasicReader&) = delete;
+
+  /**
+   * Parse next chunk of serialized ULog data. Call this iteratively, e.g. over a complete file.
+   * The handler will be called immediately for each parsed ULog message.
+   * There is no size limit, so a complete memory-mapped file can be passed at once.
+   */
+  void readChunk(const uint8_t* data, size_t length);
+
+  /**
+   * Stop parsing when the definitions section is complete (formats, info, initial parameters), so
+   * reading the metadata of a log does not require reading the data section. Once stopped,
+   * readChunk() ignores further data and the first message of the data section is not passed to
+   * the handler. Set this before the first readChunk() call.
+   */
+  void setStopAfterHeader(bool stop_after_header) { _stop_after_header = stop_after_header; }
+
+  /**
+   * Pass messages undecoded to Handler::rawMessage() instead of the typed callbacks, e.g. to copy
+   * or filter them at copy speed. The file header is still passed to fileHeader() and
+   * headerComplete() is called at the end of the definitions section. Set this before the first
+   * readChunk() call.
+   */
+  void setRawMode(bool raw_mode) { _raw_mode = raw_mode; }
+
+  /**
+   * @return true if parsing stopped after the definitions section (@see setStopAfterHeader())
+   */
+  bool stopped() const { return _state == State::Stopped; }
+
+  /**
+   * File offset of the first message after the definitions section, set once it is complete
+   */
+  int64_t dataSectionOffset() const { return _data_section_offset; }
+
+  /**
+   * File offset of the message that is currently passed to the handler. Only valid within the
+   * handler callbacks, e.g. to build an index of the file.
+   */
+  uint64_t messageOffset() const { return _message_offset; }
+
+  /**
+   * After stopping at the header, parse the messages of a trailing section of the file (e.g. the
+   * last 64KB, starting at or after dataSectionOffset()). The first message boundary is searched for
+   * such that the following messages end exactly at the end of data, which is the case for a
+   * completely written file, or the last one is cut off there, e.g. after a crash (@see
+   * recoverLog() for other corruptions). The messages are passed to the
+   * handler as data section messages, so it must accept data of subscriptions it has not seen.
+   * @param file_offset file offset of data (for messageOffset())
+   * @return number of bytes skipped before the first message, -1 if no message boundary was found
+   */
+  int64_t readTail(const uint8_t* data, size_t length, uint64_t file_offset);
+
+  /**
+   * Collect statistics (ReaderStats) from now on. Adds a few counter updates per message.
+   */
+  void enableStats() { _stats_enabled = true; }
+  const ReaderStats& stats() const { return _stats; }
+
+ private:
+  static constexpr int kBufferSizeInit = 2048;
+
+  void recordMessage(const uint8_t* message);
+
+  static bool isKnownMessageType(uint8_t msg_type);
+
+  size_t readMagic(const uint8_t* data, size_t length);
+  size_t readFlagBits(const uint8_t* data, size_t length);
+  void corruptionDetected();
+  size_t appendToPartialBuffer(const uint8_t* data, size_t length);
+  void tryToRecover(const uint8_t* data, size_t length);
+
+  void readHeaderMessage(const uint8_t* message);
+  void readRawMessage(const uint8_t* message);
+  void completeHeader();
+  void readDataMessage(const uint8_t* message);
+  void readEncodedDataMessage(const uint8_t* message);
+  void addDecoder(const AddLoggedMessage& add_logged_message);
+
+  enum class State {
+    ReadMagic,
+    ReadFlagBits,
+    ReadHeader,
+    ReadData,
+    Stopped,  ///< after the header (setStopAfterHeader())
+    InvalidData,
+  };
+
+  State _state{State::ReadMagic};
+  Handler& _handler;
+
+  std::vector<uint8_t> _file_header_buffer;  ///< start of the file while it is incomplete
+  uint8_t* _partial_message_buffer{nullptr};  ///< contains at most one ULog message (unless
+                                              ///< _need_recovery==true)
+  size_t _partial_message_buffer_length_capacity{0};
+  size_t _partial_message_buffer_length{0};
+
+  bool _need_recovery{false};
+  bool _corruption_reported{false};
+
+  uint64_t _total_num_read{};  ///< total number of bytes read (includes current partial buffer
+                               ///< data), i.e. the file offset after the data read so far
+  uint64_t _message_offset{0};
+
+  bool _stop_after_header{false};
+  bool _raw_mode{false};
+  int64_t _data_section_offset{-1};
+
+  ulog_file_header_s _file_header{};
+
+  bool _decode_data{false};  ///< set if the log contains encoded data (DATA_ENCODED)
+  std::map<std::string, MessageFormat> _formats;
+  std::unordered_map<uint16_t, DataDecoder> _decoders;
+
+  bool _stats_enabled{false};
+  ReaderStats _stats;
+};
+
+template <typename Handler>
+bool BasicReader<Handler>::isKnownMessageType(uint8_t msg_type)
+{
+  switch (static_cast<ULogMessageType>(msg_type)) {
+    case ULogMessageType::FORMAT:
+    case ULogMessageType::DATA:
+    case ULogMessageType::INFO:
+    case ULogMessageType::INFO_MULTIPLE:
+    case ULogMessageType::PARAMETER:
+    case ULogMessageType::PARAMETER_DEFAULT:
+    case ULogMessageType::ADD_LOGGED_MSG:
+    case ULogMessageType::REMOVE_LOGGED_MSG:
+    case ULogMessageType::SYNC:
+    case ULogMessageType::DROPOUT:
+    case ULogMessageType::LOGGING:
+    case ULogMessageType::LOGGING_TAGGED:
+    case ULogMessageType::LOGGING_DEFERRED:
+    case ULogMessageType::FLAG_BITS:
+    case ULogMessageType::DATA_ENCODED:
+      return true;
+  }
+  return false;
+}
+
+template <typename Handler>
+// cppcheck-suppress [uninitMemberVar,unmatchedSuppression]
+BasicReader<Handler>::BasicReader(Handler& handler) : _handler(handler)
+{
+  // Reader assumes to run on little endian
+  // TODO: use std::endian from C++20
+  int num = 1;
+  // cppcheck-suppress [knownConditionTrueFalse,unmatchedSuppression]
+  if (*reinterpret_cast<char*>(&num) != 1) {
+    _handler.error("Reader requires little endian", false);
+    _state = State::InvalidData;
+  }
+  _partial_message_buffer = static_cast<uint8_t*>(malloc(kBufferSizeInit));
+  _partial_message_buffer_length_capacity = kBufferSizeInit;
+}
+
+template <typename Handler>
+BasicReader<Handler>::~BasicReader()
+{
+  if (_partial_message_buffer) {
+    free(_partial_message_buffer);
+  }
+}
+
+template <typename Handler>
+void BasicReader<Handler>::readChunk(const uint8_t* data, size_t length)
+{
+  if (_state == State::InvalidData || _state == State::Stopped) {
+    return;
+  }
+
+  if (_state == State::ReadMagic) {
+    // The file header and the flag bits are parsed in one piece, so collect them first if the
+    // chunks are smaller (e.g. reads from a socket)
+    static constexpr size_t kFileHeaderLength =
+        sizeof(ulog_file_header_s) + sizeof(ulog_message_flag_bits_s);
+    if (!_file_header_buffer.empty() || length < kFileHeaderLength) {
+      _file_header_buffer.insert(_file_header_buffer.end(), data, data + length);
+      if (_file_header_buffer.size() < kFileHeaderLength) {
+        return;
+      }
+      const std::vector<uint8_t> buffered = std::move(_file_header_buffer);
+      _file_header_buffer.clear();
+      readChunk(buffered.data(), buffered.size());
+      return;
+    }
+    const size_t num_read = readMagic(data, length);
+    data += num_read;
+    length -= num_read;
+    _total_num_read += num_read;
+    if (_stats_enabled) {
+      _stats.file_header_bytes += num_read;
+    }
+  }
+
+  if (_state == State::ReadFlagBits && length > 0) {
+    const size_t num_read = readFlagBits(data, length);
+    data += num_read;
+    length -= num_read;
+    _total_num_read += num_read;
+    if (_stats_enabled) {
+      _stats.file_header_bytes += num_read;
+    }
+  }
+
+  static constexpr size_t kULogHeaderLength = sizeof(ulog_message_header_s);
+
+  // Also continue without new data if the partial buffer still contains a full message (after
+  // recovery, it can contain more than one)
+  auto partial_buffer_has_message = [this]() {
+    return _partial_message_buffer_length >= kULogHeaderLength &&
+           _partial_message_buffer_length >=
+               reinterpret_cast<const ulog_message_header_s*>(_partial_message_buffer)->msg_size +
+                   kULogHeaderLength;
+  };
+  while ((length > 0 || partial_buffer_has_message()) && !_need_recovery &&
+         _state != State::Stopped) {
+    // Try to get a full ulog message. There's 2 options:
+    // - we have some partial data in the buffer. We need to append and use that buffer
+    // - no partial data left. Use 'data' if it contains a full message
+    const uint8_t* ulog_message = nullptr;
+    bool clear_from_partial_message_buffer = false;
+    if (_partial_message_buffer_length > 0) {
+      auto ensure_enough_data_in_partial_buffer = [&](size_t required_data) -> bool {
+        if (_partial_message_buffer_length < required_data) {
+          // Try to append
+          const size_t num_append = std::min(required_data - _partial_message_buffer_length, length);
+          if (_partial_message_buffer_length + num_append >
+              _partial_message_buffer_length_capacity) {
+            // Overflow, resize buffer
+            _partial_message_buffer_length_capacity = _partial_message_buffer_length + num_append;
+            _partial_message_buffer = static_cast<uint8_t*>(
+                realloc(_partial_message_buffer, _partial_message_buffer_length_capacity));
+            ULOG_CPP_READER_DBG_PRINTF("%llu: resized partial buffer to %zu\n",
+                                       static_cast<unsigned long long>(_total_num_read),
+                                       _partial_message_buffer_length_capacity);
+          }
+          memcpy(_partial_message_buffer + _partial_message_buffer_length, data, num_append);
+          _partial_message_buffer_length += num_append;
+          data += num_append;
+          length -= num_append;
+          _total_num_read += num_append;
+        }
+        return _partial_message_buffer_length >= required_data;
+      };
+      if (ensure_enough_data_in_partial_buffer(kULogHeaderLength)) {
+        const ulog_message_header_s* header =
+            reinterpret_cast<const ulog_message_header_s*>(_partial_message_buffer);
+        if (ensure_enough_data_in_partial_buffer(header->msg_size + kULogHeaderLength)) {
+          ulog_message = reinterpret_cast<const uint8_t*>(_partial_message_buffer);
+          clear_from_partial_message_buffer = true;
+        } else {
+          // Not enough data yet (length == 0) or overflow
+          ULOG_CPP_READER_DBG_PRINTF("%llu: not enough data (length=%zu)\n",
+                                     static_cast<unsigned long long>(_total_num_read), length);
+        }
+      }
+
+    } else {
+      size_t full_message_length = 0;
+      if (length > kULogHeaderLength) {
+        const ulog_message_header_s* header = reinterpret_cast<const ulog_message_header_s*>(data);
+        if (length >= header->msg_size + kULogHeaderLength) {
+          full_message_length = header->msg_size + kULogHeaderLength;
+        }
+      }
+      if (full_message_length > 0) {
+        ulog_message = data;
+        data += full_message_length;
+        length -= full_message_length;
+        _total_num_read += full_message_length;
+      } else {
+        // Not a full message in buffer -> add to partial buffer
+        const size_t num_append = appendToPartialBuffer(data, length);
+        data += num_append;
+        length -= num_append;
+        _total_num_read += num_append;
+      }
+    }
+
+    if (ulog_message) {
+      const ulog_message_header_s* header =
+          reinterpret_cast<const ulog_message_header_s*>(ulog_message);
+      // The partial buffer ends at the current file offset and starts with the message
+      _message_offset =
+          _total_num_read - (clear_from_partial_message_buffer ? _partial_message_buffer_length
+                                                               : header->msg_size + kULogHeaderLength);
+
+      // Check for corruption
+      if (header->msg_size == 0 || header->msg_type == 0) {
+        ULOG_CPP_READER_DBG_PRINTF("%llu: Invalid msg detected\n",
+                                   static_cast<unsigned long long>(_total_num_read));
+        corruptionDetected();
+        if (_stats_enabled) {
+          _stats.discarded_bytes += header->msg_size + kULogHeaderLength;
+        }
+        // We'll exit the loop afterwards
+      } else {
+        // Parse the message
+        try {
+          if (_raw_mode) {
+            readRawMessage(ulog_message);
+          } else {
+            if (_state == State::ReadHeader) {
+              readHeaderMessage(ulog_message);
+            }
+            if (_state == State::ReadData) {
+              readDataMessage(ulog_message);
+            }
+          }
+          if (_stats_enabled) {
+            recordMessage(ulog_message);
+          }
+        } catch (const ParsingException& exception) {
+          ULOG_CPP_READER_DBG_PRINTF("%llu: parser exception: %s\n",
+                                     static_cast<unsigned long long>(_total_num_read),
+                                     exception.what());
+          corruptionDetected();
+          if (_stats_enabled) {
+            _stats.discarded_bytes += header->msg_size + kULogHeaderLength;
+          }
+        }
+      }
+
+      if (clear_from_partial_message_buffer) {
+        // In most cases this will clear the whole buffer, but in case of corruptions we might have
+        // more data
+        const size_t num_remove = header->msg_size + kULogHeaderLength;
+        memmove(_partial_message_buffer, _partial_message_buffer + num_remove,
+                _partial_message_buffer_length - num_remove);
+        _partial_message_buffer_length -= num_remove;
+      }
+    }
+  }
+
+  if (_need_recovery) {
+    tryToRecover(data, length);
+  }
+}
+
+template <typename Handler>
+int64_t BasicReader<Handler>::readTail(const uint8_t* data, size_t length, uint64_t file_offset)
+{
+  if (_state != State::Stopped) {
+    throw UsageException("readTail() requires a reader stopped after the header");
+  }
+  static constexpr size_t kULogHeaderLength = sizeof(ulog_message_header_s);
+  if (length < kULogHeaderLength) {
+    return -1;
+  }
+  // The first message boundary is within the maximum message length. Of the candidates, the chain
+  // of messages that ends at the end of data (or in a message that is cut off there) with the most
+  // messages is used, so a message boundary is not confused with message content that happens to
+  // look like a message header. The chain of an offset on an already found chain is shorter, so
+  // these are skipped.
+  const size_t num_candidates =
+      std::min<size_t>(length, kULogHeaderLength + std::numeric_limits<uint16_t>::max());
+  std::vector<bool> on_chain(num_candidates, false);
+  std::vector<size_t> chain;
+  int64_t start = -1;
+  uint32_t max_num_messages = 0;
+  for (size_t candidate = 0; candidate < num_candidates; ++candidate) {
+    if (on_chain[candidate]) {
+      continue;
+    }
+    chain.clear();
+    bool valid = true;
+    size_t offset = candidate;
+    while (offset + kULogHeaderLength <= length) {
+      ulog_message_header_s header;
+      memcpy(&header, data + offset, kULogHeaderLength);
+      if (header.msg_size == 0 || !isKnownMessageType(header.msg_type)) {
+        valid = false;
+        break;
+      }
+      const size_t end = offset + kULogHeaderLength + header.msg_size;
+      if (end > length) {
+        break;  // cut off
+      }
+      chain.push_back(offset);
+      offset = end;
+    }
+    if (!valid || chain.empty()) {
+      continue;
+    }
+    for (const size_t chain_offset : chain) {
+      if (chain_offset >= num_candidates) {
+        break;
+      }
+      on_chain[chain_offset] = true;
+    }
+    if (chain.size() > max_num_messages) {
+      max_num_messages = static_cast<uint32_t>(chain.size());
+      start = static_cast<int64_t>(candidate);
+    }
+  }
+  if (start < 0) {
+    return -1;
+  }
+  _partial_message_buffer_length = 0;
+  _need_recovery = false;
+  _state = State::ReadData;
+  _total_num_read = file_offset + start;
+  readChunk(data + start, length - static_cast<size_t>(start));
+  if (_state == State::ReadData) {
+    _state = State::Stopped;
+  }
+  return start;
+}
+
+template <typename Handler>
+void BasicReader<Handler>::tryToRecover(const uint8_t* data, size_t length)
+{
+  // Try to find a valid message in 'data' by moving data into the partial buffer and search for a
+  // message
+  while (length > 0) {
+    const size_t num_append = appendToPartialBuffer(data, length);
+    data += num_append;
+    length -= num_append;
+    _total_num_read += num_append;
+
+    if (_partial_message_buffer_length >= sizeof(ulog_message_header_s)) {
+      bool found = false;
+      size_t index = 0;
+      // If the partial buffer was already full, skip the first index, otherwise we risk infinite
+      // recursion
+      if (num_append == 0) {
+        index = 1;
+      }
+      for (; index < _partial_message_buffer_length - sizeof(ulog_message_header_s); ++index) {
+        const ulog_message_header_s* header =
+            reinterpret_cast<const ulog_message_header_s*>(_partial_message_buffer + index);
+        // Try to use it if it looks sane (we could also check for a SYNC message)
+        if (header->msg_size != 0 && header->msg_type != 0 && header->msg_size < 10000 &&
+            isKnownMessageType(header->msg_type)) {
+          found = true;
+          break;
+        }
+      }
+
+      // Discard unused data
+      if (index > 0) {
+        if (_stats_enabled) {
+          _stats.discarded_bytes += index;
+        }
+        memmove(_partial_message_buffer, _partial_message_buffer + index,
+                _partial_message_buffer_length - index);
+        _partial_message_buffer_length -= index;
+      }
+
+      if (found) {
+        ULOG_CPP_READER_DBG_PRINTF(
+            "%llu: recovered, recursive call (index = %zu, length = %zu, partial buf len = %zu)\n",
+            static_cast<unsigned long long>(_total_num_read), index, length,
+            _partial_message_buffer_length);
+        _need_recovery = false;
+        readChunk(data, length);
+
+        return;
+      }
+      ULOG_CPP_READER_DBG_PRINTF(
+          "%llu: no valid msg found (length = %zu, partial buf len = %zu)\n",
+          static_cast<unsigned long long>(_total_num_read), length, _partial_message_buffer_length);
+    }
+  }
+}
+
+template <typename Handler>
+void BasicReader<Handler>::corruptionDetected()
+{
+  if (!_corruption_reported) {
+    _handler.error("Message corruption detected at offset " + std::to_string(_message_offset),
+                   true);
+    _corruption_reported = true;
+  }
+  _need_recovery = true;
+  if (_stats_enabled) {
+    _stats.recovery_events += 1;
+  }
+}
+
+template <typename Handler>
+void BasicReader<Handler>::recordMessage(const uint8_t* message)
+{
+  const ulog_message_header_s* header = reinterpret_cast<const ulog_message_header_s*>(message);
+  const uint32_t size = header->msg_size + ULOG_MSG_HEADER_LEN;
+  ReaderStats::Counter& type_counter = _stats.per_type[header->msg_type];
+  ++type_counter.messages;
+  type_counter.bytes += size;
+  _stats.largest_message = std::max(_stats.largest_message, size);
+
+  const auto type = static_cast<ULogMessageType>(header->msg_type);
+  if ((type == ULogMessageType::DATA || type == ULogMessageType::DATA_ENCODED) &&
+      header->msg_size >= sizeof(uint16_t)) {
+    uint16_t msg_id;
+    memcpy(&msg_id, message + ULOG_MSG_HEADER_LEN, sizeof(msg_id));
+    if (msg_id >= _stats.per_msg_id.size()) {
+      _stats.per_msg_id.resize(msg_id + 1);
+    }
+    ++_stats.per_msg_id[msg_id].messages;
+    _stats.per_msg_id[msg_id].bytes += size;
+  }
+}
+
+template <typename Handler>
+size_t BasicReader<Handler>::appendToPartialBuffer(const uint8_t* data, size_t length)
+{
+  const size_t num_append =
+      std::min(length, _partial_message_buffer_length_capacity - _partial_message_buffer_length);
+  memcpy(_partial_message_buffer + _partial_message_buffer_length, data, num_append);
+  _partial_message_buffer_length += num_append;
+  return num_append;
+}
+
+template <typename Handler>
+size_t BasicReader<Handler>::readMagic(const uint8_t* data, size_t length)
+{
+  // readChunk() collects the file header and the flag bits before calling this
+  if (length < sizeof(ulog_file_header_s)) {
+    _handler.error("Not enough data to read file magic", false);
+    _state = State::InvalidData;
+    return 0;
+  }
+
+  const ulog_file_header_s* header = reinterpret_cast<const ulog_file_header_s*>(data);
+
+  // Check magic bytes
+  if (memcmp(header->magic, ulog_file_magic_bytes, sizeof(ulog_file_magic_bytes)) != 0) {
+    _handler.error("Invalid file format (incorrect header bytes)", false);
+    _state = State::InvalidData;
+    return 0;
+  }
+
+  _state = State::ReadFlagBits;
+  _file_header = *header;
+
+  return sizeof(ulog_file_header_s);
+}
+
+template <typename Handler>
+size_t BasicReader<Handler>::readFlagBits(const uint8_t* data, size_t length)
+{
+  // readChunk() passes the whole flags in one piece (for simplicity of the parser)
+  size_t ret = 0;
+  if (length < sizeof(ulog_message_flag_bits_s)) {
+    _handler.error("Not enough data to read file flags", false);
+    _state = State::InvalidData;
+    return 0;
+  }
+  // This message is optional and follows directly the file magic
+  const ulog_message_flag_bits_s* flag_bits =
+      reinterpret_cast<const ulog_message_flag_bits_s*>(data);
+  if (static_cast<ULogMessageType>(flag_bits->msg_type) == ULogMessageType::FLAG_BITS) {
+    // This is expected to be the first message after the file magic
+    if (flag_bits->appended_offsets[0] != 0) {
+      // TODO: handle appended data
+      _handler.error("File contains appended offsets - this is not supported",
+                                     true);
+    }
+    // Check incompat flags
+    bool has_incompat_flags = false;
+    if (flag_bits->incompat_flags[0] & ~(ULOG_INCOMPAT_FLAG0_DATA_APPENDED_MASK)) {
+      has_incompat_flags = true;
+    }
+    for (unsigned i = 1;
+         i < sizeof(flag_bits->incompat_flags) / sizeof(flag_bits->incompat_flags[0]); ++i) {
+      if (flag_bits->incompat_flags[i]) {
+        has_incompat_flags = true;
+      }
+    }
+    if (has_incompat_flags) {
+      _handler.error("Unknown incompatible flag set: cannot parse the log", false);
+      _state = State::InvalidData;
+    } else {
+      _decode_data = flag_bits->compat_flags[0] & ULOG_COMPAT_FLAG0_ENCODED_DATA_MASK;
+      _handler.fileHeader({_file_header, *flag_bits});
+      ret = flag_bits->msg_size + ULOG_MSG_HEADER_LEN;
+      _state = State::ReadHeader;
+    }
+  } else {
+    // Create header w/o flag bits
+    _handler.fileHeader(FileHeader{_file_header});
+    _state = State::ReadHeader;
+  }
+  return ret;
+}
+
+template <typename Handler>
+void BasicReader<Handler>::readHeaderMessage(const uint8_t* message)
+{
+  const ulog_message_header_s* header = reinterpret_cast<const ulog_message_header_s*>(message);
+  switch (static_cast<ULogMessageType>(header->msg_type)) {
+    case ULogMessageType::INFO:
+      _handler.messageInfo(MessageInfo{message, false});
+      break;
+    case ULogMessageType::INFO_MULTIPLE:
+      _handler.messageInfo(MessageInfo{message, true});
+      break;
+    case ULogMessageType::FORMAT: {
+      MessageFormat message_format{message};
+      if (_decode_data) {
+        _formats.insert({message_format.name(), message_format});
+      }
+      _handler.messageFormat(std::move(message_format));
+      break;
+    }
+    case ULogMessageType::PARAMETER:
+      _handler.parameter(Parameter{message});
+      break;
+    case ULogMessageType::PARAMETER_DEFAULT:
+      _handler.parameterDefault(ParameterDefault{message});
+      break;
+    case ULogMessageType::ADD_LOGGED_MSG:
+    case ULogMessageType::LOGGING:
+    case ULogMessageType::LOGGING_TAGGED:
+    case ULogMessageType::LOGGING_DEFERRED:
+      completeHeader();
+      break;
+    default:
+      ULOG_CPP_READER_DBG_PRINTF("%llu: Unknown/unexpected message type in header: %i\n",
+                                 static_cast<unsigned long long>(_total_num_read),
+                                 header->msg_type);
+      break;
+  }
+}
+
+template <typename Handler>
+void BasicReader<Handler>::completeHeader()
+{
+  ULOG_CPP_READER_DBG_PRINTF("%llu: Header completed\n",
+                             static_cast<unsigned long long>(_total_num_read));
+  _data_section_offset = static_cast<int64_t>(_message_offset);
+  _state = _stop_after_header ? State::Stopped : State::ReadData;
+  _handler.headerComplete();
+}
+
+template <typename Handler>
+void BasicReader<Handler>::readRawMessage(const uint8_t* message)
+{
+  const ulog_message_header_s* header = reinterpret_cast<const ulog_message_header_s*>(message);
+  if (_state == State::ReadHeader) {
+    switch (static_cast<ULogMessageType>(header->msg_type)) {
+      case ULogMessageType::ADD_LOGGED_MSG:
+      case ULogMessageType::LOGGING:
+      case ULogMessageType::LOGGING_TAGGED:
+      case ULogMessageType::LOGGING_DEFERRED:
+        completeHeader();
+        break;
+      default:
+        break;
+    }
+  }
+  if (_state != State::Stopped) {
+    _handler.rawMessage(message, header->msg_size + ULOG_MSG_HEADER_LEN);
+  }
+}
+
+template <typename Handler>
+void BasicReader<Handler>::readDataMessage(const uint8_t* message)
+{
+  const ulog_message_header_s* header = reinterpret_cast<const ulog_message_header_s*>(message);
+  switch (static_cast<ULogMessageType>(header->msg_type)) {
+    case ULogMessageType::INFO:
+      _handler.messageInfo(MessageInfo{message, false});
+      break;
+    case ULogMessageType::INFO_MULTIPLE:
+      _handler.messageInfo(MessageInfo{message, true});
+      break;
+    case ULogMessageType::PARAMETER:
+      _handler.parameter(Parameter{message});
+      break;
+    case ULogMessageType::PARAMETER_DEFAULT:
+      _handler.parameterDefault(ParameterDefault{message});
+      break;
+    case ULogMessageType::ADD_LOGGED_MSG: {
+      AddLoggedMessage add_logged_message{message};
+      if (_decode_data) {
+        addDecoder(add_logged_message);
+      }
+      _handler.addLoggedMessage(std::move(add_logged_message));
+      break;
+    }
+    case ULogMessageType::LOGGING:
+      _handler.logging(Logging{message});
+      break;
+    case ULogMessageType::LOGGING_TAGGED:
+      _handler.logging(Logging{message, true});
+      break;
+    case ULogMessageType::LOGGING_DEFERRED:
+      _handler.deferredLogging(DeferredLogging{message});
+      break;
+    case ULogMessageType::DATA:
+      _handler.data(Data{message});
+      break;
+    case ULogMessageType::DROPOUT:
+      _handler.dropout(Dropout{message});
+      break;
+    case ULogMessageType::SYNC:
+      _handler.sync(Sync{message});
+      break;
+    case ULogMessageType::DATA_ENCODED:
+      if (_decode_data) {
+        readEncodedDataMessage(message);
+      }
+      break;
+    default:
+      ULOG_CPP_READER_DBG_PRINTF("%llu: Unknown/unexpected message type in data: %i\n",
+                                 static_cast<unsigned long long>(_total_num_read),
+                                 header->msg_type);
+      break;
+  }
+}
+
+template <typename Handler>
+void BasicReader<Handler>::readEncodedDataMessage(const uint8_t* message)
+{
+  const ulog_message_data_encoded_s* encoded =
+      reinterpret_cast<const ulog_message_data_encoded_s*>(message);
+  if (encoded->msg_size < sizeof(*encoded) - ULOG_MSG_HEADER_LEN) {
+    throw ParsingException("message too short");
+  }
+  const auto decoder_iter = _decoders.find(encoded->msg_id);
+  if (decoder_iter == _decoders.end()) {
+    throw ParsingException("Encoded data for unknown subscription");
+  }
+  for (auto& data : decoder_iter->second.decode(message)) {
+    _handler.data(std::move(data));
+  }
+}
+
+template <typename Handler>
+void BasicReader<Handler>::addDecoder(const AddLoggedMessage& add_logged_message)
+{
+  _decoders.erase(add_logged_message.msgId());
+  const auto format_iter = _formats.find(add_logged_message.messageName());
+  if (format_iter == _formats.end()) {
+    return;
+  }
+  DataEncodingLayout layout(format_iter->second, _formats);
+  if (layout.encodable()) {
+    _decoders.emplace(add_logged_message.msgId(), DataDecoder(std::move(layout)));
+  }
+}
+
+}  // namespace ulog_cpp
+
+#undef ULOG_CPP_READER_DBG_PRINTF
@@ -7,10 +7,87 @@
 #include <unordered_map>
 #include <vector>
 
+#include "arena.hpp"
 #include "data_handler_interface.hpp"
+#include "deferred_logging.hpp"
 
 namespace ulog_cpp {
 
+/**
+ * Non-owning view of a data sample stored in a DataContainer. It is valid as long as the
+ * DataContainer exists.
+ */
+class DataView {
+ public:
+  /**
+   * Payload bytes, with a subset of the std::vector<uint8_t> interface
+   */
+  class Bytes {
+   public:
+    Bytes(const uint8_t* data, size_t size) : _data(data), _size(size) {}
+
+    const uint8_t* data() const { return _data; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    const uint8_t* begin() const { return _data; }
+    const uint8_t* end() const { return _data + _size; }
+    uint8_t operator[](size_t index) const { return _data[index]; }
+
+   private:
+    const uint8_t* _data;
+    size_t _size;
+  };
+
+  DataView(uint16_t msg_id, const uint8_t* data, uint32_t size)
+      : _data(data), _size(size), _msg_id(msg_id)
+  {
+  }
+
+  uint16_t msgId() const { return _msg_id; }
+  Bytes data() const { return {_data, _size}; }
+
+  bool operator==(const DataView& data) const
+  {
+    return _msg_id == data._msg_id && _size == data._size && memcmp(_data, data._data, _size) == 0;
+  }
+  bool operator==(const Data& data) const
+  {
+    return _msg_id == data.msgId() && _size == data.data().size() &&
+           memcmp(_data, data.data().data(), _size) == 0;
+  }
+
+ private:
+  const uint8_t* _data;
+  uint32_t _size;
+  uint16_t _msg_id;
+};
+
+inline bool operator==(const Data& data, const DataView& data_view)
+{
+  return data_view == data;
+}
+
+/**
+ * Data samples of a subscription. The payloads are stored contiguously in an arena instead of
+ * one allocation per sample, and are accessed through DataView's.
+ */
+class DataSamples {
+ public:
+  using ConstIterator = std::vector<DataView>::const_iterator;
+
+  void append(const Data& data);
+
+  size_t size() const { return _samples.size(); }
+  bool empty() const { return _samples.empty(); }
+  const DataView& operator[](size_t index) const { return _samples[index]; }
+  ConstIterator begin() const { return _samples.begin(); }
+  ConstIterator end() const { return _samples.end(); }
+
+ private:
+  ByteArena _arena;
+  std::vector<DataView> _samples;
+};
+
 class DataContainer : public DataHandlerInterface {
  public:
   enum class StorageConfig {
@@ -20,7 +97,7 @@ class DataContainer : public DataHandlerInterface {
 
   struct Subscription {
     AddLoggedMessage add_logged_message;
-    std::vector<Data> data;
+    DataSamples data;
   };
 
   explicit DataContainer(StorageConfig storage_config);
@@ -37,9 +114,18 @@ class DataContainer : public DataHandlerInterface {
   void parameterDefault(const ParameterDefault& parameter_default) override;
   void addLoggedMessage(const AddLoggedMessage& add_logged_message) override;
   void logging(const Logging& logging) override;
+  void deferredLogging(const DeferredLogging& logging) override;
   void data(const Data& data) override;
   void dropout(const Dropout& dropout) override;
 
+  void messageInfo(MessageInfo&& message_info) override;
+  void messageFormat(MessageFormat&& message_format) override;
+  void parameter(Parameter&& parameter) override;
+  void parameterDefault(ParameterDefault&& parameter_default) override;
+  void addLoggedMessage(AddLoggedMessage&& add_logged_message) override;
+  void logging(Logging&& logging) override;
+  void deferredLogging(DeferredLogging&& logging) override;
+
   // Stored data
   bool isHeaderComplete() const { return _header_complete; }
   bool hadFatalError() const { return _had_fatal_error; }
@@ -58,6 +144,9 @@ class DataContainer : public DataHandlerInterface {
   }
   const std::vector<Parameter>& changedParameters() const { return _changed_parameters; }
   const std::vector<Logging>& logging() const { return _logging; }
+  const std::vector<DeferredLogging>& deferredLogging() const { return _deferred_logging; }
+  /// Formats registered in the log, to expand deferredLogging()
+  const DeferredFormatter& deferredFormatter() const { return _deferred_formatter; }
   const std::unordered_map<uint16_t, Subscription>& subscriptions() const { return _subscriptions; }
   const std::vector<Dropout>& dropouts() const { return _dropouts; }
 
@@ -77,6 +166,8 @@ class DataContainer : public DataHandlerInterface {
   std::vector<Parameter> _changed_parameters;
   std::unordered_map<uint16_t, Subscription> _subscriptions;
   std::vector<Logging> _logging;
+  std::vector<DeferredLogging> _deferred_logging;
+  DeferredFormatter _deferred_formatter;
   std::vector<Dropout> _dropouts;
 };
 
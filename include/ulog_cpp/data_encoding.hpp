@@ -0,0 +1,122 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "messages.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Field layout of a message format, as used for encoding. Each (array) element of a basic type is
+ * one lane. Nested formats are flattened. If the first field is 'uint64_t timestamp', it is
+ * encoded as delta-of-delta, all other lanes are XOR encoded with the previous sample.
+ */
+class DataEncodingLayout {
+ public:
+  DataEncodingLayout() = default;
+  /**
+   * @param format message format of the subscription
+   * @param formats all known formats, used to resolve nested types
+   */
+  DataEncodingLayout(const MessageFormat& format,
+                     const std::map<std::string, MessageFormat>& formats);
+
+  /**
+   * Whether samples of this layout can be encoded (all types resolved, and not too large)
+   */
+  bool encodable() const { return _encodable; }
+  bool hasTimestamp() const { return _has_timestamp; }
+  unsigned sampleSize() const { return _sample_size; }
+  const std::vector<uint8_t>& lanes() const { return _lanes; }  ///< lane sizes in bytes
+
+  /**
+   * Upper bound for the encoded size of a single (non-first) sample in bits
+   */
+  unsigned maxEncodedSampleBits() const { return _max_encoded_sample_bits; }
+
+ private:
+  void addFields(const MessageFormat& format, const std::map<std::string, MessageFormat>& formats,
+                 int depth);
+
+  std::vector<uint8_t> _lanes;
+  unsigned _sample_size{0};
+  unsigned _max_encoded_sample_bits{0};
+  bool _has_timestamp{false};
+  bool _encodable{true};
+};
+
+/**
+ * Collects consecutive samples of a single subscription and serializes them as one
+ * ULogMessageType::DATA_ENCODED message. Timestamps are stored as delta-of-delta, all other fields
+ * with Gorilla-style XOR against the previous sample.
+ * Each block is self-contained, so a reader can recover at any message boundary.
+ */
+class DataEncoder {
+ public:
+  static constexpr unsigned kMaxSamplesPerBlock = 256;
+  static constexpr unsigned kMaxBlockPayload = 32768;
+  static constexpr unsigned kMaxSampleSize = 4096;  ///< larger samples are not encoded
+
+  DataEncoder(uint16_t msg_id, DataEncodingLayout layout);
+
+  const DataEncodingLayout& layout() const { return _layout; }
+  bool empty() const { return _num_samples == 0; }
+
+  /**
+   * Whether another sample fits into the current block. If not, call flush() first.
+   */
+  bool canAppend() const;
+
+  /**
+   * Add a sample to the block. length must match the layout's sampleSize().
+   */
+  void append(const uint8_t* sample, unsigned length);
+
+  /**
+   * Serialize the current block (if not empty) and start a new one
+   */
+  void flush(const DataWriteCB& writer);
+
+ private:
+  void writeBits(uint64_t value, unsigned num_bits);
+
+  const uint16_t _msg_id;
+  const DataEncodingLayout _layout;
+
+  unsigned _num_samples{0};
+  std::vector<uint8_t> _first_sample;
+  std::vector<uint8_t> _bits;  ///< encoded bit stream, MSB first
+  unsigned _num_bits{0};
+
+  // Encoder state
+  std::vector<uint64_t> _previous;  ///< previous value per lane
+  std::vector<uint8_t> _leading;    ///< leading zeros per lane of the last stored XOR window
+  std::vector<uint8_t> _trailing;   ///< trailing zeros per lane of the last stored XOR window
+  uint64_t _previous_delta{0};
+};
+
+/**
+ * Decodes ULogMessageType::DATA_ENCODED messages created by DataEncoder
+ */
+class DataDecoder {
+ public:
+  explicit DataDecoder(DataEncodingLayout layout);
+
+  /**
+   * Decode a full message (including the ULog message header) into DATA samples.
+   * Throws a ParsingException on invalid data.
+   */
+  std::vector<Data> decode(const uint8_t* msg) const;
+
+ private:
+  const DataEncodingLayout _layout;
+};
+
+}  // namespace ulog_cpp
@@ -24,10 +24,47 @@ class DataHandlerInterface {
   virtual void parameterDefault(const ParameterDefault& parameter_default) {}
   virtual void addLoggedMessage(const AddLoggedMessage& add_logged_message) {}
   virtual void logging(const Logging& logging) {}
+  virtual void deferredLogging(const DeferredLogging& logging) {}
   virtual void data(const Data& data) {}
   virtual void dropout(const Dropout& dropout) {}
   virtual void sync(const Sync& sync) {}
 
+  /**
+   * Complete message (including the ULog message header), in raw mode instead of the methods
+   * above (@see BasicReader::setRawMode())
+   */
+  virtual void rawMessage(const uint8_t* message, size_t length) {}
+
+  // Ownership-transferring variants. The Reader passes freshly parsed messages as rvalues, so
+  // handlers that store them can move instead of copy. By default they forward to the methods
+  // above, so handlers only need to override the variant they need.
+  virtual void messageInfo(MessageInfo&& message_info)
+  {
+    messageInfo(static_cast<const MessageInfo&>(message_info));
+  }
+  virtual void messageFormat(MessageFormat&& message_format)
+  {
+    messageFormat(static_cast<const MessageFormat&>(message_format));
+  }
+  virtual void parameter(Parameter&& parameter)
+  {
+    this->parameter(static_cast<const Parameter&>(parameter));
+  }
+  virtual void parameterDefault(ParameterDefault&& parameter_default)
+  {
+    parameterDefault(static_cast<const ParameterDefault&>(parameter_default));
+  }
+  virtual void addLoggedMessage(AddLoggedMessage&& add_logged_message)
+  {
+    addLoggedMessage(static_cast<const AddLoggedMessage&>(add_logged_message));
+  }
+  virtual void logging(Logging&& logging) { this->logging(static_cast<const Logging&>(logging)); }
+  virtual void deferredLogging(DeferredLogging&& logging)
+  {
+    deferredLogging(static_cast<const DeferredLogging&>(logging));
+  }
+  virtual void data(Data&& data) { this->data(static_cast<const Data&>(data)); }
+
  private:
 };
 
@@ -0,0 +1,176 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "messages.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Deferred text logging: a format string is registered once and written as INFO_MULTIPLE message
+ * kDeferredFormatInfoKey with the value "<id>:<argument codes>:<format>". Text messages
+ * (ULogMessageType::LOGGING_DEFERRED) then only contain the format id and the encoded arguments,
+ * and are formatted when reading (DeferredFormatter).
+ *
+ * Argument codes and their encoding:
+ * - 'i': signed integer, as int64_t
+ * - 'u': unsigned integer or bool, as uint64_t
+ * - 'f': floating point, as double
+ * - 's': string, as uint16_t length followed by the characters
+ */
+static constexpr const char* kDeferredFormatInfoKey = "log_format";
+
+/**
+ * Encoding of an argument type. Not defined for unsupported types.
+ */
+template <typename T, typename Enable = void>
+struct DeferredArg;
+
+template <typename T>
+struct DeferredArg<T, std::enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value>> {
+  static constexpr char kCode = 'i';
+  static size_t size(T /*value*/) { return sizeof(int64_t); }
+  static uint8_t* encode(uint8_t* out, T value)
+  {
+    const int64_t encoded = value;
+    memcpy(out, &encoded, sizeof(encoded));
+    return out + sizeof(encoded);
+  }
+};
+
+template <typename T>
+struct DeferredArg<T, std::enable_if_t<std::is_integral<T>::value && !std::is_signed<T>::value>> {
+  static constexpr char kCode = 'u';
+  static size_t size(T /*value*/) { return sizeof(uint64_t); }
+  static uint8_t* encode(uint8_t* out, T value)
+  {
+    const uint64_t encoded = value;
+    memcpy(out, &encoded, sizeof(encoded));
+    return out + sizeof(encoded);
+  }
+};
+
+template <typename T>
+struct DeferredArg<T, std::enable_if_t<std::is_floating_point<T>::value>> {
+  static constexpr char kCode = 'f';
+  static size_t size(T /*value*/) { return sizeof(double); }
+  static uint8_t* encode(uint8_t* out, T value)
+  {
+    const double encoded = value;
+    memcpy(out, &encoded, sizeof(encoded));
+    return out + sizeof(encoded);
+  }
+};
+
+/// Strings longer than 65535 characters are truncated
+template <>
+struct DeferredArg<const char*> {
+  static constexpr char kCode = 's';
+  static size_t length(const char* value)
+  {
+    return std::min<size_t>(strlen(value), std::numeric_limits<uint16_t>::max());
+  }
+  static size_t size(const char* value) { return sizeof(uint16_t) + length(value); }
+  static uint8_t* encode(uint8_t* out, const char* value)
+  {
+    const uint16_t len = length(value);
+    memcpy(out, &len, sizeof(len));
+    memcpy(out + sizeof(len), value, len);
+    return out + sizeof(len) + len;
+  }
+};
+
+template <>
+struct DeferredArg<std::string> {
+  static constexpr char kCode = 's';
+  static size_t length(const std::string& value)
+  {
+    return std::min<size_t>(value.size(), std::numeric_limits<uint16_t>::max());
+  }
+  static size_t size(const std::string& value) { return sizeof(uint16_t) + length(value); }
+  static uint8_t* encode(uint8_t* out, const std::string& value)
+  {
+    const uint16_t len = length(value);
+    memcpy(out, &len, sizeof(len));
+    memcpy(out + sizeof(len), value.data(), len);
+    return out + sizeof(len) + len;
+  }
+};
+
+/**
+ * Handle of a registered format string (@see SimpleWriter::registerTextFormat()). The argument
+ * types are part of the type, so writing with a wrong number of arguments does not compile.
+ */
+template <typename... Args>
+struct DeferredFormat {
+  uint16_t id{0};
+  Logging::Level level{Logging::Level::Info};
+};
+
+template <typename... Args>
+std::string deferredArgCodes()
+{
+  return std::string{DeferredArg<std::decay_t<Args>>::kCode...};
+}
+
+/**
+ * Encode the arguments into buffer (resized to the encoded size)
+ */
+template <typename... Args>
+void encodeDeferredArgs(std::vector<uint8_t>& buffer, const Args&... args)
+{
+  buffer.resize((size_t{0} + ... + DeferredArg<std::decay_t<Args>>::size(args)));
+  uint8_t* out = buffer.data();
+  ((out = DeferredArg<std::decay_t<Args>>::encode(out, args)), ...);
+  (void)out;
+}
+
+/**
+ * INFO_MULTIPLE message registering a format (key kDeferredFormatInfoKey)
+ */
+MessageInfo deferredFormatInfo(uint16_t id, const std::string& arg_codes,
+                               const std::string& format);
+
+/**
+ * Expands deferred text messages with the registered format strings. The supported conversions
+ * are the ones of printf (length modifiers are ignored, the argument type comes from the
+ * encoding), except for '*' width and precision.
+ */
+class DeferredFormatter {
+ public:
+  /**
+   * Register the format of a kDeferredFormatInfoKey info message
+   * @return false if the info message is not a (valid) format registration
+   */
+  bool addFormat(const MessageInfo& message_info);
+
+  bool hasFormat(uint16_t id) const { return _formats.find(id) != _formats.end(); }
+
+  /**
+   * Format the message text. Unknown format ids and arguments that do not match the conversion
+   * are marked in the text instead of throwing.
+   */
+  std::string format(const DeferredLogging& logging) const;
+
+  Logging expand(const DeferredLogging& logging) const;
+
+ private:
+  struct Format {
+    std::string arg_codes;
+    std::string format;
+  };
+  std::unordered_map<uint16_t, Format> _formats;
+};
+
+}  // namespace ulog_cpp
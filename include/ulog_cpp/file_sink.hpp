@@ -0,0 +1,66 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ulog_cpp {
+
+enum class FileSinkType {
+  Stdio,    ///< fwrite(), fflush() + fsync()
+  IoUring,  ///< asynchronous writes from registered buffers (Linux >= 5.6)
+  Direct,   ///< O_DIRECT writes of aligned blocks from a background thread (no page cache)
+  Mmap,     ///< shared memory mapping, survives a crash of the process (@see recoverLog())
+};
+
+struct FileSinkConfig {
+  FileSinkType type{FileSinkType::Stdio};
+  size_t buffer_size{1024 * 1024};  ///< [bytes] per buffer, or mapped window (not used by Stdio)
+  int num_buffers{4};               ///< buffers that can be in flight (IoUring and Direct)
+  /// [bytes] file size reserved with fallocate() on open, truncated to the written size on close
+  /// (Direct and Mmap only, 0: disabled)
+  uint64_t preallocate_size{0};
+};
+
+/**
+ * Output file of the writers (SimpleWriter, zz_data_log). Not thread-safe.
+ */
+class FileSink {
+ public:
+  virtual ~FileSink() = default;
+
+  virtual void write(const uint8_t* data, int length) = 0;
+
+  /**
+   * Hand all written data to the kernel
+   */
+  virtual void flush() = 0;
+
+  /**
+   * flush() and fsync(). Depending on the type, this only schedules the fsync and returns
+   * immediately.
+   */
+  virtual void sync() = 0;
+
+  /**
+   * The actually used type, which differs from the requested one after a fallback
+   */
+  virtual FileSinkType type() const = 0;
+};
+
+/**
+ * Open a file for writing (overwritten if it exists). If the requested type is not available (e.g.
+ * io_uring on an old kernel or blocked by seccomp, or a file system without O_DIRECT support), it
+ * falls back to FileSinkType::Stdio.
+ * Throws a ParsingException if the file cannot be opened.
+ */
+std::unique_ptr<FileSink> createFileSink(const std::string& filename,
+                                         const FileSinkConfig& config = {});
+
+const char* fileSinkTypeName(FileSinkType type);
+
+}  // namespace ulog_cpp
@@ -0,0 +1,101 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "data_handler_interface.hpp"
+#include "message_stream.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * In-memory sink for serialized ULog data (e.g. the callback of a Writer), keeping the header and
+ * the most recent data in a fixed-size circular buffer. dump() then writes a complete log with the
+ * last pre_trigger_us of data, for example after an error occurred.
+ *
+ * Messages are stored whole, so a dump always starts at a message boundary. The header,
+ * subscriptions, info messages and parameter changes are kept outside of the buffer (these are
+ * never evicted).
+ * DATA_ENCODED is not supported, as the encoded blocks depend on each other.
+ */
+class FlightRecorder {
+ public:
+  struct Config {
+    size_t buffer_size{4 * 1024 * 1024};  ///< [bytes] data, logging, dropout and sync messages
+    /// [us] data written by dump(), relative to the latest timestamp
+    uint64_t pre_trigger_us{10'000'000};
+  };
+
+  struct Stats {
+    uint64_t messages{0};          ///< messages currently in the buffer
+    uint64_t buffered_bytes{0};    ///< bytes currently in the buffer
+    uint64_t evicted_messages{0};  ///< messages overwritten by newer ones
+    uint64_t dumps{0};
+  };
+
+  explicit FlightRecorder(const Config& config);
+
+  /**
+   * Add serialized ULog data. Does not need to be aligned to message boundaries.
+   * Throws a UsageException for DATA_ENCODED messages.
+   */
+  void write(const uint8_t* data, int length);
+
+  /**
+   * Write the header followed by the buffered data of the last pre_trigger_us.
+   * The buffer is not cleared, so dumps can overlap.
+   */
+  void dump(const DataWriteCB& writer);
+
+  /**
+   * dump() into a file (overwritten if it exists).
+   * Throws a ParsingException if the file cannot be written.
+   */
+  void dumpToFile(const std::string& filename);
+
+  const Stats& stats() const { return _stats; }
+
+  /**
+   * Install a handler for a signal (e.g. SIGUSR1), which requests a dump. The handler only sets a
+   * flag (@see consumeSignalTrigger()), the dump is done by the owner of the FlightRecorder.
+   */
+  static void installSignalTrigger(int signal_number);
+
+  /**
+   * @return true if the signal was received since the last call
+   */
+  static bool consumeSignalTrigger();
+
+ private:
+  static constexpr int kRecordHeaderLen = sizeof(uint64_t);  ///< timestamp in front of each message
+
+  void handleMessage(const uint8_t* message, int length);
+  void pushRecord(uint64_t timestamp, const uint8_t* message, int length);
+  void evictOldest();
+  void copyFromRing(size_t offset, uint8_t* dest, size_t length) const;
+  size_t recordLength(size_t offset) const;
+
+  const Config _config;
+
+  std::vector<uint8_t> _header;      ///< file header and definitions section
+  std::vector<uint8_t> _persistent;  ///< messages from the data section that must always be dumped
+  bool _header_complete{false};
+
+  MessageSplitter _splitter;
+
+  std::vector<uint8_t> _ring;
+  size_t _ring_head{0};  ///< next write offset
+  size_t _ring_tail{0};  ///< oldest record
+  size_t _ring_used{0};
+  uint64_t _latest_timestamp{0};
+
+  std::vector<uint8_t> _dump_buffer;
+  Stats _stats;
+};
+
+}  // namespace ulog_cpp
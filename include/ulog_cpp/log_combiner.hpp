@@ -0,0 +1,120 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "data_container.hpp"
+#include "writer.hpp"
+
+namespace ulog_cpp {
+
+struct LogCombinerStats {
+  uint64_t messages_out{0};   ///< data section
+  uint64_t bytes_out{0};      ///< data section, without remapped format registrations
+  uint32_t subscriptions{0};  ///< AddLoggedMessage's written
+  uint64_t dropped_data{0};   ///< data messages of unknown subscriptions
+};
+
+/**
+ * Timestamp of a data or text message (of the first sample for DATA_ENCODED)
+ * @return false if the message has no timestamp
+ */
+bool messageTimestamp(const uint8_t* message, size_t length, uint64_t& timestamp);
+
+/**
+ * Writes the messages of several logs (inputs) into one log, used by LogMerger and ShmLogDaemon.
+ *
+ * The definitions sections of the inputs are combined: formats are united (a format defined
+ * differently by two inputs is an error), for info messages, parameters and default parameters
+ * the first input defining a key wins. Messages of the data sections are copied undecoded, only
+ * the ids are rewritten:
+ * - msg_ids of AddLoggedMessage's get unique values in the combined log
+ * - the multi_id of a topic is changed if another input already uses it for the same topic
+ * - deferred text format ids (kDeferredFormatInfoKey) get unique values
+ * The msg_ids and text format ids of removed inputs and subscriptions are reused, but only in the
+ * next file (after writeHeader()), as a reader does not expect an id to be defined twice.
+ */
+class LogCombiner {
+ public:
+  LogCombiner();
+  ~LogCombiner();
+
+  /**
+   * Add the definitions section of an input. Throws a ParsingException if a format is defined
+   * differently than by a previous input, in which case the input is not added.
+   * @return input index for writeMessage()
+   */
+  size_t addInput(const DataContainer& header);
+
+  /**
+   * Remove an input, e.g. of a process that exited. Its subscriptions, multi_ids and text formats
+   * are released, its formats are kept.
+   */
+  void removeInput(size_t input);
+
+  /**
+   * Whether few msg_ids or text format ids are left for the current file, and starting a new one
+   * (writeHeader()) would make released ids available again
+   */
+  bool idsRunningOut() const;
+
+  /// Formats of all inputs added so far
+  const std::map<std::string, MessageFormat>& formats() const { return _formats; }
+
+  /**
+   * Write the file header and the definitions section of the current inputs, followed by the
+   * active subscriptions and text format registrations, so a new file can be started at any time.
+   */
+  void writeHeader(Writer& writer, uint64_t timestamp);
+
+  /**
+   * Rewrite the ids of a message from the data section of an input in place, and write it.
+   * @return false if the message was dropped (data of an unknown subscription)
+   */
+  bool writeMessage(size_t input, uint8_t* message, size_t length, Writer& writer);
+
+  const LogCombinerStats& stats() const { return _stats; }
+
+ private:
+  struct Input;
+
+  /**
+   * Merged ids of one kind: never used ids first, then the ones released before the current file
+   */
+  struct IdAllocator {
+    /// @return false if there is none left
+    bool allocate(uint16_t& id);
+    void release(uint16_t id) { released.push_back(id); }
+    /// Ids released so far can be used in the new file
+    void newFile();
+    size_t available() const;
+
+    uint32_t next{0};
+    std::vector<uint16_t> free;
+    std::vector<uint16_t> released;  ///< still defined in the current file
+  };
+
+  MessageInfo remapFormatInfo(Input& input, const MessageInfo& message_info);
+  uint8_t assignMultiId(Input& input, const std::string& message_name, uint8_t multi_id);
+
+  std::vector<std::unique_ptr<Input>> _inputs;  ///< nullptr for removed inputs
+  std::map<std::string, MessageFormat> _formats;
+  std::map<uint16_t, AddLoggedMessage> _subscriptions;  ///< active, by merged msg_id
+  std::map<uint16_t, MessageInfo> _format_infos;  ///< remapped text format registrations, by id
+  IdAllocator _msg_ids;
+  IdAllocator _format_ids;
+  std::unordered_map<std::string, std::vector<bool>> _used_multi_ids;  ///< by topic name
+
+  LogCombinerStats _stats;
+};
+
+}  // namespace ulog_cpp
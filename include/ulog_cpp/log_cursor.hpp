@@ -0,0 +1,195 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "basic_reader.hpp"
+#include "data_container.hpp"
+
+namespace ulog_cpp {
+
+struct LogCursorConfig {
+  std::vector<std::string> topics;    ///< data of these topics only, empty: all
+  bool data_only{false};              ///< skip all messages except data samples
+  size_t read_chunk_size{64 * 1024};  ///< [bytes] parsed at a time, bounds the memory use
+};
+
+/**
+ * Pull-style reading of a log: instead of passing every message to a handler, the messages of the
+ * data section are returned one at a time on request, so the caller can stop early or read at its
+ * own pace (e.g. the next 1000 samples of a topic):
+ * @code
+ * ulog_cpp::LogCursor cursor("log.ulg", {{"vehicle_status"}, true});
+ * for (const auto& message : cursor) {
+ *   const ulog_cpp::DataView sample = message.data();
+ *   ...
+ * }
+ * @endcode
+ * The definitions section is read by the constructor (@see header()). The data section is then
+ * parsed lazily, read_chunk_size bytes at a time, with a reader in raw mode, so messages are not
+ * decoded unless the caller does it (e.g. Logging{message.raw()}). Returned messages point into
+ * the current chunk of the file or buffer, only messages crossing a chunk boundary are copied.
+ * Encoded data (DATA_ENCODED) is decoded into DATA messages.
+ */
+class LogCursor {
+ public:
+  /**
+   * Message of the data section, valid until the cursor is advanced
+   */
+  class Message {
+   public:
+    ULogMessageType type() const
+    {
+      return static_cast<ULogMessageType>(
+          reinterpret_cast<const ulog_message_header_s*>(_raw)->msg_type);
+    }
+
+    /// Complete message, including the ULog message header
+    const uint8_t* raw() const { return _raw; }
+    size_t size() const { return _size; }
+
+    /// Timestamp of a data or text message, @return false if the message has none
+    bool timestamp(uint64_t& timestamp) const;
+
+    /// Subscription id of a DATA message
+    uint16_t msgId() const { return reinterpret_cast<const ulog_message_data_s*>(_raw)->msg_id; }
+    /// Payload of a DATA message
+    DataView data() const
+    {
+      return {msgId(), _raw + sizeof(ulog_message_data_s),
+              static_cast<uint32_t>(_size - sizeof(ulog_message_data_s))};
+    }
+
+   private:
+    friend class LogCursor;
+
+    const uint8_t* _raw{nullptr};
+    size_t _size{0};
+  };
+
+  /**
+   * Input iterator over the remaining messages. Incrementing it advances the cursor, so all
+   * iterators of a cursor refer to the same position.
+   */
+  class Iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Message;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Message*;
+    using reference = const Message&;
+
+    explicit Iterator(LogCursor* cursor = nullptr) : _cursor(cursor) {}
+
+    reference operator*() const { return _cursor->message(); }
+    pointer operator->() const { return &_cursor->message(); }
+    Iterator& operator++()
+    {
+      if (!_cursor->next()) {
+        _cursor = nullptr;
+      }
+      return *this;
+    }
+
+    bool operator==(const Iterator& other) const { return _cursor == other._cursor; }
+    bool operator!=(const Iterator& other) const { return _cursor != other._cursor; }
+
+   private:
+    LogCursor* _cursor;
+  };
+
+  /**
+   * Read a log file. Throws a ParsingException if it cannot be opened or has an invalid header.
+   */
+  explicit LogCursor(const std::string& filename, LogCursorConfig config = {});
+
+  /**
+   * Read a log from memory, e.g. a memory-mapped file. The data is not copied and must outlive the
+   * cursor. Throws a ParsingException if the header is invalid.
+   */
+  LogCursor(const uint8_t* data, size_t length, LogCursorConfig config = {});
+
+  ~LogCursor();
+
+  LogCursor(const LogCursor&) = delete;
+  LogCursor& operator=(const LogCursor&) = delete;
+
+  /// Definitions section (formats, info, initial parameters)
+  const DataContainer& header() const { return _header; }
+
+  /// Subscriptions seen so far, @return nullptr if msg_id is unknown
+  const AddLoggedMessage* subscription(uint16_t msg_id) const;
+
+  /**
+   * Advance to the next message
+   * @return false at the end of the log
+   */
+  bool next();
+
+  /// Current message, after next() returned true
+  const Message& message() const { return _message; }
+
+  /// Continues with the message after the current one
+  Iterator begin() { return next() ? Iterator{this} : Iterator{}; }
+  Iterator end() { return Iterator{}; }
+
+  /// Parsing errors of the data section read so far
+  const std::vector<std::string>& errors() const { return _errors; }
+
+ private:
+  class Collector;
+
+  void readHeader();
+  bool readNextChunk();
+  bool refill();
+
+  void addMessage(const uint8_t* message, size_t length);
+  uint16_t addSubscription(const uint8_t* message);  ///< @return msg_id
+  void addEncodedData(const uint8_t* message);
+
+  const LogCursorConfig _config;
+  const std::unordered_set<std::string> _topics;
+
+  // Input: either a file or a buffer
+  FILE* _file{nullptr};
+  const uint8_t* _data{nullptr};
+  size_t _length{0};
+  uint64_t _position{0};
+  std::vector<uint8_t> _read_buffer;
+  const uint8_t* _chunk{nullptr};  ///< currently parsed, messages within are not copied
+  size_t _chunk_length{0};
+
+  DataContainer _header{DataContainer::StorageConfig::Header};
+  std::unique_ptr<Collector> _collector;
+  std::unique_ptr<BasicReader<Collector>> _reader;
+
+  std::unordered_map<uint16_t, AddLoggedMessage> _subscriptions;
+  std::vector<bool> _kept_msg_ids;  ///< indexed by msg_id
+  std::unordered_map<uint16_t, DataDecoder> _decoders;
+
+  // Messages of the current chunk
+  struct Entry {
+    const uint8_t* message;  ///< in the chunk, or nullptr if copied to _copied
+    size_t offset;           ///< in _copied
+    size_t length;
+  };
+  std::vector<Entry> _entries;
+  std::vector<uint8_t> _copied;
+  size_t _next_entry{0};
+  Message _message;
+
+  std::vector<std::string> _errors;
+};
+
+}  // namespace ulog_cpp
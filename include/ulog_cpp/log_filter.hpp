@@ -0,0 +1,68 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "writer.hpp"
+
+namespace ulog_cpp {
+
+struct LogFilterConfig {
+  std::vector<std::string> topics;          ///< topics to keep, empty: all
+  std::vector<std::string> exclude_topics;  ///< topics to drop
+  uint64_t start_timestamp{0};              ///< [us] drop data and text messages before
+  uint64_t end_timestamp{std::numeric_limits<uint64_t>::max()};  ///< [us] and after
+  bool drop_text{false};                                         ///< drop all text messages
+};
+
+struct LogFilterStats {
+  uint64_t messages_in{0};
+  uint64_t messages_out{0};
+  uint64_t bytes_out{0};  ///< without the file header
+};
+
+/**
+ * Copies a log with a subset of its messages. It is a handler for a reader in raw mode, so the
+ * messages are not decoded and kept messages are written unchanged:
+ * @code
+ * ulog_cpp::LogFilter filter(write_cb, config);
+ * ulog_cpp::BasicReader<ulog_cpp::LogFilter> reader{filter};
+ * reader.setRawMode(true);
+ * reader.readChunk(...);
+ * @endcode
+ * The definitions section, info messages, parameters and dropouts are always kept, so the message
+ * ids of the kept topics do not change. The timestamp of a data message is its first field.
+ * Encoded data blocks (DATA_ENCODED) are kept or dropped as a whole, by their first timestamp.
+ */
+class LogFilter final : public DataHandlerInterface {
+ public:
+  LogFilter(DataWriteCB data_write_cb, LogFilterConfig config);
+
+  void fileHeader(const FileHeader& header) override;
+  void rawMessage(const uint8_t* message, size_t length) override;
+  void error(const std::string& msg, bool is_recoverable) override;
+
+  const LogFilterStats& stats() const { return _stats; }
+  const std::vector<std::string>& errors() const { return _errors; }
+
+ private:
+  bool keepTopic(const std::string& topic) const;
+  bool inTimeRange(const uint8_t* message, size_t length, size_t timestamp_offset) const;
+
+  Writer _writer;
+  const LogFilterConfig _config;
+  std::unordered_set<std::string> _topics;
+  std::unordered_set<std::string> _exclude_topics;
+  std::vector<bool> _kept_msg_ids;  ///< indexed by msg_id
+  LogFilterStats _stats;
+  std::vector<std::string> _errors;
+};
+
+}  // namespace ulog_cpp
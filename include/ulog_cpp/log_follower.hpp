@@ -0,0 +1,96 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "data_handler_interface.hpp"
+#include "reader.hpp"
+
+namespace ulog_cpp {
+
+struct LogFollowerConfig {
+  /// Continue with the next segment when zz_data_log rotates the file: "log.ulg" --> "log.1.ulg"
+  bool follow_rotation{true};
+  size_t read_chunk_size{64 * 1024};
+};
+
+/**
+ * Reads a log while it is being written (live tail). New data is passed to a Reader as it is
+ * appended, so a partially written message is kept until it is complete. Linux only: waiting uses
+ * inotify on the directory of the log, there is no busy polling.
+ *
+ * The file does not need to exist yet. With follow_rotation, once the next segment of the
+ * zz_data_log rotation exists, the current one is read to its end and the next one is read with a
+ * new Reader, so the handler gets fileHeader() and the definitions section again.
+ *
+ * Notes on the writer:
+ * - Data buffered in the writing process (e.g. by the stdio sink) is only seen once it is flushed.
+ * - Writes through FileSinkType::Mmap do not generate inotify events: the file is then read up to
+ *   the size in its commit marker on each poll() timeout.
+ * - Space preallocated by FileSinkType::Direct reads as zeros, so that sink cannot be followed.
+ */
+class LogFollower {
+ public:
+  /**
+   * Throws a ParsingException if inotify is not available or the directory does not exist.
+   */
+  LogFollower(std::string filename, std::shared_ptr<DataHandlerInterface> handler,
+              LogFollowerConfig config = {});
+  ~LogFollower();
+
+  LogFollower(const LogFollower&) = delete;
+  LogFollower& operator=(const LogFollower&) = delete;
+
+  /**
+   * Read all data available now. If there is none, wait up to timeout for the file to change
+   * (or for interrupt()) and read again.
+   * @return number of bytes read
+   */
+  size_t poll(std::chrono::milliseconds timeout);
+
+  /// Wake up a blocking poll(), may be called from another thread or a signal handler
+  void interrupt();
+
+  /// The writer closed the current segment and everything was read (no next segment yet). Reset
+  /// when the writer reopens the segment and appends to it.
+  bool closed() const { return _closed; }
+
+  /// Current segment
+  const std::string& filename() const { return _filename; }
+  uint32_t segment() const { return _segment; }  ///< 0 for the first file
+  uint64_t bytesRead() const { return _bytes_read; }
+
+ private:
+  size_t readAvailable();
+  size_t readToEnd();
+  uint64_t readableSize() const;
+  void startSegment(std::string filename);
+  void waitForEvents(std::chrono::milliseconds timeout);
+
+  const LogFollowerConfig _config;
+  const std::shared_ptr<DataHandlerInterface> _handler;
+  std::unique_ptr<Reader> _reader;
+
+  std::string _filename;
+  std::string _next_filename;
+  std::string _marker_filename;
+  uint32_t _segment{0};
+  int _fd{-1};
+  uint64_t _offset{0};  ///< in the current segment
+  uint64_t _bytes_read{0};
+  bool _closed{false};
+  bool _close_seen{false};  ///< IN_CLOSE_WRITE since the last read
+
+  int _inotify_fd{-1};
+  int _wake_fd{-1};
+  std::vector<uint8_t> _buffer;
+};
+
+}  // namespace ulog_cpp
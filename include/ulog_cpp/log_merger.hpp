@@ -0,0 +1,68 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "data_container.hpp"
+#include "log_combiner.hpp"
+#include "writer.hpp"
+
+namespace ulog_cpp {
+
+struct LogMergerConfig {
+  size_t read_ahead_bytes{4 * 1024 * 1024};  ///< data buffered per input
+};
+
+using LogMergerStats = LogCombinerStats;
+
+/**
+ * Merges several logs, e.g. one per process, into a single log.
+ *
+ * The definitions sections are read first and combined (@see LogCombiner for how formats and ids
+ * are handled). The data sections are then merged by timestamp, with every input read by its own
+ * thread into a bounded buffer, so memory does not grow with the size of the inputs.
+ *
+ * The inputs are assumed to be sorted by time, as written by a logger. Messages without timestamp
+ * are ordered by the last timestamp of their input, so the order within an input is kept.
+ */
+class LogMerger {
+ public:
+  explicit LogMerger(std::vector<std::string> filenames, LogMergerConfig config = {});
+  ~LogMerger();
+
+  LogMerger(const LogMerger&) = delete;
+  LogMerger& operator=(const LogMerger&) = delete;
+
+  /**
+   * Write the merged log. Throws ParsingException if an input cannot be read or the inputs have
+   * conflicting formats, in which case nothing is written.
+   */
+  void merge(const DataWriteCB& data_write_cb);
+
+  const LogMergerStats& stats() const { return _combiner.stats(); }
+
+  /// Parsing errors of the inputs, prefixed with the file name
+  const std::vector<std::string>& errors() const { return _errors; }
+
+ private:
+  class Input;
+
+  void readHeaders();
+  void writeHeader(Writer& writer);
+  void mergeData(Writer& writer);
+
+  const std::vector<std::string> _filenames;
+  const LogMergerConfig _config;
+  std::vector<std::unique_ptr<Input>> _inputs;
+
+  LogCombiner _combiner;
+  std::vector<std::string> _errors;
+};
+
+}  // namespace ulog_cpp
@@ -0,0 +1,45 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace ulog_cpp {
+
+struct RecoveryResult {
+  uint64_t file_size{0};       ///< [bytes] before recovery
+  uint64_t valid_size{0};      ///< [bytes] up to the end of the last complete message
+  uint64_t num_messages{0};    ///< complete messages (without the file header)
+  bool commit_marker{false};   ///< a commit marker of FileSinkType::Mmap was found
+  uint64_t committed_size{0};  ///< [bytes] stored in the commit marker
+};
+
+/**
+ * Commit marker written next to a log by FileSinkType::Mmap while the file is open. It holds the
+ * end offset of the last complete message and is removed when the file is closed normally.
+ */
+std::string commitMarkerFilename(const std::string& filename);
+
+/** Content of the commit marker file */
+struct ulog_commit_marker_s {
+  uint8_t magic[8];
+  uint64_t committed_size;  ///< [bytes] written up to the end of the last complete message
+};
+
+static constexpr uint8_t ulog_commit_marker_magic[8] = {'U', 'L', 'o', 'g', 'C', 'm', 't', 0x01};
+
+/**
+ * Finalize a log that was not closed properly (e.g. after a crash of the writing process): the file
+ * is truncated after the last complete message, which removes partially written messages and the
+ * preallocated space. If a commit marker exists, the file is not kept beyond the committed size and
+ * the marker is removed.
+ * The messages are only checked for a valid type and length, not parsed.
+ * @param truncate false to only determine the valid size
+ * Throws a ParsingException if the file cannot be read or does not start with a ULog file header.
+ */
+RecoveryResult recoverLog(const std::string& filename, bool truncate = true);
+
+}  // namespace ulog_cpp
@@ -0,0 +1,101 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "raw_messages.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Whether a sink may drop a message if its receiver is too slow (followed by a dropout message),
+ * as the log stays readable without it: data samples, including encoded blocks (which are
+ * self-contained), text messages, sync and dropout messages.
+ */
+bool isDroppable(ULogMessageType type);
+
+/**
+ * Dropout message for the time since dropping_since, at most 65535 ms
+ */
+ulog_message_dropout_s dropoutSince(std::chrono::steady_clock::time_point dropping_since);
+
+/**
+ * Splits serialized ULog data written in arbitrary pieces (e.g. by a Writer) into the file header
+ * and complete messages, for sinks that handle messages individually. Messages within a piece are
+ * passed in place, only messages spanning pieces are copied.
+ */
+class MessageSplitter {
+ public:
+  /**
+   * @param file_header_cb called once with the complete file header
+   * @param message_cb called with each complete message, including the ULog message header
+   */
+  template <typename FileHeaderCB, typename MessageCB>
+  void write(const uint8_t* data, size_t length, FileHeaderCB&& file_header_cb,
+             MessageCB&& message_cb);
+
+ private:
+  static size_t messageSize(const uint8_t* message)
+  {
+    uint16_t msg_size;
+    memcpy(&msg_size, message, sizeof(msg_size));
+    return ULOG_MSG_HEADER_LEN + msg_size;
+  }
+
+  /// Append up to required - _pending.size() bytes. @return true if _pending has required bytes
+  bool fillPending(const uint8_t*& data, size_t& length, size_t required)
+  {
+    const size_t num_bytes = std::min(length, required - _pending.size());
+    _pending.insert(_pending.end(), data, data + num_bytes);
+    data += num_bytes;
+    length -= num_bytes;
+    return _pending.size() == required;
+  }
+
+  std::vector<uint8_t> _pending;  ///< incomplete file header or message
+  bool _file_header_complete{false};
+};
+
+template <typename FileHeaderCB, typename MessageCB>
+void MessageSplitter::write(const uint8_t* data, size_t length, FileHeaderCB&& file_header_cb,
+                            MessageCB&& message_cb)
+{
+  if (!_file_header_complete) {
+    if (!fillPending(data, length, sizeof(ulog_file_header_s))) {
+      return;
+    }
+    file_header_cb(_pending.data(), _pending.size());
+    _pending.clear();
+    _file_header_complete = true;
+  }
+
+  // Complete the message started by a previous write
+  if (!_pending.empty()) {
+    if (_pending.size() < ULOG_MSG_HEADER_LEN &&
+        !fillPending(data, length, ULOG_MSG_HEADER_LEN)) {
+      return;
+    }
+    if (!fillPending(data, length, messageSize(_pending.data()))) {
+      return;
+    }
+    message_cb(_pending.data(), _pending.size());
+    _pending.clear();
+  }
+
+  while (length >= ULOG_MSG_HEADER_LEN && messageSize(data) <= length) {
+    const size_t size = messageSize(data);
+    message_cb(data, size);
+    data += size;
+    length -= size;
+  }
+  _pending.assign(data, data + length);
+}
+
+}  // namespace ulog_cpp
@@ -220,6 +220,43 @@ class Logging {
   std::string _message;
 };
 
+/**
+ * Text message with deferred formatting (ULogMessageType::LOGGING_DEFERRED): the id of a format
+ * string and the encoded arguments. Expanded with a DeferredFormatter.
+ */
+class DeferredLogging {
+ public:
+  explicit DeferredLogging(const uint8_t* msg);
+
+  DeferredLogging(Logging::Level level, uint16_t format_id, uint64_t timestamp,
+                  std::vector<uint8_t> args);
+
+  Logging::Level logLevel() const { return _log_level; }
+  uint16_t formatId() const { return _format_id; }
+  uint64_t timestamp() const { return _timestamp; }
+  const std::vector<uint8_t>& args() const { return _args; }
+
+  void serialize(const DataWriteCB& writer) const;
+
+  /**
+   * Serialize without constructing a DeferredLogging (single call of the writer)
+   */
+  static void serialize(const DataWriteCB& writer, Logging::Level level, uint16_t format_id,
+                        uint64_t timestamp, const uint8_t* args, size_t args_length);
+
+  bool operator==(const DeferredLogging& logging) const
+  {
+    return _log_level == logging._log_level && _format_id == logging._format_id &&
+           _timestamp == logging._timestamp && _args == logging._args;
+  }
+
+ private:
+  Logging::Level _log_level{};
+  uint16_t _format_id{};
+  uint64_t _timestamp{};
+  std::vector<uint8_t> _args;
+};
+
 class Data {
  public:
   explicit Data(const uint8_t* msg);
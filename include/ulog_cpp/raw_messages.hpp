@@ -24,6 +24,8 @@ enum class ULogMessageType : uint8_t {
   LOGGING = 'L',
   LOGGING_TAGGED = 'C',
   FLAG_BITS = 'B',
+  DATA_ENCODED = 'E',  ///< Extension: block of delta/XOR encoded DATA samples
+  LOGGING_DEFERRED = 'T',  ///< Extension: text message as format id and raw arguments
 };
 
 /* declare message data structs with byte alignment (no padding) */
@@ -159,6 +161,24 @@ struct ulog_message_data_s {
   uint16_t msg_id;
 };
 
+/**
+ * @brief Encoded Data Message (extension)
+ *
+ * Contains a block of num_samples consecutive samples of the same msg_id. The first sample is
+ * stored as-is, followed by a bit stream with the delta-of-delta encoded timestamps and the
+ * XOR encoded field values of the remaining samples (see DataEncoder).
+ *
+ * Only written if ULOG_COMPAT_FLAG0_ENCODED_DATA_MASK is set in the flag bits. Readers that do not
+ * know this message type skip it.
+ */
+struct ulog_message_data_encoded_s {
+  uint16_t msg_size;  ///< size of message - ULOG_MSG_HEADER_LEN
+  uint8_t msg_type = static_cast<uint8_t>(ULogMessageType::DATA_ENCODED);
+
+  uint16_t msg_id;
+  uint16_t num_samples;
+};
+
 /**
  * @brief Information Message
  *
@@ -215,6 +235,22 @@ struct ulog_message_logging_tagged_s {
   char message[128];  ///< defines the maximum length of a logged message string
 };
 
+/**
+ * @brief Deferred Logging Message (extension)
+ *
+ * Text message of a format string that was registered before as INFO_MULTIPLE "log_format"
+ * (@see DeferredFormatter). Followed by the encoded arguments (@see DeferredArg). Readers that do
+ * not know this message type skip it.
+ */
+struct ulog_message_logging_deferred_s {
+  uint16_t msg_size;  ///< size of message - ULOG_MSG_HEADER_LEN
+  uint8_t msg_type = static_cast<uint8_t>(ULogMessageType::LOGGING_DEFERRED);
+
+  uint8_t log_level;  ///< same levels as in the linux kernel
+  uint16_t format_id;
+  uint64_t timestamp;
+};
+
 /**
  * @brief Parameter Message
  *
@@ -268,6 +304,7 @@ struct ulog_message_parameter_default_s {
 #define ULOG_INCOMPAT_FLAG0_DATA_APPENDED_MASK (1 << 0)
 
 #define ULOG_COMPAT_FLAG0_DEFAULT_PARAMETERS_MASK (1 << 0)
+#define ULOG_COMPAT_FLAG0_ENCODED_DATA_MASK (1 << 1)
 
 struct ulog_message_flag_bits_s {
   uint16_t msg_size;
@@ -0,0 +1,108 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "file_sink.hpp"
+#include "log_combiner.hpp"
+#include "shm_transport.hpp"
+#include "writer.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Logging daemon of the shared memory transport (@see ShmTransportConfig): reads the logs of all
+ * registered producers (ShmLogProducer, e.g. zz_data_log in shared memory mode) and writes them
+ * into one file with a LogCombiner, so ids of different processes do not collide.
+ *
+ * The messages read from all rings in one poll() are merged by timestamp. A producer is added to
+ * the log once its definitions section is complete. ULog requires all formats in the header, so
+ * if a producer brings formats that are not in the current file, a new file is started (with all
+ * formats, active subscriptions and text formats). A new file is also started when the ids of
+ * removed producers are needed again, so producers can come and go indefinitely. A producer
+ * defining a format differently than others is rejected. Producers that exit (or crash) are
+ * removed after their ring is read.
+ */
+class ShmLogDaemon {
+ public:
+  struct Config {
+    /// First file, later files are numbered: "log.ulg" --> "log.1.ulg" --> "log.2.ulg"
+    std::string filename{"log.ulg"};
+    FileSinkConfig sink_config;
+    /// [ms] collect producers before writing the first file, so it contains all of their formats
+    uint32_t startup_wait_ms{200};
+    uint32_t sync_interval_ms{1000};  ///< [ms] fsync of the file
+  };
+
+  struct Stats {
+    uint32_t producers{0};           ///< currently attached
+    uint32_t producers_total{0};     ///< attached since start
+    uint32_t rejected_producers{0};  ///< conflicting formats
+    uint32_t files{0};
+    uint64_t bytes_read{0};  ///< from the rings
+  };
+
+  /**
+   * Create the registry, so producers can register. Throws a ParsingException if the shared
+   * memory cannot be created.
+   */
+  ShmLogDaemon(const ShmTransportConfig& transport_config, Config config);
+  ~ShmLogDaemon();
+
+  ShmLogDaemon(const ShmLogDaemon&) = delete;
+  ShmLogDaemon& operator=(const ShmLogDaemon&) = delete;
+
+  /**
+   * Attach new producers, read all rings and write the messages. Does not block.
+   */
+  void poll();
+
+  /**
+   * poll() until stop is set
+   */
+  void run(const std::atomic<bool>& stop, std::chrono::milliseconds poll_interval);
+
+  const Stats& stats() const { return _stats; }
+  const LogCombinerStats& combinerStats() const { return _combiner.stats(); }
+
+  /// Current file, empty before the first one is opened
+  const std::string& filename() const { return _filename; }
+
+  /// Parsing errors and rejected producers
+  const std::vector<std::string>& errors() const { return _errors; }
+
+ private:
+  class Producer;
+
+  void attachProducers();
+  void admitProducers();
+  void openFile();
+  void writePending();
+  void removeProducer(size_t index);
+
+  const ShmTransportConfig _transport_config;
+  const Config _config;
+  std::unique_ptr<ShmRegistry> _registry;
+  std::vector<std::unique_ptr<Producer>> _producers;
+
+  LogCombiner _combiner;
+  size_t _num_written_formats{0};  ///< formats in the current file
+  std::unique_ptr<FileSink> _file;
+  std::unique_ptr<Writer> _writer;
+  std::string _filename;
+
+  std::chrono::steady_clock::time_point _start_time;
+  std::chrono::steady_clock::time_point _last_sync;
+  Stats _stats;
+  std::vector<std::string> _errors;
+};
+
+}  // namespace ulog_cpp
@@ -0,0 +1,213 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "message_stream.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Shared memory transport between logging processes (ShmLogProducer) and a logging daemon
+ * (ShmLogDaemon), which writes the logs of all processes into one file. Linux only (POSIX shared
+ * memory), no network.
+ *
+ * The daemon creates a registry segment with the given name. Each producer claims a slot in the
+ * registry and creates its own ring segment ("<name>.<pid>.<slot>"), into which it writes its
+ * serialized log: the definitions section (formats, info messages, parameters) is the control
+ * channel, followed by the data. The daemon attaches rings as producers register.
+ */
+struct ShmTransportConfig {
+  std::string name{"/zz_data_log"};   ///< registry segment, at most 200 characters
+  size_t ring_size{4 * 1024 * 1024};  ///< [bytes] per producer
+  uint32_t max_producers{64};         ///< used by the daemon
+  /// [ms] how long a producer waits for ring space for messages that must not be dropped
+  /// (definitions, subscriptions, info messages, parameters), before it gives up
+  uint32_t blocking_timeout_ms{1000};
+};
+
+/**
+ * Single-producer single-consumer byte ring in a POSIX shared memory segment. Written messages are
+ * published as a whole. Lock-free, the positions are atomic counters in the segment.
+ */
+class ShmRing {
+ public:
+  /**
+   * Create a ring (producer). An existing segment with that name is replaced.
+   * Throws a ParsingException if the segment cannot be created.
+   */
+  static std::unique_ptr<ShmRing> create(const std::string& name, size_t capacity);
+
+  /**
+   * Open a ring created by another process (consumer).
+   * Throws a ParsingException if the segment does not exist or is not a ring.
+   */
+  static std::unique_ptr<ShmRing> open(const std::string& name);
+
+  /// Remove the segment name, the mapping stays valid
+  static void unlink(const std::string& name);
+
+  ~ShmRing();
+
+  ShmRing(const ShmRing&) = delete;
+  ShmRing& operator=(const ShmRing&) = delete;
+
+  /**
+   * Append data if there is enough space for all of it. Never blocks.
+   * @return false if the ring is full
+   */
+  bool tryWrite(const uint8_t* data, size_t length);
+
+  /**
+   * Pass all written data to read_cb (in up to two calls, in order) and release the space.
+   * @return number of bytes read
+   */
+  size_t read(const std::function<void(const uint8_t*, size_t)>& read_cb);
+
+  /// Producer: no more data will be written
+  void close();
+  bool closed() const;
+
+  /// Producer process id (stored by create())
+  int pid() const;
+
+  size_t capacity() const { return _capacity; }
+  const std::string& name() const { return _name; }
+
+ private:
+  struct Header;
+
+  ShmRing(std::string name, void* mapping, size_t mapping_size);
+
+  const std::string _name;
+  void* const _mapping;
+  const size_t _mapping_size;
+  Header* const _header;
+  uint8_t* const _data;
+  const size_t _capacity;
+};
+
+/**
+ * Registry of producers in a shared memory segment, created by the daemon.
+ * A producer claims a Free slot (Claimed), creates its ring and publishes it (Ready). The daemon
+ * then opens the ring (Attached), and frees the slot when the producer is gone.
+ */
+class ShmRegistry {
+ public:
+  enum class SlotState : uint32_t {
+    Free = 0,
+    Claimed,
+    Ready,
+    Attached,
+  };
+
+  /**
+   * Create the registry (daemon). An existing segment with that name is replaced.
+   */
+  static std::unique_ptr<ShmRegistry> create(const std::string& name, uint32_t num_slots);
+
+  /**
+   * Open the registry of a running daemon (producer).
+   * Throws a ParsingException if there is none.
+   */
+  static std::unique_ptr<ShmRegistry> open(const std::string& name);
+
+  ~ShmRegistry();  ///< the creator removes the segment
+
+  ShmRegistry(const ShmRegistry&) = delete;
+  ShmRegistry& operator=(const ShmRegistry&) = delete;
+
+  uint32_t numSlots() const;
+
+  // Producer
+  /// @return claimed slot, or -1 if all are in use
+  int claim(int pid);
+  void publish(uint32_t slot, const std::string& ring_name);
+  /// Release a slot that was not attached by the daemon yet. @return false if it was attached
+  bool withdraw(uint32_t slot);
+
+  // Daemon
+  SlotState state(uint32_t slot) const;
+  int pid(uint32_t slot) const;
+  std::string ringName(uint32_t slot) const;
+  /// @return false if the producer withdrew in the meantime
+  bool attach(uint32_t slot);
+  void release(uint32_t slot);
+
+ private:
+  struct Header;
+  struct Slot;
+
+  ShmRegistry(std::string name, void* mapping, size_t mapping_size, bool owner);
+  Slot& slot(uint32_t index) const;
+
+  const std::string _name;
+  void* const _mapping;
+  const size_t _mapping_size;
+  const bool _owner;
+};
+
+/**
+ * Sink for serialized ULog data (e.g. the callback of a Writer or zz_data_log) that passes the log
+ * of this process to a ShmLogDaemon. Data does not need to be aligned to message boundaries.
+ *
+ * Writing never blocks on the daemon for data and text messages (@see isDroppable()): if the ring
+ * is full, they are dropped, and a dropout message with the duration is written once there is space again.
+ * Other messages (definitions, subscriptions, info messages, parameters) wait up to
+ * blocking_timeout_ms for space, as the log cannot be read without them. If one still does not
+ * fit, the producer is broken: the ring is closed, so the daemon removes it, and all further
+ * writes are discarded.
+ * Not thread-safe, the caller serializes writes (as zz_data_log does).
+ */
+class ShmLogProducer {
+ public:
+  struct Stats {
+    uint64_t messages{0};          ///< written to the ring
+    uint64_t dropped_messages{0};  ///< ring full
+  };
+
+  /**
+   * Register at the daemon. Throws a ParsingException if no daemon is running or all producer
+   * slots are used.
+   */
+  explicit ShmLogProducer(const ShmTransportConfig& config);
+  ~ShmLogProducer();
+
+  ShmLogProducer(const ShmLogProducer&) = delete;
+  ShmLogProducer& operator=(const ShmLogProducer&) = delete;
+
+  void write(const uint8_t* data, int length);
+
+  const Stats& stats() const { return _stats; }
+
+  /// A message that must not be dropped timed out, nothing is written anymore
+  bool broken() const { return _broken; }
+
+ private:
+  void handleMessage(const uint8_t* message, size_t length);
+  bool writeDropout();
+  /// Wait up to blocking_timeout_ms for space, mark the producer broken on timeout
+  void writeBlocking(const uint8_t* data, size_t length);
+
+  const ShmTransportConfig _config;
+  std::unique_ptr<ShmRegistry> _registry;
+  int _slot{-1};
+  std::unique_ptr<ShmRing> _ring;
+
+  MessageSplitter _splitter;
+
+  bool _dropping{false};
+  std::chrono::steady_clock::time_point _dropping_since;
+  bool _broken{false};
+  Stats _stats;
+};
+
+}  // namespace ulog_cpp
@@ -10,6 +10,8 @@
 #include <unordered_map>
 #include <vector>
 
+#include "deferred_logging.hpp"
+#include "file_sink.hpp"
 #include "writer.hpp"
 
 namespace ulog_cpp {
@@ -24,14 +26,19 @@ class SimpleWriter {
    * Constructor with a callback for writing data.
    * @param data_write_cb callback for serialized ULog data
    * @param timestamp_us start timestamp [us]
+   * @param encode_data write delta/XOR encoded data (@see Writer)
    */
-  explicit SimpleWriter(DataWriteCB data_write_cb, uint64_t timestamp_us);
+  explicit SimpleWriter(DataWriteCB data_write_cb, uint64_t timestamp_us,
+                        bool encode_data = false);
   /**
    * Constructor to write to a file.
    * @param filename ULog file to write to (will be overwritten if it exists)
    * @param timestamp_us  start timestamp [us]
+   * @param encode_data write delta/XOR encoded data (@see Writer)
+   * @param sink_config how the file is written (@see createFileSink())
    */
-  explicit SimpleWriter(const std::string& filename, uint64_t timestamp_us);
+  explicit SimpleWriter(const std::string& filename, uint64_t timestamp_us,
+                        bool encode_data = false, const FileSinkConfig& sink_config = {});
 
   ~SimpleWriter();
 
@@ -115,6 +122,40 @@ class SimpleWriter {
    */
   void writeTextMessage(Logging::Level level, const std::string& message, uint64_t timestamp);
 
+  /**
+   * Register a printf-style format string for writeDeferredText(). The format is written to the
+   * log once, this can be called before or after headerComplete().
+   * @tparam Args argument types: integers, bool, floating point, const char* or std::string
+   * @code
+   * const auto battery_low = writer.registerTextFormat<int, float>(Logging::Level::Warning,
+   *                                                                "Battery %i low: %.1f V");
+   * writer.writeDeferredText(battery_low, timestamp, 2, 10.4F);
+   * @endcode
+   */
+  template <typename... Args>
+  DeferredFormat<Args...> registerTextFormat(Logging::Level level, const std::string& format)
+  {
+    return {registerTextFormatImpl(deferredArgCodes<Args...>(), format), level};
+  }
+
+  /**
+   * Write a text message with deferred formatting: only the format id and the binary arguments are
+   * written, the reader formats the text (@see DeferredFormatter). This avoids the formatting cost
+   * and is smaller than writeTextMessage().
+   */
+  template <typename... FormatArgs, typename... Args>
+  void writeDeferredText(const DeferredFormat<FormatArgs...>& format, uint64_t timestamp,
+                         const Args&... args)
+  {
+    static_assert(sizeof...(FormatArgs) == sizeof...(Args), "Wrong number of format arguments");
+    if (!_header_complete) {
+      throw UsageException("Header not yet complete");
+    }
+    encodeDeferredArgs<FormatArgs...>(_text_args, static_cast<const FormatArgs&>(args)...);
+    _writer->deferredLogging(format.level, format.id, timestamp, _text_args.data(),
+                             _text_args.size());
+  }
+
   /**
    * Write some data. The timestamp must be monotonically increasing for a given time-series (i.e.
    * same id).
@@ -127,8 +168,34 @@ class SimpleWriter {
     writeDataImpl(id, reinterpret_cast<const uint8_t*>(&data), sizeof(data));
   }
 
+  /**
+   * Write count samples of the same time-series at once. The samples are validated once and
+   * handed to the output with a single call, the written data is identical to calling writeData()
+   * for each sample.
+   * @param id ID from writeAddLoggedMessage()
+   * @param data array of count samples
+   */
+  template <typename T>
+  void writeDataBatch(uint16_t id, const T* data, size_t count)
+  {
+    writeDataBatchImpl(id, reinterpret_cast<const uint8_t*>(data), sizeof(T), count);
+  }
+
+  template <typename T>
+  void writeDataBatch(uint16_t id, const std::vector<T>& data)
+  {
+    writeDataBatch(id, data.data(), data.size());
+  }
+
+  /**
+   * Write samples of different time-series at once (@see writeDataBatch()). Nothing is written if
+   * an entry is invalid.
+   */
+  void writeDataBatch(const DataBatch& batch);
+
   /**
    * Flush the buffer and call fsync() on the file (only if the file-based constructor is used).
+   * Buffered encoded data is written out in any case.
    */
   void fsync();
 
@@ -146,13 +213,20 @@ class SimpleWriter {
   };
 
   void writeDataImpl(uint16_t id, const uint8_t* data, unsigned length);
+  void writeDataBatchImpl(uint16_t id, const uint8_t* data, unsigned length, size_t count);
+  /// @return the number of bytes written per sample
+  unsigned validateData(uint16_t id, unsigned length) const;
+  uint16_t registerTextFormatImpl(const std::string& arg_codes, const std::string& format);
 
   std::unique_ptr<Writer> _writer;
-  std::FILE* _file{nullptr};
+  std::unique_ptr<FileSink> _file;
 
   bool _header_complete{false};
   std::unordered_map<std::string, Format> _formats;
   std::vector<Subscription> _subscriptions;
+  std::vector<unsigned> _batch_lengths;
+  uint16_t _num_text_formats{0};
+  std::vector<uint8_t> _text_args;
 };
 
 }  // namespace ulog_cpp
@@ -0,0 +1,152 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "data_handler_interface.hpp"
+#include "message_stream.hpp"
+#include "reader.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Streaming of a live log to a local receiver (e.g. a visualizer) over a Unix domain socket,
+ * without writing it to disk. Linux only, no network. A path starting with '@' is a socket in the
+ * abstract namespace (no file).
+ */
+struct SocketSinkConfig {
+  std::string path;
+  size_t batch_size{64 * 1024};  ///< [bytes] messages are collected and sent together
+  uint32_t batch_interval_ms{10};  ///< [ms] an incomplete batch is sent by the next write after this
+  bool drop_on_backpressure{true};     ///< drop data instead of blocking if the receiver is slow
+  size_t max_buffered{1024 * 1024};    ///< [bytes] queued for a slow receiver before dropping data
+  uint32_t blocking_timeout_ms{1000};  ///< [ms] for messages that must not be dropped
+  uint32_t reconnect_interval_ms{1000};
+};
+
+/**
+ * Sink for serialized ULog data (e.g. the callback of a Writer or zz_data_log) that streams it to a
+ * SocketReceiver. Connecting, sending and reconnecting happen within write() and flush(), there is
+ * no thread. Data does not need to be aligned to message boundaries.
+ *
+ * The header (file header and definitions section) and the state needed to read the data section
+ * (subscriptions, info messages such as text format registrations, the latest parameter values)
+ * are cached, and sent first on every (re)connection, so a receiver can start at any time.
+ * Messages written while not connected are discarded.
+ *
+ * With drop_on_backpressure, data and text messages (@see isDroppable()) are dropped once max_buffered is queued for
+ * the receiver, followed by a dropout message with the duration. Other messages, and all messages
+ * without drop_on_backpressure, wait up to blocking_timeout_ms, after which the connection is
+ * closed. Not thread-safe, the caller serializes writes (as zz_data_log does).
+ */
+class SocketSink {
+ public:
+  struct Stats {
+    uint64_t messages{0};          ///< sent or queued
+    uint64_t bytes_sent{0};
+    uint64_t dropped_messages{0};  ///< receiver too slow
+    uint32_t connections{0};
+  };
+
+  explicit SocketSink(SocketSinkConfig config);
+  ~SocketSink();
+
+  SocketSink(const SocketSink&) = delete;
+  SocketSink& operator=(const SocketSink&) = delete;
+
+  void write(const uint8_t* data, int length);
+
+  /**
+   * Send the current batch, waiting up to blocking_timeout_ms. Call this when writes pause.
+   */
+  void flush();
+
+  bool connected() const { return _fd >= 0; }
+  const Stats& stats() const { return _stats; }
+
+ private:
+  void handleMessage(const uint8_t* message, size_t length);
+  void queueMessage(const uint8_t* message, size_t length);
+  void cacheMessage(const uint8_t* message, size_t length);
+  bool connect();  ///< and queue the cached state
+  void disconnect();
+  /// @return false if the connection was closed (timeout when blocking, or receiver gone)
+  bool send(bool blocking);
+  void writeDropout();
+
+  const SocketSinkConfig _config;
+  int _fd{-1};
+  std::chrono::steady_clock::time_point _last_connect_attempt;
+  std::chrono::steady_clock::time_point _last_send;
+
+  MessageSplitter _splitter;
+
+  // Cache, sent on connection
+  std::vector<uint8_t> _header;  ///< file header and definitions section
+  bool _header_complete{false};
+  std::map<uint16_t, std::vector<uint8_t>> _subscriptions;  ///< by msg_id
+  std::vector<uint8_t> _infos;
+  std::map<std::string, std::vector<uint8_t>> _parameters;  ///< changes in the data section
+
+  std::vector<uint8_t> _send_buffer;
+  size_t _send_offset{0};
+
+  bool _dropping{false};
+  std::chrono::steady_clock::time_point _dropping_since;
+  Stats _stats;
+};
+
+/**
+ * Receiving end of a SocketSink: listens on a Unix domain socket and passes the stream to a Reader.
+ * One connection is read at a time; every connection starts with a new Reader, so the handler gets
+ * fileHeader() and the definitions section again.
+ */
+class SocketReceiver {
+ public:
+  /**
+   * Create the socket (an existing socket file is replaced). Throws a ParsingException on failure.
+   */
+  SocketReceiver(std::string path, std::shared_ptr<DataHandlerInterface> handler);
+  ~SocketReceiver();  ///< removes the socket file
+
+  SocketReceiver(const SocketReceiver&) = delete;
+  SocketReceiver& operator=(const SocketReceiver&) = delete;
+
+  /**
+   * Accept a connection if there is none, and read all available data. If there is none, wait up
+   * to timeout for data (or for interrupt()) and read again.
+   * @return number of bytes read
+   */
+  size_t poll(std::chrono::milliseconds timeout);
+
+  /// Wake up a blocking poll(), may be called from another thread or a signal handler
+  void interrupt();
+
+  bool connected() const { return _connection_fd >= 0; }
+  uint32_t connections() const { return _connections; }
+  uint64_t bytesRead() const { return _bytes_read; }
+
+ private:
+  size_t readAvailable();
+  void waitForEvents(std::chrono::milliseconds timeout);
+
+  const std::string _path;
+  const std::shared_ptr<DataHandlerInterface> _handler;
+  std::unique_ptr<Reader> _reader;
+  int _listen_fd{-1};
+  int _connection_fd{-1};
+  int _wake_fd{-1};
+  uint32_t _connections{0};
+  uint64_t _bytes_read{0};
+  std::vector<uint8_t> _buffer;
+};
+
+}  // namespace ulog_cpp
@@ -0,0 +1,132 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "messages.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Field of a logged struct, known at compile time (@see ULOG_CPP_FIELD)
+ */
+struct FieldDescription {
+  const char* type;
+  const char* name;
+  int array_length;  ///< -1 means not-an-array
+  size_t offset;     ///< [bytes] within the struct
+  size_t size;       ///< [bytes] including all array elements
+};
+
+/**
+ * ULog type name of a C++ type. Only the ULog basic types are defined, so other field types do
+ * not compile.
+ */
+template <typename T>
+struct FieldTypeName;
+
+#define ULOG_CPP_FIELD_TYPE_NAME(cpp_type)                \
+  template <>                                             \
+  struct FieldTypeName<cpp_type> {                        \
+    static constexpr const char* kName = #cpp_type;       \
+  }
+ULOG_CPP_FIELD_TYPE_NAME(int8_t);
+ULOG_CPP_FIELD_TYPE_NAME(uint8_t);
+ULOG_CPP_FIELD_TYPE_NAME(int16_t);
+ULOG_CPP_FIELD_TYPE_NAME(uint16_t);
+ULOG_CPP_FIELD_TYPE_NAME(int32_t);
+ULOG_CPP_FIELD_TYPE_NAME(uint32_t);
+ULOG_CPP_FIELD_TYPE_NAME(int64_t);
+ULOG_CPP_FIELD_TYPE_NAME(uint64_t);
+ULOG_CPP_FIELD_TYPE_NAME(float);
+ULOG_CPP_FIELD_TYPE_NAME(double);
+ULOG_CPP_FIELD_TYPE_NAME(bool);
+ULOG_CPP_FIELD_TYPE_NAME(char);
+#undef ULOG_CPP_FIELD_TYPE_NAME
+
+/**
+ * Describes a logged struct. Specializations provide the message name and the fields in
+ * declaration order (usually generated, see examples/generate_structs.py):
+ * @code
+ * template <>
+ * struct StructDescription<MyData> {
+ *   static constexpr const char* kName = "MyData";
+ *   static constexpr FieldDescription kFields[] = {ULOG_CPP_FIELD(MyData, timestamp), ...};
+ * };
+ * static_assert(ulog_cpp::hasValidLayout<MyData>(), "MyData: fields do not match the layout");
+ * @endcode
+ */
+template <typename T>
+struct StructDescription;
+
+/**
+ * FieldDescription of a member. The type name, array length, offset and size are taken from the
+ * member itself, so they cannot deviate from the struct.
+ */
+#define ULOG_CPP_FIELD(struct_type, member)                                                      \
+  ulog_cpp::FieldDescription                                                                     \
+  {                                                                                              \
+    ulog_cpp::FieldTypeName<std::remove_extent_t<decltype(struct_type::member)>>::kName, #member, \
+        std::rank<decltype(struct_type::member)>::value == 0                                     \
+            ? -1                                                                                 \
+            : static_cast<int>(std::extent<decltype(struct_type::member)>::value),               \
+        offsetof(struct_type, member), sizeof(struct_type::member)                               \
+  }
+
+/**
+ * @return true if the fields are listed in memory order without overlaps and fit into the struct.
+ * A field list that is out of order would write the data of one field under the name of another.
+ */
+template <typename T>
+constexpr bool hasValidLayout()
+{
+  if (!std::is_trivially_copyable<T>::value) {
+    return false;
+  }
+  size_t end = 0;
+  for (const FieldDescription& field : StructDescription<T>::kFields) {
+    if (field.offset < end) {
+      return false;
+    }
+    end = field.offset + field.size;
+  }
+  return end <= sizeof(T);
+}
+
+/**
+ * Fields for the message format, with padding fields ("_paddingN") for the gaps between members,
+ * so the format matches the in-memory layout of the struct. Trailing padding is not included.
+ */
+std::vector<Field> fieldsWithPadding(const FieldDescription* fields, size_t num_fields);
+
+/**
+ * Message name of a described struct. Built once, so this does not allocate.
+ */
+template <typename T>
+const std::string& describedMessageName()
+{
+  static const std::string name = StructDescription<T>::kName;
+  return name;
+}
+
+/**
+ * Message format fields of a described struct (@see fieldsWithPadding()). Built once.
+ */
+template <typename T>
+const std::vector<Field>& describedFields()
+{
+  static_assert(hasValidLayout<T>(), "Fields do not match the struct layout");
+  static const std::vector<Field> fields = fieldsWithPadding(
+      StructDescription<T>::kFields, std::size(StructDescription<T>::kFields));
+  return fields;
+}
+
+}  // namespace ulog_cpp
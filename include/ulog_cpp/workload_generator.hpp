@@ -0,0 +1,97 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "messages.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Description of a synthetic log: topics with their layout and rate, duration, and injected
+ * dropouts and corruption. The same spec (including the seed) always generates the same log.
+ */
+struct WorkloadSpec {
+  struct Topic {
+    std::string name;
+    std::vector<Field> fields;  ///< first field must be 'uint64_t timestamp'
+    double rate_hz{10.};
+  };
+
+  enum class Corruption {
+    BitFlip,   ///< flip a single bit of the message
+    Garbage,   ///< insert random bytes before the message
+    Truncate,  ///< drop the end of the message
+  };
+
+  uint64_t seed{1};
+  double duration_s{10.};
+  uint64_t max_bytes{0};  ///< stop once the log has reached this size, 0 for no limit
+  bool encode_data{false};
+  std::vector<Topic> topics;
+  double logging_rate_hz{0.};
+
+  double dropout_probability{0.};  ///< per data sample
+  uint16_t dropout_duration_ms{20};
+
+  double corruption_probability{0.};  ///< per data sample
+  std::vector<Corruption> corruption_types{Corruption::BitFlip, Corruption::Garbage,
+                                           Corruption::Truncate};
+
+  /**
+   * Add topics named 'topic_<N>' with random layouts (derived from the seed)
+   */
+  void addRandomTopics(int count, double min_rate_hz, double max_rate_hz, int min_fields,
+                       int max_fields);
+
+  /**
+   * Parse a text spec. One setting per line, '#' starts a comment:
+   *   seed <n>
+   *   duration <seconds>
+   *   max_size_mb <n>
+   *   encode_data <0|1>
+   *   logging_rate <hz>
+   *   dropout <probability> <duration_ms>
+   *   corruption <probability> [bitflip,garbage,truncate]
+   *   topic <name> <rate_hz> <type>[[<array_length>]]:<name> ...
+   *   random_topics <count> <min_rate_hz> <max_rate_hz> <min_fields> <max_fields>
+   * random_topics uses the seed set before it. Throws a UsageException on invalid input.
+   */
+  static WorkloadSpec parse(std::istream& stream);
+};
+
+struct WorkloadStats {
+  uint64_t num_bytes{0};
+  uint64_t num_samples{0};
+  uint64_t num_logging{0};
+  uint64_t num_dropouts{0};
+  uint64_t num_corruptions{0};
+  std::vector<uint64_t> samples_per_topic;
+};
+
+/**
+ * Generates a ULog file from a WorkloadSpec, using Writer. Samples of all topics are written in
+ * timestamp order, field values are random walks (so they also work for DATA_ENCODED).
+ */
+class WorkloadGenerator {
+ public:
+  explicit WorkloadGenerator(WorkloadSpec spec);
+
+  /**
+   * Write the complete log
+   */
+  WorkloadStats generate(const DataWriteCB& writer) const;
+
+  const WorkloadSpec& spec() const { return _spec; }
+
+ private:
+  const WorkloadSpec _spec;
+};
+
+}  // namespace ulog_cpp
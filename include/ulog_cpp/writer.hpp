@@ -6,9 +6,57 @@
 
 #include <cstdint>
 #include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
 
+#include "data_encoding.hpp"
 #include "data_handler_interface.hpp"
 
+namespace ulog_cpp {
+
+/**
+ * Samples of possibly different time-series, written in the given order with a single call
+ * (@see SimpleWriter::writeDataBatch(), zz_data_log::WriteBatch()). Can be reused after clear().
+ */
+class DataBatch {
+ public:
+  struct Entry {
+    uint16_t msg_id;
+    unsigned length;
+    size_t offset;  ///< into data()
+  };
+
+  template <typename T>
+  void add(uint16_t msg_id, const T& data)
+  {
+    add(msg_id, reinterpret_cast<const uint8_t*>(&data), sizeof(data));
+  }
+
+  void add(uint16_t msg_id, const uint8_t* data, unsigned length)
+  {
+    _entries.push_back({msg_id, length, _data.size()});
+    _data.insert(_data.end(), data, data + length);
+  }
+
+  void clear()
+  {
+    _entries.clear();
+    _data.clear();
+  }
+
+  bool empty() const { return _entries.empty(); }
+  size_t size() const { return _entries.size(); }
+  const std::vector<Entry>& entries() const { return _entries; }
+  const uint8_t* data() const { return _data.data(); }
+
+ private:
+  std::vector<Entry> _entries;
+  std::vector<uint8_t> _data;
+};
+
+}  // namespace ulog_cpp
+
 /**
  * Low-level class for serializing ULog data. This exposes the full ULog functionality, but does
  * not do integrity checks. Use SimpleWriter for a simpler API with checks.
@@ -17,8 +65,15 @@ namespace ulog_cpp {
 
 class Writer : public DataHandlerInterface {
  public:
-  explicit Writer(DataWriteCB data_write_cb);
-  virtual ~Writer() = default;
+  /**
+   * @param data_write_cb callback for serialized ULog data
+   * @param encode_data if true, DATA samples are written as delta/XOR encoded blocks
+   * (ULogMessageType::DATA_ENCODED) and ULOG_COMPAT_FLAG0_ENCODED_DATA_MASK is set in the header.
+   * This reduces the file size, but requires a reader with support for it. Buffered samples are
+   * written out before any other message, so the log order is kept.
+   */
+  explicit Writer(DataWriteCB data_write_cb, bool encode_data = false);
+  virtual ~Writer();
 
   void headerComplete() override;
 
@@ -29,13 +84,63 @@ class Writer : public DataHandlerInterface {
   void parameterDefault(const ParameterDefault& parameter_default) override;
   void addLoggedMessage(const AddLoggedMessage& add_logged_message) override;
   void logging(const Logging& logging) override;
+  void deferredLogging(const DeferredLogging& logging) override;
   void data(const Data& data) override;
   void dropout(const Dropout& dropout) override;
   void sync(const Sync& sync) override;
 
+  /**
+   * Write a deferred text message (ULogMessageType::LOGGING_DEFERRED) from already encoded
+   * arguments, without constructing a DeferredLogging
+   */
+  void deferredLogging(Logging::Level level, uint16_t format_id, uint64_t timestamp,
+                       const uint8_t* args, size_t args_length);
+
+  /**
+   * Write a complete message (including the ULog message header) unchanged, e.g. from a reader in
+   * raw mode. There are no checks, and it is not encoded (with encode_data).
+   */
+  void rawMessage(const uint8_t* message, size_t length) override;
+
+  /**
+   * Write DATA messages of count samples of the same time-series with a single call of the write
+   * callback. The result is identical to calling data() for each sample.
+   * @param samples first sample
+   * @param sample_size bytes written per sample
+   * @param stride distance between samples [bytes], >= sample_size
+   */
+  void dataBatch(uint16_t msg_id, const uint8_t* samples, unsigned sample_size, size_t stride,
+                 size_t count);
+
+  /**
+   * Write DATA messages of a batch with a single call of the write callback. The result is
+   * identical to calling data() for each entry.
+   * @param lengths bytes written per entry (at most the entry length), nullptr to write entries
+   * completely
+   */
+  void dataBatch(const DataBatch& batch, const unsigned* lengths = nullptr);
+
+  /**
+   * Write out data that is buffered in the writer (only used with encode_data)
+   */
+  void flush();
+
  private:
+  /**
+   * Append a sample to the encoder of the time-series, if there is one with a matching sample size
+   * @return false if the sample must be written unencoded
+   */
+  bool encodeSample(uint16_t msg_id, const uint8_t* data, size_t length);
+  void flushEncoder(uint16_t msg_id, DataEncoder& encoder);
+
   const DataWriteCB _data_write_cb;
   bool _header_complete{false};
+  std::vector<uint8_t> _batch_buffer;
+
+  const bool _encode_data;
+  std::map<std::string, MessageFormat> _formats;
+  std::unordered_map<uint16_t, DataEncoder> _encoders;
+  std::vector<uint16_t> _pending_blocks;  ///< msg_ids of non-empty encoders, by first sample
 };
 
 }  // namespace ulog_cpp
@@ -4,6 +4,7 @@
  ****************************************************************************/
 #pragma once
 #include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <iostream>
 #include <memory>
@@ -12,7 +13,12 @@
 #include <unordered_map>
 #include <vector>
 
+#include "deferred_logging.hpp"
+#include "file_sink.hpp"
+#include "flight_recorder.hpp"
+#include "shm_transport.hpp"
 #include "writer.hpp"
+#include "zz_data_log_stats.hpp"
 
 using namespace std;
 using namespace ulog_cpp;
@@ -38,15 +44,30 @@ struct InitParams {
 };
 
 namespace ulog_cpp {
+
+/**
+ * Per-topic write policy of zz_data_log (@see zz_data_log::setTopicPolicy()). A sample is only
+ * written if it passes all of the enabled conditions.
+ */
+struct TopicPolicy {
+    double max_rate_hz{0.};      ///< based on the sample timestamp, 0: unlimited
+    uint32_t keep_every_nth{1};  ///< keep every Nth sample, 1: all
+    /// keep a sample only if this field changed by more than threshold since the last kept sample
+    /// (e.g. "cpuload" or "debug_array[2]"), empty: disabled
+    std::string threshold_field;
+    double threshold{0.};
+
+    std::string toString() const;
+};
+
+template <typename T>
+class TopicWriter;
+
 /**
  * ULog serialization class which checks for integrity and correct calling order.
  * It throws an UsageException() in case of a failed integrity check.
  */
 class zz_data_log {
-    // Declare CreateInstance as a friend function
-    friend void CreateInstance(const std::string& filename, bool ZzDataLogOn = true);
-    friend std::shared_ptr<zz_data_log> GetInstance();
-
    public:
     /**
      * Constructor with a callback for writing data.
@@ -58,10 +79,32 @@ class zz_data_log {
      * Constructor to write to a file.
      * @param filename ULog file to write to (will be overwritten if it exists)
      * @param timestamp_us  start timestamp [us]
+     * @param sink_config how the file is written (@see createFileSink()), also used after rotation.
+     * Files are preallocated to the rotation size, unless preallocate_size is set.
+     */
+    explicit zz_data_log(const std::string& filename, uint64_t timestamp_us, const FileSinkConfig& sink_config = {});
+
+    explicit zz_data_log(const std::string& filename, const FileSinkConfig& sink_config = {});
+
+    /**
+     * Constructor for flight recorder mode: the log is kept in a fixed-size in-memory buffer
+     * (@see FlightRecorder) and only written to a file on a trigger, which is one of
+     * triggerFlightRecorder(), writeTextMessage() with level Error or higher, or a signal
+     * installed with FlightRecorder::installSignalTrigger() (handled in the next Write()).
+     * There is no file rotation in this mode.
+     * @param config buffer size and time span of the dumps
+     * @param dump_filename first dump file, subsequent dumps are numbered: "crash.ulg" -->
+     * "crash.1.ulg" --> "crash.2.ulg"
      */
-    explicit zz_data_log(const std::string& filename, uint64_t timestamp_us);
+    explicit zz_data_log(const FlightRecorder::Config& config, const std::string& dump_filename);
 
-    explicit zz_data_log(const std::string& filename);
+    /**
+     * Constructor for shared memory mode: the log is passed to a running ShmLogDaemon, which writes
+     * the logs of all processes into one file (@see ShmLogProducer). There is no file rotation in
+     * this mode, the daemon handles the files.
+     * Throws a ParsingException if no daemon is running.
+     */
+    explicit zz_data_log(const ShmTransportConfig& config);
 
     ~zz_data_log();
 
@@ -69,13 +112,13 @@ class zz_data_log {
      * filename of the ULog file
      * @return  eg: "test.ulg" --> "test.1.ulg" or "test.2.ulg" --> "test.3.ulg"
      * */
-    std::string generateNewFilename(const std::string& filename);
+    static std::string generateNewFilename(const std::string& filename);
 
     /**
      * path of the ULog file
      * @return eg: "/tmp/test.ulg" --> "/tmp/test.1.ulg" or "/tmp/test.2.ulg" --> "/tmp/test.3.ulg"
      * */
-    std::string generateNewPathOrFilename(const std::string& pathOrFilename);
+    static std::string generateNewPathOrFilename(const std::string& pathOrFilename);
 
     /**
      * Constructor to write to a file.
@@ -116,6 +159,7 @@ class zz_data_log {
                 },
                 struct_variant);
         }
+        writeStatsTopicFormat();
         // Check header complete
         headerComplete();
         // Write all structs to add_logged_message
@@ -131,6 +175,9 @@ class zz_data_log {
                 },
                 struct_variant);
         }
+        addStatsTopic();
+        writePolicyInfos();
+        writeTextFormats();
         printf("Logger Init called.\n");
         return true;
     }
@@ -139,11 +186,18 @@ class zz_data_log {
             throw UsageException("Filename, key and key_value must not be empty.");
             return false;
         }
+        if (&init_params != &init_params_) {
+            // Keep the structs for rotation and policies, the file name is set by the constructor
+            init_params_.key = init_params.key;
+            init_params_.key_value = init_params.key_value;
+            init_params_.all_structs = init_params.all_structs;
+        }
         writeInfo(init_params.key, init_params.key_value);
         // Write all structs to message_format
         for (const auto& struct_variant : init_params.all_structs) {
             writeMessageFormat(struct_variant.messageNname, struct_variant.fields);
         }
+        writeStatsTopicFormat();
         // Check header complete
         headerComplete();
         // Write all structs to add_logged_message
@@ -151,6 +205,9 @@ class zz_data_log {
             uint16_t id = writeAddLoggedMessage(struct_variant.messageNname);
             id_map_[struct_variant.messageNname] = id;
         }
+        addStatsTopic();
+        writePolicyInfos();
+        writeTextFormats();
         printf("Logger Init called.\n");
         return true;
     }
@@ -162,33 +219,125 @@ class zz_data_log {
     static void CreateInstance(const std::string& filename, bool ZzDataLogOn = true);
 
     /**
-     * Get the zz_data_log instance
+     * Create a zz_data_log instance in shared memory mode (@see zz_data_log(const ShmTransportConfig&))
+     */
+    static void CreateShmInstance(const ShmTransportConfig& config = {}, bool ZzDataLogOn = true);
+
+    /**
+     * Get the zz_data_log instance. Does not lock, but prefer keeping the returned pointer or a
+     * TopicWriter over calling this for every write.
      */
     static std::shared_ptr<zz_data_log> GetInstance();
 
+    /**
+     * Register a logger under a name. Use this for independent logs in the same process (e.g.
+     * high-rate sensor data and low-rate events on different disks): each instance has its own
+     * sink, lock, policies and statistics.
+     * Throws a UsageException if the name is already used.
+     */
+    static void CreateNamedInstance(const std::string& name, std::shared_ptr<zz_data_log> logger);
+
+    /**
+     * Get a logger registered with CreateNamedInstance(). Takes a lock, so look it up once.
+     */
+    static std::shared_ptr<zz_data_log> GetNamedInstance(const std::string& name);
+
+    static void RemoveNamedInstance(const std::string& name);
+
     template <typename T>
     void Write(const T data) {
-        static atomic<int> count(0);
-        std::lock_guard<std::mutex> lock(mutex_);
+        // Policies are checked before locking and serialization, so filtered samples are cheap
+        if (_has_topic_policies.load(std::memory_order_relaxed) &&
+            !acceptByPolicy(data.messageName(), reinterpret_cast<const uint8_t*>(&data), sizeof(data))) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock = lockForWrite();
         uint16_t id = 0;
         std::unordered_map<std::string, uint16_t>::iterator it = id_map_.find(data.messageName());
         if (it != id_map_.end()) {
             id = it->second;
         } else {
+            _stats.addRejected();
             throw UsageException("id not found");
         }
         // printf("%s %d %s %d\n", __func__, __LINE__, data.messageName().c_str(), id);
-        if (ZzDataLogOn_) {
-            writeData(id, data);
-            count.fetch_add(1);
-            if (count.load() == 10) {
-                count.store(0);
-                fsync();
-            }
-        }
+        writeSample(id, reinterpret_cast<const uint8_t*>(&data), sizeof(data));
         // printf("Logger Write called.\n");
     }
 
+    /**
+     * Write count samples of a topic at once (e.g. the contents of a sensor FIFO). The lock is taken
+     * once and the samples are handed to the file in a single call. The written data is identical to
+     * calling Write() for each sample, topic policies are applied per sample. The periodic fsync
+     * is done at most once per batch.
+     */
+    template <typename T>
+    void WriteBatch(const T* data, size_t count) {
+        std::unique_lock<std::mutex> lock = lockForWrite();
+        const auto it = id_map_.find(T::messageName());
+        if (it == id_map_.end()) {
+            _stats.addRejected();
+            throw UsageException("id not found");
+        }
+        writeSamples(it->second, T::messageName(), reinterpret_cast<const uint8_t*>(data), sizeof(T), count);
+    }
+
+    template <typename T>
+    void WriteBatch(const std::vector<T>& data) {
+        WriteBatch(data.data(), data.size());
+    }
+
+    /**
+     * Write samples of different topics at once (@see WriteBatch()), with ids from
+     * TopicWriter::msgId(). Topic policies are not applied. Nothing is written if an entry is invalid.
+     */
+    void WriteBatch(const DataBatch& batch);
+
+    /**
+     * Get a handle for writing a topic, which avoids the lookup of the message id by name in every
+     * Write(). The id is resolved once here, so this must be called after Init(). The handle stays
+     * valid across file rotations, but not beyond the lifetime of the logger.
+     */
+    template <typename T>
+    TopicWriter<T> topicWriter() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = id_map_.find(T::messageName());
+        if (it == id_map_.end()) {
+            throw UsageException("Unknown topic: " + T::messageName());
+        }
+        return TopicWriter<T>(this, it->second, T::messageName());
+    }
+
+    /**
+     * Snapshot of the logger statistics. Can be called from any thread at any time.
+     */
+    DataLogStats stats() const { return _stats.snapshot(); }
+
+    /**
+     * Also write the statistics into the log as topic "zz_data_log_stats", at most every
+     * interval_us (checked in Write()). Must be called before Init().
+     */
+    void enableStatsTopic(uint64_t interval_us);
+
+    /**
+     * Write the flight recorder buffer to the next dump file (only in flight recorder mode).
+     * @return the file name
+     */
+    std::string triggerFlightRecorder();
+
+    /**
+     * Set (or replace) the write policy of a topic. Can be called at any time after Init(), from
+     * any thread. Each change is recorded in the log as info message "zz_policy_<topic>".
+     * Under concurrent writers of the same topic, the policy is applied approximately.
+     * @param message_name topic name (messageName())
+     */
+    void setTopicPolicy(const std::string& message_name, const TopicPolicy& policy);
+
+    /**
+     * Remove the write policy of a topic (all samples are written again)
+     */
+    void clearTopicPolicy(const std::string& message_name);
+
     /**
      * Write a key-value info to the header. Typically used for versioning information.
      * @tparam T one of std::string, int32_t, float
@@ -262,10 +411,39 @@ class zz_data_log {
     uint16_t writeAddLoggedMessage(const std::string& message_format_name, uint8_t multi_id = 0);
 
     /**
-     * Write a text message
+     * Write a text message. In flight recorder mode, levels Error and higher trigger a dump.
      */
     void writeTextMessage(Logging::Level level, const std::string& message, uint64_t timestamp);
 
+    /**
+     * Register a printf-style format string for writeDeferredText() (@see
+     * SimpleWriter::registerTextFormat()). Can be called before or after Init(), the registered
+     * formats are written again to each new file after a rotation.
+     */
+    template <typename... Args>
+    DeferredFormat<Args...> registerTextFormat(Logging::Level level, const std::string& format) {
+        return {registerTextFormatImpl(deferredArgCodes<Args...>(), format), level};
+    }
+
+    /**
+     * Write a text message with deferred formatting: only the format id and the binary arguments are
+     * written. In flight recorder mode, levels Error and higher trigger a dump.
+     */
+    template <typename... FormatArgs, typename... Args>
+    void writeDeferredText(const DeferredFormat<FormatArgs...>& format, uint64_t timestamp, const Args&... args) {
+        static_assert(sizeof...(FormatArgs) == sizeof...(Args), "Wrong number of format arguments");
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Checked under the lock, rotation resets it
+        if (!_header_complete) {
+            throw UsageException("Header not yet complete");
+        }
+        encodeDeferredArgs<FormatArgs...>(_text_args, static_cast<const FormatArgs&>(args)...);
+        _writer->deferredLogging(format.level, format.id, timestamp, _text_args.data(), _text_args.size());
+        if (_flight_recorder && format.level <= Logging::Level::Error) {
+            dumpFlightRecorder();
+        }
+    }
+
     /**
      * Write some data. The timestamp must be monotonically increasing for a given time-series (i.e.
      * same id).
@@ -283,6 +461,9 @@ class zz_data_log {
     void fsync();
 
    private:
+    template <typename T>
+    friend class TopicWriter;
+
     static const std::string kFormatNameRegexStr;
     static const std::regex kFormatNameRegex;
     static const std::string kFieldNameRegexStr;
@@ -296,18 +477,79 @@ class zz_data_log {
     };
 
     void writeDataImpl(uint16_t id, const uint8_t* data, unsigned length);
+    std::unique_lock<std::mutex> lockForWrite();
+    /// write a sample with mutex_ held, including the periodic fsync and the stats topic
+    void writeSample(uint16_t id, const uint8_t* data, unsigned length);
+    void writeTopicSample(uint16_t id, const std::string& message_name, const uint8_t* data, unsigned length);
+    /// write consecutive samples of a topic with mutex_ held, applying the topic policy
+    void writeSamples(uint16_t id, const std::string& message_name, const uint8_t* data, unsigned length,
+                      size_t count);
+    /// writeSample() for count samples
+    void writeSampleRun(uint16_t id, const uint8_t* data, unsigned length, size_t count);
+    void writeDataBatchImpl(uint16_t id, const uint8_t* data, unsigned length, size_t count);
+    /// @return the number of bytes written per sample
+    unsigned validateData(uint16_t id, unsigned length);
+    void writeToFile(const uint8_t* data, int length);
+    std::string dumpFlightRecorder();
+
+    static const std::string kStatsTopicName;
+    struct StatsTopicSample {
+        uint64_t timestamp;
+        uint64_t bytes_written;
+        uint64_t messages_written;
+        uint64_t dropped_writes;
+        uint64_t rejected_writes;
+        uint64_t rotations;
+        uint64_t file_size;
+        uint64_t fsync_count;
+        uint64_t fsync_max_ns;
+        uint64_t mutex_wait_max_ns;
+        uint64_t max_waiting_writers;
+    };
+    void writeStatsTopicFormat();
+    void addStatsTopic();
+    void writeStatsTopic();
+
+    struct TopicFilter {
+        TopicPolicy policy;
+        uint16_t msg_id{0};
+        uint64_t min_interval_us{0};
+        double (*read_threshold_value)(const uint8_t*){nullptr};
+        unsigned threshold_offset{0};
+        unsigned threshold_size{0};
+
+        std::atomic<uint64_t> counter{0};
+        std::atomic<uint64_t> last_timestamp{0};
+        std::atomic<double> last_value{0.};
+        std::atomic<bool> has_last_value{false};
+    };
+    using TopicFilterMap = std::unordered_map<std::string, std::shared_ptr<TopicFilter>>;
+
+    bool acceptByPolicy(const std::string& message_name, const uint8_t* data, unsigned length);
+    void updateTopicFilters(const std::string& message_name, std::shared_ptr<TopicFilter> filter);
+    void writePolicyInfo(const std::string& message_name, const std::string& value);
+    void writePolicyInfos();  ///< all active policies, after a rotation
+    uint16_t registerTextFormatImpl(const std::string& arg_codes, const std::string& format);
+    void writeTextFormats();  ///< all registered text formats, after a rotation
 
     std::unique_ptr<Writer> _writer;
-    std::FILE* _file{nullptr};
+    std::unique_ptr<FileSink> _file;
+    FileSinkConfig _sink_config;
+    std::unique_ptr<FlightRecorder> _flight_recorder;  ///< set in flight recorder mode
+    std::unique_ptr<ShmLogProducer> _shm_producer;     ///< set in shared memory mode
+    std::string _next_dump_filename;
 
     bool _header_complete{false};
     std::unordered_map<std::string, Format> _formats;
     std::vector<Subscription> _subscriptions;
+    std::vector<unsigned> _batch_lengths;
+    std::vector<MessageInfo> _text_formats;  ///< index: format id
+    std::vector<uint8_t> _text_args;
 
     static std::shared_ptr<zz_data_log> instance_;
     std::unordered_map<std::string, uint16_t> id_map_;
     std::mutex mutex_;
-    bool ZzDataLogOn_;
+    bool ZzDataLogOn_{true};
 
     // 文件大小限制，以字节为单位
     static constexpr uint64_t kMaxFileSize = 10 * 1024 * 1024;  // 10MB
@@ -315,6 +557,48 @@ class zz_data_log {
 
     // 缓存初始化参数
     InitParams init_params_;
+
+    size_t _writes_since_fsync{0};
+    DataLogStatsRegistry _stats;
+    uint64_t _stats_topic_interval_us{0};  ///< 0: disabled
+    uint64_t _stats_topic_last_us{0};
+    uint16_t _stats_topic_msg_id{0};
+
+    std::atomic<bool> _has_topic_policies{false};
+    std::shared_ptr<const TopicFilterMap> _topic_filters;  ///< replaced as a whole (atomic_load/store)
+    std::mutex _topic_filters_mutex;                       ///< serializes policy updates
+};
+
+/**
+ * Handle for writing a single topic of a zz_data_log (@see zz_data_log::topicWriter()). Cheap to
+ * copy, and can be used from any thread.
+ */
+template <typename T>
+class TopicWriter {
+   public:
+    TopicWriter() = default;
+
+    void Write(const T& data) const {
+        _logger->writeTopicSample(_msg_id, _message_name, reinterpret_cast<const uint8_t*>(&data), sizeof(data));
+    }
+
+    /// @see zz_data_log::WriteBatch()
+    void WriteBatch(const T* data, size_t count) const {
+        std::unique_lock<std::mutex> lock = _logger->lockForWrite();
+        _logger->writeSamples(_msg_id, _message_name, reinterpret_cast<const uint8_t*>(data), sizeof(T), count);
+    }
+
+    bool valid() const { return _logger != nullptr; }
+    uint16_t msgId() const { return _msg_id; }
+
+   private:
+    friend class zz_data_log;
+    TopicWriter(zz_data_log* logger, uint16_t msg_id, std::string message_name)
+        : _logger(logger), _msg_id(msg_id), _message_name(std::move(message_name)) {}
+
+    zz_data_log* _logger{nullptr};
+    uint16_t _msg_id{0};
+    std::string _message_name;  ///< for the topic policy
 };
 
 }  // namespace ulog_cpp
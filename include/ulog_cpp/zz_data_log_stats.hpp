@@ -0,0 +1,138 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ulog_cpp {
+
+/**
+ * Lock-free latency histogram with power-of-two buckets: bucket 0 counts values < 1ns, bucket i
+ * counts values in [2^(i-1), 2^i) ns.
+ */
+class LatencyHistogram {
+   public:
+    static constexpr int kNumBuckets = 40;  // up to ~9 minutes
+
+    struct Snapshot {
+        std::array<uint64_t, kNumBuckets> buckets{};
+        uint64_t count{0};
+        uint64_t total_ns{0};
+        uint64_t max_ns{0};
+
+        /**
+         * Approximate percentile (upper bound of the bucket)
+         * @param p percentile in [0, 1]
+         */
+        uint64_t percentileNs(double p) const;
+        uint64_t meanNs() const { return count > 0 ? total_ns / count : 0; }
+    };
+
+    void add(uint64_t value_ns);
+    Snapshot snapshot() const;
+
+   private:
+    std::array<std::atomic<uint64_t>, kNumBuckets> _buckets{};
+    std::atomic<uint64_t> _count{0};
+    std::atomic<uint64_t> _total_ns{0};
+    std::atomic<uint64_t> _max_ns{0};
+};
+
+struct DataLogTopicStats {
+    std::string name;
+    uint16_t msg_id{0};
+    uint64_t messages{0};
+    uint64_t bytes{0};     ///< serialized size, including the message header
+    uint64_t filtered{0};  ///< samples not written due to the topic policy
+};
+
+/**
+ * Snapshot of the zz_data_log counters (@see zz_data_log::stats())
+ */
+struct DataLogStats {
+    uint64_t bytes_written{0};     ///< all bytes written (over all files), including headers
+    uint64_t messages_written{0};  ///< data samples
+    uint64_t dropped_writes{0};    ///< Write() calls while logging is disabled
+    uint64_t rejected_writes{0};   ///< writes that threw (unknown topic, data too small, ...)
+    uint64_t filtered_writes{0};   ///< Write() calls filtered by a topic policy
+    uint64_t rotations{0};
+    uint64_t file_size{0};            ///< bytes in the current file
+    uint32_t waiting_writers{0};      ///< threads currently waiting for the log mutex
+    uint32_t max_waiting_writers{0};  ///< maximum number of threads waiting for the log mutex
+    LatencyHistogram::Snapshot fsync;
+    LatencyHistogram::Snapshot mutex_wait;
+    std::vector<DataLogTopicStats> topics;
+};
+
+/**
+ * Counters updated by zz_data_log. Everything on the write path is a relaxed atomic, only
+ * topic registration (in the header phase) takes a lock.
+ */
+class DataLogStatsRegistry {
+   public:
+    void addTopic(uint16_t msg_id, const std::string& name);
+    /// @param bytes of all count messages
+    void addMessage(uint16_t msg_id, uint64_t bytes, uint64_t count = 1) {
+        _messages_written.fetch_add(count, std::memory_order_relaxed);
+        if (msg_id < _num_topics.load(std::memory_order_acquire)) {
+            TopicCounters& topic = _topics[msg_id];
+            topic.messages.fetch_add(count, std::memory_order_relaxed);
+            topic.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+    }
+    void addBytes(uint64_t bytes) {
+        _bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+        _file_size.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    void addDropped(uint64_t count = 1) { _dropped_writes.fetch_add(count, std::memory_order_relaxed); }
+    void addRejected() { _rejected_writes.fetch_add(1, std::memory_order_relaxed); }
+    void addFiltered(uint16_t msg_id) {
+        _filtered_writes.fetch_add(1, std::memory_order_relaxed);
+        if (msg_id < _num_topics.load(std::memory_order_acquire)) {
+            _topics[msg_id].filtered.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    void addRotation() {
+        _rotations.fetch_add(1, std::memory_order_relaxed);
+        _file_size.store(0, std::memory_order_relaxed);
+    }
+    void addFsync(uint64_t duration_ns) { _fsync.add(duration_ns); }
+
+    void beginMutexWait();
+    void endMutexWait(uint64_t duration_ns);
+
+    DataLogStats snapshot() const;
+
+   private:
+    struct TopicCounters {
+        std::string name;
+        std::atomic<uint64_t> messages{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> filtered{0};
+    };
+
+    std::atomic<uint64_t> _bytes_written{0};
+    std::atomic<uint64_t> _messages_written{0};
+    std::atomic<uint64_t> _dropped_writes{0};
+    std::atomic<uint64_t> _rejected_writes{0};
+    std::atomic<uint64_t> _filtered_writes{0};
+    std::atomic<uint64_t> _rotations{0};
+    std::atomic<uint64_t> _file_size{0};
+    std::atomic<uint32_t> _waiting_writers{0};
+    std::atomic<uint32_t> _max_waiting_writers{0};
+    LatencyHistogram _fsync;
+    LatencyHistogram _mutex_wait;
+
+    mutable std::mutex _topics_mutex;
+    std::deque<TopicCounters> _topics;  ///< indexed by msg_id, elements are never moved
+    std::atomic<size_t> _num_topics{0};
+};
+
+}  // namespace ulog_cpp
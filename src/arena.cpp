@@ -0,0 +1,33 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "arena.hpp"
+
+#include <algorithm>
+
+namespace ulog_cpp {
+
+uint8_t* ByteArena::allocate(size_t size)
+{
+  if (size > _remaining) {
+    if (size > _next_block_size / 2) {
+      // Large allocation: use a dedicated block, so the current one can still be filled up
+      _blocks.push_back(std::unique_ptr<uint8_t[]>(new uint8_t[size]));
+      _capacity += size;
+      return _blocks.back().get();
+    }
+    _blocks.push_back(std::unique_ptr<uint8_t[]>(new uint8_t[_next_block_size]));
+    _current = _blocks.back().get();
+    _remaining = _next_block_size;
+    _capacity += _next_block_size;
+    _next_block_size = std::min(_next_block_size * 2, kMaxBlockSize);
+  }
+  uint8_t* ret = _current;
+  _current += size;
+  _remaining -= size;
+  return ret;
+}
+
+}  // namespace ulog_cpp
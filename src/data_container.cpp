@@ -7,6 +7,14 @@
 
 namespace ulog_cpp {
 
+void DataSamples::append(const Data& data)
+{
+  const auto& bytes = data.data();
+  uint8_t* storage = _arena.allocate(bytes.size());
+  memcpy(storage, bytes.data(), bytes.size());
+  _samples.emplace_back(data.msgId(), storage, bytes.size());
+}
+
 DataContainer::DataContainer(DataContainer::StorageConfig storage_config)
     : _storage_config(storage_config)
 {
@@ -28,62 +36,107 @@ void DataContainer::fileHeader(const FileHeader& header)
   _file_header = header;
 }
 void DataContainer::messageInfo(const MessageInfo& message_info)
+{
+  messageInfo(MessageInfo(message_info));
+}
+void DataContainer::messageInfo(MessageInfo&& message_info)
 {
   if (_header_complete && _storage_config == StorageConfig::Header) {
     return;
   }
   if (message_info.isMulti()) {
+    if (message_info.field().name == kDeferredFormatInfoKey) {
+      _deferred_formatter.addFormat(message_info);
+    }
     if (message_info.isContinued()) {
       auto& messages = _message_info_multi[message_info.field().name];
       if (messages.empty()) {
         throw ParsingException("info_multi msg is continued, but no previous");
       }
-      messages[messages.size() - 1].push_back(message_info);
+      messages[messages.size() - 1].push_back(std::move(message_info));
     } else {
-      _message_info_multi[message_info.field().name].push_back({message_info});
+      auto& messages = _message_info_multi[message_info.field().name];
+      messages.emplace_back();
+      messages.back().push_back(std::move(message_info));
     }
   } else {
-    _message_info.insert({message_info.field().name, message_info});
+    std::string name = message_info.field().name;
+    _message_info.emplace(std::move(name), std::move(message_info));
   }
 }
 void DataContainer::messageFormat(const MessageFormat& message_format)
+{
+  messageFormat(MessageFormat(message_format));
+}
+void DataContainer::messageFormat(MessageFormat&& message_format)
 {
   if (_message_formats.find(message_format.name()) != _message_formats.end()) {
     throw ParsingException("Duplicate message format");
   }
-  _message_formats.insert({message_format.name(), message_format});
+  std::string name = message_format.name();
+  _message_formats.emplace(std::move(name), std::move(message_format));
 }
 void DataContainer::parameter(const Parameter& parameter)
+{
+  this->parameter(Parameter(parameter));
+}
+void DataContainer::parameter(Parameter&& parameter)
 {
   if (_header_complete && _storage_config == StorageConfig::Header) {
     return;
   }
   if (_header_complete) {
-    _changed_parameters.push_back(parameter);
+    _changed_parameters.push_back(std::move(parameter));
   } else {
-    _initial_parameters.insert({parameter.field().name, parameter});
+    std::string name = parameter.field().name;
+    _initial_parameters.emplace(std::move(name), std::move(parameter));
   }
 }
 void DataContainer::parameterDefault(const ParameterDefault& parameter_default)
 {
-  _default_parameters.insert({parameter_default.field().name, parameter_default});
+  parameterDefault(ParameterDefault(parameter_default));
+}
+void DataContainer::parameterDefault(ParameterDefault&& parameter_default)
+{
+  std::string name = parameter_default.field().name;
+  _default_parameters.emplace(std::move(name), std::move(parameter_default));
 }
 void DataContainer::addLoggedMessage(const AddLoggedMessage& add_logged_message)
+{
+  addLoggedMessage(AddLoggedMessage(add_logged_message));
+}
+void DataContainer::addLoggedMessage(AddLoggedMessage&& add_logged_message)
 {
   if (_header_complete && _storage_config == StorageConfig::Header) {
     return;
   }
-  if (_subscriptions.find(add_logged_message.msgId()) != _subscriptions.end()) {
+  const uint16_t msg_id = add_logged_message.msgId();
+  if (_subscriptions.find(msg_id) != _subscriptions.end()) {
     throw ParsingException("Duplicate AddLoggedMessage message ID");
   }
-  _subscriptions.insert({add_logged_message.msgId(), {add_logged_message, {}}});
+  _subscriptions.emplace(msg_id, Subscription{std::move(add_logged_message), {}});
 }
 void DataContainer::logging(const Logging& logging)
+{
+  this->logging(Logging(logging));
+}
+void DataContainer::logging(Logging&& logging)
+{
+  if (_header_complete && _storage_config == StorageConfig::Header) {
+    return;
+  }
+  _logging.push_back(std::move(logging));
+}
+void DataContainer::deferredLogging(const DeferredLogging& logging)
+{
+  deferredLogging(DeferredLogging(logging));
+}
+void DataContainer::deferredLogging(DeferredLogging&& logging)
 {
   if (_header_complete && _storage_config == StorageConfig::Header) {
     return;
   }
-  _logging.emplace_back(std::move(logging));
+  _deferred_logging.push_back(std::move(logging));
 }
 void DataContainer::data(const Data& data)
 {
@@ -94,13 +147,13 @@ void DataContainer::data(const Data& data)
   if (iter == _subscriptions.end()) {
     throw ParsingException("Invalid subscription");
   }
-  iter->second.data.emplace_back(std::move(data));
+  iter->second.data.append(data);
 }
 void DataContainer::dropout(const Dropout& dropout)
 {
   if (_header_complete && _storage_config == StorageConfig::Header) {
     return;
   }
-  _dropouts.emplace_back(std::move(dropout));
+  _dropouts.push_back(dropout);
 }
 }  // namespace ulog_cpp
@@ -0,0 +1,367 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "data_encoding.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#define CHECK_MSG_SIZE(size, min_required) \
+  if ((size) < (min_required)) throw ParsingException("message too short")
+
+namespace ulog_cpp {
+
+namespace {
+
+constexpr unsigned kMaxNestingDepth = 16;
+constexpr uint8_t kNoWindow = 0xff;
+
+/**
+ * Number of bits to store a leading zero count or a meaningful bit length for a lane size in bytes
+ */
+unsigned windowBits(unsigned lane_size)
+{
+  switch (lane_size) {
+    case 1:
+      return 3;
+    case 2:
+      return 4;
+    case 4:
+      return 5;
+    default:
+      return 6;
+  }
+}
+
+unsigned countLeadingZeros(uint64_t value)
+{
+#if defined(__GNUC__)
+  return __builtin_clzll(value);
+#else
+  unsigned count = 0;
+  for (uint64_t mask = 1ULL << 63; (value & mask) == 0; mask >>= 1) ++count;
+  return count;
+#endif
+}
+
+unsigned countTrailingZeros(uint64_t value)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(value);
+#else
+  unsigned count = 0;
+  for (; (value & 1) == 0; value >>= 1) ++count;
+  return count;
+#endif
+}
+
+int64_t signExtend(uint64_t value, unsigned num_bits)
+{
+  if (num_bits < 64 && (value & (1ULL << (num_bits - 1)))) {
+    value |= ~((1ULL << num_bits) - 1);
+  }
+  return static_cast<int64_t>(value);
+}
+
+class BitReader {
+ public:
+  BitReader(const uint8_t* data, unsigned length) : _data(data), _num_bits(length * 8) {}
+
+  uint64_t read(unsigned num_bits)
+  {
+    if (_bit_index + num_bits > _num_bits) {
+      throw ParsingException("Encoded data too short");
+    }
+    uint64_t value = 0;
+    while (num_bits > 0) {
+      const unsigned bit_offset = _bit_index % 8;
+      const unsigned available_bits = 8 - bit_offset;
+      const unsigned n = std::min(available_bits, num_bits);
+      const uint8_t chunk = (_data[_bit_index / 8] >> (available_bits - n)) & ((1U << n) - 1);
+      value = (value << n) | chunk;
+      _bit_index += n;
+      num_bits -= n;
+    }
+    return value;
+  }
+
+ private:
+  const uint8_t* _data;
+  const unsigned _num_bits;
+  unsigned _bit_index{0};
+};
+
+}  // namespace
+
+DataEncodingLayout::DataEncodingLayout(const MessageFormat& format,
+                                       const std::map<std::string, MessageFormat>& formats)
+{
+  const auto& fields = format.fields();
+  _has_timestamp = !fields.empty() && fields[0].name == "timestamp" &&
+                   fields[0].type == "uint64_t" && fields[0].array_length == -1;
+  addFields(format, formats, 0);
+  if (_sample_size == 0 || _sample_size > DataEncoder::kMaxSampleSize) {
+    _encodable = false;
+  }
+
+  for (unsigned i = 0; i < _lanes.size(); ++i) {
+    if (i == 0 && _has_timestamp) {
+      _max_encoded_sample_bits += 5 + 64;
+    } else {
+      _max_encoded_sample_bits += 2 + 2 * windowBits(_lanes[i]) + _lanes[i] * 8;
+    }
+  }
+}
+
+void DataEncodingLayout::addFields(const MessageFormat& format,
+                                   const std::map<std::string, MessageFormat>& formats, int depth)
+{
+  for (const auto& field : format.fields()) {
+    const int num_elements = field.array_length < 0 ? 1 : field.array_length;
+    const auto& basic_type_iter = Field::kBasicTypes.find(field.type);
+    if (basic_type_iter != Field::kBasicTypes.end()) {
+      _lanes.insert(_lanes.end(), num_elements, static_cast<uint8_t>(basic_type_iter->second));
+      _sample_size += num_elements * basic_type_iter->second;
+      continue;
+    }
+    const auto& nested_iter = formats.find(field.type);
+    if (nested_iter == formats.end() || depth >= static_cast<int>(kMaxNestingDepth)) {
+      _encodable = false;
+      return;
+    }
+    for (int i = 0; i < num_elements && _encodable; ++i) {
+      addFields(nested_iter->second, formats, depth + 1);
+    }
+  }
+}
+
+DataEncoder::DataEncoder(uint16_t msg_id, DataEncodingLayout layout)
+    : _msg_id(msg_id),
+      _layout(std::move(layout)),
+      _previous(_layout.lanes().size()),
+      _leading(_layout.lanes().size()),
+      _trailing(_layout.lanes().size())
+{
+  if (!_layout.encodable()) {
+    throw UsageException("Message format cannot be encoded");
+  }
+}
+
+bool DataEncoder::canAppend() const
+{
+  if (_num_samples == 0) {
+    return true;
+  }
+  const unsigned max_num_bits = _num_bits + _layout.maxEncodedSampleBits();
+  return _num_samples < kMaxSamplesPerBlock &&
+         _layout.sampleSize() + (max_num_bits + 7) / 8 <= kMaxBlockPayload;
+}
+
+void DataEncoder::append(const uint8_t* sample, unsigned length)
+{
+  if (length != _layout.sampleSize()) {
+    throw UsageException("Sample size does not match the message format");
+  }
+  const auto& lanes = _layout.lanes();
+
+  if (_num_samples == 0) {
+    _first_sample.assign(sample, sample + length);
+    unsigned offset = 0;
+    for (unsigned i = 0; i < lanes.size(); ++i) {
+      _previous[i] = 0;
+      memcpy(&_previous[i], sample + offset, lanes[i]);
+      offset += lanes[i];
+    }
+    std::fill(_leading.begin(), _leading.end(), kNoWindow);
+    _previous_delta = 0;
+    _num_samples = 1;
+    return;
+  }
+
+  unsigned offset = 0;
+  for (unsigned i = 0; i < lanes.size(); ++i) {
+    uint64_t value = 0;
+    memcpy(&value, sample + offset, lanes[i]);
+    offset += lanes[i];
+
+    if (i == 0 && _layout.hasTimestamp()) {
+      // Delta-of-delta
+      const uint64_t delta = value - _previous[i];
+      const int64_t delta_of_delta = static_cast<int64_t>(delta - _previous_delta);
+      if (delta_of_delta == 0) {
+        writeBits(0b0, 1);
+      } else if (delta_of_delta >= -64 && delta_of_delta < 64) {
+        writeBits(0b10, 2);
+        writeBits(delta_of_delta, 7);
+      } else if (delta_of_delta >= -256 && delta_of_delta < 256) {
+        writeBits(0b110, 3);
+        writeBits(delta_of_delta, 9);
+      } else if (delta_of_delta >= -2048 && delta_of_delta < 2048) {
+        writeBits(0b1110, 4);
+        writeBits(delta_of_delta, 12);
+      } else if (delta_of_delta >= std::numeric_limits<int32_t>::min() &&
+                 delta_of_delta <= std::numeric_limits<int32_t>::max()) {
+        writeBits(0b11110, 5);
+        writeBits(delta_of_delta, 32);
+      } else {
+        writeBits(0b11111, 5);
+        writeBits(delta_of_delta, 64);
+      }
+      _previous_delta = delta;
+
+    } else {
+      // XOR with previous value
+      const uint64_t xor_value = value ^ _previous[i];
+      if (xor_value == 0) {
+        writeBits(0b0, 1);
+      } else {
+        const unsigned width = lanes[i] * 8;
+        const unsigned leading = countLeadingZeros(xor_value) - (64 - width);
+        const unsigned trailing = countTrailingZeros(xor_value);
+        if (_leading[i] != kNoWindow && leading >= _leading[i] && trailing >= _trailing[i]) {
+          // Meaningful bits fit into the previous window
+          writeBits(0b10, 2);
+          writeBits(xor_value >> _trailing[i], width - _leading[i] - _trailing[i]);
+        } else {
+          const unsigned meaningful_bits = width - leading - trailing;
+          writeBits(0b11, 2);
+          writeBits(leading, windowBits(lanes[i]));
+          writeBits(meaningful_bits - 1, windowBits(lanes[i]));
+          writeBits(xor_value >> trailing, meaningful_bits);
+          _leading[i] = leading;
+          _trailing[i] = trailing;
+        }
+      }
+    }
+    _previous[i] = value;
+  }
+  ++_num_samples;
+}
+
+void DataEncoder::flush(const DataWriteCB& writer)
+{
+  if (_num_samples == 0) {
+    return;
+  }
+  ulog_message_data_encoded_s encoded;
+  const int msg_size =
+      sizeof(encoded) - ULOG_MSG_HEADER_LEN + _first_sample.size() + _bits.size();
+  if (msg_size > std::numeric_limits<uint16_t>::max()) {
+    throw ParsingException("message too long");
+  }
+  encoded.msg_size = msg_size;
+  encoded.msg_id = _msg_id;
+  encoded.num_samples = _num_samples;
+
+  writer(reinterpret_cast<const unsigned char*>(&encoded), sizeof(encoded));
+  writer(_first_sample.data(), _first_sample.size());
+  writer(_bits.data(), _bits.size());
+
+  _num_samples = 0;
+  _bits.clear();
+  _num_bits = 0;
+}
+
+void DataEncoder::writeBits(uint64_t value, unsigned num_bits)
+{
+  while (num_bits > 0) {
+    const unsigned bit_offset = _num_bits % 8;
+    if (bit_offset == 0) {
+      _bits.push_back(0);
+    }
+    const unsigned free_bits = 8 - bit_offset;
+    const unsigned n = std::min(free_bits, num_bits);
+    const uint8_t chunk = (value >> (num_bits - n)) & ((1U << n) - 1);
+    _bits.back() |= chunk << (free_bits - n);
+    _num_bits += n;
+    num_bits -= n;
+  }
+}
+
+DataDecoder::DataDecoder(DataEncodingLayout layout) : _layout(std::move(layout)) {}
+
+std::vector<Data> DataDecoder::decode(const uint8_t* msg) const
+{
+  const ulog_message_data_encoded_s* encoded =
+      reinterpret_cast<const ulog_message_data_encoded_s*>(msg);
+  const unsigned header_size = sizeof(*encoded) - ULOG_MSG_HEADER_LEN;
+  const unsigned sample_size = _layout.sampleSize();
+  CHECK_MSG_SIZE(encoded->msg_size, header_size + sample_size);
+  if (encoded->num_samples == 0) {
+    throw ParsingException("Encoded data without samples");
+  }
+  const auto& lanes = _layout.lanes();
+  const uint8_t* payload = msg + sizeof(*encoded);
+
+  std::vector<Data> samples;
+  samples.reserve(encoded->num_samples);
+  samples.emplace_back(encoded->msg_id, std::vector<uint8_t>(payload, payload + sample_size));
+
+  std::vector<uint64_t> previous(lanes.size());
+  std::vector<uint8_t> leading(lanes.size(), kNoWindow);
+  std::vector<uint8_t> trailing(lanes.size());
+  unsigned offset = 0;
+  for (unsigned i = 0; i < lanes.size(); ++i) {
+    memcpy(&previous[i], payload + offset, lanes[i]);
+    offset += lanes[i];
+  }
+  uint64_t previous_delta = 0;
+
+  BitReader bits(payload + sample_size, encoded->msg_size - header_size - sample_size);
+  for (unsigned sample_index = 1; sample_index < encoded->num_samples; ++sample_index) {
+    std::vector<uint8_t> sample(sample_size);
+    offset = 0;
+    for (unsigned i = 0; i < lanes.size(); ++i) {
+      uint64_t value = previous[i];
+
+      if (i == 0 && _layout.hasTimestamp()) {
+        int64_t delta_of_delta = 0;
+        if (bits.read(1) == 0) {
+          delta_of_delta = 0;
+        } else if (bits.read(1) == 0) {
+          delta_of_delta = signExtend(bits.read(7), 7);
+        } else if (bits.read(1) == 0) {
+          delta_of_delta = signExtend(bits.read(9), 9);
+        } else if (bits.read(1) == 0) {
+          delta_of_delta = signExtend(bits.read(12), 12);
+        } else if (bits.read(1) == 0) {
+          delta_of_delta = signExtend(bits.read(32), 32);
+        } else {
+          delta_of_delta = signExtend(bits.read(64), 64);
+        }
+        previous_delta += delta_of_delta;
+        value += previous_delta;
+
+      } else if (bits.read(1) != 0) {
+        const unsigned width = lanes[i] * 8;
+        if (bits.read(1) == 0) {
+          if (leading[i] == kNoWindow) {
+            throw ParsingException("Invalid encoded data (no XOR window)");
+          }
+          const unsigned meaningful_bits = width - leading[i] - trailing[i];
+          value ^= bits.read(meaningful_bits) << trailing[i];
+        } else {
+          const unsigned num_leading = bits.read(windowBits(lanes[i]));
+          const unsigned meaningful_bits = bits.read(windowBits(lanes[i])) + 1;
+          if (num_leading + meaningful_bits > width) {
+            throw ParsingException("Invalid encoded data (XOR window)");
+          }
+          leading[i] = num_leading;
+          trailing[i] = width - num_leading - meaningful_bits;
+          value ^= bits.read(meaningful_bits) << trailing[i];
+        }
+      }
+
+      memcpy(sample.data() + offset, &value, lanes[i]);
+      offset += lanes[i];
+      previous[i] = value;
+    }
+    samples.emplace_back(encoded->msg_id, std::move(sample));
+  }
+  return samples;
+}
+
+}  // namespace ulog_cpp
@@ -0,0 +1,185 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "deferred_logging.hpp"
+
+#include <cstdio>
+
+namespace ulog_cpp {
+
+namespace {
+
+const char* kMismatch = "<?>";
+
+template <typename T>
+void appendFormatted(std::string& out, const std::string& spec, T value)
+{
+  char buffer[128];
+  const int length = snprintf(buffer, sizeof(buffer), spec.c_str(), value);
+  if (length < 0) {
+    out += kMismatch;
+  } else if (static_cast<size_t>(length) < sizeof(buffer)) {
+    out.append(buffer, length);
+  } else {
+    std::vector<char> large(length + 1);
+    snprintf(large.data(), large.size(), spec.c_str(), value);
+    out.append(large.data(), length);
+  }
+}
+
+bool isIntegerConversion(char c)
+{
+  return c == 'd' || c == 'i' || c == 'u' || c == 'x' || c == 'X' || c == 'o';
+}
+
+bool isFloatConversion(char c)
+{
+  return c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G' || c == 'a' ||
+         c == 'A';
+}
+
+}  // namespace
+
+MessageInfo deferredFormatInfo(uint16_t id, const std::string& arg_codes,
+                               const std::string& format)
+{
+  const std::string value = std::to_string(id) + ':' + arg_codes + ':' + format;
+  return MessageInfo{Field("char", kDeferredFormatInfoKey, static_cast<int>(value.size())),
+                     std::vector<uint8_t>(value.begin(), value.end()), true};
+}
+
+bool DeferredFormatter::addFormat(const MessageInfo& message_info)
+{
+  if (message_info.field().name != kDeferredFormatInfoKey || message_info.field().type != "char") {
+    return false;
+  }
+  const std::string value(message_info.valueRaw().begin(), message_info.valueRaw().end());
+  const size_t id_end = value.find(':');
+  if (id_end == std::string::npos || id_end == 0) {
+    return false;
+  }
+  const size_t codes_end = value.find(':', id_end + 1);
+  if (codes_end == std::string::npos) {
+    return false;
+  }
+  unsigned long id = 0;
+  try {
+    id = std::stoul(value.substr(0, id_end));
+  } catch (const std::exception&) {
+    return false;
+  }
+  if (id > std::numeric_limits<uint16_t>::max()) {
+    return false;
+  }
+  Format& format = _formats[static_cast<uint16_t>(id)];
+  format.arg_codes = value.substr(id_end + 1, codes_end - id_end - 1);
+  format.format = value.substr(codes_end + 1);
+  return true;
+}
+
+std::string DeferredFormatter::format(const DeferredLogging& logging) const
+{
+  const auto format_iter = _formats.find(logging.formatId());
+  if (format_iter == _formats.end()) {
+    return "<unknown format " + std::to_string(logging.formatId()) + ">";
+  }
+  const std::string& codes = format_iter->second.arg_codes;
+  const std::string& format = format_iter->second.format;
+  const std::vector<uint8_t>& args = logging.args();
+
+  std::string result;
+  size_t arg_index = 0;
+  size_t arg_offset = 0;
+  size_t i = 0;
+  while (i < format.size()) {
+    const size_t percent = format.find('%', i);
+    result.append(format, i, percent == std::string::npos ? std::string::npos : percent - i);
+    if (percent == std::string::npos) {
+      break;
+    }
+    i = percent + 1;
+    if (i < format.size() && format[i] == '%') {
+      result += '%';
+      ++i;
+      continue;
+    }
+    // Flags, width and precision are kept, length modifiers are replaced
+    std::string spec = "%";
+    while (i < format.size() && strchr("-+ #0123456789.", format[i])) {
+      spec += format[i++];
+    }
+    while (i < format.size() && strchr("hlLqjzt", format[i])) {
+      ++i;
+    }
+    if (i >= format.size()) {
+      result += kMismatch;
+      break;
+    }
+    const char conversion = format[i++];
+
+    const char code = arg_index < codes.size() ? codes[arg_index] : '\0';
+    ++arg_index;
+    if (code == 'i' || code == 'u') {
+      if (arg_offset + sizeof(uint64_t) > args.size()) {
+        result += kMismatch;
+        continue;
+      }
+      uint64_t value;
+      memcpy(&value, args.data() + arg_offset, sizeof(value));
+      arg_offset += sizeof(value);
+      if (isIntegerConversion(conversion) && code == 'i') {
+        appendFormatted(result, spec + "ll" + conversion, static_cast<long long>(value));
+      } else if (isIntegerConversion(conversion)) {
+        appendFormatted(result, spec + "ll" + conversion, static_cast<unsigned long long>(value));
+      } else if (conversion == 'c') {
+        appendFormatted(result, spec + conversion, static_cast<int>(value));
+      } else {
+        result += kMismatch;
+      }
+    } else if (code == 'f') {
+      if (arg_offset + sizeof(double) > args.size()) {
+        result += kMismatch;
+        continue;
+      }
+      double value;
+      memcpy(&value, args.data() + arg_offset, sizeof(value));
+      arg_offset += sizeof(value);
+      if (isFloatConversion(conversion)) {
+        appendFormatted(result, spec + conversion, value);
+      } else {
+        result += kMismatch;
+      }
+    } else if (code == 's') {
+      uint16_t length = 0;
+      if (arg_offset + sizeof(length) <= args.size()) {
+        memcpy(&length, args.data() + arg_offset, sizeof(length));
+      }
+      if (arg_offset + sizeof(length) + length > args.size()) {
+        result += kMismatch;
+        arg_offset = args.size();
+        continue;
+      }
+      const std::string value(reinterpret_cast<const char*>(args.data()) + arg_offset +
+                                  sizeof(length),
+                              length);
+      arg_offset += sizeof(length) + length;
+      if (conversion == 's') {
+        appendFormatted(result, spec + conversion, value.c_str());
+      } else {
+        result += kMismatch;
+      }
+    } else {
+      result += kMismatch;
+    }
+  }
+  return result;
+}
+
+Logging DeferredFormatter::expand(const DeferredLogging& logging) const
+{
+  return Logging{logging.logLevel(), format(logging), logging.timestamp()};
+}
+
+}  // namespace ulog_cpp
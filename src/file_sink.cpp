@@ -0,0 +1,840 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "file_sink.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ULOG_CPP_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#else
+#define ULOG_CPP_HAVE_IO_URING 0
+#endif
+
+#include "exception.hpp"
+#include "log_recovery.hpp"
+#include "raw_messages.hpp"
+
+namespace ulog_cpp {
+
+namespace {
+
+class StdioFileSink : public FileSink {
+ public:
+  explicit StdioFileSink(const std::string& filename) : _file(std::fopen(filename.c_str(), "wb"))
+  {
+    if (!_file) {
+      throw ParsingException("Failed to open file");
+    }
+  }
+  ~StdioFileSink() override { std::fclose(_file); }
+
+  void write(const uint8_t* data, int length) override { std::fwrite(data, 1, length, _file); }
+  void flush() override { std::fflush(_file); }
+  void sync() override
+  {
+    std::fflush(_file);
+    ::fsync(fileno(_file));
+  }
+  FileSinkType type() const override { return FileSinkType::Stdio; }
+
+ private:
+  std::FILE* const _file;
+};
+
+#if ULOG_CPP_HAVE_IO_URING
+
+/**
+ * Data is copied into page-aligned buffers, which are registered with the ring. A write request is
+ * submitted when a buffer is full or on flush(), and the producer only blocks if all buffers are
+ * in flight. A buffer that is partially in flight (after a flush()) keeps being filled behind the
+ * submitted part. At most one fsync is in flight, a sync() in the meantime is issued after it.
+ */
+class IoUringFileSink : public FileSink {
+ public:
+  /**
+   * Takes ownership of fd. Returns nullptr if io_uring is not available.
+   */
+  static std::unique_ptr<IoUringFileSink> create(int fd, const FileSinkConfig& config)
+  {
+    if (config.buffer_size == 0 || config.buffer_size > UINT32_MAX || config.num_buffers <= 0) {
+      ::close(fd);
+      throw UsageException("Invalid io_uring buffer configuration");
+    }
+    std::unique_ptr<IoUringFileSink> sink(new IoUringFileSink(fd, config.buffer_size));
+    if (!sink->setup(config.num_buffers)) {
+      return nullptr;
+    }
+    return sink;
+  }
+
+  ~IoUringFileSink() override
+  {
+    if (_ready) {
+      try {
+        submitWrite(_current);
+        while (_in_flight > 0) {
+          reap(true);
+        }
+      } catch (const ExceptionBase&) {
+        // Nothing left to do about write errors at this point
+      }
+    }
+    if (_ring_fd >= 0) {
+      if (_sqes) {
+        munmap(_sqes, _sqes_size);
+      }
+      if (_cq_ring && _cq_ring != _sq_ring) {
+        munmap(_cq_ring, _cq_ring_size);
+      }
+      if (_sq_ring) {
+        munmap(_sq_ring, _sq_ring_size);
+      }
+      ::close(_ring_fd);
+    }
+    for (auto& buffer : _buffers) {
+      free(buffer.data);
+    }
+    ::close(_fd);
+  }
+
+  void write(const uint8_t* data, int length) override
+  {
+    throwOnError();
+    while (length > 0) {
+      Buffer& buffer = _buffers[_current];
+      if (buffer.fill == _buffer_size) {
+        nextBuffer();
+        continue;
+      }
+      const int num_bytes = static_cast<int>(std::min<size_t>(length, _buffer_size - buffer.fill));
+      memcpy(buffer.data + buffer.fill, data, num_bytes);
+      buffer.fill += num_bytes;
+      data += num_bytes;
+      length -= num_bytes;
+    }
+  }
+
+  void flush() override
+  {
+    throwOnError();
+    submitWrite(_current);
+    reap(false);
+  }
+
+  void sync() override
+  {
+    flush();
+    if (_sync_in_flight) {
+      _sync_requested = true;
+    } else {
+      submitSync();
+    }
+  }
+
+  FileSinkType type() const override { return FileSinkType::IoUring; }
+
+ private:
+  static constexpr uint64_t kSyncUserData = UINT64_MAX;
+  static constexpr unsigned kRingEntries = 64;
+
+  struct Buffer {
+    uint8_t* data{nullptr};
+    size_t fill{0};
+    size_t submitted{0};
+    int in_flight{0};
+  };
+
+  IoUringFileSink(int fd, size_t buffer_size) : _fd(fd), _buffer_size(buffer_size) {}
+
+  bool setup(int num_buffers)
+  {
+    io_uring_params params{};
+    _ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, kRingEntries, &params));
+    if (_ring_fd < 0) {
+      return false;
+    }
+    // IORING_OP_WRITE was added together with this feature (Linux 5.6)
+    if ((params.features & IORING_FEAT_RW_CUR_POS) == 0) {
+      return false;
+    }
+
+    _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+    }
+    _sq_ring = mapRing(_sq_ring_size, IORING_OFF_SQ_RING);
+    if (!_sq_ring) {
+      return false;
+    }
+    _cq_ring = single_mmap ? _sq_ring : mapRing(_cq_ring_size, IORING_OFF_CQ_RING);
+    _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    _sqes = static_cast<io_uring_sqe*>(mapRing(_sqes_size, IORING_OFF_SQES));
+    if (!_cq_ring || !_sqes) {
+      return false;
+    }
+
+    auto* sq = static_cast<uint8_t*>(_sq_ring);
+    _sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    _sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    _sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    auto* cq = static_cast<uint8_t*>(_cq_ring);
+    _cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    _cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    _cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    _max_in_flight = params.sq_entries;
+
+    std::vector<iovec> iovecs;
+    _buffers.resize(num_buffers);
+    for (auto& buffer : _buffers) {
+      void* data = nullptr;
+      if (posix_memalign(&data, 4096, _buffer_size) != 0) {
+        return false;
+      }
+      buffer.data = static_cast<uint8_t*>(data);
+      iovecs.push_back({data, _buffer_size});
+    }
+    // Registration can fail due to RLIMIT_MEMLOCK, in which case plain writes are used
+    _fixed_buffers = syscall(__NR_io_uring_register, _ring_fd, IORING_REGISTER_BUFFERS,
+                             iovecs.data(), iovecs.size()) == 0;
+    _ready = true;
+    return true;
+  }
+
+  void* mapRing(size_t size, off_t offset) const
+  {
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd,
+                     offset);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+  }
+
+  void enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+  {
+    while (syscall(__NR_io_uring_enter, _ring_fd, to_submit, min_complete, flags, nullptr, 0) < 0) {
+      if (errno != EINTR) {
+        throw ParsingException(std::string("io_uring_enter failed: ") + strerror(errno));
+      }
+    }
+  }
+
+  void submitSqe(const io_uring_sqe& sqe)
+  {
+    while (_in_flight >= _max_in_flight) {
+      reap(true);
+    }
+    const unsigned tail = *_sq_tail;  // only written by us
+    const unsigned index = tail & _sq_mask;
+    _sqes[index] = sqe;
+    _sq_array[index] = index;
+    __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++_in_flight;
+    enter(1, 0, 0);
+  }
+
+  void submitWrite(int buffer_index)
+  {
+    Buffer& buffer = _buffers[buffer_index];
+    const size_t length = buffer.fill - buffer.submitted;
+    if (length == 0) {
+      return;
+    }
+    io_uring_sqe sqe{};
+    sqe.opcode = _fixed_buffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe.fd = _fd;
+    sqe.off = _file_offset;
+    sqe.addr = reinterpret_cast<uint64_t>(buffer.data + buffer.submitted);
+    sqe.len = static_cast<uint32_t>(length);
+    sqe.buf_index = _fixed_buffers ? buffer_index : 0;
+    sqe.user_data = (static_cast<uint64_t>(buffer_index) << 32) | length;
+    submitSqe(sqe);
+    ++buffer.in_flight;
+    buffer.submitted = buffer.fill;
+    _file_offset += length;
+  }
+
+  void submitSync()
+  {
+    io_uring_sqe sqe{};
+    sqe.opcode = IORING_OP_FSYNC;
+    sqe.fd = _fd;
+    sqe.flags = IOSQE_IO_DRAIN;  // after all previously submitted writes
+    sqe.user_data = kSyncUserData;
+    submitSqe(sqe);
+    _sync_in_flight = true;
+  }
+
+  void nextBuffer()
+  {
+    submitWrite(_current);
+    _current = (_current + 1) % static_cast<int>(_buffers.size());
+    Buffer& buffer = _buffers[_current];
+    while (buffer.in_flight > 0) {
+      reap(true);
+    }
+    buffer.fill = 0;
+    buffer.submitted = 0;
+  }
+
+  void reap(bool wait)
+  {
+    if (wait) {
+      enter(0, 1, IORING_ENTER_GETEVENTS);
+    }
+    unsigned head = *_cq_head;  // only written by us
+    const unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+    bool sync_completed = false;
+    for (; head != tail; ++head) {
+      const io_uring_cqe& cqe = _cqes[head & _cq_mask];
+      --_in_flight;
+      if (cqe.user_data == kSyncUserData) {
+        sync_completed = true;
+        if (cqe.res < 0) {
+          _error = -cqe.res;
+        }
+        continue;
+      }
+      const auto length = static_cast<int32_t>(cqe.user_data & 0xffffffff);
+      --_buffers[cqe.user_data >> 32].in_flight;
+      if (cqe.res != length) {
+        _error = cqe.res < 0 ? -cqe.res : EIO;  // a short write means the disk is full
+      }
+    }
+    __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+
+    if (sync_completed) {
+      _sync_in_flight = false;
+      if (_sync_requested && _error == 0) {
+        _sync_requested = false;
+        submitSync();
+      }
+    }
+  }
+
+  void throwOnError() const
+  {
+    if (_error != 0) {
+      throw ParsingException(std::string("Failed to write file: ") + strerror(_error));
+    }
+  }
+
+  const int _fd;
+  const size_t _buffer_size;
+
+  bool _ready{false};  ///< setup() succeeded
+  int _ring_fd{-1};
+  void* _sq_ring{nullptr};
+  void* _cq_ring{nullptr};
+  io_uring_sqe* _sqes{nullptr};
+  size_t _sq_ring_size{0};
+  size_t _cq_ring_size{0};
+  size_t _sqes_size{0};
+  unsigned* _sq_tail{nullptr};
+  unsigned _sq_mask{0};
+  unsigned* _sq_array{nullptr};
+  unsigned* _cq_head{nullptr};
+  unsigned* _cq_tail{nullptr};
+  unsigned _cq_mask{0};
+  io_uring_cqe* _cqes{nullptr};
+
+  std::vector<Buffer> _buffers;
+  bool _fixed_buffers{false};
+  int _current{0};
+  uint64_t _file_offset{0};
+  unsigned _in_flight{0};
+  unsigned _max_in_flight{0};
+  bool _sync_in_flight{false};
+  bool _sync_requested{false};
+  int _error{0};
+};
+
+#endif  // ULOG_CPP_HAVE_IO_URING
+
+#ifdef O_DIRECT
+
+/**
+ * The data is collected in aligned buffers. Full buffers are written with pwrite() by a background
+ * thread, so the producer only blocks if all buffers are waiting to be written.
+ * flush() hands over the current buffer early, with the last partial block padded with zeros. The
+ * next buffer starts with a copy of that block, which is written again once it has more data.
+ * sync() queues an fdatasync() on the background thread.
+ */
+class DirectFileSink : public FileSink {
+ public:
+  static constexpr size_t kBlockSize = 4096;
+
+  /**
+   * Takes ownership of fd. Returns nullptr if O_DIRECT writes are not supported.
+   */
+  static std::unique_ptr<DirectFileSink> create(int fd, const FileSinkConfig& config)
+  {
+    if (config.buffer_size == 0 || config.num_buffers <= 0) {
+      ::close(fd);
+      throw UsageException("Invalid O_DIRECT buffer configuration");
+    }
+    const size_t buffer_size = (config.buffer_size + kBlockSize - 1) / kBlockSize * kBlockSize;
+    std::unique_ptr<DirectFileSink> sink(new DirectFileSink(fd, buffer_size));
+    if (!sink->setup(config.num_buffers, config.preallocate_size)) {
+      return nullptr;
+    }
+    return sink;
+  }
+
+  ~DirectFileSink() override
+  {
+    if (_thread.joinable()) {
+      if (_dirty) {
+        submitBuffer();
+      }
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+      }
+      _condition.notify_all();
+      _thread.join();
+      const Buffer& buffer = _buffers[_current];
+      if (ftruncate(_fd, static_cast<off_t>(buffer.file_offset + buffer.fill)) != 0) {
+        // Nothing left to do at this point
+      }
+    }
+    for (auto& buffer : _buffers) {
+      free(buffer.data);
+    }
+    ::close(_fd);
+  }
+
+  void write(const uint8_t* data, int length) override
+  {
+    throwOnError();
+    while (length > 0) {
+      Buffer& buffer = _buffers[_current];
+      const int num_bytes = static_cast<int>(std::min<size_t>(length, _buffer_size - buffer.fill));
+      memcpy(buffer.data + buffer.fill, data, num_bytes);
+      buffer.fill += num_bytes;
+      data += num_bytes;
+      length -= num_bytes;
+      _dirty = true;
+      if (buffer.fill == _buffer_size) {
+        submitBuffer();
+      }
+    }
+  }
+
+  void flush() override
+  {
+    throwOnError();
+    if (_dirty) {
+      submitBuffer();
+    }
+  }
+
+  void sync() override
+  {
+    flush();
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_sync_queued) {
+        return;
+      }
+      _sync_queued = true;
+      _jobs.push_back({-1, 0, 0});
+    }
+    _condition.notify_all();
+  }
+
+  FileSinkType type() const override { return FileSinkType::Direct; }
+
+ private:
+  struct Buffer {
+    uint8_t* data{nullptr};
+    size_t fill{0};
+    uint64_t file_offset{0};  ///< of data[0], a multiple of kBlockSize
+    bool queued{false};
+  };
+  struct Job {
+    int buffer;  ///< -1: fdatasync()
+    uint64_t file_offset;
+    size_t length;
+  };
+
+  DirectFileSink(int fd, size_t buffer_size) : _fd(fd), _buffer_size(buffer_size) {}
+
+  bool setup(int num_buffers, uint64_t preallocate_size)
+  {
+    _buffers.resize(num_buffers);
+    for (auto& buffer : _buffers) {
+      void* data = nullptr;
+      if (posix_memalign(&data, kBlockSize, _buffer_size) != 0) {
+        return false;
+      }
+      buffer.data = static_cast<uint8_t*>(data);
+    }
+    // Some file systems only fail on the first write
+    memset(_buffers[0].data, 0, kBlockSize);
+    if (pwrite(_fd, _buffers[0].data, kBlockSize, 0) != static_cast<ssize_t>(kBlockSize)) {
+      return false;
+    }
+    if (preallocate_size > 0) {
+      // Not supported by all file systems, in which case the file grows as usual
+      (void)fallocate(_fd, 0, 0, static_cast<off_t>(preallocate_size));
+    }
+    _thread = std::thread([this]() { run(); });
+    return true;
+  }
+
+  void submitBuffer()
+  {
+    Buffer& buffer = _buffers[_current];
+    const size_t padded_length = (buffer.fill + kBlockSize - 1) / kBlockSize * kBlockSize;
+    memset(buffer.data + buffer.fill, 0, padded_length - buffer.fill);
+    const size_t partial_length = buffer.fill % kBlockSize;
+
+    const int next = (_current + 1) % static_cast<int>(_buffers.size());
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      buffer.queued = true;
+      _jobs.push_back({_current, buffer.file_offset, padded_length});
+      _condition.notify_all();
+      _condition.wait(lock, [&]() { return !_buffers[next].queued; });
+    }
+
+    // The partial last block continues in the next buffer
+    Buffer& next_buffer = _buffers[next];
+    memmove(next_buffer.data, buffer.data + buffer.fill - partial_length, partial_length);
+    next_buffer.fill = partial_length;
+    next_buffer.file_offset = buffer.file_offset + buffer.fill - partial_length;
+    _current = next;
+    _dirty = false;
+  }
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+      _condition.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+      if (_jobs.empty()) {
+        return;  // stopped
+      }
+      const Job job = _jobs.front();
+      _jobs.pop_front();
+      if (job.buffer < 0) {
+        _sync_queued = false;
+      }
+      lock.unlock();
+
+      int error = 0;
+      if (job.buffer < 0) {
+        if (fdatasync(_fd) != 0) {
+          error = errno;
+        }
+      } else {
+        const uint8_t* data = _buffers[job.buffer].data;
+        size_t written = 0;
+        while (written < job.length) {
+          const ssize_t ret = pwrite(_fd, data + written, job.length - written,
+                                     static_cast<off_t>(job.file_offset + written));
+          if (ret < 0 && errno == EINTR) {
+            continue;
+          }
+          if (ret <= 0) {
+            error = ret < 0 ? errno : EIO;
+            break;
+          }
+          written += ret;
+        }
+      }
+
+      lock.lock();
+      if (error != 0) {
+        _error = error;
+      }
+      if (job.buffer >= 0) {
+        _buffers[job.buffer].queued = false;
+        _condition.notify_all();
+      }
+    }
+  }
+
+  void throwOnError() const
+  {
+    const int error = _error.load();
+    if (error != 0) {
+      throw ParsingException(std::string("Failed to write file: ") + strerror(error));
+    }
+  }
+
+  const int _fd;
+  const size_t _buffer_size;
+  std::vector<Buffer> _buffers;
+  int _current{0};  ///< only accessed by the producer
+  bool _dirty{false};
+
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  std::deque<Job> _jobs;
+  bool _sync_queued{false};
+  bool _stop{false};
+  std::atomic<int> _error{0};
+  std::thread _thread;
+};
+
+#endif  // O_DIRECT
+
+#ifdef MAP_POPULATE
+
+/**
+ * Writes into a shared memory mapping of the file, which is mapped window by window. Written data is
+ * in the page cache immediately, so it is not lost if the process crashes.
+ * The written stream is split into messages to maintain a commit marker (a small memory-mapped
+ * file next to the log) with the end of the last complete message. After a crash, recoverLog()
+ * truncates the file to that size. The marker is removed on close.
+ */
+class MmapFileSink : public FileSink {
+ public:
+  MmapFileSink(const std::string& filename, const FileSinkConfig& config)
+      : _marker_filename(commitMarkerFilename(filename))
+  {
+    if (config.buffer_size == 0) {
+      throw UsageException("Invalid mmap window size");
+    }
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    _window_size = (config.buffer_size + page_size - 1) / page_size * page_size;
+
+    _fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    _marker_fd = ::open(_marker_filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (_fd < 0 || _marker_fd < 0 || ftruncate(_marker_fd, sizeof(ulog_commit_marker_s)) != 0) {
+      closeFiles();
+      throw ParsingException("Failed to open file");
+    }
+    void* marker = mmap(nullptr, sizeof(ulog_commit_marker_s), PROT_READ | PROT_WRITE, MAP_SHARED,
+                        _marker_fd, 0);
+    if (marker == MAP_FAILED) {
+      closeFiles();
+      throw ParsingException("Failed to map file");
+    }
+    _marker = static_cast<ulog_commit_marker_s*>(marker);
+    memcpy(_marker->magic, ulog_commit_marker_magic, sizeof(_marker->magic));
+    _marker->committed_size = 0;
+
+    if (config.preallocate_size > 0) {
+      // Not supported by all file systems, in which case the file is extended per window
+      if (fallocate(_fd, 0, 0, static_cast<off_t>(config.preallocate_size)) == 0) {
+        _file_size = config.preallocate_size;
+      }
+    }
+    try {
+      mapWindow(0);
+    } catch (...) {
+      munmap(_marker, sizeof(ulog_commit_marker_s));
+      closeFiles();
+      throw;
+    }
+  }
+
+  ~MmapFileSink() override
+  {
+    if (_window) {
+      munmap(_window, _window_size);
+    }
+    munmap(_marker, sizeof(ulog_commit_marker_s));
+    if (ftruncate(_fd, static_cast<off_t>(_written)) == 0) {
+      std::remove(_marker_filename.c_str());
+    }
+    closeFiles();
+  }
+
+  void write(const uint8_t* data, int length) override
+  {
+    commitMessages(data, length);
+    while (length > 0) {
+      const size_t window_offset = _written - _window_offset;
+      if (window_offset == _window_size) {
+        mapWindow(_window_offset + _window_size);
+        continue;
+      }
+      const int num_bytes = static_cast<int>(std::min<size_t>(length, _window_size - window_offset));
+      memcpy(_window + window_offset, data, num_bytes);
+      _written += num_bytes;
+      data += num_bytes;
+      length -= num_bytes;
+    }
+    if (_committed != _marker->committed_size) {
+      _marker->committed_size = _committed;
+    }
+  }
+
+  void flush() override {}  // Already in the page cache
+
+  void sync() override { ::fdatasync(_fd); }
+
+  FileSinkType type() const override { return FileSinkType::Mmap; }
+
+ private:
+  void mapWindow(uint64_t window_offset)
+  {
+    if (_window) {
+      munmap(_window, _window_size);
+      _window = nullptr;
+    }
+    const uint64_t window_end = window_offset + _window_size;
+    if (window_end > _file_size) {
+      if (fallocate(_fd, 0, static_cast<off_t>(_file_size),
+                    static_cast<off_t>(window_end - _file_size)) != 0 &&
+          ftruncate(_fd, static_cast<off_t>(window_end)) != 0) {
+        throw ParsingException(std::string("Failed to extend file: ") + strerror(errno));
+      }
+      _file_size = window_end;
+    }
+    void* window = mmap(nullptr, _window_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        _fd, static_cast<off_t>(window_offset));
+    if (window == MAP_FAILED) {
+      throw ParsingException(std::string("Failed to map file: ") + strerror(errno));
+    }
+    _window = static_cast<uint8_t*>(window);
+    _window_offset = window_offset;
+  }
+
+  /**
+   * Track the message boundaries of the data that is about to be written
+   */
+  void commitMessages(const uint8_t* data, int length)
+  {
+    uint64_t offset = _written;
+    while (length > 0) {
+      if (_header_fill < ULOG_MSG_HEADER_LEN) {
+        const int num_bytes = std::min(length, ULOG_MSG_HEADER_LEN - _header_fill);
+        memcpy(_header + _header_fill, data, num_bytes);
+        _header_fill += num_bytes;
+        data += num_bytes;
+        length -= num_bytes;
+        offset += num_bytes;
+        if (_header_fill == ULOG_MSG_HEADER_LEN) {
+          uint16_t msg_size;
+          memcpy(&msg_size, _header, sizeof(msg_size));
+          _message_remaining = msg_size;
+        }
+      } else {
+        const int num_bytes =
+            static_cast<int>(std::min<uint64_t>(length, _message_remaining));
+        _message_remaining -= num_bytes;
+        data += num_bytes;
+        length -= num_bytes;
+        offset += num_bytes;
+      }
+      if (_header_fill == ULOG_MSG_HEADER_LEN && _message_remaining == 0) {
+        _committed = offset;
+        _header_fill = 0;
+      }
+    }
+  }
+
+  void closeFiles()
+  {
+    if (_fd >= 0) {
+      ::close(_fd);
+    }
+    if (_marker_fd >= 0) {
+      ::close(_marker_fd);
+    }
+  }
+
+  const std::string _marker_filename;
+  int _fd{-1};
+  int _marker_fd{-1};
+  ulog_commit_marker_s* _marker{nullptr};
+  size_t _window_size{0};
+  uint8_t* _window{nullptr};
+  uint64_t _window_offset{0};
+  uint64_t _file_size{0};
+  uint64_t _written{0};
+  uint64_t _committed{0};
+
+  // The file header is handled like a message without a header
+  uint8_t _header[ULOG_MSG_HEADER_LEN]{};
+  int _header_fill{ULOG_MSG_HEADER_LEN};
+  uint64_t _message_remaining{sizeof(ulog_file_header_s)};
+};
+
+#endif  // MAP_POPULATE
+
+}  // namespace
+
+std::unique_ptr<FileSink> createFileSink(const std::string& filename, const FileSinkConfig& config)
+{
+  switch (config.type) {
+    case FileSinkType::IoUring: {
+#if ULOG_CPP_HAVE_IO_URING
+      const int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+      if (fd < 0) {
+        throw ParsingException("Failed to open file");
+      }
+      auto sink = IoUringFileSink::create(fd, config);
+      if (sink) {
+        return sink;
+      }
+#endif
+      break;
+    }
+    case FileSinkType::Direct: {
+#ifdef O_DIRECT
+      const int fd =
+          ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0666);
+      if (fd >= 0) {
+        auto sink = DirectFileSink::create(fd, config);
+        if (sink) {
+          return sink;
+        }
+      } else if (errno != EINVAL) {
+        throw ParsingException("Failed to open file");
+      }
+#endif
+      break;
+    }
+    case FileSinkType::Mmap:
+#ifdef MAP_POPULATE
+      return std::make_unique<MmapFileSink>(filename, config);
+#endif
+      break;
+    case FileSinkType::Stdio:
+      break;
+  }
+  return std::make_unique<StdioFileSink>(filename);
+}
+
+const char* fileSinkTypeName(FileSinkType type)
+{
+  switch (type) {
+    case FileSinkType::Stdio:
+      return "stdio";
+    case FileSinkType::IoUring:
+      return "io_uring";
+    case FileSinkType::Direct:
+      return "direct";
+    case FileSinkType::Mmap:
+      return "mmap";
+  }
+  return "unknown";
+}
+
+}  // namespace ulog_cpp
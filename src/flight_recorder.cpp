@@ -0,0 +1,213 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "flight_recorder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+#include "exception.hpp"
+#include "raw_messages.hpp"
+
+namespace ulog_cpp {
+
+namespace {
+std::atomic<bool> g_signal_triggered{false};
+static_assert(std::atomic<bool>::is_always_lock_free, "required for the signal handler");
+
+void signalHandler(int /*signal_number*/)
+{
+  g_signal_triggered.store(true);
+}
+
+bool isDefinitionMessage(ULogMessageType type)
+{
+  switch (type) {
+    case ULogMessageType::FORMAT:
+    case ULogMessageType::INFO:
+    case ULogMessageType::INFO_MULTIPLE:
+    case ULogMessageType::PARAMETER:
+    case ULogMessageType::PARAMETER_DEFAULT:
+    case ULogMessageType::FLAG_BITS:
+      return true;
+    default:
+      return false;
+  }
+}
+}  // namespace
+
+FlightRecorder::FlightRecorder(const Config& config)
+    : _config(config), _ring(config.buffer_size)
+{
+  if (_ring.empty()) {
+    throw UsageException("FlightRecorder: buffer_size must not be 0");
+  }
+}
+
+void FlightRecorder::write(const uint8_t* data, int length)
+{
+  if (length <= 0) {
+    return;
+  }
+  _splitter.write(
+      data, length,
+      [this](const uint8_t* file_header, size_t size) {
+        _header.insert(_header.end(), file_header, file_header + size);
+      },
+      [this](const uint8_t* message, size_t size) {
+        handleMessage(message, static_cast<int>(size));
+      });
+}
+
+void FlightRecorder::handleMessage(const uint8_t* message, int length)
+{
+  const auto type = static_cast<ULogMessageType>(message[2]);
+  if (type == ULogMessageType::DATA_ENCODED) {
+    throw UsageException("FlightRecorder: DATA_ENCODED is not supported");
+  }
+  if (!_header_complete) {
+    if (isDefinitionMessage(type)) {
+      _header.insert(_header.end(), message, message + length);
+      return;
+    }
+    _header_complete = true;
+  }
+
+  // The timestamp offset within the message, if it has one
+  int timestamp_offset = -1;
+  switch (type) {
+    case ULogMessageType::DATA:
+      timestamp_offset = ULOG_MSG_HEADER_LEN + sizeof(uint16_t);
+      break;
+    case ULogMessageType::LOGGING:
+      timestamp_offset = ULOG_MSG_HEADER_LEN + sizeof(uint8_t);
+      break;
+    case ULogMessageType::LOGGING_TAGGED:
+    case ULogMessageType::LOGGING_DEFERRED:  // same layout: level, tag/format id, timestamp
+      timestamp_offset = ULOG_MSG_HEADER_LEN + sizeof(uint8_t) + sizeof(uint16_t);
+      break;
+    case ULogMessageType::DROPOUT:
+    case ULogMessageType::SYNC:
+      break;
+    default:
+      // Subscriptions, info and parameter changes
+      _persistent.insert(_persistent.end(), message, message + length);
+      return;
+  }
+
+  if (timestamp_offset >= 0 && timestamp_offset + static_cast<int>(sizeof(uint64_t)) <= length) {
+    uint64_t timestamp;
+    memcpy(&timestamp, message + timestamp_offset, sizeof(timestamp));
+    _latest_timestamp = std::max(_latest_timestamp, timestamp);
+  }
+  pushRecord(_latest_timestamp, message, length);
+}
+
+void FlightRecorder::pushRecord(uint64_t timestamp, const uint8_t* message, int length)
+{
+  const size_t record_length = kRecordHeaderLen + length;
+  if (record_length > _ring.size()) {
+    ++_stats.evicted_messages;
+    return;
+  }
+  while (_ring.size() - _ring_used < record_length) {
+    evictOldest();
+  }
+
+  const auto copy_to_ring = [this](const uint8_t* src, size_t num_bytes) {
+    const size_t first = std::min(num_bytes, _ring.size() - _ring_head);
+    memcpy(_ring.data() + _ring_head, src, first);
+    memcpy(_ring.data(), src + first, num_bytes - first);
+    _ring_head = (_ring_head + num_bytes) % _ring.size();
+  };
+  copy_to_ring(reinterpret_cast<const uint8_t*>(&timestamp), sizeof(timestamp));
+  copy_to_ring(message, length);
+  _ring_used += record_length;
+  ++_stats.messages;
+  _stats.buffered_bytes += length;
+}
+
+void FlightRecorder::copyFromRing(size_t offset, uint8_t* dest, size_t length) const
+{
+  offset %= _ring.size();
+  const size_t first = std::min(length, _ring.size() - offset);
+  memcpy(dest, _ring.data() + offset, first);
+  memcpy(dest + first, _ring.data(), length - first);
+}
+
+size_t FlightRecorder::recordLength(size_t offset) const
+{
+  uint16_t msg_size;
+  copyFromRing(offset + kRecordHeaderLen, reinterpret_cast<uint8_t*>(&msg_size), sizeof(msg_size));
+  return kRecordHeaderLen + ULOG_MSG_HEADER_LEN + msg_size;
+}
+
+void FlightRecorder::evictOldest()
+{
+  const size_t record_length = recordLength(_ring_tail);
+  _ring_tail = (_ring_tail + record_length) % _ring.size();
+  _ring_used -= record_length;
+  --_stats.messages;
+  _stats.buffered_bytes -= record_length - kRecordHeaderLen;
+  ++_stats.evicted_messages;
+}
+
+void FlightRecorder::dump(const DataWriteCB& writer)
+{
+  writer(_header.data(), static_cast<int>(_header.size()));
+  if (!_persistent.empty()) {
+    writer(_persistent.data(), static_cast<int>(_persistent.size()));
+  }
+
+  const uint64_t min_timestamp =
+      _latest_timestamp > _config.pre_trigger_us ? _latest_timestamp - _config.pre_trigger_us : 0;
+  size_t offset = _ring_tail;
+  size_t remaining = _ring_used;
+  while (remaining > 0) {
+    const size_t record_length = recordLength(offset);
+    uint64_t timestamp;
+    copyFromRing(offset, reinterpret_cast<uint8_t*>(&timestamp), sizeof(timestamp));
+    if (timestamp >= min_timestamp) {
+      const size_t message_length = record_length - kRecordHeaderLen;
+      _dump_buffer.resize(message_length);
+      copyFromRing(offset + kRecordHeaderLen, _dump_buffer.data(), message_length);
+      writer(_dump_buffer.data(), static_cast<int>(message_length));
+    }
+    offset = (offset + record_length) % _ring.size();
+    remaining -= record_length;
+  }
+  ++_stats.dumps;
+}
+
+void FlightRecorder::dumpToFile(const std::string& filename)
+{
+  std::FILE* file = std::fopen(filename.c_str(), "wb");
+  if (!file) {
+    throw ParsingException("Failed to open file");
+  }
+  bool failed = false;
+  dump([file, &failed](const uint8_t* data, int length) {
+    failed |= std::fwrite(data, 1, length, file) != static_cast<size_t>(length);
+  });
+  failed |= std::fclose(file) != 0;
+  if (failed) {
+    throw ParsingException("Failed to write file");
+  }
+}
+
+void FlightRecorder::installSignalTrigger(int signal_number)
+{
+  std::signal(signal_number, signalHandler);
+}
+
+bool FlightRecorder::consumeSignalTrigger()
+{
+  return g_signal_triggered.exchange(false);
+}
+
+}  // namespace ulog_cpp
@@ -0,0 +1,345 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "log_combiner.hpp"
+
+#include <cstring>
+#include <limits>
+
+#include "deferred_logging.hpp"
+#include "exception.hpp"
+
+namespace ulog_cpp {
+
+namespace {
+
+constexpr uint32_t kNumIds = std::numeric_limits<uint16_t>::max() + 1;
+/// Ids per kind that should be left for the current file, see LogCombiner::idsRunningOut()
+constexpr size_t kIdReserve = 4096;
+
+}  // namespace
+
+struct LogCombiner::Input {
+  // Definitions section
+  uint8_t compat_flags[8]{};
+  std::map<std::string, MessageInfo> infos;
+  std::vector<MessageInfo> infos_multi;  ///< without text format registrations
+  std::map<std::string, Parameter> parameters;
+  std::map<std::string, ParameterDefault> default_parameters;
+
+  std::vector<int32_t> msg_ids = std::vector<int32_t>(kNumIds, -1);  ///< merged id, -1: unknown
+  std::unordered_map<uint16_t, uint16_t> format_ids;                  ///< merged format id
+  std::map<std::pair<std::string, uint8_t>, uint8_t> multi_ids;      ///< merged multi_id
+};
+
+bool messageTimestamp(const uint8_t* message, size_t length, uint64_t& timestamp)
+{
+  size_t timestamp_offset;
+  switch (static_cast<ULogMessageType>(message[2])) {
+    case ULogMessageType::DATA:
+      timestamp_offset = sizeof(ulog_message_data_s);
+      break;
+    case ULogMessageType::DATA_ENCODED:
+      timestamp_offset = sizeof(ulog_message_data_encoded_s);
+      break;
+    case ULogMessageType::LOGGING:
+      timestamp_offset = ULOG_MSG_HEADER_LEN + 1;
+      break;
+    case ULogMessageType::LOGGING_TAGGED:
+    case ULogMessageType::LOGGING_DEFERRED:
+      timestamp_offset = ULOG_MSG_HEADER_LEN + 3;
+      break;
+    default:
+      return false;
+  }
+  if (timestamp_offset + sizeof(timestamp) > length) {
+    return false;
+  }
+  memcpy(&timestamp, message + timestamp_offset, sizeof(timestamp));
+  return true;
+}
+
+bool LogCombiner::IdAllocator::allocate(uint16_t& id)
+{
+  if (next < kNumIds) {
+    id = static_cast<uint16_t>(next++);
+    return true;
+  }
+  if (free.empty()) {
+    return false;
+  }
+  id = free.back();
+  free.pop_back();
+  return true;
+}
+
+void LogCombiner::IdAllocator::newFile()
+{
+  free.insert(free.end(), released.begin(), released.end());
+  released.clear();
+}
+
+size_t LogCombiner::IdAllocator::available() const
+{
+  return kNumIds - next + free.size();
+}
+
+LogCombiner::LogCombiner() = default;
+
+LogCombiner::~LogCombiner() = default;
+
+size_t LogCombiner::addInput(const DataContainer& header)
+{
+  for (const auto& format_iter : header.messageFormats()) {
+    const auto existing = _formats.find(format_iter.first);
+    if (existing != _formats.end() && !(existing->second == format_iter.second)) {
+      throw ParsingException("Conflicting definitions of format " + format_iter.first);
+    }
+  }
+  _formats.insert(header.messageFormats().begin(), header.messageFormats().end());
+
+  auto input = std::make_unique<Input>();
+  memcpy(input->compat_flags, header.fileHeader().flagBits().compat_flags,
+         sizeof(input->compat_flags));
+  input->infos = header.messageInfo();
+  input->parameters = header.initialParameters();
+  input->default_parameters = header.defaultParameters();
+  for (const auto& multi_iter : header.messageInfoMulti()) {
+    for (const auto& infos_multi : multi_iter.second) {
+      for (const auto& info : infos_multi) {
+        if (info.field().name == kDeferredFormatInfoKey) {
+          remapFormatInfo(*input, info);
+        } else {
+          input->infos_multi.push_back(info);
+        }
+      }
+    }
+  }
+  _inputs.push_back(std::move(input));
+  return _inputs.size() - 1;
+}
+
+void LogCombiner::removeInput(size_t input)
+{
+  if (input >= _inputs.size() || !_inputs[input]) {
+    throw UsageException("Invalid input");
+  }
+  for (const int32_t msg_id : _inputs[input]->msg_ids) {
+    if (msg_id >= 0) {
+      _subscriptions.erase(static_cast<uint16_t>(msg_id));
+      _msg_ids.release(static_cast<uint16_t>(msg_id));
+    }
+  }
+  for (const auto& multi_iter : _inputs[input]->multi_ids) {
+    _used_multi_ids[multi_iter.first.first][multi_iter.second] = false;
+  }
+  for (const auto& format_iter : _inputs[input]->format_ids) {
+    _format_ids.release(format_iter.second);
+  }
+  _inputs[input].reset();
+}
+
+bool LogCombiner::idsRunningOut() const
+{
+  return (_msg_ids.available() < kIdReserve && !_msg_ids.released.empty()) ||
+         (_format_ids.available() < kIdReserve && !_format_ids.released.empty());
+}
+
+void LogCombiner::writeHeader(Writer& writer, uint64_t timestamp)
+{
+  for (const uint16_t format_id : _format_ids.released) {
+    _format_infos.erase(format_id);
+  }
+  _msg_ids.newFile();
+  _format_ids.newFile();
+
+  bool has_default_parameters = false;
+  uint8_t compat_flags[8]{};
+  std::map<std::string, MessageInfo> infos;
+  std::map<std::string, Parameter> parameters;
+  std::map<std::string, ParameterDefault> default_parameters;
+  for (const auto& input : _inputs) {
+    if (!input) {
+      continue;
+    }
+    has_default_parameters |= !input->default_parameters.empty();
+    for (size_t i = 0; i < sizeof(compat_flags); ++i) {
+      compat_flags[i] |= input->compat_flags[i];
+    }
+    infos.insert(input->infos.begin(), input->infos.end());
+    parameters.insert(input->parameters.begin(), input->parameters.end());
+    default_parameters.insert(input->default_parameters.begin(), input->default_parameters.end());
+  }
+  ulog_message_flag_bits_s flag_bits = FileHeader(timestamp, has_default_parameters).flagBits();
+  for (size_t i = 0; i < sizeof(compat_flags); ++i) {
+    flag_bits.compat_flags[i] |= compat_flags[i];
+  }
+  writer.fileHeader(FileHeader(FileHeader(timestamp).header(), flag_bits));
+
+  for (const auto& info : infos) {
+    writer.messageInfo(info.second);
+  }
+  for (const auto& input : _inputs) {
+    if (input) {
+      for (const auto& info : input->infos_multi) {
+        writer.messageInfo(info);
+      }
+    }
+  }
+  for (const auto& format_info : _format_infos) {
+    writer.messageInfo(format_info.second);
+  }
+  for (const auto& format : _formats) {
+    writer.messageFormat(format.second);
+  }
+  for (const auto& parameter : parameters) {
+    writer.parameter(parameter.second);
+  }
+  for (const auto& parameter_default : default_parameters) {
+    writer.parameterDefault(parameter_default.second);
+  }
+  writer.headerComplete();
+
+  for (const auto& subscription : _subscriptions) {
+    writer.addLoggedMessage(subscription.second);
+  }
+}
+
+MessageInfo LogCombiner::remapFormatInfo(Input& input, const MessageInfo& message_info)
+{
+  const std::string value(message_info.valueRaw().begin(), message_info.valueRaw().end());
+  const size_t id_end = value.find(':');
+  if (id_end == std::string::npos) {
+    return message_info;
+  }
+  unsigned long id = 0;
+  try {
+    id = std::stoul(value.substr(0, id_end));
+  } catch (const std::exception&) {
+    return message_info;
+  }
+  if (id > std::numeric_limits<uint16_t>::max()) {
+    return message_info;
+  }
+  const auto format_iter = input.format_ids.find(static_cast<uint16_t>(id));
+  const bool is_new = format_iter == input.format_ids.end();
+  uint16_t merged_id;
+  if (!is_new) {
+    merged_id = format_iter->second;
+  } else {
+    if (!_format_ids.allocate(merged_id)) {
+      throw ParsingException("Too many text formats");
+    }
+    input.format_ids[static_cast<uint16_t>(id)] = merged_id;
+  }
+  const std::string merged_value = std::to_string(merged_id) + value.substr(id_end);
+  MessageInfo merged_info{
+      Field("char", kDeferredFormatInfoKey, static_cast<int>(merged_value.size())),
+      std::vector<uint8_t>(merged_value.begin(), merged_value.end()), true};
+  if (is_new) {
+    _format_infos.emplace(merged_id, merged_info);
+  }
+  return merged_info;
+}
+
+uint8_t LogCombiner::assignMultiId(Input& input, const std::string& message_name,
+                                   uint8_t multi_id)
+{
+  const auto key = std::make_pair(message_name, multi_id);
+  const auto multi_iter = input.multi_ids.find(key);
+  if (multi_iter != input.multi_ids.end()) {
+    return multi_iter->second;
+  }
+  std::vector<bool>& used = _used_multi_ids[message_name];
+  used.resize(std::numeric_limits<uint8_t>::max() + 1, false);
+  uint32_t merged = multi_id;
+  if (used[merged]) {
+    merged = 0;
+    while (merged < used.size() && used[merged]) {
+      ++merged;
+    }
+    if (merged == used.size()) {
+      throw ParsingException("Too many instances of " + message_name);
+    }
+  }
+  used[merged] = true;
+  input.multi_ids[key] = static_cast<uint8_t>(merged);
+  return static_cast<uint8_t>(merged);
+}
+
+bool LogCombiner::writeMessage(size_t input_index, uint8_t* message, size_t length,
+                               Writer& writer)
+{
+  Input& input = *_inputs.at(input_index);
+  uint16_t msg_id;
+  switch (static_cast<ULogMessageType>(message[2])) {
+    case ULogMessageType::ADD_LOGGED_MSG: {
+      const AddLoggedMessage add_logged_message{message};
+      if (!_msg_ids.allocate(msg_id)) {
+        throw ParsingException("Too many subscriptions");
+      }
+      const uint8_t multi_id =
+          assignMultiId(input, add_logged_message.messageName(), add_logged_message.multiId());
+      input.msg_ids[add_logged_message.msgId()] = msg_id;
+      message[ULOG_MSG_HEADER_LEN] = multi_id;
+      memcpy(message + ULOG_MSG_HEADER_LEN + 1, &msg_id, sizeof(msg_id));
+      _subscriptions.emplace(msg_id,
+                             AddLoggedMessage(multi_id, msg_id, add_logged_message.messageName()));
+      ++_stats.subscriptions;
+      break;
+    }
+    case ULogMessageType::REMOVE_LOGGED_MSG:
+    case ULogMessageType::DATA:
+    case ULogMessageType::DATA_ENCODED: {
+      if (length < ULOG_MSG_HEADER_LEN + sizeof(msg_id)) {
+        return false;
+      }
+      memcpy(&msg_id, message + ULOG_MSG_HEADER_LEN, sizeof(msg_id));
+      const int32_t merged_id = input.msg_ids[msg_id];
+      if (merged_id < 0) {
+        ++_stats.dropped_data;
+        return false;
+      }
+      if (static_cast<ULogMessageType>(message[2]) == ULogMessageType::REMOVE_LOGGED_MSG) {
+        input.msg_ids[msg_id] = -1;
+        _subscriptions.erase(static_cast<uint16_t>(merged_id));
+        _msg_ids.release(static_cast<uint16_t>(merged_id));
+      }
+      msg_id = static_cast<uint16_t>(merged_id);
+      memcpy(message + ULOG_MSG_HEADER_LEN, &msg_id, sizeof(msg_id));
+      break;
+    }
+    case ULogMessageType::INFO_MULTIPLE: {
+      const MessageInfo message_info{message, true};
+      if (message_info.field().name == kDeferredFormatInfoKey) {
+        writer.messageInfo(remapFormatInfo(input, message_info));
+        ++_stats.messages_out;
+        return true;
+      }
+      break;
+    }
+    case ULogMessageType::LOGGING_DEFERRED: {
+      uint16_t format_id;
+      if (length < ULOG_MSG_HEADER_LEN + 1 + sizeof(format_id)) {
+        break;
+      }
+      memcpy(&format_id, message + ULOG_MSG_HEADER_LEN + 1, sizeof(format_id));
+      const auto format_iter = input.format_ids.find(format_id);
+      if (format_iter != input.format_ids.end()) {
+        format_id = format_iter->second;
+        memcpy(message + ULOG_MSG_HEADER_LEN + 1, &format_id, sizeof(format_id));
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  writer.rawMessage(message, length);
+  ++_stats.messages_out;
+  _stats.bytes_out += length;
+  return true;
+}
+
+}  // namespace ulog_cpp
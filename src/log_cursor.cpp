@@ -0,0 +1,243 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "log_cursor.hpp"
+
+#include <cstring>
+#include <limits>
+
+#include "exception.hpp"
+#include "log_combiner.hpp"
+
+namespace ulog_cpp {
+
+/**
+ * Handler of the raw mode reader, collects the data section messages of a chunk
+ */
+class LogCursor::Collector final : public DataHandlerInterface {
+ public:
+  explicit Collector(LogCursor& cursor) : _cursor(cursor) {}
+
+  void headerComplete() override { _header_complete = true; }
+  void rawMessage(const uint8_t* message, size_t length) override
+  {
+    if (_header_complete) {
+      _cursor.addMessage(message, length);
+    }
+  }
+  void error(const std::string& msg, bool is_recoverable) override
+  {
+    _cursor._errors.push_back(msg);
+  }
+
+ private:
+  LogCursor& _cursor;
+  bool _header_complete{false};
+};
+
+bool LogCursor::Message::timestamp(uint64_t& timestamp) const
+{
+  return messageTimestamp(_raw, _size, timestamp);
+}
+
+LogCursor::LogCursor(const std::string& filename, LogCursorConfig config)
+    : _config(std::move(config)),
+      _topics(_config.topics.begin(), _config.topics.end()),
+      _read_buffer(_config.read_chunk_size)
+{
+  _file = fopen(filename.c_str(), "rb");
+  if (!_file) {
+    throw ParsingException("Failed to open file " + filename);
+  }
+  try {
+    readHeader();
+  } catch (...) {
+    fclose(_file);
+    throw;
+  }
+}
+
+LogCursor::LogCursor(const uint8_t* data, size_t length, LogCursorConfig config)
+    : _config(std::move(config)),
+      _topics(_config.topics.begin(), _config.topics.end()),
+      _data(data),
+      _length(length)
+{
+  readHeader();
+}
+
+LogCursor::~LogCursor()
+{
+  if (_file) {
+    fclose(_file);
+  }
+}
+
+const AddLoggedMessage* LogCursor::subscription(uint16_t msg_id) const
+{
+  const auto iter = _subscriptions.find(msg_id);
+  return iter == _subscriptions.end() ? nullptr : &iter->second;
+}
+
+void LogCursor::readHeader()
+{
+  {
+    BasicReader<DataContainer> reader{_header};
+    reader.setStopAfterHeader(true);
+    while (!reader.stopped() && readNextChunk()) {
+      reader.readChunk(_chunk, _chunk_length);
+    }
+  }
+  if (_header.hadFatalError()) {
+    throw ParsingException(_header.parsingErrors().empty() ? "invalid log"
+                                                           : _header.parsingErrors().back());
+  }
+
+  // The data section is read from the start again by a raw mode reader, which skips the header
+  _position = 0;
+  if (_file) {
+    rewind(_file);
+  }
+  _collector = std::make_unique<Collector>(*this);
+  _reader = std::make_unique<BasicReader<Collector>>(*_collector);
+  _reader->setRawMode(true);
+  // Without topic filter, data of unknown subscriptions is kept as well
+  _kept_msg_ids.assign(std::numeric_limits<uint16_t>::max() + 1, _topics.empty());
+}
+
+bool LogCursor::readNextChunk()
+{
+  if (_file) {
+    _chunk_length = fread(_read_buffer.data(), 1, _read_buffer.size(), _file);
+    _chunk = _read_buffer.data();
+  } else {
+    _chunk_length = static_cast<size_t>(std::min<uint64_t>(_config.read_chunk_size,
+                                                           _length - _position));
+    _chunk = _data + _position;
+  }
+  _position += _chunk_length;
+  return _chunk_length > 0;
+}
+
+bool LogCursor::refill()
+{
+  _entries.clear();
+  _copied.clear();
+  _next_entry = 0;
+  while (_entries.empty()) {
+    if (!readNextChunk()) {
+      return false;
+    }
+    _reader->readChunk(_chunk, _chunk_length);
+  }
+  return true;
+}
+
+bool LogCursor::next()
+{
+  if (_next_entry >= _entries.size() && !refill()) {
+    return false;
+  }
+  const Entry& entry = _entries[_next_entry++];
+  _message._raw = entry.message ? entry.message : _copied.data() + entry.offset;
+  _message._size = entry.length;
+  return true;
+}
+
+void LogCursor::addMessage(const uint8_t* message, size_t length)
+{
+  uint16_t msg_id;
+  switch (static_cast<ULogMessageType>(message[2])) {
+    case ULogMessageType::ADD_LOGGED_MSG:
+      msg_id = addSubscription(message);
+      if (_config.data_only || !_kept_msg_ids[msg_id]) {
+        return;
+      }
+      break;
+    case ULogMessageType::REMOVE_LOGGED_MSG:
+    case ULogMessageType::DATA:
+    case ULogMessageType::DATA_ENCODED: {
+      if (length < ULOG_MSG_HEADER_LEN + sizeof(msg_id)) {
+        return;  // truncated
+      }
+      memcpy(&msg_id, message + ULOG_MSG_HEADER_LEN, sizeof(msg_id));
+      if (!_kept_msg_ids[msg_id]) {
+        return;
+      }
+      const auto type = static_cast<ULogMessageType>(message[2]);
+      if (type == ULogMessageType::DATA_ENCODED) {
+        addEncodedData(message);
+        return;
+      }
+      if (type == ULogMessageType::REMOVE_LOGGED_MSG && _config.data_only) {
+        return;
+      }
+      break;
+    }
+    default:
+      if (_config.data_only) {
+        return;
+      }
+      break;
+  }
+
+  if (message >= _chunk && message + length <= _chunk + _chunk_length) {
+    _entries.push_back({message, 0, length});
+  } else {
+    // Crossed a chunk boundary, the reader's buffer is reused for the next message
+    _entries.push_back({nullptr, _copied.size(), length});
+    _copied.insert(_copied.end(), message, message + length);
+  }
+}
+
+uint16_t LogCursor::addSubscription(const uint8_t* message)
+{
+  AddLoggedMessage add_logged_message{message};
+  const uint16_t msg_id = add_logged_message.msgId();
+  _kept_msg_ids[msg_id] =
+      _topics.empty() || _topics.find(add_logged_message.messageName()) != _topics.end();
+
+  _decoders.erase(msg_id);
+  if (_header.fileHeader().flagBits().compat_flags[0] & ULOG_COMPAT_FLAG0_ENCODED_DATA_MASK) {
+    const auto& formats = _header.messageFormats();
+    const auto format_iter = formats.find(add_logged_message.messageName());
+    if (format_iter != formats.end()) {
+      DataEncodingLayout layout(format_iter->second, formats);
+      if (layout.encodable()) {
+        _decoders.emplace(msg_id, DataDecoder(std::move(layout)));
+      }
+    }
+  }
+  _subscriptions.erase(msg_id);
+  _subscriptions.emplace(msg_id, std::move(add_logged_message));
+  return msg_id;
+}
+
+void LogCursor::addEncodedData(const uint8_t* message)
+{
+  const auto* encoded = reinterpret_cast<const ulog_message_data_encoded_s*>(message);
+  if (encoded->msg_size < sizeof(*encoded) - ULOG_MSG_HEADER_LEN) {
+    throw ParsingException("message too short");
+  }
+  const auto decoder_iter = _decoders.find(encoded->msg_id);
+  if (decoder_iter == _decoders.end()) {
+    throw ParsingException("Encoded data for unknown subscription");
+  }
+  // The samples are returned as DATA messages
+  for (const Data& data : decoder_iter->second.decode(message)) {
+    ulog_message_data_s header{};
+    header.msg_size = static_cast<uint16_t>(sizeof(header) - ULOG_MSG_HEADER_LEN +
+                                            data.data().size());
+    header.msg_type = static_cast<uint8_t>(ULogMessageType::DATA);
+    header.msg_id = data.msgId();
+    const size_t length = sizeof(header) + data.data().size();
+    _entries.push_back({nullptr, _copied.size(), length});
+    const auto* header_bytes = reinterpret_cast<const uint8_t*>(&header);
+    _copied.insert(_copied.end(), header_bytes, header_bytes + sizeof(header));
+    _copied.insert(_copied.end(), data.data().begin(), data.data().end());
+  }
+}
+
+}  // namespace ulog_cpp
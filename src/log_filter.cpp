@@ -0,0 +1,95 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "log_filter.hpp"
+
+#include <cstring>
+
+namespace ulog_cpp {
+
+LogFilter::LogFilter(DataWriteCB data_write_cb, LogFilterConfig config)
+    : _writer(std::move(data_write_cb)),
+      _config(std::move(config)),
+      _topics(_config.topics.begin(), _config.topics.end()),
+      _exclude_topics(_config.exclude_topics.begin(), _config.exclude_topics.end()),
+      _kept_msg_ids(std::numeric_limits<uint16_t>::max() + 1, false)
+{
+}
+
+void LogFilter::fileHeader(const FileHeader& header)
+{
+  _writer.fileHeader(header);
+}
+
+void LogFilter::error(const std::string& msg, bool is_recoverable)
+{
+  _errors.push_back(msg);
+}
+
+bool LogFilter::keepTopic(const std::string& topic) const
+{
+  if (!_topics.empty() && _topics.find(topic) == _topics.end()) {
+    return false;
+  }
+  return _exclude_topics.find(topic) == _exclude_topics.end();
+}
+
+bool LogFilter::inTimeRange(const uint8_t* message, size_t length, size_t timestamp_offset) const
+{
+  uint64_t timestamp;
+  if (timestamp_offset + sizeof(timestamp) > length) {
+    return true;
+  }
+  memcpy(&timestamp, message + timestamp_offset, sizeof(timestamp));
+  return timestamp >= _config.start_timestamp && timestamp <= _config.end_timestamp;
+}
+
+void LogFilter::rawMessage(const uint8_t* message, size_t length)
+{
+  ++_stats.messages_in;
+  bool keep = true;
+  uint16_t msg_id;
+  switch (static_cast<ULogMessageType>(message[2])) {
+    case ULogMessageType::ADD_LOGGED_MSG: {
+      const AddLoggedMessage add_logged_message{message};
+      keep = keepTopic(add_logged_message.messageName());
+      _kept_msg_ids[add_logged_message.msgId()] = keep;
+      break;
+    }
+    case ULogMessageType::REMOVE_LOGGED_MSG:
+    case ULogMessageType::DATA:
+    case ULogMessageType::DATA_ENCODED: {
+      if (length < ULOG_MSG_HEADER_LEN + sizeof(msg_id)) {
+        keep = false;  // truncated
+        break;
+      }
+      memcpy(&msg_id, message + ULOG_MSG_HEADER_LEN, sizeof(msg_id));
+      keep = _kept_msg_ids[msg_id];
+      const auto type = static_cast<ULogMessageType>(message[2]);
+      if (keep && type == ULogMessageType::DATA) {
+        keep = inTimeRange(message, length, sizeof(ulog_message_data_s));
+      } else if (keep && type == ULogMessageType::DATA_ENCODED) {
+        keep = inTimeRange(message, length, sizeof(ulog_message_data_encoded_s));
+      }
+      break;
+    }
+    case ULogMessageType::LOGGING:
+      keep = !_config.drop_text && inTimeRange(message, length, ULOG_MSG_HEADER_LEN + 1);
+      break;
+    case ULogMessageType::LOGGING_TAGGED:
+    case ULogMessageType::LOGGING_DEFERRED:
+      keep = !_config.drop_text && inTimeRange(message, length, ULOG_MSG_HEADER_LEN + 3);
+      break;
+    default:
+      break;
+  }
+  if (keep) {
+    _writer.rawMessage(message, length);
+    ++_stats.messages_out;
+    _stats.bytes_out += length;
+  }
+}
+
+}  // namespace ulog_cpp
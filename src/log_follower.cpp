@@ -0,0 +1,234 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "log_follower.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "exception.hpp"
+#include "log_recovery.hpp"
+#include "zz_data_log.hpp"
+
+namespace ulog_cpp {
+
+namespace {
+
+std::string directoryOf(const std::string& filename)
+{
+  const size_t slash = filename.rfind('/');
+  if (slash == std::string::npos) {
+    return ".";
+  }
+  return slash == 0 ? "/" : filename.substr(0, slash);
+}
+
+std::string basenameOf(const std::string& filename)
+{
+  const size_t slash = filename.rfind('/');
+  return slash == std::string::npos ? filename : filename.substr(slash + 1);
+}
+
+bool fileExists(const std::string& filename)
+{
+  struct stat st {};
+  return stat(filename.c_str(), &st) == 0;
+}
+
+}  // namespace
+
+LogFollower::LogFollower(std::string filename, std::shared_ptr<DataHandlerInterface> handler,
+                         LogFollowerConfig config)
+    : _config(config), _handler(std::move(handler)), _buffer(config.read_chunk_size)
+{
+  _inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  _wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  const std::string directory = directoryOf(filename);
+  if (_inotify_fd < 0 || _wake_fd < 0 ||
+      inotify_add_watch(_inotify_fd, directory.c_str(),
+                        IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO) < 0) {
+    const std::string error = strerror(errno);
+    if (_inotify_fd >= 0) {
+      close(_inotify_fd);
+    }
+    if (_wake_fd >= 0) {
+      close(_wake_fd);
+    }
+    throw ParsingException("Failed to watch directory " + directory + ": " + error);
+  }
+  startSegment(std::move(filename));
+}
+
+LogFollower::~LogFollower()
+{
+  if (_fd >= 0) {
+    close(_fd);
+  }
+  close(_inotify_fd);
+  close(_wake_fd);
+}
+
+size_t LogFollower::poll(std::chrono::milliseconds timeout)
+{
+  size_t bytes_read = readAvailable();
+  if (bytes_read == 0) {
+    waitForEvents(timeout);
+    bytes_read = readAvailable();
+  }
+  return bytes_read;
+}
+
+void LogFollower::interrupt()
+{
+  const uint64_t value = 1;
+  (void)write(_wake_fd, &value, sizeof(value));
+}
+
+size_t LogFollower::readAvailable()
+{
+  size_t bytes_read = 0;
+  while (true) {
+    if (_fd < 0) {
+      _fd = open(_filename.c_str(), O_RDONLY | O_CLOEXEC);
+      if (_fd < 0) {
+        return bytes_read;
+      }
+    }
+    bytes_read += readToEnd();
+    if (_next_filename.empty() || !fileExists(_next_filename)) {
+      return bytes_read;
+    }
+    // The writer closes a segment before it creates the next one
+    bytes_read += readToEnd();
+    startSegment(_next_filename);
+  }
+}
+
+size_t LogFollower::readToEnd()
+{
+  const uint64_t end = readableSize();
+  if (end < _offset) {
+    // The file was replaced, start over
+    _reader = std::make_unique<Reader>(_handler);
+    _offset = 0;
+  }
+  size_t bytes_read = 0;
+  while (_offset < end) {
+    const size_t length =
+        static_cast<size_t>(std::min<uint64_t>(_buffer.size(), end - _offset));
+    const ssize_t ret = pread(_fd, _buffer.data(), length, static_cast<off_t>(_offset));
+    if (ret <= 0) {
+      break;
+    }
+    _reader->readChunk(_buffer.data(), static_cast<size_t>(ret));
+    _offset += ret;
+    bytes_read += ret;
+  }
+  _bytes_read += bytes_read;
+  // Data after the last close means the writer reopened the file
+  if (_close_seen) {
+    _closed = true;
+    _close_seen = false;
+  } else if (bytes_read > 0) {
+    _closed = false;
+  }
+  return bytes_read;
+}
+
+uint64_t LogFollower::readableSize() const
+{
+  struct stat st {};
+  if (fstat(_fd, &st) != 0) {
+    return _offset;
+  }
+  uint64_t size = st.st_size;
+  // The mmap sink extends the file ahead of the data, its commit marker holds the written size
+  const int marker_fd = open(_marker_filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (marker_fd >= 0) {
+    ulog_commit_marker_s marker{};
+    if (pread(marker_fd, &marker, sizeof(marker), 0) == sizeof(marker) &&
+        memcmp(marker.magic, ulog_commit_marker_magic, sizeof(marker.magic)) == 0) {
+      size = std::min(size, marker.committed_size);
+    }
+    close(marker_fd);
+  }
+  return size;
+}
+
+void LogFollower::startSegment(std::string filename)
+{
+  if (_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+    ++_segment;
+  }
+  _filename = std::move(filename);
+  _next_filename.clear();
+  if (_config.follow_rotation) {
+    _next_filename = zz_data_log::generateNewPathOrFilename(_filename);
+    if (_next_filename == _filename) {
+      _next_filename.clear();  // no extension, no rotation
+    }
+  }
+  _marker_filename = commitMarkerFilename(_filename);
+  _reader = std::make_unique<Reader>(_handler);
+  _offset = 0;
+  _closed = false;
+  _close_seen = false;
+}
+
+void LogFollower::waitForEvents(std::chrono::milliseconds timeout)
+{
+  const std::string basename = basenameOf(_filename);
+  const std::string next_basename = basenameOf(_next_filename);
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  // Events of other files in the directory are skipped
+  while (true) {
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    pollfd fds[2]{{_inotify_fd, POLLIN, 0}, {_wake_fd, POLLIN, 0}};
+    const int ret = ::poll(fds, 2, static_cast<int>(std::max<int64_t>(remaining.count(), 0)));
+    if (ret <= 0) {
+      return;
+    }
+    if (fds[1].revents & POLLIN) {
+      uint64_t value;
+      (void)read(_wake_fd, &value, sizeof(value));
+      return;
+    }
+    alignas(inotify_event) char events[4096];
+    const ssize_t length = read(_inotify_fd, events, sizeof(events));
+    bool relevant = false;
+    for (ssize_t offset = 0; offset < length;) {
+      const auto* event = reinterpret_cast<const inotify_event*>(events + offset);
+      offset += sizeof(inotify_event) + event->len;
+      if (event->len == 0) {
+        continue;
+      }
+      const char* name = event->name;
+      if (name == basename) {
+        relevant = true;
+        if (event->mask & IN_CLOSE_WRITE) {
+          _close_seen = true;  // closed() once the data up to here is read
+        }
+      } else if (!_next_filename.empty() && name == next_basename) {
+        relevant = true;
+      }
+    }
+    if (relevant) {
+      return;
+    }
+  }
+}
+
+}  // namespace ulog_cpp
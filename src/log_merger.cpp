@@ -0,0 +1,314 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "log_merger.hpp"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include "basic_reader.hpp"
+#include "exception.hpp"
+
+namespace ulog_cpp {
+
+namespace {
+
+constexpr size_t kReadChunkSize = 256 * 1024;
+constexpr size_t kBatchSize = 64 * 1024;  ///< granularity of the read-ahead queue
+
+}  // namespace
+
+/**
+ * One input log: its definitions section, the id mappings and the read-ahead thread. The thread
+ * parses the data section in raw mode and queues the messages in batches, blocking while more
+ * than read_ahead_bytes are queued.
+ */
+class LogMerger::Input {
+ public:
+  struct Message {
+    uint8_t* data{nullptr};
+    size_t length{0};
+    uint64_t timestamp{0};
+  };
+
+  Input(std::string filename, size_t read_ahead_bytes)
+      : _filename(std::move(filename)), _read_ahead_bytes(read_ahead_bytes)
+  {
+  }
+
+  ~Input()
+  {
+    {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _space_cv.notify_all();
+    if (_thread.joinable()) {
+      _thread.join();
+    }
+  }
+
+  const std::string& filename() const { return _filename; }
+  const DataContainer& header() const { return _header; }
+
+  /**
+   * Read the definitions section (in the calling thread)
+   */
+  void readHeader()
+  {
+    FILE* file = fopen(_filename.c_str(), "rb");
+    if (!file) {
+      throw ParsingException("Failed to open file " + _filename);
+    }
+    BasicReader<DataContainer> reader{_header};
+    reader.setStopAfterHeader(true);
+    std::vector<uint8_t> buffer(kReadChunkSize);
+    size_t bytes_read;
+    while (!reader.stopped() && (bytes_read = fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+      reader.readChunk(buffer.data(), bytes_read);
+    }
+    fclose(file);
+    if (_header.hadFatalError()) {
+      const std::string& error =
+          _header.parsingErrors().empty() ? "invalid log" : _header.parsingErrors().back();
+      throw ParsingException(_filename + ": " + error);
+    }
+  }
+
+  void startReadAhead() { _thread = std::thread(&Input::readAhead, this); }
+
+  /**
+   * Advance to the next message of the data section. Blocks until it is read.
+   * @return false at the end of the input
+   */
+  bool next()
+  {
+    while (_current_index >= _current.messages.size()) {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _data_cv.wait(lock, [this] { return !_queue.empty() || _ended; });
+      if (_queue.empty()) {
+        return false;
+      }
+      _queued_bytes -= _queue.front().data.size();
+      _current = std::move(_queue.front());
+      _queue.pop_front();
+      _current_index = 0;
+      lock.unlock();
+      _space_cv.notify_one();
+    }
+    const Batch::Entry& entry = _current.messages[_current_index++];
+    _head = {_current.data.data() + entry.offset, entry.length, entry.timestamp};
+    return true;
+  }
+
+  /// Current message, valid until the next call to next()
+  const Message& head() const { return _head; }
+
+  /// Parsing errors of the data section, complete once next() returned false
+  const std::vector<std::string>& errors() const { return _errors; }
+
+ private:
+  struct Batch {
+    struct Entry {
+      size_t offset;
+      size_t length;
+      uint64_t timestamp;
+    };
+    std::vector<uint8_t> data;
+    std::vector<Entry> messages;
+  };
+
+  class Collector : public DataHandlerInterface {
+   public:
+    explicit Collector(Input& input) : _input(input) {}
+
+    void headerComplete() override { _header_complete = true; }
+    void rawMessage(const uint8_t* message, size_t length) override
+    {
+      if (_header_complete) {
+        _input.addMessage(message, length);
+      }
+    }
+    void error(const std::string& msg, bool is_recoverable) override
+    {
+      _input._errors.push_back(msg);
+    }
+
+   private:
+    Input& _input;
+    bool _header_complete{false};
+  };
+
+  void readAhead()
+  {
+    FILE* file = fopen(_filename.c_str(), "rb");
+    if (!file) {
+      _errors.push_back("Failed to open file " + _filename);
+    } else {
+      try {
+        Collector collector{*this};
+        BasicReader<Collector> reader{collector};
+        reader.setRawMode(true);
+        std::vector<uint8_t> buffer(kReadChunkSize);
+        size_t bytes_read;
+        while (!stopRequested() &&
+               (bytes_read = fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+          reader.readChunk(buffer.data(), bytes_read);
+          if (_batch.data.size() >= kBatchSize) {
+            pushBatch();
+          }
+        }
+        pushBatch();
+      } catch (const std::exception& exception) {
+        _errors.emplace_back(exception.what());
+      }
+      fclose(file);
+    }
+    {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _ended = true;
+    }
+    _data_cv.notify_one();
+  }
+
+  void addMessage(const uint8_t* message, size_t length)
+  {
+    uint64_t timestamp;
+    if (messageTimestamp(message, length, timestamp)) {
+      _last_timestamp = timestamp;
+    }
+    _batch.messages.push_back({_batch.data.size(), length, _last_timestamp});
+    _batch.data.insert(_batch.data.end(), message, message + length);
+  }
+
+  void pushBatch()
+  {
+    if (_batch.messages.empty()) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(_mutex);
+    _space_cv.wait(lock, [this] { return _stop || _queued_bytes < _read_ahead_bytes; });
+    if (_stop) {
+      return;
+    }
+    _queued_bytes += _batch.data.size();
+    _queue.push_back(std::move(_batch));
+    _batch = Batch{};
+    lock.unlock();
+    _data_cv.notify_one();
+  }
+
+  bool stopRequested()
+  {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _stop;
+  }
+
+  const std::string _filename;
+  const size_t _read_ahead_bytes;
+  DataContainer _header{DataContainer::StorageConfig::Header};
+
+  // Read-ahead thread
+  std::thread _thread;
+  Batch _batch;
+  uint64_t _last_timestamp{0};
+  std::vector<std::string> _errors;
+
+  // Shared, protected by _mutex
+  std::mutex _mutex;
+  std::condition_variable _data_cv;
+  std::condition_variable _space_cv;
+  std::deque<Batch> _queue;
+  size_t _queued_bytes{0};
+  bool _ended{false};
+  bool _stop{false};
+
+  // Merging thread
+  Batch _current;
+  size_t _current_index{0};
+  Message _head;
+};
+
+LogMerger::LogMerger(std::vector<std::string> filenames, LogMergerConfig config)
+    : _filenames(std::move(filenames)), _config(config)
+{
+}
+
+LogMerger::~LogMerger() = default;
+
+void LogMerger::merge(const DataWriteCB& data_write_cb)
+{
+  if (!_inputs.empty()) {
+    throw UsageException("merge() can only be called once");
+  }
+  readHeaders();
+  Writer writer(data_write_cb);
+  writeHeader(writer);
+  mergeData(writer);
+}
+
+void LogMerger::readHeaders()
+{
+  for (const auto& filename : _filenames) {
+    _inputs.push_back(std::make_unique<Input>(filename, _config.read_ahead_bytes));
+    Input& input = *_inputs.back();
+    input.readHeader();
+    try {
+      _combiner.addInput(input.header());
+    } catch (const ParsingException& exception) {
+      throw ParsingException(std::string(exception.what()) + " in " + filename);
+    }
+  }
+}
+
+void LogMerger::writeHeader(Writer& writer)
+{
+  uint64_t timestamp = std::numeric_limits<uint64_t>::max();
+  for (const auto& input : _inputs) {
+    timestamp = std::min(timestamp, input->header().fileHeader().header().timestamp);
+  }
+  _combiner.writeHeader(writer, timestamp);
+}
+
+void LogMerger::mergeData(Writer& writer)
+{
+  for (auto& input : _inputs) {
+    input->startReadAhead();
+  }
+
+  // Min-heap by (timestamp, input index)
+  using Head = std::pair<uint64_t, size_t>;
+  std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+  for (size_t i = 0; i < _inputs.size(); ++i) {
+    if (_inputs[i]->next()) {
+      heads.emplace(_inputs[i]->head().timestamp, i);
+    }
+  }
+  while (!heads.empty()) {
+    const size_t index = heads.top().second;
+    heads.pop();
+    Input& input = *_inputs[index];
+    _combiner.writeMessage(index, input.head().data, input.head().length, writer);
+    if (input.next()) {
+      heads.emplace(input.head().timestamp, index);
+    }
+  }
+
+  // The read-ahead threads parse the whole file, including the definitions section
+  for (const auto& input : _inputs) {
+    for (const auto& error : input->errors()) {
+      _errors.push_back(input->filename() + ": " + error);
+    }
+  }
+}
+
+}  // namespace ulog_cpp
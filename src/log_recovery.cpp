@@ -0,0 +1,128 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "log_recovery.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "exception.hpp"
+#include "raw_messages.hpp"
+
+namespace ulog_cpp {
+
+namespace {
+
+bool isValidMessageType(uint8_t type)
+{
+  switch (static_cast<ULogMessageType>(type)) {
+    case ULogMessageType::FORMAT:
+    case ULogMessageType::DATA:
+    case ULogMessageType::INFO:
+    case ULogMessageType::INFO_MULTIPLE:
+    case ULogMessageType::PARAMETER:
+    case ULogMessageType::PARAMETER_DEFAULT:
+    case ULogMessageType::ADD_LOGGED_MSG:
+    case ULogMessageType::REMOVE_LOGGED_MSG:
+    case ULogMessageType::SYNC:
+    case ULogMessageType::DROPOUT:
+    case ULogMessageType::LOGGING:
+    case ULogMessageType::LOGGING_TAGGED:
+    case ULogMessageType::LOGGING_DEFERRED:
+    case ULogMessageType::FLAG_BITS:
+    case ULogMessageType::DATA_ENCODED:
+      return true;
+  }
+  return false;
+}
+
+/**
+ * Reads the commit marker, returns false if it does not exist or is invalid
+ */
+bool readCommitMarker(const std::string& filename, uint64_t& committed_size)
+{
+  std::FILE* file = std::fopen(filename.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  ulog_commit_marker_s marker{};
+  const bool valid = std::fread(&marker, sizeof(marker), 1, file) == 1 &&
+                     memcmp(marker.magic, ulog_commit_marker_magic, sizeof(marker.magic)) == 0;
+  std::fclose(file);
+  committed_size = marker.committed_size;
+  return valid;
+}
+
+}  // namespace
+
+std::string commitMarkerFilename(const std::string& filename)
+{
+  return filename + ".committed";
+}
+
+RecoveryResult recoverLog(const std::string& filename, bool truncate)
+{
+  std::FILE* file = std::fopen(filename.c_str(), "rb");
+  if (!file) {
+    throw ParsingException("Failed to open file");
+  }
+  RecoveryResult result;
+  ulog_file_header_s file_header{};
+  if (std::fread(&file_header, sizeof(file_header), 1, file) != 1 ||
+      memcmp(file_header.magic, ulog_file_magic_bytes, sizeof(ulog_file_magic_bytes)) != 0) {
+    std::fclose(file);
+    throw ParsingException("Invalid ULog file header");
+  }
+  std::fseek(file, 0, SEEK_END);
+  result.file_size = std::ftell(file);
+
+  const std::string marker_filename = commitMarkerFilename(filename);
+  result.commit_marker = readCommitMarker(marker_filename, result.committed_size);
+  const uint64_t end =
+      result.commit_marker ? std::min(result.file_size, result.committed_size) : result.file_size;
+
+  // Only the message headers are needed, so read in chunks and skip over the message bodies
+  std::vector<uint8_t> buffer(256 * 1024);
+  uint64_t buffer_offset = 0;
+  size_t buffer_length = 0;
+  uint64_t offset = sizeof(ulog_file_header_s);
+  while (offset + ULOG_MSG_HEADER_LEN <= end) {
+    if (offset < buffer_offset || offset + ULOG_MSG_HEADER_LEN > buffer_offset + buffer_length) {
+      std::fseek(file, static_cast<long>(offset), SEEK_SET);
+      buffer_offset = offset;
+      buffer_length = std::fread(buffer.data(), 1, buffer.size(), file);
+      if (buffer_length < ULOG_MSG_HEADER_LEN) {
+        break;
+      }
+    }
+    ulog_message_header_s header;
+    memcpy(&header, buffer.data() + (offset - buffer_offset), ULOG_MSG_HEADER_LEN);
+    const uint64_t message_end = offset + ULOG_MSG_HEADER_LEN + header.msg_size;
+    if (!isValidMessageType(header.msg_type) || message_end > end) {
+      break;
+    }
+    offset = message_end;
+    ++result.num_messages;
+  }
+  std::fclose(file);
+  result.valid_size = offset;
+
+  if (truncate) {
+    if (result.valid_size < result.file_size &&
+        ::truncate(filename.c_str(), static_cast<off_t>(result.valid_size)) != 0) {
+      throw ParsingException("Failed to truncate file");
+    }
+    if (result.commit_marker) {
+      std::remove(marker_filename.c_str());
+    }
+  }
+  return result;
+}
+
+}  // namespace ulog_cpp
@@ -0,0 +1,39 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "message_stream.hpp"
+
+#include <limits>
+
+namespace ulog_cpp {
+
+bool isDroppable(ULogMessageType type)
+{
+  switch (type) {
+    case ULogMessageType::DATA:
+    case ULogMessageType::DATA_ENCODED:
+    case ULogMessageType::LOGGING:
+    case ULogMessageType::LOGGING_TAGGED:
+    case ULogMessageType::LOGGING_DEFERRED:
+    case ULogMessageType::SYNC:
+    case ULogMessageType::DROPOUT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+ulog_message_dropout_s dropoutSince(std::chrono::steady_clock::time_point dropping_since)
+{
+  const auto duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::steady_clock::now() - dropping_since)
+                               .count();
+  ulog_message_dropout_s dropout{};
+  dropout.duration =
+      static_cast<uint16_t>(std::min<int64_t>(duration_ms, std::numeric_limits<uint16_t>::max()));
+  return dropout;
+}
+
+}  // namespace ulog_cpp
@@ -400,6 +400,60 @@ void Logging::serialize(const DataWriteCB& writer) const
   }
 }
 
+DeferredLogging::DeferredLogging(const uint8_t* msg)
+{
+  const ulog_message_logging_deferred_s* logging =
+      reinterpret_cast<const ulog_message_logging_deferred_s*>(msg);
+  const int header_size = sizeof(ulog_message_logging_deferred_s) - ULOG_MSG_HEADER_LEN;
+  CHECK_MSG_SIZE(logging->msg_size, header_size);
+  if (logging->log_level < static_cast<uint8_t>(Logging::Level::Emergency) ||
+      logging->log_level > static_cast<uint8_t>(Logging::Level::Debug)) {
+    _log_level = Logging::Level::Debug;
+  } else {
+    _log_level = static_cast<Logging::Level>(logging->log_level);
+  }
+  _format_id = logging->format_id;
+  _timestamp = logging->timestamp;
+  const uint8_t* args = msg + sizeof(ulog_message_logging_deferred_s);
+  _args.assign(args, args + (logging->msg_size - header_size));
+}
+DeferredLogging::DeferredLogging(Logging::Level level, uint16_t format_id, uint64_t timestamp,
+                                 std::vector<uint8_t> args)
+    : _log_level(level), _format_id(format_id), _timestamp(timestamp), _args(std::move(args))
+{
+}
+void DeferredLogging::serialize(const DataWriteCB& writer) const
+{
+  serialize(writer, _log_level, _format_id, _timestamp, _args.data(), _args.size());
+}
+void DeferredLogging::serialize(const DataWriteCB& writer, Logging::Level level,
+                                uint16_t format_id, uint64_t timestamp, const uint8_t* args,
+                                size_t args_length)
+{
+  // Up to this size, the message is assembled on the stack
+  static constexpr size_t kMaxStackArgs = 256;
+  ulog_message_logging_deferred_s logging;
+  const size_t msg_size = sizeof(logging) - ULOG_MSG_HEADER_LEN + args_length;
+  if (msg_size > std::numeric_limits<uint16_t>::max()) {
+    throw ParsingException("message too long");
+  }
+  logging.msg_size = msg_size;
+  logging.log_level = static_cast<uint8_t>(level);
+  logging.format_id = format_id;
+  logging.timestamp = timestamp;
+  if (args_length <= kMaxStackArgs) {
+    uint8_t message[sizeof(logging) + kMaxStackArgs];
+    memcpy(message, &logging, sizeof(logging));
+    if (args_length > 0) {
+      memcpy(message + sizeof(logging), args, args_length);
+    }
+    writer(message, static_cast<int>(sizeof(logging) + args_length));
+  } else {
+    writer(reinterpret_cast<const uint8_t*>(&logging), sizeof(logging));
+    writer(args, static_cast<int>(args_length));
+  }
+}
+
 Data::Data(const uint8_t* msg)
 {
   const ulog_message_data_s* msg_data = reinterpret_cast<const ulog_message_data_s*>(msg);
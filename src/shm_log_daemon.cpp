@@ -0,0 +1,336 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "shm_log_daemon.hpp"
+
+#include <signal.h>
+
+#include <cerrno>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <tuple>
+
+#include "basic_reader.hpp"
+#include "data_handler_interface.hpp"
+#include "exception.hpp"
+
+namespace ulog_cpp {
+
+namespace {
+
+std::string numberedFilename(const std::string& filename, uint32_t number)
+{
+  if (number == 0) {
+    return filename;
+  }
+  const size_t slash = filename.rfind('/');
+  const size_t dot = filename.rfind('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    return filename + "." + std::to_string(number);
+  }
+  return filename.substr(0, dot) + "." + std::to_string(number) + filename.substr(dot);
+}
+
+bool processAlive(int pid)
+{
+  return pid <= 0 || kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+uint64_t currentTimeUs()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+/**
+ * Attached producer: parses its ring in raw mode. The definitions section is decoded into a
+ * DataContainer for the LogCombiner, data section messages are collected until the next write.
+ */
+class ShmLogDaemon::Producer : public DataHandlerInterface {
+ public:
+  struct Entry {
+    size_t offset;
+    size_t length;
+    uint64_t timestamp;
+  };
+
+  Producer(uint32_t slot_index, std::unique_ptr<ShmRing> shm_ring)
+      : slot(slot_index), ring(std::move(shm_ring)), _reader(*this)
+  {
+    _reader.setRawMode(true);
+  }
+
+  /// @return number of bytes read
+  size_t read()
+  {
+    return ring->read(
+        [this](const uint8_t* data, size_t length) { _reader.readChunk(data, length); });
+  }
+
+  void fileHeader(const FileHeader& header) override { _header.fileHeader(header); }
+  void headerComplete() override { _header.headerComplete(); }
+  void error(const std::string& msg, bool is_recoverable) override { errors.push_back(msg); }
+
+  void rawMessage(const uint8_t* message, size_t length) override
+  {
+    if (!_header.isHeaderComplete()) {
+      readHeaderMessage(message);
+      return;
+    }
+    uint64_t timestamp;
+    if (messageTimestamp(message, length, timestamp)) {
+      _last_timestamp = timestamp;
+    }
+    pending_entries.push_back({pending.size(), length, _last_timestamp});
+    pending.insert(pending.end(), message, message + length);
+  }
+
+  const DataContainer& header() const { return _header; }
+
+  void clearPending()
+  {
+    pending.clear();
+    pending_entries.clear();
+  }
+
+  const uint32_t slot;
+  const std::unique_ptr<ShmRing> ring;
+  int input{-1};  ///< LogCombiner input, -1 until the definitions section is complete
+  bool rejected{false};
+
+  std::vector<uint8_t> pending;  ///< data section messages read since the last write
+  std::vector<Entry> pending_entries;
+  std::vector<std::string> errors;
+
+ private:
+  void readHeaderMessage(const uint8_t* message)
+  {
+    switch (static_cast<ULogMessageType>(message[2])) {
+      case ULogMessageType::INFO:
+        _header.messageInfo(MessageInfo{message, false});
+        break;
+      case ULogMessageType::INFO_MULTIPLE:
+        _header.messageInfo(MessageInfo{message, true});
+        break;
+      case ULogMessageType::FORMAT:
+        _header.messageFormat(MessageFormat{message});
+        break;
+      case ULogMessageType::PARAMETER:
+        _header.parameter(Parameter{message});
+        break;
+      case ULogMessageType::PARAMETER_DEFAULT:
+        _header.parameterDefault(ParameterDefault{message});
+        break;
+      default:
+        break;
+    }
+  }
+
+  DataContainer _header{DataContainer::StorageConfig::Header};
+  BasicReader<Producer> _reader;
+  uint64_t _last_timestamp{0};
+};
+
+ShmLogDaemon::ShmLogDaemon(const ShmTransportConfig& transport_config, Config config)
+    : _transport_config(transport_config),
+      _config(std::move(config)),
+      _registry(ShmRegistry::create(transport_config.name, transport_config.max_producers)),
+      _start_time(std::chrono::steady_clock::now()),
+      _last_sync(_start_time)
+{
+}
+
+ShmLogDaemon::~ShmLogDaemon()
+{
+  _writer.reset();
+  if (_file) {
+    _file->sync();
+  }
+  _file.reset();
+  for (const auto& producer : _producers) {
+    ShmRing::unlink(producer->ring->name());
+  }
+}
+
+void ShmLogDaemon::poll()
+{
+  attachProducers();
+
+  // Check for exited producers before reading, so no data is lost
+  std::vector<bool> finished(_producers.size());
+  bool any_finished = false;
+  for (size_t i = 0; i < _producers.size(); ++i) {
+    Producer& producer = *_producers[i];
+    finished[i] = producer.ring->closed() || !processAlive(producer.ring->pid());
+    any_finished |= finished[i];
+    _stats.bytes_read += producer.read();
+    for (const auto& error : producer.errors) {
+      _errors.push_back("Producer " + std::to_string(producer.ring->pid()) + ": " + error);
+    }
+    producer.errors.clear();
+  }
+
+  admitProducers();
+
+  bool has_inputs = false;
+  for (const auto& producer : _producers) {
+    has_inputs |= producer->input >= 0;
+  }
+  if (!_writer) {
+    const auto elapsed = std::chrono::steady_clock::now() - _start_time;
+    if (has_inputs &&
+        (any_finished || elapsed >= std::chrono::milliseconds(_config.startup_wait_ms))) {
+      openFile();
+    }
+  } else if (_combiner.formats().size() != _num_written_formats || _combiner.idsRunningOut()) {
+    openFile();
+  }
+  if (_writer) {
+    writePending();
+  }
+
+  for (size_t i = _producers.size(); i > 0; --i) {
+    if (finished[i - 1]) {
+      removeProducer(i - 1);
+    }
+  }
+  _stats.producers = static_cast<uint32_t>(_producers.size());
+
+  if (_file) {
+    const auto now = std::chrono::steady_clock::now();
+    if (now - _last_sync >= std::chrono::milliseconds(_config.sync_interval_ms)) {
+      _file->sync();
+      _last_sync = now;
+    } else {
+      _file->flush();
+    }
+  }
+}
+
+void ShmLogDaemon::run(const std::atomic<bool>& stop, std::chrono::milliseconds poll_interval)
+{
+  while (!stop.load()) {
+    poll();
+    std::this_thread::sleep_for(poll_interval);
+  }
+  poll();
+}
+
+void ShmLogDaemon::attachProducers()
+{
+  for (uint32_t slot = 0; slot < _registry->numSlots(); ++slot) {
+    switch (_registry->state(slot)) {
+      case ShmRegistry::SlotState::Ready: {
+        std::unique_ptr<ShmRing> ring;
+        try {
+          ring = ShmRing::open(_registry->ringName(slot));
+        } catch (const ParsingException& exception) {
+          // Withdrawn in the meantime, or not a ring
+          if (_registry->state(slot) == ShmRegistry::SlotState::Ready) {
+            _errors.push_back(exception.what());
+            _registry->release(slot);
+          }
+          break;
+        }
+        if (_registry->attach(slot)) {
+          _producers.push_back(std::make_unique<Producer>(slot, std::move(ring)));
+          ++_stats.producers_total;
+        }
+        break;
+      }
+      case ShmRegistry::SlotState::Claimed:
+        // The producer died before publishing its ring
+        if (!processAlive(_registry->pid(slot))) {
+          _registry->release(slot);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void ShmLogDaemon::admitProducers()
+{
+  for (auto& producer : _producers) {
+    if (producer->input < 0 && !producer->rejected && producer->header().isHeaderComplete()) {
+      try {
+        producer->input = static_cast<int>(_combiner.addInput(producer->header()));
+      } catch (const ParsingException& exception) {
+        producer->rejected = true;
+        ++_stats.rejected_producers;
+        _errors.push_back("Producer " + std::to_string(producer->ring->pid()) +
+                          " rejected: " + exception.what());
+      }
+    }
+    if (producer->rejected) {
+      producer->clearPending();
+    }
+  }
+}
+
+void ShmLogDaemon::openFile()
+{
+  _writer.reset();
+  if (_file) {
+    _file->sync();
+  }
+  _file.reset();
+  _filename = numberedFilename(_config.filename, _stats.files);
+  _file = createFileSink(_filename, _config.sink_config);
+  _writer = std::make_unique<Writer>(
+      [this](const uint8_t* data, int length) { _file->write(data, length); });
+  _combiner.writeHeader(*_writer, currentTimeUs());
+  _num_written_formats = _combiner.formats().size();
+  ++_stats.files;
+}
+
+void ShmLogDaemon::writePending()
+{
+  // Merge the messages of all producers by timestamp
+  using Head = std::tuple<uint64_t, size_t, size_t>;  // timestamp, producer, entry
+  std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+  for (size_t i = 0; i < _producers.size(); ++i) {
+    const Producer& producer = *_producers[i];
+    if (producer.input >= 0 && !producer.pending_entries.empty()) {
+      heads.emplace(producer.pending_entries[0].timestamp, i, 0);
+    }
+  }
+  while (!heads.empty()) {
+    const size_t producer_index = std::get<1>(heads.top());
+    const size_t entry_index = std::get<2>(heads.top());
+    heads.pop();
+    Producer& producer = *_producers[producer_index];
+    const Producer::Entry& entry = producer.pending_entries[entry_index];
+    _combiner.writeMessage(producer.input, producer.pending.data() + entry.offset, entry.length,
+                           *_writer);
+    if (entry_index + 1 < producer.pending_entries.size()) {
+      heads.emplace(producer.pending_entries[entry_index + 1].timestamp, producer_index,
+                    entry_index + 1);
+    }
+  }
+  for (auto& producer : _producers) {
+    if (producer->input >= 0) {
+      producer->clearPending();
+    }
+  }
+}
+
+void ShmLogDaemon::removeProducer(size_t index)
+{
+  Producer& producer = *_producers[index];
+  if (producer.input >= 0) {
+    _combiner.removeInput(producer.input);
+  }
+  ShmRing::unlink(producer.ring->name());
+  _registry->release(producer.slot);
+  _producers.erase(_producers.begin() + static_cast<std::ptrdiff_t>(index));
+}
+
+}  // namespace ulog_cpp
@@ -0,0 +1,413 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "shm_transport.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include "exception.hpp"
+#include "raw_messages.hpp"
+
+namespace ulog_cpp {
+
+namespace {
+
+constexpr uint32_t kRingMagic = 0x5a5a5231;      // "ZZR1"
+constexpr uint32_t kRegistryMagic = 0x5a5a4331;  // "ZZC1"
+constexpr size_t kMaxNameLength = 200;
+constexpr size_t kRingNameLength = 256;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "required for process-shared atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "required for process-shared atomics");
+
+/**
+ * Create (create=true, replacing an existing one) or open a segment and map it.
+ * @param size segment size if created, set to the size of an opened segment
+ */
+void* mapSegment(const std::string& name, bool create, size_t& size)
+{
+  if (create) {
+    shm_unlink(name.c_str());
+  }
+  const int fd = shm_open(name.c_str(), create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0600);
+  if (fd < 0) {
+    throw ParsingException("Failed to open shared memory " + name + ": " + strerror(errno));
+  }
+  if (create) {
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      const int error = errno;
+      ::close(fd);
+      shm_unlink(name.c_str());
+      throw ParsingException("Failed to size shared memory " + name + ": " + strerror(error));
+    }
+  } else {
+    struct stat status {};
+    if (fstat(fd, &status) != 0) {
+      ::close(fd);
+      throw ParsingException("Failed to stat shared memory " + name);
+    }
+    size = static_cast<size_t>(status.st_size);
+  }
+  void* mapping = size > 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                           : MAP_FAILED;
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    if (create) {
+      shm_unlink(name.c_str());
+    }
+    throw ParsingException("Failed to map shared memory " + name);
+  }
+  return mapping;
+}
+
+}  // namespace
+
+struct ShmRing::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  int32_t pid;
+  std::atomic<uint32_t> closed;
+  alignas(64) std::atomic<uint64_t> write_pos;  ///< only written by the producer
+  alignas(64) std::atomic<uint64_t> read_pos;   ///< only written by the consumer
+};
+
+std::unique_ptr<ShmRing> ShmRing::create(const std::string& name, size_t capacity)
+{
+  if (capacity == 0) {
+    throw UsageException("ShmRing: capacity must not be 0");
+  }
+  size_t size = sizeof(Header) + capacity;
+  void* mapping = mapSegment(name, true, size);
+  Header* header = new (mapping) Header{};
+  header->capacity = capacity;
+  header->pid = static_cast<int32_t>(getpid());
+  header->version = 1;
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = kRingMagic;
+  return std::unique_ptr<ShmRing>(new ShmRing(name, mapping, size));
+}
+
+std::unique_ptr<ShmRing> ShmRing::open(const std::string& name)
+{
+  size_t size = 0;
+  void* mapping = mapSegment(name, false, size);
+  const Header* header = static_cast<const Header*>(mapping);
+  if (size < sizeof(Header) || header->magic != kRingMagic ||
+      header->capacity != size - sizeof(Header)) {
+    munmap(mapping, size);
+    throw ParsingException("Not a ring: " + name);
+  }
+  return std::unique_ptr<ShmRing>(new ShmRing(name, mapping, size));
+}
+
+void ShmRing::unlink(const std::string& name)
+{
+  shm_unlink(name.c_str());
+}
+
+ShmRing::ShmRing(std::string name, void* mapping, size_t mapping_size)
+    : _name(std::move(name)),
+      _mapping(mapping),
+      _mapping_size(mapping_size),
+      _header(static_cast<Header*>(mapping)),
+      _data(static_cast<uint8_t*>(mapping) + sizeof(Header)),
+      _capacity(_header->capacity)
+{
+}
+
+ShmRing::~ShmRing()
+{
+  munmap(_mapping, _mapping_size);
+}
+
+bool ShmRing::tryWrite(const uint8_t* data, size_t length)
+{
+  const uint64_t write_pos = _header->write_pos.load(std::memory_order_relaxed);
+  const uint64_t read_pos = _header->read_pos.load(std::memory_order_acquire);
+  if (_capacity - (write_pos - read_pos) < length) {
+    return false;
+  }
+  const size_t offset = write_pos % _capacity;
+  const size_t first = std::min(length, _capacity - offset);
+  memcpy(_data + offset, data, first);
+  memcpy(_data, data + first, length - first);
+  _header->write_pos.store(write_pos + length, std::memory_order_release);
+  return true;
+}
+
+size_t ShmRing::read(const std::function<void(const uint8_t*, size_t)>& read_cb)
+{
+  const uint64_t read_pos = _header->read_pos.load(std::memory_order_relaxed);
+  const uint64_t write_pos = _header->write_pos.load(std::memory_order_acquire);
+  const size_t length = write_pos - read_pos;
+  if (length == 0) {
+    return 0;
+  }
+  const size_t offset = read_pos % _capacity;
+  const size_t first = std::min(length, _capacity - offset);
+  read_cb(_data + offset, first);
+  if (first < length) {
+    read_cb(_data, length - first);
+  }
+  _header->read_pos.store(write_pos, std::memory_order_release);
+  return length;
+}
+
+void ShmRing::close()
+{
+  _header->closed.store(1, std::memory_order_release);
+}
+
+bool ShmRing::closed() const
+{
+  return _header->closed.load(std::memory_order_acquire) != 0;
+}
+
+int ShmRing::pid() const
+{
+  return _header->pid;
+}
+
+struct ShmRegistry::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_slots;
+};
+
+struct ShmRegistry::Slot {
+  std::atomic<uint32_t> state;
+  std::atomic<int32_t> pid;
+  char ring_name[kRingNameLength];
+};
+
+std::unique_ptr<ShmRegistry> ShmRegistry::create(const std::string& name, uint32_t num_slots)
+{
+  if (name.size() > kMaxNameLength || num_slots == 0) {
+    throw UsageException("ShmRegistry: invalid name or number of slots");
+  }
+  size_t size = sizeof(Header) + num_slots * sizeof(Slot);
+  void* mapping = mapSegment(name, true, size);
+  Header* header = new (mapping) Header{};
+  header->version = 1;
+  header->num_slots = num_slots;
+  auto* slots = reinterpret_cast<Slot*>(static_cast<uint8_t*>(mapping) + sizeof(Header));
+  for (uint32_t i = 0; i < num_slots; ++i) {
+    new (&slots[i]) Slot{};
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = kRegistryMagic;
+  return std::unique_ptr<ShmRegistry>(new ShmRegistry(name, mapping, size, true));
+}
+
+std::unique_ptr<ShmRegistry> ShmRegistry::open(const std::string& name)
+{
+  size_t size = 0;
+  void* mapping;
+  try {
+    mapping = mapSegment(name, false, size);
+  } catch (const ParsingException&) {
+    throw ParsingException("No logging daemon running (" + name + ")");
+  }
+  const Header* header = static_cast<const Header*>(mapping);
+  if (size < sizeof(Header) || header->magic != kRegistryMagic ||
+      size != sizeof(Header) + header->num_slots * sizeof(Slot)) {
+    munmap(mapping, size);
+    throw ParsingException("Not a registry: " + name);
+  }
+  return std::unique_ptr<ShmRegistry>(new ShmRegistry(name, mapping, size, false));
+}
+
+ShmRegistry::ShmRegistry(std::string name, void* mapping, size_t mapping_size, bool owner)
+    : _name(std::move(name)), _mapping(mapping), _mapping_size(mapping_size), _owner(owner)
+{
+}
+
+ShmRegistry::~ShmRegistry()
+{
+  munmap(_mapping, _mapping_size);
+  if (_owner) {
+    shm_unlink(_name.c_str());
+  }
+}
+
+uint32_t ShmRegistry::numSlots() const
+{
+  return static_cast<const Header*>(_mapping)->num_slots;
+}
+
+ShmRegistry::Slot& ShmRegistry::slot(uint32_t index) const
+{
+  if (index >= numSlots()) {
+    throw UsageException("Invalid registry slot");
+  }
+  return reinterpret_cast<Slot*>(static_cast<uint8_t*>(_mapping) + sizeof(Header))[index];
+}
+
+int ShmRegistry::claim(int pid)
+{
+  for (uint32_t i = 0; i < numSlots(); ++i) {
+    uint32_t expected = static_cast<uint32_t>(SlotState::Free);
+    if (slot(i).state.compare_exchange_strong(expected, static_cast<uint32_t>(SlotState::Claimed),
+                                              std::memory_order_acq_rel)) {
+      slot(i).pid.store(pid, std::memory_order_release);
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void ShmRegistry::publish(uint32_t slot_index, const std::string& ring_name)
+{
+  Slot& registry_slot = slot(slot_index);
+  if (ring_name.size() >= sizeof(registry_slot.ring_name)) {
+    throw UsageException("Ring name too long");
+  }
+  memcpy(registry_slot.ring_name, ring_name.c_str(), ring_name.size() + 1);
+  registry_slot.state.store(static_cast<uint32_t>(SlotState::Ready), std::memory_order_release);
+}
+
+bool ShmRegistry::withdraw(uint32_t slot_index)
+{
+  uint32_t state = static_cast<uint32_t>(SlotState::Ready);
+  if (slot(slot_index).state.compare_exchange_strong(state, static_cast<uint32_t>(SlotState::Free),
+                                                     std::memory_order_acq_rel)) {
+    return true;
+  }
+  state = static_cast<uint32_t>(SlotState::Claimed);
+  return slot(slot_index).state.compare_exchange_strong(
+      state, static_cast<uint32_t>(SlotState::Free), std::memory_order_acq_rel);
+}
+
+ShmRegistry::SlotState ShmRegistry::state(uint32_t slot_index) const
+{
+  return static_cast<SlotState>(slot(slot_index).state.load(std::memory_order_acquire));
+}
+
+bool ShmRegistry::attach(uint32_t slot_index)
+{
+  uint32_t state = static_cast<uint32_t>(SlotState::Ready);
+  return slot(slot_index).state.compare_exchange_strong(
+      state, static_cast<uint32_t>(SlotState::Attached), std::memory_order_acq_rel);
+}
+
+void ShmRegistry::release(uint32_t slot_index)
+{
+  slot(slot_index).pid.store(0, std::memory_order_relaxed);
+  slot(slot_index).state.store(static_cast<uint32_t>(SlotState::Free), std::memory_order_release);
+}
+
+int ShmRegistry::pid(uint32_t slot_index) const
+{
+  return slot(slot_index).pid.load(std::memory_order_acquire);
+}
+
+std::string ShmRegistry::ringName(uint32_t slot_index) const
+{
+  const Slot& registry_slot = slot(slot_index);
+  return std::string(registry_slot.ring_name,
+                     strnlen(registry_slot.ring_name, sizeof(registry_slot.ring_name)));
+}
+
+ShmLogProducer::ShmLogProducer(const ShmTransportConfig& config)
+    : _config(config), _registry(ShmRegistry::open(config.name))
+{
+  const int pid = static_cast<int>(getpid());
+  _slot = _registry->claim(pid);
+  if (_slot < 0) {
+    throw ParsingException("No free producer slot in " + config.name);
+  }
+  const std::string ring_name = config.name + "." + std::to_string(pid) + "." + std::to_string(_slot);
+  try {
+    _ring = ShmRing::create(ring_name, config.ring_size);
+  } catch (...) {
+    _registry->withdraw(_slot);
+    throw;
+  }
+  _registry->publish(_slot, ring_name);
+}
+
+ShmLogProducer::~ShmLogProducer()
+{
+  _ring->close();
+  // The daemon removes attached rings after reading them
+  if (_registry->withdraw(_slot)) {
+    ShmRing::unlink(_ring->name());
+  }
+}
+
+void ShmLogProducer::write(const uint8_t* data, int length)
+{
+  if (_broken || length <= 0) {
+    return;
+  }
+  _splitter.write(
+      data, length,
+      [this](const uint8_t* file_header, size_t size) { writeBlocking(file_header, size); },
+      [this](const uint8_t* message, size_t size) { handleMessage(message, size); });
+}
+
+void ShmLogProducer::handleMessage(const uint8_t* message, size_t length)
+{
+  if (_broken) {
+    return;
+  }
+  if (!isDroppable(static_cast<ULogMessageType>(message[2]))) {
+    writeBlocking(message, length);
+    return;
+  }
+  if ((!_dropping || writeDropout()) && _ring->tryWrite(message, length)) {
+    ++_stats.messages;
+    return;
+  }
+  if (!_dropping) {
+    _dropping = true;
+    _dropping_since = std::chrono::steady_clock::now();
+  }
+  ++_stats.dropped_messages;
+}
+
+bool ShmLogProducer::writeDropout()
+{
+  const ulog_message_dropout_s dropout = dropoutSince(_dropping_since);
+  if (!_ring->tryWrite(reinterpret_cast<const uint8_t*>(&dropout), sizeof(dropout))) {
+    return false;
+  }
+  _dropping = false;
+  ++_stats.messages;
+  return true;
+}
+
+void ShmLogProducer::writeBlocking(const uint8_t* data, size_t length)
+{
+  if (length > _ring->capacity()) {
+    throw UsageException("Message larger than the ring");
+  }
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(_config.blocking_timeout_ms);
+  while (!_ring->tryWrite(data, length)) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      // The log is not readable without this message: stop, the daemon removes the closed ring
+      ++_stats.dropped_messages;
+      _broken = true;
+      _ring->close();
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  ++_stats.messages;
+}
+
+}  // namespace ulog_cpp
@@ -5,8 +5,6 @@
 
 #include "simple_writer.hpp"
 
-#include <unistd.h>
-
 namespace ulog_cpp {
 
 const std::string SimpleWriter::kFormatNameRegexStr = "[a-zA-Z0-9_\\-/]+";
@@ -14,30 +12,24 @@ const std::regex SimpleWriter::kFormatNameRegex = std::regex(std::string(kFormat
 const std::string SimpleWriter::kFieldNameRegexStr = "[a-z0-9_]+";
 const std::regex SimpleWriter::kFieldNameRegex = std::regex(std::string(kFieldNameRegexStr));
 
-SimpleWriter::SimpleWriter(DataWriteCB data_write_cb, uint64_t timestamp_us)
-    : _writer(std::make_unique<Writer>(std::move(data_write_cb)))
+SimpleWriter::SimpleWriter(DataWriteCB data_write_cb, uint64_t timestamp_us, bool encode_data)
+    : _writer(std::make_unique<Writer>(std::move(data_write_cb), encode_data))
 {
   _writer->fileHeader(FileHeader(timestamp_us));
 }
 
-SimpleWriter::SimpleWriter(const std::string& filename, uint64_t timestamp_us)
+SimpleWriter::SimpleWriter(const std::string& filename, uint64_t timestamp_us, bool encode_data,
+                           const FileSinkConfig& sink_config)
+    : _file(createFileSink(filename, sink_config))
 {
-  _file = std::fopen(filename.c_str(), "wb");
-  if (!_file) {
-    throw ParsingException("Failed to open file");
-  }
-
   _writer = std::make_unique<Writer>(
-      [this](const uint8_t* data, int length) { std::fwrite(data, 1, length, _file); });
+      [this](const uint8_t* data, int length) { _file->write(data, length); }, encode_data);
   _writer->fileHeader(FileHeader(timestamp_us));
 }
 
 SimpleWriter::~SimpleWriter()
 {
   _writer.reset();
-  if (_file) {
-    std::fclose(_file);
-  }
 }
 
 void SimpleWriter::writeMessageFormat(const std::string& name, const std::vector<Field>& fields)
@@ -103,11 +95,22 @@ void SimpleWriter::writeTextMessage(Logging::Level level, const std::string& mes
   _writer->logging({level, message, timestamp});
 }
 
+uint16_t SimpleWriter::registerTextFormatImpl(const std::string& arg_codes,
+                                              const std::string& format)
+{
+  if (_num_text_formats == std::numeric_limits<uint16_t>::max()) {
+    throw UsageException("Too many text formats");
+  }
+  const uint16_t id = _num_text_formats++;
+  _writer->messageInfo(deferredFormatInfo(id, arg_codes, format));
+  return id;
+}
+
 void SimpleWriter::fsync()
 {
+  _writer->flush();
   if (_file) {
-    fflush(_file);
-    ::fsync(fileno(_file));
+    _file->sync();
   }
 }
 uint16_t SimpleWriter::writeAddLoggedMessage(const std::string& message_format_name,
@@ -126,7 +129,7 @@ uint16_t SimpleWriter::writeAddLoggedMessage(const std::string& message_format_n
   return msg_id;
 }
 
-void SimpleWriter::writeDataImpl(uint16_t id, const uint8_t* data, unsigned length)
+unsigned SimpleWriter::validateData(uint16_t id, unsigned length) const
 {
   if (!_header_complete) {
     throw UsageException("Header not yet complete");
@@ -139,10 +142,32 @@ void SimpleWriter::writeDataImpl(uint16_t id, const uint8_t* data, unsigned leng
   if (length < expected_size) {
     throw UsageException("sizeof(data) is too small");
   }
+  return expected_size;
+}
+
+void SimpleWriter::writeDataImpl(uint16_t id, const uint8_t* data, unsigned length)
+{
+  const unsigned expected_size = validateData(id, length);
   std::vector<uint8_t> data_vec;
   data_vec.resize(expected_size);
   memcpy(data_vec.data(), data, expected_size);
   _writer->data(Data(id, std::move(data_vec)));
 }
 
+void SimpleWriter::writeDataBatchImpl(uint16_t id, const uint8_t* data, unsigned length,
+                                      size_t count)
+{
+  const unsigned expected_size = validateData(id, length);
+  _writer->dataBatch(id, data, expected_size, length, count);
+}
+
+void SimpleWriter::writeDataBatch(const DataBatch& batch)
+{
+  _batch_lengths.clear();
+  for (const auto& entry : batch.entries()) {
+    _batch_lengths.push_back(validateData(entry.msg_id, entry.length));
+  }
+  _writer->dataBatch(batch, _batch_lengths.data());
+}
+
 }  // namespace ulog_cpp
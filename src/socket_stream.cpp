@@ -0,0 +1,355 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "socket_stream.hpp"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#include "exception.hpp"
+#include "messages.hpp"
+#include "raw_messages.hpp"
+
+namespace ulog_cpp {
+
+namespace {
+
+socklen_t socketAddress(const std::string& path, sockaddr_un& address)
+{
+  address = {};
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    throw UsageException("Invalid socket path " + path);
+  }
+  memcpy(address.sun_path, path.data(), path.size());
+  if (path[0] == '@') {
+    address.sun_path[0] = '\0';  // abstract namespace
+  }
+  return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size());
+}
+
+bool endsHeader(ULogMessageType type)
+{
+  switch (type) {
+    case ULogMessageType::ADD_LOGGED_MSG:
+    case ULogMessageType::LOGGING:
+    case ULogMessageType::LOGGING_TAGGED:
+    case ULogMessageType::LOGGING_DEFERRED:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+SocketSink::SocketSink(SocketSinkConfig config) : _config(std::move(config))
+{
+  sockaddr_un address{};
+  socketAddress(_config.path, address);  // throws for an invalid path
+}
+
+SocketSink::~SocketSink()
+{
+  if (_fd >= 0) {
+    send(true);
+    disconnect();
+  }
+}
+
+void SocketSink::write(const uint8_t* data, int length)
+{
+  if (length <= 0) {
+    return;
+  }
+  _splitter.write(
+      data, length,
+      [this](const uint8_t* file_header, size_t size) {
+        _header.insert(_header.end(), file_header, file_header + size);
+      },
+      [this](const uint8_t* message, size_t size) { handleMessage(message, size); });
+}
+
+void SocketSink::flush()
+{
+  if (_fd >= 0 || connect()) {
+    send(true);
+  }
+}
+
+void SocketSink::handleMessage(const uint8_t* message, size_t length)
+{
+  const auto type = static_cast<ULogMessageType>(message[2]);
+  if (!_header_complete && endsHeader(type)) {
+    _header_complete = true;
+  }
+  // A new connection gets the cached state first, which does not contain this message yet
+  if (_fd >= 0 || connect()) {
+    queueMessage(message, length);
+  }
+  cacheMessage(message, length);
+}
+
+void SocketSink::queueMessage(const uint8_t* message, size_t length)
+{
+  const auto queued = [this]() { return _send_buffer.size() - _send_offset; };
+  if (_config.drop_on_backpressure && isDroppable(static_cast<ULogMessageType>(message[2])) &&
+      queued() + length > _config.max_buffered) {
+    // Make room if the receiver caught up
+    if (!send(false)) {
+      return;
+    }
+    if (queued() + length > _config.max_buffered) {
+      if (!_dropping) {
+        _dropping = true;
+        _dropping_since = std::chrono::steady_clock::now();
+      }
+      ++_stats.dropped_messages;
+      return;
+    }
+  }
+  if (_dropping) {
+    writeDropout();
+  }
+  _send_buffer.insert(_send_buffer.end(), message, message + length);
+  ++_stats.messages;
+  if (queued() > _config.max_buffered) {
+    send(true);
+  } else if (queued() >= _config.batch_size ||
+             std::chrono::steady_clock::now() - _last_send >=
+                 std::chrono::milliseconds(_config.batch_interval_ms)) {
+    send(false);
+  }
+}
+
+void SocketSink::cacheMessage(const uint8_t* message, size_t length)
+{
+  if (!_header_complete) {
+    _header.insert(_header.end(), message, message + length);
+    return;
+  }
+  switch (static_cast<ULogMessageType>(message[2])) {
+    case ULogMessageType::ADD_LOGGED_MSG: {
+      const AddLoggedMessage add_logged_message{message};
+      _subscriptions[add_logged_message.msgId()].assign(message, message + length);
+      break;
+    }
+    case ULogMessageType::REMOVE_LOGGED_MSG: {
+      uint16_t msg_id;
+      if (length >= ULOG_MSG_HEADER_LEN + sizeof(msg_id)) {
+        memcpy(&msg_id, message + ULOG_MSG_HEADER_LEN, sizeof(msg_id));
+        _subscriptions.erase(msg_id);
+      }
+      break;
+    }
+    case ULogMessageType::INFO:
+    case ULogMessageType::INFO_MULTIPLE:
+      _infos.insert(_infos.end(), message, message + length);
+      break;
+    case ULogMessageType::PARAMETER: {
+      const Parameter parameter{message};
+      _parameters[parameter.field().name].assign(message, message + length);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+bool SocketSink::connect()
+{
+  const auto now = std::chrono::steady_clock::now();
+  if (now - _last_connect_attempt < std::chrono::milliseconds(_config.reconnect_interval_ms)) {
+    return false;
+  }
+  _last_connect_attempt = now;
+  sockaddr_un address{};
+  const socklen_t address_length = socketAddress(_config.path, address);
+  _fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (_fd < 0) {
+    return false;
+  }
+  if (::connect(_fd, reinterpret_cast<const sockaddr*>(&address), address_length) != 0) {
+    close(_fd);
+    _fd = -1;
+    return false;
+  }
+  ++_stats.connections;
+
+  _send_buffer = _header;
+  _send_offset = 0;
+  for (const auto& subscription : _subscriptions) {
+    _send_buffer.insert(_send_buffer.end(), subscription.second.begin(), subscription.second.end());
+  }
+  _send_buffer.insert(_send_buffer.end(), _infos.begin(), _infos.end());
+  for (const auto& parameter : _parameters) {
+    _send_buffer.insert(_send_buffer.end(), parameter.second.begin(), parameter.second.end());
+  }
+  return send(true);
+}
+
+void SocketSink::disconnect()
+{
+  close(_fd);
+  _fd = -1;
+  _send_buffer.clear();
+  _send_offset = 0;
+  _dropping = false;
+}
+
+bool SocketSink::send(bool blocking)
+{
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(_config.blocking_timeout_ms);
+  while (_send_offset < _send_buffer.size()) {
+    const ssize_t ret = ::send(_fd, _send_buffer.data() + _send_offset,
+                               _send_buffer.size() - _send_offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (ret > 0) {
+      _send_offset += ret;
+      _stats.bytes_sent += ret;
+      continue;
+    }
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if (!blocking) {
+        break;
+      }
+      const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      pollfd fds{_fd, POLLOUT, 0};
+      if (remaining.count() > 0 && ::poll(&fds, 1, static_cast<int>(remaining.count())) > 0) {
+        continue;
+      }
+    }
+    // Timeout, or the receiver is gone
+    disconnect();
+    return false;
+  }
+  if (_send_offset == _send_buffer.size()) {
+    _send_buffer.clear();
+    _send_offset = 0;
+  } else if (_send_offset > _send_buffer.size() / 2) {
+    _send_buffer.erase(_send_buffer.begin(),
+                       _send_buffer.begin() + static_cast<std::ptrdiff_t>(_send_offset));
+    _send_offset = 0;
+  }
+  _last_send = std::chrono::steady_clock::now();
+  return true;
+}
+
+void SocketSink::writeDropout()
+{
+  const ulog_message_dropout_s dropout = dropoutSince(_dropping_since);
+  const auto* dropout_data = reinterpret_cast<const uint8_t*>(&dropout);
+  _send_buffer.insert(_send_buffer.end(), dropout_data, dropout_data + sizeof(dropout));
+  _dropping = false;
+  ++_stats.messages;
+}
+
+SocketReceiver::SocketReceiver(std::string path, std::shared_ptr<DataHandlerInterface> handler)
+    : _path(std::move(path)), _handler(std::move(handler)), _buffer(64 * 1024)
+{
+  sockaddr_un address{};
+  const socklen_t address_length = socketAddress(_path, address);
+  if (_path[0] != '@') {
+    unlink(_path.c_str());
+  }
+  _listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  _wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (_listen_fd < 0 || _wake_fd < 0 ||
+      bind(_listen_fd, reinterpret_cast<const sockaddr*>(&address), address_length) != 0 ||
+      listen(_listen_fd, 1) != 0) {
+    const std::string error = strerror(errno);
+    if (_listen_fd >= 0) {
+      close(_listen_fd);
+    }
+    if (_wake_fd >= 0) {
+      close(_wake_fd);
+    }
+    throw ParsingException("Failed to listen on " + _path + ": " + error);
+  }
+}
+
+SocketReceiver::~SocketReceiver()
+{
+  if (_connection_fd >= 0) {
+    close(_connection_fd);
+  }
+  close(_listen_fd);
+  close(_wake_fd);
+  if (_path[0] != '@') {
+    unlink(_path.c_str());
+  }
+}
+
+size_t SocketReceiver::poll(std::chrono::milliseconds timeout)
+{
+  size_t bytes_read = readAvailable();
+  if (bytes_read == 0) {
+    waitForEvents(timeout);
+    bytes_read = readAvailable();
+  }
+  return bytes_read;
+}
+
+void SocketReceiver::interrupt()
+{
+  const uint64_t value = 1;
+  (void)write(_wake_fd, &value, sizeof(value));
+}
+
+size_t SocketReceiver::readAvailable()
+{
+  if (_connection_fd < 0) {
+    _connection_fd = accept4(_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (_connection_fd < 0) {
+      return 0;
+    }
+    ++_connections;
+    _reader = std::make_unique<Reader>(_handler);
+  }
+  size_t bytes_read = 0;
+  while (true) {
+    const ssize_t ret = recv(_connection_fd, _buffer.data(), _buffer.size(), 0);
+    if (ret > 0) {
+      // Any read size works, the reader keeps partial messages
+      _reader->readChunk(_buffer.data(), ret);
+      bytes_read += ret;
+      continue;
+    }
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+      // The sender disconnected
+      close(_connection_fd);
+      _connection_fd = -1;
+    }
+    break;
+  }
+  _bytes_read += bytes_read;
+  return bytes_read;
+}
+
+void SocketReceiver::waitForEvents(std::chrono::milliseconds timeout)
+{
+  pollfd fds[2]{{_connection_fd >= 0 ? _connection_fd : _listen_fd, POLLIN, 0},
+                {_wake_fd, POLLIN, 0}};
+  if (::poll(fds, 2, static_cast<int>(timeout.count())) > 0 && (fds[1].revents & POLLIN)) {
+    uint64_t value;
+    (void)read(_wake_fd, &value, sizeof(value));
+  }
+}
+
+}  // namespace ulog_cpp
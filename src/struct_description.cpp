@@ -0,0 +1,30 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "struct_description.hpp"
+
+namespace ulog_cpp {
+
+std::vector<Field> fieldsWithPadding(const FieldDescription* fields, size_t num_fields)
+{
+  std::vector<Field> result;
+  size_t end = 0;
+  int num_padding = 0;
+  for (size_t i = 0; i < num_fields; ++i) {
+    const FieldDescription& field = fields[i];
+    if (field.offset < end) {
+      throw UsageException(std::string("Field out of order: ") + field.name);
+    }
+    if (field.offset > end) {
+      result.emplace_back("uint8_t", "_padding" + std::to_string(num_padding++),
+                          static_cast<int>(field.offset - end));
+    }
+    result.emplace_back(field.type, field.name, field.array_length);
+    end = field.offset + field.size;
+  }
+  return result;
+}
+
+}  // namespace ulog_cpp
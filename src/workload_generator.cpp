@@ -0,0 +1,417 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "workload_generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <set>
+#include <sstream>
+
+#include "writer.hpp"
+
+namespace ulog_cpp {
+
+namespace {
+
+/**
+ * splitmix64: small, and unlike the std distributions, the results are the same on every platform
+ */
+class Random {
+ public:
+  explicit Random(uint64_t seed) : _state(seed) {}
+
+  uint64_t next()
+  {
+    uint64_t z = (_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27U)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31U);
+  }
+  double uniform() { return static_cast<double>(next() >> 11U) * 0x1.0p-53; }  ///< [0, 1)
+  uint64_t below(uint64_t n) { return n == 0 ? 0 : next() % n; }
+
+ private:
+  uint64_t _state;
+};
+
+enum class LaneType { Timestamp, Signed, Unsigned, Float, Double, Bool, Char };
+
+struct Lane {
+  LaneType type;
+  unsigned offset;
+  unsigned size;
+};
+
+struct TopicState {
+  uint64_t interval_us;
+  std::vector<Lane> lanes;
+  std::vector<double> values;
+  std::vector<uint8_t> sample;
+};
+
+TopicState createTopicState(const WorkloadSpec::Topic& topic, Random& random)
+{
+  TopicState state{};
+  state.interval_us = std::max<uint64_t>(1, std::llround(1e6 / topic.rate_hz));
+  unsigned offset = 0;
+  for (const auto& field : topic.fields) {
+    const int size = Field::kBasicTypes.at(field.type);
+    LaneType type = LaneType::Signed;
+    if (offset == 0 && field.name == "timestamp") {
+      type = LaneType::Timestamp;
+    } else if (field.type[0] == 'u') {
+      type = LaneType::Unsigned;
+    } else if (field.type == "float") {
+      type = LaneType::Float;
+    } else if (field.type == "double") {
+      type = LaneType::Double;
+    } else if (field.type == "bool") {
+      type = LaneType::Bool;
+    } else if (field.type == "char") {
+      type = LaneType::Char;
+    }
+    const int array_length = field.array_length <= 0 ? 1 : field.array_length;
+    for (int i = 0; i < array_length; ++i) {
+      state.lanes.push_back({type, offset, static_cast<unsigned>(size)});
+      state.values.push_back(random.uniform() * 200. - 100.);
+      offset += size;
+    }
+  }
+  state.sample.resize(offset);
+  return state;
+}
+
+void updateSample(TopicState& state, uint64_t timestamp, Random& random)
+{
+  for (size_t i = 0; i < state.lanes.size(); ++i) {
+    const Lane& lane = state.lanes[i];
+    uint8_t* dest = state.sample.data() + lane.offset;
+    double& value = state.values[i];
+    value += random.uniform() - 0.5;
+    switch (lane.type) {
+      case LaneType::Timestamp:
+        memcpy(dest, &timestamp, sizeof(timestamp));
+        break;
+      case LaneType::Signed:
+      case LaneType::Unsigned: {
+        // Truncation to the field size (little endian)
+        const auto integer = static_cast<int64_t>(value);
+        memcpy(dest, &integer, lane.size);
+        break;
+      }
+      case LaneType::Float: {
+        const auto f = static_cast<float>(value);
+        memcpy(dest, &f, sizeof(f));
+        break;
+      }
+      case LaneType::Double:
+        memcpy(dest, &value, sizeof(value));
+        break;
+      case LaneType::Bool:
+        *dest = value > 0. ? 1 : 0;
+        break;
+      case LaneType::Char:
+        *dest = 'a' + static_cast<uint8_t>(std::llabs(std::llround(value)) % 26);
+        break;
+    }
+  }
+}
+
+void corrupt(std::vector<uint8_t>& message, WorkloadSpec::Corruption type, Random& random)
+{
+  switch (type) {
+    case WorkloadSpec::Corruption::BitFlip:
+      message[random.below(message.size())] ^= 1U << random.below(8);
+      break;
+    case WorkloadSpec::Corruption::Garbage: {
+      std::vector<uint8_t> garbage(1 + random.below(64));
+      for (auto& byte : garbage) {
+        byte = static_cast<uint8_t>(random.next());
+      }
+      message.insert(message.begin(), garbage.begin(), garbage.end());
+      break;
+    }
+    case WorkloadSpec::Corruption::Truncate:
+      message.resize(random.below(message.size()));
+      break;
+  }
+}
+
+Field parseField(const std::string& token)
+{
+  const auto colon = token.find(':');
+  if (colon == std::string::npos || colon == 0 || colon + 1 == token.size()) {
+    throw UsageException("Invalid field (expected <type>:<name>): " + token);
+  }
+  std::string type = token.substr(0, colon);
+  int array_length = -1;
+  const auto bracket = type.find('[');
+  if (bracket != std::string::npos) {
+    if (type.back() != ']') {
+      throw UsageException("Invalid field type: " + type);
+    }
+    array_length = std::stoi(type.substr(bracket + 1, type.size() - bracket - 2));
+    if (array_length <= 0) {
+      throw UsageException("Invalid array length: " + type);
+    }
+    type = type.substr(0, bracket);
+  }
+  if (Field::kBasicTypes.find(type) == Field::kBasicTypes.end()) {
+    throw UsageException("Invalid field type (only basic types are supported): " + type);
+  }
+  return {type, token.substr(colon + 1), array_length};
+}
+
+}  // namespace
+
+void WorkloadSpec::addRandomTopics(int count, double min_rate_hz, double max_rate_hz,
+                                   int min_fields, int max_fields)
+{
+  static const std::vector<std::string> kTypes{"int8_t",  "uint8_t",  "int16_t", "uint16_t",
+                                               "int32_t", "uint32_t", "int64_t", "uint64_t",
+                                               "float",   "double",   "bool",    "char"};
+  Random random(seed ^ (0xA5A5A5A5ULL + topics.size()));
+  for (int i = 0; i < count; ++i) {
+    Topic topic;
+    topic.name = "topic_" + std::to_string(topics.size());
+    topic.rate_hz = min_rate_hz + random.uniform() * (max_rate_hz - min_rate_hz);
+    topic.fields.emplace_back("uint64_t", "timestamp");
+    const int num_fields =
+        min_fields + static_cast<int>(random.below(std::max(1, max_fields - min_fields + 1)));
+    for (int f = 0; f < num_fields; ++f) {
+      const int array_length = random.below(2) == 0 ? -1 : 2 + static_cast<int>(random.below(7));
+      topic.fields.emplace_back(kTypes[random.below(kTypes.size())], "f" + std::to_string(f),
+                                array_length);
+    }
+    topics.push_back(std::move(topic));
+  }
+}
+
+WorkloadSpec WorkloadSpec::parse(std::istream& stream)
+{
+  WorkloadSpec spec;
+  std::string line;
+  int line_number = 0;
+  while (std::getline(stream, line)) {
+    ++line_number;
+    const auto comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.resize(comment);
+    }
+    std::istringstream tokens(line);
+    std::string key;
+    if (!(tokens >> key)) {
+      continue;
+    }
+    try {
+      if (key == "seed") {
+        tokens >> spec.seed;
+      } else if (key == "duration") {
+        tokens >> spec.duration_s;
+      } else if (key == "max_size_mb") {
+        uint64_t size_mb = 0;
+        tokens >> size_mb;
+        spec.max_bytes = size_mb * 1024 * 1024;
+      } else if (key == "encode_data") {
+        tokens >> spec.encode_data;
+      } else if (key == "logging_rate") {
+        tokens >> spec.logging_rate_hz;
+      } else if (key == "dropout") {
+        tokens >> spec.dropout_probability >> spec.dropout_duration_ms;
+      } else if (key == "corruption") {
+        if (!(tokens >> spec.corruption_probability)) {
+          throw UsageException("Invalid or missing value for " + key);
+        }
+        std::string types;
+        if (tokens >> types) {
+          spec.corruption_types.clear();
+          std::istringstream type_tokens(types);
+          std::string type;
+          while (std::getline(type_tokens, type, ',')) {
+            if (type == "bitflip") {
+              spec.corruption_types.push_back(Corruption::BitFlip);
+            } else if (type == "garbage") {
+              spec.corruption_types.push_back(Corruption::Garbage);
+            } else if (type == "truncate") {
+              spec.corruption_types.push_back(Corruption::Truncate);
+            } else {
+              throw UsageException("Invalid corruption type: " + type);
+            }
+          }
+        }
+        tokens.clear();
+      } else if (key == "topic") {
+        Topic topic;
+        if (!(tokens >> topic.name >> topic.rate_hz)) {
+          throw UsageException("Invalid or missing value for " + key);
+        }
+        std::string field;
+        while (tokens >> field) {
+          topic.fields.push_back(parseField(field));
+        }
+        tokens.clear();
+        if (topic.fields.empty() || topic.fields[0].name != "timestamp") {
+          topic.fields.insert(topic.fields.begin(), Field("uint64_t", "timestamp"));
+        }
+        spec.topics.push_back(std::move(topic));
+      } else if (key == "random_topics") {
+        int count = 0;
+        double min_rate_hz = 0.;
+        double max_rate_hz = 0.;
+        int min_fields = 0;
+        int max_fields = 0;
+        tokens >> count >> min_rate_hz >> max_rate_hz >> min_fields >> max_fields;
+        if (tokens && (count < 0 || min_fields < 0 || max_fields < min_fields)) {
+          throw UsageException("Invalid random_topics parameters");
+        }
+        if (tokens) {
+          spec.addRandomTopics(count, min_rate_hz, max_rate_hz, min_fields, max_fields);
+        }
+      } else {
+        throw UsageException("Unknown key: " + key);
+      }
+      if (tokens.fail()) {
+        throw UsageException("Invalid or missing value for " + key);
+      }
+    } catch (const std::logic_error& error) {  // std::stoi
+      throw UsageException("Workload spec line " + std::to_string(line_number) + ": " +
+                           error.what());
+    } catch (const UsageException& error) {
+      throw UsageException("Workload spec line " + std::to_string(line_number) + ": " +
+                           error.what());
+    }
+  }
+  return spec;
+}
+
+WorkloadGenerator::WorkloadGenerator(WorkloadSpec spec) : _spec(std::move(spec))
+{
+  if (_spec.topics.size() > std::numeric_limits<uint16_t>::max()) {
+    throw UsageException("Too many topics");
+  }
+  std::set<std::string> names;
+  for (const auto& topic : _spec.topics) {
+    if (!names.insert(topic.name).second) {
+      throw UsageException("Duplicate topic: " + topic.name);
+    }
+    if (!(topic.rate_hz > 0.)) {
+      throw UsageException("Invalid rate for topic " + topic.name);
+    }
+    if (topic.fields.empty() || topic.fields[0].name != "timestamp" ||
+        topic.fields[0].type != "uint64_t" || topic.fields[0].array_length != -1) {
+      throw UsageException("First field of " + topic.name + " must be 'uint64_t timestamp'");
+    }
+  }
+  if (_spec.corruption_probability > 0. && _spec.corruption_types.empty()) {
+    throw UsageException("No corruption types given");
+  }
+}
+
+WorkloadStats WorkloadGenerator::generate(const DataWriteCB& writer) const
+{
+  static constexpr uint64_t kStartTimeUs = 1000000;
+  WorkloadStats stats;
+  stats.samples_per_topic.resize(_spec.topics.size());
+  Random random(_spec.seed);
+
+  // Messages are collected per call, so corruption can be applied to complete messages
+  std::vector<uint8_t> pending;
+  bool corruption_pending = false;
+  auto forward = [&]() {
+    if (pending.empty()) {
+      return;
+    }
+    if (corruption_pending) {
+      corrupt(pending, _spec.corruption_types[random.below(_spec.corruption_types.size())],
+              random);
+      ++stats.num_corruptions;
+      corruption_pending = false;
+    }
+    if (!pending.empty()) {
+      writer(pending.data(), static_cast<int>(pending.size()));
+      stats.num_bytes += pending.size();
+      pending.clear();
+    }
+  };
+  Writer ulog_writer(
+      [&pending](const uint8_t* data, int length) {
+        pending.insert(pending.end(), data, data + length);
+      },
+      _spec.encode_data);
+
+  // Header
+  ulog_writer.fileHeader(FileHeader(kStartTimeUs));
+  ulog_writer.messageInfo(MessageInfo("sys_name", "ulog_generate"));
+  ulog_writer.messageInfo(MessageInfo("workload_seed", std::to_string(_spec.seed)));
+  for (const auto& topic : _spec.topics) {
+    ulog_writer.messageFormat(MessageFormat(topic.name, topic.fields));
+  }
+  ulog_writer.headerComplete();
+  std::vector<TopicState> states;
+  states.reserve(_spec.topics.size());
+  for (size_t i = 0; i < _spec.topics.size(); ++i) {
+    ulog_writer.addLoggedMessage(AddLoggedMessage(0, i, _spec.topics[i].name));
+    states.push_back(createTopicState(_spec.topics[i], random));
+  }
+  forward();
+
+  // Events in timestamp order. Index topics.size() is used for logging messages.
+  using Event = std::pair<uint64_t, size_t>;
+  std::priority_queue<Event, std::vector<Event>, std::greater<>> events;
+  for (size_t i = 0; i < states.size(); ++i) {
+    events.emplace(kStartTimeUs + random.below(states[i].interval_us), i);
+  }
+  const uint64_t logging_interval_us =
+      _spec.logging_rate_hz > 0. ? std::max<uint64_t>(1, std::llround(1e6 / _spec.logging_rate_hz))
+                                 : 0;
+  if (logging_interval_us > 0) {
+    events.emplace(kStartTimeUs, states.size());
+  }
+
+  const auto end_time_us = kStartTimeUs + static_cast<uint64_t>(_spec.duration_s * 1e6);
+  while (!events.empty()) {
+    const Event event = events.top();
+    events.pop();
+    const uint64_t timestamp = event.first;
+    if (timestamp > end_time_us || (_spec.max_bytes > 0 && stats.num_bytes >= _spec.max_bytes)) {
+      break;
+    }
+
+    if (event.second == states.size()) {
+      ulog_writer.logging(Logging(Logging::Level::Info,
+                                  "workload message " + std::to_string(stats.num_logging),
+                                  timestamp));
+      ++stats.num_logging;
+      events.emplace(timestamp + logging_interval_us, event.second);
+    } else {
+      TopicState& state = states[event.second];
+      if (_spec.dropout_probability > 0. && random.uniform() < _spec.dropout_probability) {
+        ulog_writer.dropout(Dropout(_spec.dropout_duration_ms));
+        ++stats.num_dropouts;
+      } else {
+        updateSample(state, timestamp, random);
+        ulog_writer.data(Data(event.second, state.sample));
+        ++stats.num_samples;
+        ++stats.samples_per_topic[event.second];
+        if (_spec.corruption_probability > 0. &&
+            random.uniform() < _spec.corruption_probability) {
+          // With encode_data, this applies to the next block that is written out
+          corruption_pending = true;
+        }
+      }
+      events.emplace(timestamp + state.interval_us, event.second);
+    }
+    forward();
+  }
+  ulog_writer.flush();
+  forward();
+  return stats;
+}
+
+}  // namespace ulog_cpp
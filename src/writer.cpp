@@ -5,9 +5,14 @@
 
 #include "writer.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 namespace ulog_cpp {
 
-Writer::Writer(DataWriteCB data_write_cb) : _data_write_cb(std::move(data_write_cb))
+Writer::Writer(DataWriteCB data_write_cb, bool encode_data)
+    : _data_write_cb(std::move(data_write_cb)), _encode_data(encode_data)
 {
   // Writer assumes to run on little endian
   // TODO: use std::endian from C++20
@@ -18,16 +23,28 @@ Writer::Writer(DataWriteCB data_write_cb) : _data_write_cb(std::move(data_write_
   }
 }
 
+Writer::~Writer()
+{
+  flush();
+}
+
 void Writer::headerComplete()
 {
   _header_complete = true;
 }
 void Writer::fileHeader(const FileHeader& header)
 {
-  header.serialize(_data_write_cb);
+  if (_encode_data) {
+    ulog_message_flag_bits_s flag_bits = header.flagBits();
+    flag_bits.compat_flags[0] |= ULOG_COMPAT_FLAG0_ENCODED_DATA_MASK;
+    FileHeader(header.header(), flag_bits).serialize(_data_write_cb);
+  } else {
+    header.serialize(_data_write_cb);
+  }
 }
 void Writer::messageInfo(const MessageInfo& message_info)
 {
+  flush();
   message_info.serialize(_data_write_cb);
 }
 void Writer::messageFormat(const MessageFormat& message_format)
@@ -35,14 +52,19 @@ void Writer::messageFormat(const MessageFormat& message_format)
   if (_header_complete) {
     throw ParsingException("Header completed, cannot write formats");
   }
+  if (_encode_data) {
+    _formats.insert({message_format.name(), message_format});
+  }
   message_format.serialize(_data_write_cb);
 }
 void Writer::parameter(const Parameter& parameter)
 {
+  flush();
   parameter.serialize(_data_write_cb, ULogMessageType::PARAMETER);
 }
 void Writer::parameterDefault(const ParameterDefault& parameter_default)
 {
+  flush();
   parameter_default.serialize(_data_write_cb);
 }
 void Writer::addLoggedMessage(const AddLoggedMessage& add_logged_message)
@@ -50,22 +72,165 @@ void Writer::addLoggedMessage(const AddLoggedMessage& add_logged_message)
   if (!_header_complete) {
     throw ParsingException("Header not yet completed, cannot write AddLoggedMessage");
   }
+  if (_encode_data) {
+    flush();
+    _encoders.erase(add_logged_message.msgId());
+    const auto format_iter = _formats.find(add_logged_message.messageName());
+    if (format_iter != _formats.end()) {
+      DataEncodingLayout layout(format_iter->second, _formats);
+      if (layout.encodable()) {
+        _encoders.emplace(add_logged_message.msgId(),
+                          DataEncoder(add_logged_message.msgId(), std::move(layout)));
+      }
+    }
+  }
   add_logged_message.serialize(_data_write_cb);
 }
 void Writer::logging(const Logging& logging)
 {
+  flush();
+  logging.serialize(_data_write_cb);
+}
+void Writer::deferredLogging(const DeferredLogging& logging)
+{
+  flush();
   logging.serialize(_data_write_cb);
 }
+void Writer::deferredLogging(Logging::Level level, uint16_t format_id, uint64_t timestamp,
+                             const uint8_t* args, size_t args_length)
+{
+  flush();
+  DeferredLogging::serialize(_data_write_cb, level, format_id, timestamp, args, args_length);
+}
+void Writer::rawMessage(const uint8_t* message, size_t length)
+{
+  flush();
+  _data_write_cb(message, static_cast<int>(length));
+}
 void Writer::data(const Data& data)
 {
+  if (_encode_data && encodeSample(data.msgId(), data.data().data(), data.data().size())) {
+    return;
+  }
   data.serialize(_data_write_cb);
 }
+bool Writer::encodeSample(uint16_t msg_id, const uint8_t* data, size_t length)
+{
+  const auto encoder_iter = _encoders.find(msg_id);
+  if (encoder_iter == _encoders.end()) {
+    return false;
+  }
+  DataEncoder& encoder = encoder_iter->second;
+  if (length != encoder.layout().sampleSize()) {
+    // Unexpected size: write it unencoded, but keep the order of samples
+    flushEncoder(msg_id, encoder);
+    return false;
+  }
+  if (!encoder.canAppend()) {
+    flushEncoder(msg_id, encoder);
+  }
+  if (encoder.empty()) {
+    _pending_blocks.push_back(msg_id);
+  }
+  encoder.append(data, length);
+  return true;
+}
+void Writer::flushEncoder(uint16_t msg_id, DataEncoder& encoder)
+{
+  if (encoder.empty()) {
+    return;
+  }
+  encoder.flush(_data_write_cb);
+  _pending_blocks.erase(std::find(_pending_blocks.begin(), _pending_blocks.end(), msg_id));
+}
+void Writer::dataBatch(uint16_t msg_id, const uint8_t* samples, unsigned sample_size,
+                       size_t stride, size_t count)
+{
+  if (count == 0) {
+    return;
+  }
+  if (sample_size + sizeof(uint16_t) > std::numeric_limits<uint16_t>::max()) {
+    throw ParsingException("message too long");
+  }
+  ulog_message_data_s header;
+  header.msg_size = sample_size + sizeof(uint16_t);
+  header.msg_id = msg_id;
+  const size_t header_length = ULOG_MSG_HEADER_LEN + sizeof(uint16_t);
+  const size_t message_length = header_length + sample_size;
+
+  if (_encode_data) {
+    const auto encoder_iter = _encoders.find(msg_id);
+    if (encoder_iter != _encoders.end()) {
+      if (sample_size == encoder_iter->second.layout().sampleSize()) {
+        for (size_t i = 0; i < count; ++i) {
+          encodeSample(msg_id, samples + i * stride, sample_size);
+        }
+        return;
+      }
+      // Unexpected size: write it unencoded, but keep the order of samples
+      flushEncoder(msg_id, encoder_iter->second);
+    }
+  }
+
+  _batch_buffer.resize(message_length * count);
+  uint8_t* message = _batch_buffer.data();
+  for (size_t i = 0; i < count; ++i) {
+    memcpy(message, &header, header_length);
+    memcpy(message + header_length, samples + i * stride, sample_size);
+    message += message_length;
+  }
+  _data_write_cb(_batch_buffer.data(), static_cast<int>(_batch_buffer.size()));
+}
+void Writer::dataBatch(const DataBatch& batch, const unsigned* lengths)
+{
+  const auto& entries = batch.entries();
+  const size_t header_length = ULOG_MSG_HEADER_LEN + sizeof(uint16_t);
+  _batch_buffer.clear();
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const DataBatch::Entry& entry = entries[i];
+    const unsigned length = lengths ? lengths[i] : entry.length;
+    const uint8_t* sample = batch.data() + entry.offset;
+    if (length + sizeof(uint16_t) > std::numeric_limits<uint16_t>::max()) {
+      throw ParsingException("message too long");
+    }
+    if (_encode_data) {
+      // Encoders write on their own, so keep the order by writing out what is collected so far
+      if (!_batch_buffer.empty() && _encoders.count(entry.msg_id) > 0) {
+        _data_write_cb(_batch_buffer.data(), static_cast<int>(_batch_buffer.size()));
+        _batch_buffer.clear();
+      }
+      if (encodeSample(entry.msg_id, sample, length)) {
+        continue;
+      }
+    }
+    ulog_message_data_s header;
+    header.msg_size = length + sizeof(uint16_t);
+    header.msg_id = entry.msg_id;
+    const size_t offset = _batch_buffer.size();
+    _batch_buffer.resize(offset + header_length + length);
+    memcpy(_batch_buffer.data() + offset, &header, header_length);
+    memcpy(_batch_buffer.data() + offset + header_length, sample, length);
+  }
+  if (!_batch_buffer.empty()) {
+    _data_write_cb(_batch_buffer.data(), static_cast<int>(_batch_buffer.size()));
+  }
+}
 void Writer::dropout(const Dropout& dropout)
 {
+  flush();
   dropout.serialize(_data_write_cb);
 }
 void Writer::sync(const Sync& sync)
 {
+  flush();
   sync.serialize(_data_write_cb);
 }
+void Writer::flush()
+{
+  // Oldest block first, so the blocks are ordered by their first sample
+  for (const uint16_t msg_id : _pending_blocks) {
+    _encoders.at(msg_id).flush(_data_write_cb);
+  }
+  _pending_blocks.clear();
+}
 }  // namespace ulog_cpp
@@ -5,7 +5,9 @@
 
 #include "zz_data_log.hpp"
 
-#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
 
 std::shared_ptr<zz_data_log> zz_data_log::instance_ = nullptr;
 
@@ -15,6 +17,39 @@ const std::string zz_data_log::kFormatNameRegexStr = "[a-zA-Z0-9_\\-/]+";
 const std::regex zz_data_log::kFormatNameRegex = std::regex(std::string(kFormatNameRegexStr));
 const std::string zz_data_log::kFieldNameRegexStr = "[a-zA-Z0-9_]+";
 const std::regex zz_data_log::kFieldNameRegex = std::regex(std::string(kFieldNameRegexStr));
+const std::string zz_data_log::kStatsTopicName = "zz_data_log_stats";
+
+namespace {
+template <typename V>
+double readValue(const uint8_t* data) {
+    V value;
+    memcpy(&value, data, sizeof(value));
+    return static_cast<double>(value);
+}
+
+std::mutex g_instance_mutex;
+std::atomic<bool> g_instance_created{false};  ///< instance_ is only read once this is set
+
+std::mutex g_named_instances_mutex;
+std::unordered_map<std::string, std::shared_ptr<zz_data_log>> g_named_instances;
+
+using ReadValueFunction = double (*)(const uint8_t*);
+const std::unordered_map<std::string, ReadValueFunction> kReadValueFunctions{
+    {"int8_t", readValue<int8_t>},   {"uint8_t", readValue<uint8_t>},   {"int16_t", readValue<int16_t>},
+    {"uint16_t", readValue<uint16_t>}, {"int32_t", readValue<int32_t>},   {"uint32_t", readValue<uint32_t>},
+    {"int64_t", readValue<int64_t>},   {"uint64_t", readValue<uint64_t>}, {"float", readValue<float>},
+    {"double", readValue<double>},     {"bool", readValue<bool>},         {"char", readValue<char>},
+};
+}  // namespace
+
+std::string TopicPolicy::toString() const {
+    std::ostringstream stream;
+    stream << "max_rate_hz=" << max_rate_hz << " keep_every_nth=" << keep_every_nth;
+    if (!threshold_field.empty()) {
+        stream << " threshold=" << threshold_field << ":" << threshold;
+    }
+    return stream.str();
+}
 
 bool isValidFilename(const std::string& filename) {
     // 查找文件名中的最后一个'.'
@@ -33,67 +68,122 @@ void zz_data_log::CreateInstance(const std::string& filename, bool ZzDataLogOn)
     if (filename.empty()) {
         throw UsageException("Filename must not be empty.");
     }
+    std::lock_guard<std::mutex> lock(g_instance_mutex);
     if (!zz_data_log::instance_) {
         zz_data_log::instance_ = std::make_shared<zz_data_log>(filename);
     }
     instance_->ZzDataLogOn_ = ZzDataLogOn;
+    g_instance_created.store(true, std::memory_order_release);
     printf("Logger CreateInstance called.\n");
 }
 
-std::shared_ptr<zz_data_log> zz_data_log::GetInstance() {
-    static std::mutex instanceMutex;
-    std::lock_guard<std::mutex> lock(instanceMutex);
-
+void zz_data_log::CreateShmInstance(const ShmTransportConfig& config, bool ZzDataLogOn) {
+    std::lock_guard<std::mutex> lock(g_instance_mutex);
     if (!zz_data_log::instance_) {
+        zz_data_log::instance_ = std::make_shared<zz_data_log>(config);
+    }
+    instance_->ZzDataLogOn_ = ZzDataLogOn;
+    g_instance_created.store(true, std::memory_order_release);
+}
+
+std::shared_ptr<zz_data_log> zz_data_log::GetInstance() {
+    // instance_ is never reset once created, so no lock is needed
+    if (!g_instance_created.load(std::memory_order_acquire)) {
         throw UsageException("Logger not initialized, please CreateInstance() first.");
     }
     // printf("Logger GetInstance called.\n");
     return zz_data_log::instance_;
 }
 
+void zz_data_log::CreateNamedInstance(const std::string& name, std::shared_ptr<zz_data_log> logger) {
+    if (name.empty() || !logger) {
+        throw UsageException("Name and logger must not be empty.");
+    }
+    std::lock_guard<std::mutex> lock(g_named_instances_mutex);
+    if (!g_named_instances.emplace(name, std::move(logger)).second) {
+        throw UsageException("Duplicate logger name: " + name);
+    }
+}
+
+std::shared_ptr<zz_data_log> zz_data_log::GetNamedInstance(const std::string& name) {
+    std::lock_guard<std::mutex> lock(g_named_instances_mutex);
+    const auto iter = g_named_instances.find(name);
+    if (iter == g_named_instances.end()) {
+        throw UsageException("Logger not found: " + name);
+    }
+    return iter->second;
+}
+
+void zz_data_log::RemoveNamedInstance(const std::string& name) {
+    std::lock_guard<std::mutex> lock(g_named_instances_mutex);
+    g_named_instances.erase(name);
+}
+
 zz_data_log::zz_data_log(DataWriteCB data_write_cb, uint64_t timestamp_us)
-    : _writer(std::make_unique<Writer>(std::move(data_write_cb))) {
+    : _writer(std::make_unique<Writer>([this, data_write_cb](const uint8_t* data, int length) {
+          data_write_cb(data, length);
+          _stats.addBytes(length);
+      })) {
     _writer->fileHeader(FileHeader(timestamp_us));
 }
 
-zz_data_log::zz_data_log(const std::string& filename, uint64_t timestamp_us) {
-    _file = std::fopen(filename.c_str(), "wb");
-    if (!_file) {
-        throw ParsingException("Failed to open file");
+zz_data_log::zz_data_log(const std::string& filename, uint64_t timestamp_us, const FileSinkConfig& sink_config)
+    : _sink_config(sink_config) {
+    if (_sink_config.preallocate_size == 0) {
+        _sink_config.preallocate_size = kMaxFileSize;
     }
-
+    _file = createFileSink(filename, _sink_config);
     _writer =
-        std::make_unique<Writer>([this](const uint8_t* data, int length) { std::fwrite(data, 1, length, _file); });
+        std::make_unique<Writer>([this](const uint8_t* data, int length) { writeToFile(data, length); });
     _writer->fileHeader(FileHeader(timestamp_us));
 }
 
-zz_data_log::zz_data_log(const std::string& filename) {
+zz_data_log::zz_data_log(const std::string& filename, const FileSinkConfig& sink_config)
+    : _sink_config(sink_config) {
     if (!isValidFilename(filename)) {
         throw UsageException(
             "Invalid filename, please input a valid filename, test.ulg or test.1.ulg or /tmp/test.ulg or "
             "/tmp/test.1.ulg");
     }
     init_params_.file_name = filename;
-    _file = std::fopen(filename.c_str(), "wb");
-    if (!_file) {
-        throw ParsingException("Failed to open file");
+    if (_sink_config.preallocate_size == 0) {
+        _sink_config.preallocate_size = kMaxFileSize;
     }
+    _file = createFileSink(filename, _sink_config);
 
     _writer =
-        std::make_unique<Writer>([this](const uint8_t* data, int length) { std::fwrite(data, 1, length, _file); });
+        std::make_unique<Writer>([this](const uint8_t* data, int length) { writeToFile(data, length); });
+    _writer->fileHeader(FileHeader(currentTimeUs()));
+}
+
+zz_data_log::zz_data_log(const FlightRecorder::Config& config, const std::string& dump_filename)
+    : _flight_recorder(std::make_unique<FlightRecorder>(config)), _next_dump_filename(dump_filename) {
+    if (!isValidFilename(dump_filename)) {
+        throw UsageException("Invalid dump filename, e.g. crash.ulg or /tmp/crash.ulg");
+    }
+    _writer = std::make_unique<Writer>([this](const uint8_t* data, int length) {
+        _flight_recorder->write(data, length);
+        _stats.addBytes(length);
+    });
+    _writer->fileHeader(FileHeader(currentTimeUs()));
+}
+
+zz_data_log::zz_data_log(const ShmTransportConfig& config)
+    : _shm_producer(std::make_unique<ShmLogProducer>(config)) {
+    _writer = std::make_unique<Writer>([this](const uint8_t* data, int length) {
+        _shm_producer->write(data, length);
+        _stats.addBytes(length);
+    });
     _writer->fileHeader(FileHeader(currentTimeUs()));
 }
 
 zz_data_log::~zz_data_log() {
     _writer.reset();
-    if (_file) {
-        std::fclose(_file);
-    }
+    _file.reset();
+    _shm_producer.reset();
 }
 
 std::string zz_data_log::generateNewFilename(const std::string& filename) {
-    int version = 0;
-    std::cout << "generateNewFilename: " << filename << std::endl;
     if (filename.empty()) {
         throw UsageException("Filename must not be empty.");
     }
@@ -104,64 +194,32 @@ std::string zz_data_log::generateNewFilename(const std::string& filename) {
         return filename;
     }
 
-    // 找到版本号开始的点
-    size_t versionStartPos = filename.rfind('.', lastDotPos - 1);
-    if (versionStartPos == lastDotPos) {
-        version = 1;
-    } else {
-        // 提取版本号
+    // 找到版本号开始的点: "test.2.ulg" --> "2"; "test.ulg" 没有版本号
+    int version = 1;
+    size_t baseEndPos = lastDotPos;
+    size_t versionStartPos = lastDotPos == 0 ? std::string::npos : filename.rfind('.', lastDotPos - 1);
+    if (versionStartPos != std::string::npos) {
         std::string versionStr = filename.substr(versionStartPos + 1, lastDotPos - versionStartPos - 1);
-        std::cout << "versionStr: " << versionStr << std::endl;
-        version = std::stoi(versionStr);
-        ++version;
+        if (!versionStr.empty() && versionStr.size() < 9 &&
+            versionStr.find_first_not_of("0123456789") == std::string::npos) {
+            version = std::stoi(versionStr) + 1;
+            baseEndPos = versionStartPos;
+        }
     }
 
-    std::string newFilename = filename.substr(0, versionStartPos) + "." + std::to_string(version) + ".ulg";
-    return newFilename;
+    return filename.substr(0, baseEndPos) + "." + std::to_string(version) + filename.substr(lastDotPos);
 }
 
 std::string zz_data_log::generateNewPathOrFilename(const std::string& pathOrFilename) {
-    int version = 0;
-    std::cout << "generateNewPathOrFilename: " << pathOrFilename << std::endl;
     if (pathOrFilename.empty()) {
         throw UsageException("Path or filename must not be empty.");
     }
-    // 寻找最后一个斜杠的位置
+    // 寻找最后一个斜杠的位置, 只对文件名部分处理版本号
     size_t lastSlashPos = pathOrFilename.rfind('/');
     if (lastSlashPos == std::string::npos) {
-        // 如果找不到斜杠，直接进行文件名处理
         return generateNewFilename(pathOrFilename);
     }
-
-    // 从路径中提取文件名部分
-    std::string filename = pathOrFilename.substr(lastSlashPos + 1);
-
-    // 寻找文件名中的最后一个点的位置
-    size_t lastDotPos = filename.rfind('.');
-    if (lastDotPos == std::string::npos) {
-        // 如果找不到点，直接返回原始路径
-        return pathOrFilename;
-    }
-
-    // 找到版本号开始的点
-    size_t versionStartPos = filename.rfind('.', lastDotPos - 1);
-    if (versionStartPos == lastDotPos) {
-        version = 1;
-    } else {
-        // 提取版本号
-        std::string versionStr = filename.substr(versionStartPos + 1, lastDotPos - versionStartPos - 1);
-        std::cout << "versionStr: " << versionStr << std::endl;
-        version = std::stoi(versionStr);
-        // 递增版本号
-        ++version;
-    }
-
-    // 构建新的文件名
-    std::string newFilename = filename.substr(0, versionStartPos) + "." + std::to_string(version) + ".ulg";
-
-    // 构建新的路径
-    std::string newPath = pathOrFilename.substr(0, lastSlashPos + 1) + newFilename;
-    return newPath;
+    return pathOrFilename.substr(0, lastSlashPos + 1) + generateNewFilename(pathOrFilename.substr(lastSlashPos + 1));
 }
 
 void zz_data_log::writeMessageFormat(const std::string& name, const std::vector<Field>& fields) {
@@ -216,18 +274,375 @@ void zz_data_log::headerComplete() {
 }
 
 void zz_data_log::writeTextMessage(Logging::Level level, const std::string& message, uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Checked under the lock, rotation resets it
     if (!_header_complete) {
         throw UsageException("Header not yet complete");
     }
     _writer->logging({level, message, timestamp});
+    if (_flight_recorder && level <= Logging::Level::Error) {
+        dumpFlightRecorder();
+    }
+}
+
+uint16_t zz_data_log::registerTextFormatImpl(const std::string& arg_codes, const std::string& format) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (_text_formats.size() >= std::numeric_limits<uint16_t>::max()) {
+        throw UsageException("Too many text formats");
+    }
+    const uint16_t id = static_cast<uint16_t>(_text_formats.size());
+    _text_formats.push_back(deferredFormatInfo(id, arg_codes, format));
+    // Before Init() the formats are written by writeTextFormats()
+    if (_writer && _header_complete) {
+        _writer->messageInfo(_text_formats.back());
+    }
+    return id;
+}
+
+void zz_data_log::writeTextFormats() {
+    for (const MessageInfo& text_format : _text_formats) {
+        _writer->messageInfo(text_format);
+    }
+}
+
+std::string zz_data_log::triggerFlightRecorder() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!_flight_recorder) {
+        throw UsageException("Not in flight recorder mode");
+    }
+    return dumpFlightRecorder();
+}
+
+std::string zz_data_log::dumpFlightRecorder() {
+    const std::string filename = _next_dump_filename;
+    _next_dump_filename = generateNewPathOrFilename(filename);
+    _flight_recorder->dumpToFile(filename);
+    return filename;
 }
 
 void zz_data_log::fsync() {
     if (_file) {
-        fflush(_file);
-        ::fsync(fileno(_file));
+        const auto start = std::chrono::steady_clock::now();
+        _file->sync();
+        _stats.addFsync(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+std::unique_lock<std::mutex> zz_data_log::lockForWrite() {
+    const auto wait_start = std::chrono::steady_clock::now();
+    _stats.beginMutexWait();
+    std::unique_lock<std::mutex> lock(mutex_);
+    _stats.endMutexWait(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wait_start).count());
+    return lock;
+}
+
+void zz_data_log::writeSample(uint16_t id, const uint8_t* data, unsigned length) {
+    if (ZzDataLogOn_) {
+        writeDataImpl(id, data, length);
+        if (++_writes_since_fsync == 10) {
+            _writes_since_fsync = 0;
+            fsync();
+        }
+        writeStatsTopic();
+    } else {
+        _stats.addDropped();
+    }
+    if (_flight_recorder && FlightRecorder::consumeSignalTrigger()) {
+        dumpFlightRecorder();
     }
 }
+
+void zz_data_log::writeTopicSample(uint16_t id, const std::string& message_name, const uint8_t* data,
+                                   unsigned length) {
+    if (_has_topic_policies.load(std::memory_order_relaxed) && !acceptByPolicy(message_name, data, length)) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock = lockForWrite();
+    writeSample(id, data, length);
+}
+
+void zz_data_log::writeSamples(uint16_t id, const std::string& message_name, const uint8_t* data, unsigned length,
+                               size_t count) {
+    if (_has_topic_policies.load(std::memory_order_relaxed)) {
+        // Filtered samples split the batch into runs of accepted ones
+        size_t begin = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (!acceptByPolicy(message_name, data + i * length, length)) {
+                writeSampleRun(id, data + begin * length, length, i - begin);
+                begin = i + 1;
+            }
+        }
+        data += begin * length;
+        count -= begin;
+    }
+    writeSampleRun(id, data, length, count);
+}
+
+void zz_data_log::writeSampleRun(uint16_t id, const uint8_t* data, unsigned length, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    if (ZzDataLogOn_) {
+        writeDataBatchImpl(id, data, length, count);
+        _writes_since_fsync += count;
+        if (_writes_since_fsync >= 10) {
+            _writes_since_fsync = 0;
+            fsync();
+        }
+        writeStatsTopic();
+    } else {
+        _stats.addDropped(count);
+    }
+    if (_flight_recorder && FlightRecorder::consumeSignalTrigger()) {
+        dumpFlightRecorder();
+    }
+}
+
+void zz_data_log::WriteBatch(const DataBatch& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock = lockForWrite();
+    if (!ZzDataLogOn_) {
+        _stats.addDropped(batch.size());
+        return;
+    }
+    _batch_lengths.clear();
+    uint64_t total_length = 0;
+    for (const auto& entry : batch.entries()) {
+        _batch_lengths.push_back(validateData(entry.msg_id, entry.length));
+        total_length += entry.length;
+    }
+    if (_file && _currentFileSize + total_length >= kMaxFileSize) {
+        // The file is rotated within the batch, which writeDataImpl() handles per sample
+        for (const auto& entry : batch.entries()) {
+            writeDataImpl(entry.msg_id, batch.data() + entry.offset, entry.length);
+        }
+    } else {
+        _currentFileSize += total_length;
+        _writer->dataBatch(batch, _batch_lengths.data());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            _stats.addMessage(batch.entries()[i].msg_id, _batch_lengths[i] + ULOG_MSG_HEADER_LEN + sizeof(uint16_t));
+        }
+    }
+    _writes_since_fsync += batch.size();
+    if (_writes_since_fsync >= 10) {
+        _writes_since_fsync = 0;
+        fsync();
+    }
+    writeStatsTopic();
+    if (_flight_recorder && FlightRecorder::consumeSignalTrigger()) {
+        dumpFlightRecorder();
+    }
+}
+
+void zz_data_log::writeToFile(const uint8_t* data, int length) {
+    _file->write(data, length);
+    _stats.addBytes(length);
+}
+
+void zz_data_log::enableStatsTopic(uint64_t interval_us) {
+    if (_header_complete) {
+        throw UsageException("Header already complete");
+    }
+    _stats_topic_interval_us = std::max<uint64_t>(interval_us, 1);
+}
+
+void zz_data_log::setTopicPolicy(const std::string& message_name, const TopicPolicy& policy) {
+    if (policy.max_rate_hz < 0. || policy.keep_every_nth == 0 || policy.threshold < 0.) {
+        throw UsageException("Invalid policy for " + message_name);
+    }
+    auto filter = std::make_shared<TopicFilter>();
+    filter->policy = policy;
+    filter->min_interval_us = policy.max_rate_hz > 0. ? std::llround(1e6 / policy.max_rate_hz) : 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto id_iter = id_map_.find(message_name);
+        if (id_iter == id_map_.end()) {
+            throw UsageException("Unknown topic: " + message_name);
+        }
+        filter->msg_id = id_iter->second;
+
+        if (!policy.threshold_field.empty()) {
+            // Resolve "name" or "name[index]" to the offset within the sample
+            std::string field_name = policy.threshold_field;
+            int index = 0;
+            const auto bracket = field_name.find('[');
+            if (bracket != std::string::npos) {
+                index = std::stoi(field_name.substr(bracket + 1));
+                field_name.resize(bracket);
+            }
+            const auto struct_iter =
+                std::find_if(init_params_.all_structs.begin(), init_params_.all_structs.end(),
+                             [&](const StructInfo& info) { return info.messageNname == message_name; });
+            unsigned offset = 0;
+            bool found = false;
+            if (struct_iter != init_params_.all_structs.end()) {
+                for (const auto& field : struct_iter->fields) {
+                    const int size = Field::kBasicTypes.at(field.type);
+                    const int array_length = field.array_length <= 0 ? 1 : field.array_length;
+                    if (field.name == field_name) {
+                        if (index < 0 || index >= array_length) {
+                            throw UsageException("Invalid index: " + policy.threshold_field);
+                        }
+                        filter->threshold_offset = offset + index * size;
+                        filter->threshold_size = size;
+                        filter->read_threshold_value = kReadValueFunctions.at(field.type);
+                        found = true;
+                        break;
+                    }
+                    offset += size * array_length;
+                }
+            }
+            if (!found) {
+                throw UsageException("Unknown field: " + policy.threshold_field);
+            }
+        }
+        writePolicyInfo(message_name, policy.toString());
+    }
+    updateTopicFilters(message_name, std::move(filter));
+}
+
+void zz_data_log::clearTopicPolicy(const std::string& message_name) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writePolicyInfo(message_name, "none");
+    }
+    updateTopicFilters(message_name, nullptr);
+}
+
+void zz_data_log::updateTopicFilters(const std::string& message_name, std::shared_ptr<TopicFilter> filter) {
+    std::lock_guard<std::mutex> lock(_topic_filters_mutex);
+    const std::shared_ptr<const TopicFilterMap> current = std::atomic_load(&_topic_filters);
+    auto filters = current ? std::make_shared<TopicFilterMap>(*current) : std::make_shared<TopicFilterMap>();
+    if (filter) {
+        (*filters)[message_name] = std::move(filter);
+    } else {
+        filters->erase(message_name);
+    }
+    _has_topic_policies.store(!filters->empty(), std::memory_order_relaxed);
+    std::atomic_store(&_topic_filters, std::shared_ptr<const TopicFilterMap>(std::move(filters)));
+}
+
+void zz_data_log::writePolicyInfo(const std::string& message_name, const std::string& value) {
+    // Info messages are valid in the data section too
+    if (_writer) {
+        _writer->messageInfo(ulog_cpp::MessageInfo("zz_policy_" + message_name, value));
+    }
+}
+
+void zz_data_log::writePolicyInfos() {
+    const std::shared_ptr<const TopicFilterMap> filters = std::atomic_load(&_topic_filters);
+    if (!filters) {
+        return;
+    }
+    for (const auto& filter : *filters) {
+        writePolicyInfo(filter.first, filter.second->policy.toString());
+    }
+}
+
+bool zz_data_log::acceptByPolicy(const std::string& message_name, const uint8_t* data, unsigned length) {
+    const std::shared_ptr<const TopicFilterMap> filters = std::atomic_load(&_topic_filters);
+    if (!filters) {
+        return true;
+    }
+    const auto filter_iter = filters->find(message_name);
+    if (filter_iter == filters->end()) {
+        return true;
+    }
+    TopicFilter& filter = *filter_iter->second;
+
+    bool accept = true;
+    if (filter.policy.keep_every_nth > 1) {
+        accept = filter.counter.fetch_add(1, std::memory_order_relaxed) % filter.policy.keep_every_nth == 0;
+    }
+
+    double value = 0.;
+    if (accept && filter.read_threshold_value) {
+        if (filter.threshold_offset + filter.threshold_size > length) {
+            accept = false;
+        } else {
+            value = filter.read_threshold_value(data + filter.threshold_offset);
+            accept = !filter.has_last_value.load(std::memory_order_relaxed) ||
+                     std::fabs(value - filter.last_value.load(std::memory_order_relaxed)) > filter.policy.threshold;
+        }
+    }
+
+    if (accept && filter.min_interval_us > 0 && length >= sizeof(uint64_t)) {
+        uint64_t timestamp;  // first field
+        memcpy(&timestamp, data, sizeof(timestamp));
+        uint64_t last = filter.last_timestamp.load(std::memory_order_relaxed);
+        do {
+            if (last != 0 && timestamp < last + filter.min_interval_us) {
+                accept = false;
+                break;
+            }
+        } while (!filter.last_timestamp.compare_exchange_weak(last, timestamp, std::memory_order_relaxed));
+    }
+
+    if (accept && filter.read_threshold_value) {
+        filter.last_value.store(value, std::memory_order_relaxed);
+        filter.has_last_value.store(true, std::memory_order_relaxed);
+    }
+    if (!accept) {
+        _stats.addFiltered(filter.msg_id);
+    }
+    return accept;
+}
+
+void zz_data_log::writeStatsTopicFormat() {
+    if (_stats_topic_interval_us == 0) {
+        return;
+    }
+    writeMessageFormat(kStatsTopicName, {
+                                            {"uint64_t", "timestamp"},
+                                            {"uint64_t", "bytes_written"},
+                                            {"uint64_t", "messages_written"},
+                                            {"uint64_t", "dropped_writes"},
+                                            {"uint64_t", "rejected_writes"},
+                                            {"uint64_t", "rotations"},
+                                            {"uint64_t", "file_size"},
+                                            {"uint64_t", "fsync_count"},
+                                            {"uint64_t", "fsync_max_ns"},
+                                            {"uint64_t", "mutex_wait_max_ns"},
+                                            {"uint64_t", "max_waiting_writers"},
+                                        });
+}
+
+void zz_data_log::addStatsTopic() {
+    if (_stats_topic_interval_us == 0) {
+        return;
+    }
+    _stats_topic_msg_id = writeAddLoggedMessage(kStatsTopicName);
+    _stats_topic_last_us = 0;
+}
+
+void zz_data_log::writeStatsTopic() {
+    if (_stats_topic_interval_us == 0 || !_header_complete) {
+        return;
+    }
+    const uint64_t now = currentTimeUs();
+    if (_stats_topic_last_us != 0 && now - _stats_topic_last_us < _stats_topic_interval_us) {
+        return;
+    }
+    _stats_topic_last_us = now;
+    const DataLogStats stats = _stats.snapshot();
+    StatsTopicSample sample{};
+    sample.timestamp = now;
+    sample.bytes_written = stats.bytes_written;
+    sample.messages_written = stats.messages_written;
+    sample.dropped_writes = stats.dropped_writes;
+    sample.rejected_writes = stats.rejected_writes;
+    sample.rotations = stats.rotations;
+    sample.file_size = stats.file_size;
+    sample.fsync_count = stats.fsync.count;
+    sample.fsync_max_ns = stats.fsync.max_ns;
+    sample.mutex_wait_max_ns = stats.mutex_wait.max_ns;
+    sample.max_waiting_writers = stats.max_waiting_writers;
+    writeData(_stats_topic_msg_id, sample);
+}
 uint16_t zz_data_log::writeAddLoggedMessage(const std::string& message_format_name, uint8_t multi_id) {
     if (!_header_complete) {
         throw UsageException("Header not yet complete");
@@ -238,32 +653,54 @@ uint16_t zz_data_log::writeAddLoggedMessage(const std::string& message_format_na
         throw UsageException("Format not found: " + message_format_name);
     }
     _subscriptions.push_back({format_iter->second.message_size});
+    _stats.addTopic(msg_id, message_format_name);
     _writer->addLoggedMessage(AddLoggedMessage(multi_id, msg_id, message_format_name));
     return msg_id;
 }
 
-void zz_data_log::writeDataImpl(uint16_t id, const uint8_t* data, unsigned length) {
+unsigned zz_data_log::validateData(uint16_t id, unsigned length) {
     if (!_header_complete) {
         throw UsageException("Header not yet complete");
     }
     if (id >= _subscriptions.size()) {
+        _stats.addRejected();
         throw UsageException("Invalid ID");
     }
     const unsigned expected_size = _subscriptions[id].message_size;
     // Sanity check data size. sizeof(data) can be bigger because of struct padding at the end
     if (length < expected_size) {
+        _stats.addRejected();
         throw UsageException("sizeof(data) is too small");
     }
+    return expected_size;
+}
+
+void zz_data_log::writeDataBatchImpl(uint16_t id, const uint8_t* data, unsigned length, size_t count) {
+    const unsigned expected_size = validateData(id, length);
+    if (_file && _currentFileSize + length * count >= kMaxFileSize) {
+        // The file is rotated within the batch, which writeDataImpl() handles per sample
+        for (size_t i = 0; i < count; ++i) {
+            writeDataImpl(id, data + i * length, length);
+        }
+        return;
+    }
+    _currentFileSize += length * count;
+    _writer->dataBatch(id, data, expected_size, length, count);
+    _stats.addMessage(id, (expected_size + ULOG_MSG_HEADER_LEN + sizeof(uint16_t)) * count, count);
+}
+
+void zz_data_log::writeDataImpl(uint16_t id, const uint8_t* data, unsigned length) {
+    const unsigned expected_size = validateData(id, length);
     std::vector<uint8_t> data_vec;
     data_vec.resize(expected_size);
     memcpy(data_vec.data(), data, expected_size);
 
     _currentFileSize += length;
 
-    if (_currentFileSize >= kMaxFileSize) {
+    if (_file && _currentFileSize >= kMaxFileSize) {
         // 超过文件大小限制，关闭当前文件，生成新文件
         _writer.reset();
-        std::fclose(_file);
+        _file.reset();
 
         _header_complete = false;
         _subscriptions.clear();
@@ -273,15 +710,13 @@ void zz_data_log::writeDataImpl(uint16_t id, const uint8_t* data, unsigned lengt
         // 生成新文件名
         std::string newFilename = generateNewPathOrFilename(init_params_.file_name);
         init_params_.file_name = newFilename;
-        _file = std::fopen(newFilename.c_str(), "wb");
-        if (!_file) {
-            throw ParsingException("Failed to open file");
-        }
+        _file = createFileSink(newFilename, _sink_config);
 
         _currentFileSize = 0;
+        _stats.addRotation();
         // 创建新的 _writer
         _writer =
-            std::make_unique<Writer>([this](const uint8_t* data, int length) { std::fwrite(data, 1, length, _file); });
+            std::make_unique<Writer>([this](const uint8_t* data, int length) { writeToFile(data, length); });
         // 重新写入文件头
         _writer->fileHeader(FileHeader(currentTimeUs()));
         // 重新写入格式信息等
@@ -292,6 +727,7 @@ void zz_data_log::writeDataImpl(uint16_t id, const uint8_t* data, unsigned lengt
     }
 
     _writer->data(Data(id, std::move(data_vec)));
+    _stats.addMessage(id, expected_size + ULOG_MSG_HEADER_LEN + sizeof(uint16_t));
 }
 
 }  // namespace ulog_cpp
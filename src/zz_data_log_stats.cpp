@@ -0,0 +1,110 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+
+#include "zz_data_log_stats.hpp"
+
+#include <algorithm>
+
+namespace ulog_cpp {
+
+namespace {
+void updateMax(std::atomic<uint64_t>& max, uint64_t value) {
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+}  // namespace
+
+void LatencyHistogram::add(uint64_t value_ns) {
+    int bucket = 0;
+    while (bucket < kNumBuckets - 1 && value_ns >= (1ULL << bucket)) {
+        ++bucket;
+    }
+    _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _total_ns.fetch_add(value_ns, std::memory_order_relaxed);
+    updateMax(_max_ns, value_ns);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot snapshot;
+    for (int i = 0; i < kNumBuckets; ++i) {
+        snapshot.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = _count.load(std::memory_order_relaxed);
+    snapshot.total_ns = _total_ns.load(std::memory_order_relaxed);
+    snapshot.max_ns = _max_ns.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+uint64_t LatencyHistogram::Snapshot::percentileNs(double p) const {
+    uint64_t total = 0;
+    for (const uint64_t bucket : buckets) {
+        total += bucket;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const auto target = static_cast<uint64_t>(p * static_cast<double>(total - 1)) + 1;
+    uint64_t sum = 0;
+    for (int i = 0; i < kNumBuckets; ++i) {
+        sum += buckets[i];
+        if (sum >= target) {
+            return i == 0 ? 0 : std::min<uint64_t>(1ULL << i, max_ns);
+        }
+    }
+    return max_ns;
+}
+
+void DataLogStatsRegistry::addTopic(uint16_t msg_id, const std::string& name) {
+    std::lock_guard<std::mutex> lock(_topics_mutex);
+    while (_topics.size() <= msg_id) {
+        _topics.emplace_back();
+    }
+    _topics[msg_id].name = name;
+    _num_topics.store(_topics.size(), std::memory_order_release);
+}
+
+void DataLogStatsRegistry::beginMutexWait() {
+    const uint32_t waiting = _waiting_writers.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t current = _max_waiting_writers.load(std::memory_order_relaxed);
+    while (waiting > current &&
+           !_max_waiting_writers.compare_exchange_weak(current, waiting, std::memory_order_relaxed)) {
+    }
+}
+
+void DataLogStatsRegistry::endMutexWait(uint64_t duration_ns) {
+    _waiting_writers.fetch_sub(1, std::memory_order_relaxed);
+    _mutex_wait.add(duration_ns);
+}
+
+DataLogStats DataLogStatsRegistry::snapshot() const {
+    DataLogStats stats;
+    stats.bytes_written = _bytes_written.load(std::memory_order_relaxed);
+    stats.messages_written = _messages_written.load(std::memory_order_relaxed);
+    stats.dropped_writes = _dropped_writes.load(std::memory_order_relaxed);
+    stats.rejected_writes = _rejected_writes.load(std::memory_order_relaxed);
+    stats.filtered_writes = _filtered_writes.load(std::memory_order_relaxed);
+    stats.rotations = _rotations.load(std::memory_order_relaxed);
+    stats.file_size = _file_size.load(std::memory_order_relaxed);
+    stats.waiting_writers = _waiting_writers.load(std::memory_order_relaxed);
+    stats.max_waiting_writers = _max_waiting_writers.load(std::memory_order_relaxed);
+    stats.fsync = _fsync.snapshot();
+    stats.mutex_wait = _mutex_wait.snapshot();
+    std::lock_guard<std::mutex> lock(_topics_mutex);
+    for (size_t i = 0; i < _topics.size(); ++i) {
+        const TopicCounters& topic = _topics[i];
+        if (topic.name.empty()) {
+            continue;
+        }
+        stats.topics.push_back({topic.name, static_cast<uint16_t>(i),
+                                topic.messages.load(std::memory_order_relaxed),
+                                topic.bytes.load(std::memory_order_relaxed),
+                                topic.filtered.load(std::memory_order_relaxed)});
+    }
+    return stats;
+}
+
+}  // namespace ulog_cpp
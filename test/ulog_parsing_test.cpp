@@ -3,11 +3,27 @@
  * SPDX-License-Identifier: BSD-3-Clause
  ****************************************************************************/
 #include <doctest/doctest.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <thread>
 #include <ulog_cpp/data_container.hpp>
+#include <ulog_cpp/file_sink.hpp>
+#include <ulog_cpp/log_cursor.hpp>
+#include <ulog_cpp/log_filter.hpp>
+#include <ulog_cpp/log_follower.hpp>
+#include <ulog_cpp/log_merger.hpp>
+#include <ulog_cpp/log_recovery.hpp>
 #include <ulog_cpp/reader.hpp>
+#include <ulog_cpp/shm_log_daemon.hpp>
 #include <ulog_cpp/simple_writer.hpp>
+#include <ulog_cpp/socket_stream.hpp>
+#include <ulog_cpp/workload_generator.hpp>
 #include <ulog_cpp/writer.hpp>
 #include <vector>
 
@@ -356,4 +372,1683 @@ TEST_CASE("ULog parsing - simple writer")
   }
 }
 
+TEST_CASE("ULog parsing - encoded data")
+{
+  auto write_log = [](bool encode_data, std::vector<MyData>& written_data_messages) {
+    std::vector<uint8_t> written_data;
+    ulog_cpp::SimpleWriter writer(
+        [&](const uint8_t* data, int length) {
+          const int prev_size = written_data.size();
+          written_data.resize(written_data.size() + length);
+          memcpy(written_data.data() + prev_size, data, length);
+        },
+        0, encode_data);
+    writer.writeMessageFormat(MyData::messageName(), MyData::fields());
+    writer.headerComplete();
+    const uint16_t my_data_msg_id = writer.writeAddLoggedMessage(MyData::messageName());
+    writer.writeTextMessage(ulog_cpp::Logging::Level::Info, "Hello world", 0);
+
+    written_data_messages.clear();
+    float cpuload = 25.423F;
+    for (int i = 0; i < 1000; ++i) {
+      MyData data{};
+      data.timestamp = i * 1000 + (i % 7 == 0 ? 13 : 0);
+      data.cpuload = cpuload;
+      data.temperature = 40.F + static_cast<float>(i / 100);
+      data.debug_array[i % 4] = static_cast<float>(i);
+      data.counter = i;
+      writer.writeData(my_data_msg_id, data);
+      written_data_messages.push_back(data);
+      cpuload -= 0.0124F;
+    }
+    writer.fsync();
+    return written_data;
+  };
+
+  std::vector<MyData> written_data_messages;
+  const std::vector<uint8_t> plain_data = write_log(false, written_data_messages);
+  const std::vector<uint8_t> encoded_data = write_log(true, written_data_messages);
+  CHECK_LT(encoded_data.size() * 3, plain_data.size());
+
+  // Parse data, in chunks to check partial messages
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  const int chunk_size = 100;
+  for (unsigned offset = 0; offset < encoded_data.size(); offset += chunk_size) {
+    reader.readChunk(encoded_data.data() + offset,
+                     std::min<int>(chunk_size, encoded_data.size() - offset));
+  }
+
+  REQUIRE(data_container->parsingErrors().empty());
+  REQUIRE_FALSE(data_container->hadFatalError());
+  CHECK(data_container->fileHeader().flagBits().compat_flags[0] &
+        ULOG_COMPAT_FLAG0_ENCODED_DATA_MASK);
+  REQUIRE_EQ(data_container->logging().size(), 1);
+  REQUIRE_EQ(data_container->subscriptions().size(), 1);
+  const auto& data_array = data_container->subscriptions().begin()->second.data;
+  REQUIRE_EQ(data_array.size(), written_data_messages.size());
+  for (unsigned i = 0; i < data_array.size(); ++i) {
+    MyData data{};
+    REQUIRE_GE(sizeof(data), data_array[i].data().size());
+    memcpy(&data, data_array[i].data().data(), data_array[i].data().size());
+    CHECK_EQ(written_data_messages[i], data);
+  }
+
+  // Buffered samples are written before text messages and parameter changes
+  std::vector<uint8_t> mixed_data;
+  {
+    ulog_cpp::SimpleWriter writer(
+        [&](const uint8_t* data, int length) {
+          mixed_data.insert(mixed_data.end(), data, data + length);
+        },
+        0, true);
+    writer.writeParameter("PARAM_A", 1);
+    writer.writeMessageFormat(MyData::messageName(), MyData::fields());
+    writer.headerComplete();
+    const uint16_t my_data_msg_id = writer.writeAddLoggedMessage(MyData::messageName());
+    for (int i = 0; i < 250; ++i) {
+      MyData data{};
+      data.timestamp = i * 1000;
+      data.counter = i;
+      writer.writeData(my_data_msg_id, data);
+      if (i == 99) {
+        writer.writeTextMessage(ulog_cpp::Logging::Level::Info, "after 100", i * 1000);
+      } else if (i == 149) {
+        writer.writeParameterChange("PARAM_A", 2);
+      }
+    }
+  }
+  struct OrderHandler : public ulog_cpp::DataHandlerInterface {
+    void data(const ulog_cpp::Data& data) override { ++num_samples; }
+    void logging(const ulog_cpp::Logging& logging) override { logging_at = num_samples; }
+    void parameter(const ulog_cpp::Parameter& parameter) override
+    {
+      parameter_at = num_samples;
+    }
+    int num_samples{0};
+    int logging_at{-1};
+    int parameter_at{-1};
+  };
+  OrderHandler order_handler;
+  ulog_cpp::BasicReader<OrderHandler> order_reader{order_handler};
+  order_reader.readChunk(mixed_data.data(), mixed_data.size());
+  CHECK_EQ(order_handler.num_samples, 250);
+  CHECK_EQ(order_handler.logging_at, 100);
+  CHECK_EQ(order_handler.parameter_at, 150);
+
+  // Pending blocks of several topics are written in the order of their first sample
+  const auto block_order = [](const std::vector<int>& first_samples) {
+    std::vector<uint8_t> blocks_data;
+    {
+      ulog_cpp::SimpleWriter writer(
+          [&](const uint8_t* data, int length) {
+            blocks_data.insert(blocks_data.end(), data, data + length);
+          },
+          0, true);
+      writer.writeMessageFormat(MyData::messageName(), MyData::fields());
+      writer.headerComplete();
+      std::vector<uint16_t> msg_ids;
+      for (uint8_t multi_id = 0; multi_id < first_samples.size(); ++multi_id) {
+        msg_ids.push_back(writer.writeAddLoggedMessage(MyData::messageName(), multi_id));
+      }
+      for (int i = 0; i < 10; ++i) {
+        for (const int topic : first_samples) {
+          MyData data{};
+          data.timestamp = i * 1000 + topic;
+          writer.writeData(msg_ids[topic], data);
+        }
+      }
+      writer.writeTextMessage(ulog_cpp::Logging::Level::Info, "flush", 10'000);
+    }
+    struct BlockHandler : public ulog_cpp::DataHandlerInterface {
+      void rawMessage(const uint8_t* message, size_t length) override
+      {
+        if (message[2] == static_cast<uint8_t>(ulog_cpp::ULogMessageType::DATA_ENCODED)) {
+          uint16_t msg_id;
+          memcpy(&msg_id, message + ULOG_MSG_HEADER_LEN, sizeof(msg_id));
+          msg_ids.push_back(msg_id);
+        }
+      }
+      std::vector<int> msg_ids;
+    };
+    BlockHandler block_handler;
+    ulog_cpp::BasicReader<BlockHandler> block_reader{block_handler};
+    block_reader.setRawMode(true);
+    block_reader.readChunk(blocks_data.data(), blocks_data.size());
+    return block_handler.msg_ids;
+  };
+  const std::vector<int> in_id_order{0, 1, 2, 3};
+  const std::vector<int> mixed_order{3, 1, 0, 2};
+  CHECK(block_order(in_id_order) == in_id_order);
+  CHECK(block_order(mixed_order) == mixed_order);
+}
+
+TEST_CASE("ULog parsing - data container arena storage")
+{
+  ulog_cpp::ByteArena arena;
+  std::vector<std::pair<uint8_t*, size_t>> allocations;
+  for (size_t i = 0; i < 2000; ++i) {
+    const size_t size = i % 10 == 0 ? 3000 : (i % 97) + 1;
+    uint8_t* data = arena.allocate(size);
+    memset(data, static_cast<int>(i), size);
+    allocations.emplace_back(data, size);
+  }
+  for (size_t i = 0; i < allocations.size(); ++i) {
+    for (size_t k = 0; k < allocations[i].second; ++k) {
+      REQUIRE_EQ(allocations[i].first[k], static_cast<uint8_t>(i));
+    }
+  }
+  ulog_cpp::ByteArena moved_arena = std::move(arena);
+  CHECK_EQ(allocations[0].first[0], 0);
+  CHECK_LT(moved_arena.capacity(), 2 * 200 * 3000);
+
+  ulog_cpp::DataSamples samples;
+  const ulog_cpp::Data data1{3, {1, 2, 3}};
+  const ulog_cpp::Data data2{3, {4, 5}};
+  samples.append(data1);
+  samples.append(data2);
+  REQUIRE_EQ(samples.size(), 2);
+  CHECK_EQ(data1, samples[0]);
+  CHECK_EQ(data2, samples[1]);
+  CHECK_EQ(samples[1].data()[1], 5);
+  CHECK_FALSE(samples[0] == samples[1]);
+}
+
+TEST_CASE("ULog parsing - rvalue handler callbacks")
+{
+  std::vector<uint8_t> written_data;
+  ulog_cpp::Writer writer([&](const uint8_t* data, int length) {
+    written_data.insert(written_data.end(), data, data + length);
+  });
+  writer.fileHeader(ulog_cpp::FileHeader{});
+  writer.messageFormat(ulog_cpp::MessageFormat{"message_name", {{"uint64_t", "timestamp"}}});
+  writer.headerComplete();
+  writer.addLoggedMessage(ulog_cpp::AddLoggedMessage{0, 0, "message_name"});
+  writer.logging(ulog_cpp::Logging{ulog_cpp::Logging::Level::Warning, "logging message", 1});
+  writer.data(ulog_cpp::Data{0, std::vector<uint8_t>(8)});
+
+  // Only overrides the const& variants: called via the default rvalue implementations
+  struct ConstRefHandler : public ulog_cpp::DataHandlerInterface {
+    void messageFormat(const ulog_cpp::MessageFormat& message_format) override { ++num_calls; }
+    void logging(const ulog_cpp::Logging& logging) override { ++num_calls; }
+    void data(const ulog_cpp::Data& data) override { ++num_calls; }
+    int num_calls{0};
+  };
+  // Takes ownership of the parsed messages
+  struct RvalueHandler : public ulog_cpp::DataHandlerInterface {
+    void messageFormat(ulog_cpp::MessageFormat&& message_format) override
+    {
+      formats.push_back(std::move(message_format));
+    }
+    void logging(ulog_cpp::Logging&& logging) override { loggings.push_back(std::move(logging)); }
+    void data(ulog_cpp::Data&& data) override { datas.push_back(std::move(data)); }
+    std::vector<ulog_cpp::MessageFormat> formats;
+    std::vector<ulog_cpp::Logging> loggings;
+    std::vector<ulog_cpp::Data> datas;
+  };
+
+  const auto const_ref_handler = std::make_shared<ConstRefHandler>();
+  ulog_cpp::Reader const_ref_reader{const_ref_handler};
+  const_ref_reader.readChunk(written_data.data(), written_data.size());
+  CHECK_EQ(const_ref_handler->num_calls, 3);
+
+  const auto rvalue_handler = std::make_shared<RvalueHandler>();
+  ulog_cpp::Reader rvalue_reader{rvalue_handler};
+  rvalue_reader.readChunk(written_data.data(), written_data.size());
+  REQUIRE_EQ(rvalue_handler->formats.size(), 1);
+  CHECK_EQ(rvalue_handler->formats[0].name(), "message_name");
+  REQUIRE_EQ(rvalue_handler->loggings.size(), 1);
+  CHECK_EQ(rvalue_handler->loggings[0].message(), "logging message");
+  CHECK_EQ(rvalue_handler->datas.size(), 1);
+}
+
+TEST_CASE("ULog parsing - compile-time handler")
+{
+  std::vector<uint8_t> written_data;
+  ulog_cpp::Writer writer([&](const uint8_t* data, int length) {
+    written_data.insert(written_data.end(), data, data + length);
+  });
+  writer.fileHeader(ulog_cpp::FileHeader{});
+  writer.messageFormat(ulog_cpp::MessageFormat{"message_name", {{"uint64_t", "timestamp"}}});
+  writer.headerComplete();
+  writer.addLoggedMessage(ulog_cpp::AddLoggedMessage{0, 0, "message_name"});
+  for (int i = 0; i < 100; ++i) {
+    writer.data(ulog_cpp::Data{0, std::vector<uint8_t>(8, i)});
+  }
+
+  // Final handler: the reader calls it directly, without virtual dispatch
+  struct CountingHandler final : public ulog_cpp::DataHandlerInterface {
+    void data(const ulog_cpp::Data& data) override { num_bytes += data.data().size(); }
+    void error(const std::string& msg, bool is_recoverable) override { ++num_errors; }
+    size_t num_bytes{0};
+    int num_errors{0};
+  };
+
+  CountingHandler handler;
+  ulog_cpp::BasicReader<CountingHandler> reader{handler};
+  for (size_t i = 0; i < written_data.size(); i += 100) {
+    reader.readChunk(written_data.data() + i, std::min<size_t>(100, written_data.size() - i));
+  }
+  CHECK_EQ(handler.num_bytes, 800);
+  CHECK_EQ(handler.num_errors, 0);
+
+  // Same result with the virtual interface
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader virtual_reader{data_container};
+  virtual_reader.readChunk(written_data.data(), written_data.size());
+  CHECK_EQ(data_container->subscriptions().at(0).data.size(), 100);
+}
+
+TEST_CASE("ULog parsing - stop after header")
+{
+  std::vector<uint8_t> written_data;
+  ulog_cpp::Writer writer([&](const uint8_t* data, int length) {
+    written_data.insert(written_data.end(), data, data + length);
+  });
+  writer.fileHeader(ulog_cpp::FileHeader{});
+  writer.messageInfo(ulog_cpp::MessageInfo{"sys_name", "test"});
+  writer.messageFormat(ulog_cpp::MessageFormat{"message_name", {{"uint64_t", "timestamp"}}});
+  writer.parameter(ulog_cpp::Parameter{"PARAM_A", 3});
+  writer.headerComplete();
+  writer.addLoggedMessage(ulog_cpp::AddLoggedMessage{0, 0, "message_name"});
+  for (uint64_t i = 0; i < 1000; ++i) {
+    writer.data(ulog_cpp::Data{0, std::vector<uint8_t>(reinterpret_cast<const uint8_t*>(&i),
+                                                        reinterpret_cast<const uint8_t*>(&i + 1))});
+  }
+  writer.logging(ulog_cpp::Logging{ulog_cpp::Logging::Level::Info, "last message", 999});
+
+  struct MetadataHandler final : public ulog_cpp::DataHandlerInterface {
+    void headerComplete() override { ++num_header_complete; }
+    void messageInfo(const ulog_cpp::MessageInfo& message_info) override { ++num_infos; }
+    void parameter(const ulog_cpp::Parameter& parameter) override { ++num_parameters; }
+    void addLoggedMessage(const ulog_cpp::AddLoggedMessage& add_logged_message) override
+    {
+      ++num_subscriptions;
+    }
+    void logging(const ulog_cpp::Logging& logging) override { loggings.push_back(logging); }
+    void data(const ulog_cpp::Data& data) override
+    {
+      memcpy(&last_timestamp, data.data().data(), sizeof(last_timestamp));
+      ++num_data;
+    }
+    void error(const std::string& msg, bool is_recoverable) override { ++num_errors; }
+    int num_header_complete{0};
+    int num_infos{0};
+    int num_parameters{0};
+    int num_subscriptions{0};
+    int num_data{0};
+    int num_errors{0};
+    uint64_t last_timestamp{0};
+    std::vector<ulog_cpp::Logging> loggings;
+  };
+
+  MetadataHandler handler;
+  ulog_cpp::BasicReader<MetadataHandler> reader{handler};
+  reader.setStopAfterHeader(true);
+  CHECK_THROWS_AS(reader.readTail(written_data.data(), 100, 0), ulog_cpp::UsageException);
+  // Small chunks, so the header ends within a chunk
+  size_t offset = 0;
+  while (offset < written_data.size() && !reader.stopped()) {
+    const size_t length = std::min<size_t>(64, written_data.size() - offset);
+    reader.readChunk(written_data.data() + offset, length);
+    offset += length;
+  }
+  CHECK(reader.stopped());
+  CHECK_LT(offset, 512);
+  CHECK_EQ(handler.num_header_complete, 1);
+  CHECK_EQ(handler.num_infos, 1);
+  CHECK_EQ(handler.num_parameters, 1);
+  CHECK_EQ(handler.num_subscriptions, 0);
+  CHECK_EQ(handler.num_data, 0);
+  reader.readChunk(written_data.data() + offset, written_data.size() - offset);
+  CHECK_EQ(handler.num_data, 0);
+
+  // The tail starts in the middle of a message
+  const int tail_length = 1000;
+  const int tail_start = static_cast<int>(written_data.size()) - tail_length;
+  CHECK_LT(reader.dataSectionOffset(), tail_start);
+  const int64_t skipped =
+      reader.readTail(written_data.data() + tail_start, tail_length, tail_start);
+  CHECK_GT(skipped, 0);
+  CHECK_EQ(handler.num_errors, 0);
+  CHECK_EQ(handler.last_timestamp, 999);
+  // DATA messages of 13 bytes, followed by the logging message of 24 bytes
+  CHECK_EQ((tail_length - skipped - 24) % 13, 0);
+  CHECK_EQ(handler.num_data, (tail_length - skipped - 24) / 13);
+  REQUIRE_EQ(handler.loggings.size(), 1);
+  CHECK_EQ(handler.loggings[0].message(), "last message");
+  CHECK(reader.stopped());
+
+  // The last message is cut off (e.g. after a crash): the messages before it are still read
+  const int num_data = handler.num_data;
+  const int cut_off = 10;
+  const int64_t cut_off_skipped =
+      reader.readTail(written_data.data() + tail_start, tail_length - cut_off, tail_start);
+  CHECK_EQ(cut_off_skipped, skipped);
+  CHECK_EQ(handler.num_data - num_data, (tail_length - skipped - 24) / 13);
+  CHECK_EQ(handler.loggings.size(), 1);
+  CHECK_EQ(handler.num_errors, 0);
+  CHECK(reader.stopped());
+}
+
+TEST_CASE("ULog parsing - message offsets")
+{
+  std::vector<uint8_t> written_data;
+  ulog_cpp::Writer writer([&](const uint8_t* data, int length) {
+    written_data.insert(written_data.end(), data, data + length);
+  });
+  writer.fileHeader(ulog_cpp::FileHeader{});
+  writer.messageFormat(ulog_cpp::MessageFormat{"message_name", {{"uint64_t", "timestamp"}}});
+  writer.headerComplete();
+  writer.addLoggedMessage(ulog_cpp::AddLoggedMessage{0, 0, "message_name"});
+  for (int i = 0; i < 50; ++i) {
+    writer.data(ulog_cpp::Data{0, std::vector<uint8_t>(8, i)});
+    writer.logging(ulog_cpp::Logging{ulog_cpp::Logging::Level::Info, std::string(i + 1, 'x'), 0});
+  }
+
+  struct OffsetHandler final : public ulog_cpp::DataHandlerInterface {
+    void data(const ulog_cpp::Data& data) override { offsets.push_back(reader->messageOffset()); }
+    void logging(const ulog_cpp::Logging& logging) override
+    {
+      offsets.push_back(reader->messageOffset());
+    }
+    void error(const std::string& msg, bool is_recoverable) override { errors.push_back(msg); }
+    const ulog_cpp::BasicReader<OffsetHandler>* reader{nullptr};
+    std::vector<uint64_t> offsets;
+    std::vector<std::string> errors;
+  };
+
+  // Whole buffer, and chunks that split messages (partial buffer). The file header is passed in
+  // one piece.
+  for (const size_t chunk_size : {written_data.size(), size_t{7}}) {
+    OffsetHandler handler;
+    ulog_cpp::BasicReader<OffsetHandler> reader{handler};
+    handler.reader = &reader;
+    size_t offset = 0;
+    while (offset < written_data.size()) {
+      const size_t length =
+          std::min(offset == 0 ? std::max<size_t>(chunk_size, 64) : chunk_size,
+                   written_data.size() - offset);
+      reader.readChunk(written_data.data() + offset, length);
+      offset += length;
+    }
+    CHECK(handler.errors.empty());
+    REQUIRE_EQ(handler.offsets.size(), 100);
+    for (size_t i = 0; i < handler.offsets.size(); ++i) {
+      const uint8_t expected_type = i % 2 == 0 ? 'D' : 'L';
+      CHECK_EQ(written_data[handler.offsets[i] + 2], expected_type);
+    }
+    // The data section starts with the AddLoggedMessage
+    CHECK_EQ(reader.dataSectionOffset(), handler.offsets[0] - (3 + 1 + 2 + 12));
+  }
+
+  // The corruption position is reported
+  const uint64_t corrupted_offset = written_data.size() / 2;
+  std::vector<uint8_t> corrupted_data = written_data;
+  OffsetHandler handler;
+  ulog_cpp::BasicReader<OffsetHandler> reader{handler};
+  handler.reader = &reader;
+  reader.readChunk(written_data.data(), written_data.size());
+  const uint64_t message_offset = *std::lower_bound(handler.offsets.begin(), handler.offsets.end(),
+                                                    corrupted_offset);
+  corrupted_data[message_offset + 2] = 0;
+  OffsetHandler corrupted_handler;
+  ulog_cpp::BasicReader<OffsetHandler> corrupted_reader{corrupted_handler};
+  corrupted_handler.reader = &corrupted_reader;
+  corrupted_reader.readChunk(corrupted_data.data(), corrupted_data.size());
+  REQUIRE_EQ(corrupted_handler.errors.size(), 1);
+  CHECK_EQ(corrupted_handler.errors[0],
+           "Message corruption detected at offset " + std::to_string(message_offset));
+}
+
+TEST_CASE("ULog parsing - raw passthrough and filter")
+{
+  struct Sample {
+    uint64_t timestamp;
+    float value;
+    uint32_t counter;
+  };
+  std::vector<uint8_t> written_data;
+  ulog_cpp::SimpleWriter writer(
+      [&](const uint8_t* data, int length) {
+        written_data.insert(written_data.end(), data, data + length);
+      },
+      0);
+  writer.writeInfo("sys_name", "raw test");
+  const std::vector<ulog_cpp::Field> fields{
+      {"uint64_t", "timestamp"}, {"float", "value"}, {"uint32_t", "counter"}};
+  writer.writeMessageFormat("topic_a", fields);
+  writer.writeMessageFormat("topic_b", fields);
+  writer.headerComplete();
+  const uint16_t id_a = writer.writeAddLoggedMessage("topic_a");
+  const uint16_t id_b = writer.writeAddLoggedMessage("topic_b");
+  for (uint32_t i = 0; i < 100; ++i) {
+    writer.writeData(id_a, Sample{i * 1000ULL, 0.5F, i});
+    writer.writeData(id_b, Sample{i * 1000ULL + 1, 1.5F, i});
+    if (i % 10 == 0) {
+      writer.writeTextMessage(ulog_cpp::Logging::Level::Info, "text", i * 1000ULL);
+    }
+  }
+
+  // Reader in raw mode to a writer copies the log unchanged
+  {
+    std::vector<uint8_t> copied_data;
+    ulog_cpp::Writer copy_writer([&](const uint8_t* data, int length) {
+      copied_data.insert(copied_data.end(), data, data + length);
+    });
+    ulog_cpp::BasicReader<ulog_cpp::Writer> reader{copy_writer};
+    reader.setRawMode(true);
+    reader.readChunk(written_data.data(), written_data.size());
+    CHECK(copied_data == written_data);
+  }
+
+  const auto filter = [&](const ulog_cpp::LogFilterConfig& config) {
+    std::vector<uint8_t> filtered_data;
+    ulog_cpp::LogFilter log_filter(
+        [&](const uint8_t* data, int length) {
+          filtered_data.insert(filtered_data.end(), data, data + length);
+        },
+        config);
+    ulog_cpp::BasicReader<ulog_cpp::LogFilter> reader{log_filter};
+    reader.setRawMode(true);
+    for (size_t i = 0; i < written_data.size(); i += 100) {
+      reader.readChunk(written_data.data() + i, std::min<size_t>(100, written_data.size() - i));
+    }
+    CHECK(log_filter.errors().empty());
+    CHECK_EQ(log_filter.stats().bytes_out + 16 + 43, filtered_data.size());
+    const auto data_container =
+        std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+    ulog_cpp::Reader data_reader{data_container};
+    data_reader.readChunk(filtered_data.data(), filtered_data.size());
+    CHECK(data_container->parsingErrors().empty());
+    return data_container;
+  };
+
+  ulog_cpp::LogFilterConfig config;
+  config.topics = {"topic_b"};
+  auto data_container = filter(config);
+  CHECK_EQ(data_container->subscriptions().size(), 1);
+  CHECK_EQ(data_container->subscriptions().at(id_b).data.size(), 100);
+  CHECK_EQ(data_container->logging().size(), 10);
+  CHECK_EQ(data_container->messageInfo().at("sys_name").value().data(),
+           ulog_cpp::Value::ValueType{std::string("raw test")});
+
+  config = {};
+  config.exclude_topics = {"topic_b"};
+  config.start_timestamp = 20'000;
+  config.end_timestamp = 49'999;
+  config.drop_text = true;
+  data_container = filter(config);
+  CHECK_EQ(data_container->subscriptions().size(), 1);
+  const auto& samples = data_container->subscriptions().at(id_a).data;
+  REQUIRE_EQ(samples.size(), 30);
+  Sample sample;
+  memcpy(&sample, samples[0].data().data(), sizeof(sample));
+  CHECK_EQ(sample.counter, 20);
+  CHECK(data_container->logging().empty());
+
+  // Truncated messages without msg_id are dropped
+  ulog_cpp::LogFilter truncated_filter([](const uint8_t* data, int length) {}, {});
+  const uint8_t truncated_data[] = {1, 0, static_cast<uint8_t>(ulog_cpp::ULogMessageType::DATA), 0};
+  truncated_filter.rawMessage(truncated_data, sizeof(truncated_data));
+  CHECK_EQ(truncated_filter.stats().messages_in, 1);
+  CHECK_EQ(truncated_filter.stats().messages_out, 0);
+}
+
+TEST_CASE("ULog parsing - merge logs")
+{
+  struct Sample {
+    uint64_t timestamp;
+    uint32_t counter;
+  };
+  const std::vector<ulog_cpp::Field> fields{{"uint64_t", "timestamp"}, {"uint32_t", "counter"}};
+  const auto temp_directory = std::filesystem::temp_directory_path();
+  std::vector<std::string> filenames;
+  for (uint32_t process = 0; process < 3; ++process) {
+    filenames.push_back((temp_directory / ("merge_test_" + std::to_string(process) + ".ulg")));
+    ulog_cpp::SimpleWriter writer(filenames.back(), process);
+    writer.writeInfo("sys_name", "process " + std::to_string(process));
+    writer.writeMessageFormat("shared", fields);
+    writer.writeMessageFormat("own_" + std::to_string(process), fields);
+    const auto text = writer.registerTextFormat<uint32_t>(ulog_cpp::Logging::Level::Info,
+                                                          "process %u: " + std::to_string(process));
+    writer.headerComplete();
+    const uint16_t shared_id = writer.writeAddLoggedMessage("shared");
+    const uint16_t own_id = writer.writeAddLoggedMessage("own_" + std::to_string(process));
+    // Interleaved timestamps
+    for (uint32_t i = 0; i < 2000; ++i) {
+      writer.writeData(shared_id, Sample{i * 10ULL + process, i});
+      writer.writeData(own_id, Sample{i * 10ULL + process, i});
+    }
+    writer.writeDeferredText(text, 50'000 + process, process);
+  }
+
+  std::vector<uint8_t> merged_data;
+  ulog_cpp::LogMergerConfig config;
+  config.read_ahead_bytes = 1024;  // the reading threads have to wait
+  ulog_cpp::LogMerger merger(filenames, config);
+  merger.merge([&](const uint8_t* data, int length) {
+    merged_data.insert(merged_data.end(), data, data + length);
+  });
+  CHECK(merger.errors().empty());
+  CHECK_EQ(merger.stats().subscriptions, 6);
+
+  // Data is ordered by time
+  struct DataOrder : public ulog_cpp::DataHandlerInterface {
+    void data(const ulog_cpp::Data& data) override
+    {
+      uint64_t timestamp;
+      memcpy(&timestamp, data.data().data(), sizeof(timestamp));
+      sorted = sorted && timestamp >= last_timestamp;
+      last_timestamp = timestamp;
+      ++num_samples;
+    }
+    bool sorted{true};
+    uint64_t last_timestamp{0};
+    int num_samples{0};
+  } data_order;
+  ulog_cpp::BasicReader<DataOrder> order_reader{data_order};
+  order_reader.readChunk(merged_data.data(), merged_data.size());
+  CHECK(data_order.sorted);
+  CHECK_EQ(data_order.num_samples, 3 * 2 * 2000);
+
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  reader.readChunk(merged_data.data(), merged_data.size());
+  CHECK(data_container->parsingErrors().empty());
+  CHECK_EQ(data_container->messageFormats().size(), 4);
+  // The first input wins
+  CHECK_EQ(data_container->messageInfo().at("sys_name").value().data(),
+           ulog_cpp::Value::ValueType{std::string("process 0")});
+  std::set<int> shared_multi_ids;
+  for (const auto& subscription_iter : data_container->subscriptions()) {
+    const auto& subscription = subscription_iter.second;
+    REQUIRE_EQ(subscription.data.size(), 2000);
+    if (subscription.add_logged_message.messageName() == "shared") {
+      shared_multi_ids.insert(subscription.add_logged_message.multiId());
+    }
+    Sample sample;
+    memcpy(&sample, subscription.data[1999].data().data(), sizeof(sample));
+    CHECK_EQ(sample.counter, 1999);
+  }
+  CHECK(shared_multi_ids == std::set<int>({0, 1, 2}));
+
+  // Text formats of all inputs are kept apart
+  const auto& texts = data_container->deferredLogging();
+  REQUIRE_EQ(texts.size(), 3);
+  for (uint32_t process = 0; process < 3; ++process) {
+    CHECK_EQ(data_container->deferredFormatter().format(texts[process]),
+             "process " + std::to_string(process) + ": " + std::to_string(process));
+  }
+
+  // A format defined differently is an error, before anything is written
+  {
+    ulog_cpp::SimpleWriter writer(filenames[2], 0);
+    writer.writeMessageFormat("shared", {{"uint64_t", "timestamp"}, {"float", "counter"}});
+    writer.headerComplete();
+  }
+  ulog_cpp::LogMerger conflicting_merger(filenames);
+  bool written = false;
+  CHECK_THROWS_AS(
+      conflicting_merger.merge([&](const uint8_t* data, int length) { written = true; }),
+      ulog_cpp::ParsingException);
+  CHECK_FALSE(written);
+
+  for (const auto& filename : filenames) {
+    std::filesystem::remove(filename);
+  }
+}
+
+TEST_CASE("ULog writing - combiner id reuse")
+{
+  // Inputs coming and going (e.g. restarting producers of a ShmLogDaemon) with more subscriptions
+  // in total than there are msg_ids
+  std::vector<uint8_t> header_data;
+  {
+    ulog_cpp::SimpleWriter writer(
+        [&](const uint8_t* data, int length) {
+          header_data.insert(header_data.end(), data, data + length);
+        },
+        0);
+    writer.writeMessageFormat("topic", {{"uint64_t", "timestamp"}});
+    writer.registerTextFormat<uint32_t>(ulog_cpp::Logging::Level::Info, "count %u");
+    writer.headerComplete();
+  }
+  auto header =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::Header);
+  ulog_cpp::Reader{header}.readChunk(header_data.data(), header_data.size());
+
+  ulog_cpp::LogCombiner combiner;
+  combiner.addInput(*header);  // stays
+  std::vector<std::vector<uint8_t>> files;
+  std::unique_ptr<ulog_cpp::Writer> writer;
+  const auto new_file = [&]() {
+    files.emplace_back();
+    writer = std::make_unique<ulog_cpp::Writer>([&files](const uint8_t* data, int length) {
+      files.back().insert(files.back().end(), data, data + length);
+    });
+    combiner.writeHeader(*writer, 0);
+  };
+  new_file();
+
+  const int num_inputs = 700;
+  const int subscriptions_per_input = 100;
+  for (int i = 0; i < num_inputs; ++i) {
+    const size_t input = combiner.addInput(*header);
+    for (int msg_id = 0; msg_id < subscriptions_per_input; ++msg_id) {
+      std::vector<uint8_t> message;
+      ulog_cpp::AddLoggedMessage(0, static_cast<uint16_t>(msg_id), "topic")
+          .serialize([&](const uint8_t* data, int length) {
+            message.insert(message.end(), data, data + length);
+          });
+      combiner.writeMessage(input, message.data(), message.size(), *writer);
+    }
+    combiner.removeInput(input);
+    if (combiner.idsRunningOut()) {
+      new_file();
+    }
+  }
+  CHECK_EQ(combiner.stats().subscriptions, num_inputs * subscriptions_per_input);
+  REQUIRE_EQ(files.size(), 2);
+
+  size_t num_subscriptions = 0;
+  for (const auto& file : files) {
+    auto data_container =
+        std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+    ulog_cpp::Reader{data_container}.readChunk(file.data(), file.size());
+    CHECK(data_container->parsingErrors().empty());
+    num_subscriptions += data_container->subscriptions().size();
+    // Only the text format of the remaining input, those of removed inputs are not carried over
+    REQUIRE_EQ(data_container->messageInfoMulti().count(ulog_cpp::kDeferredFormatInfoKey), 1);
+    CHECK_EQ(data_container->messageInfoMulti().at(ulog_cpp::kDeferredFormatInfoKey).size(), 1);
+  }
+  CHECK_EQ(num_subscriptions, num_inputs * subscriptions_per_input);
+}
+
+TEST_CASE("ULog writing - message splitter")
+{
+  struct Sample {
+    uint64_t timestamp;
+    uint32_t counter;
+  };
+  std::vector<uint8_t> log_data;
+  {
+    ulog_cpp::SimpleWriter writer(
+        [&](const uint8_t* data, int length) {
+          log_data.insert(log_data.end(), data, data + length);
+        },
+        0);
+    writer.writeMessageFormat("topic", {{"uint64_t", "timestamp"}, {"uint32_t", "counter"}});
+    writer.headerComplete();
+    const uint16_t msg_id = writer.writeAddLoggedMessage("topic");
+    for (uint32_t i = 0; i < 100; ++i) {
+      writer.writeData(msg_id, Sample{i, i});
+    }
+  }
+
+  // Any split of the data gives the same file header and messages
+  const auto split = [&](size_t piece_size) {
+    ulog_cpp::MessageSplitter splitter;
+    std::vector<uint8_t> file_header;
+    std::vector<std::vector<uint8_t>> messages;
+    for (size_t offset = 0; offset < log_data.size(); offset += piece_size) {
+      splitter.write(
+          log_data.data() + offset, std::min(piece_size, log_data.size() - offset),
+          [&](const uint8_t* data, size_t length) { file_header.assign(data, data + length); },
+          [&](const uint8_t* data, size_t length) { messages.emplace_back(data, data + length); });
+    }
+    return std::make_pair(file_header, messages);
+  };
+  const auto whole = split(log_data.size());
+  CHECK_EQ(whole.first.size(), sizeof(ulog_cpp::ulog_file_header_s));
+  CHECK_GT(whole.second.size(), 100);
+  for (const size_t piece_size : {1, 2, 7, 100}) {
+    CHECK(split(piece_size) == whole);
+  }
+
+  // Encoded blocks are self-contained
+  CHECK(ulog_cpp::isDroppable(ulog_cpp::ULogMessageType::DATA_ENCODED));
+  CHECK_FALSE(ulog_cpp::isDroppable(ulog_cpp::ULogMessageType::ADD_LOGGED_MSG));
+}
+
+TEST_CASE("ULog writing - shared memory daemon")
+{
+  struct Sample {
+    uint64_t timestamp;
+    uint32_t counter;
+  };
+  const std::vector<ulog_cpp::Field> fields{{"uint64_t", "timestamp"}, {"uint32_t", "counter"}};
+  ulog_cpp::ShmTransportConfig transport_config;
+  transport_config.name = "/ulog_shm_test_" + std::to_string(getpid());
+  transport_config.ring_size = 64 * 1024;
+  const auto temp_directory = std::filesystem::temp_directory_path();
+  ulog_cpp::ShmLogDaemon::Config config;
+  config.filename = temp_directory / "shm_test.ulg";
+  config.startup_wait_ms = 60'000;
+
+  // A producer process with its own ids: msg_ids, multi_ids and text format ids all start at 0
+  struct Process {
+    Process(const ulog_cpp::ShmTransportConfig& transport_config,
+            const std::vector<ulog_cpp::Field>& fields, uint32_t index)
+        : producer(transport_config),
+          writer([this](const uint8_t* data, int length) { producer.write(data, length); }, 0)
+    {
+      writer.writeMessageFormat("shared", fields);
+      writer.writeMessageFormat("own_" + std::to_string(index), fields);
+      text = writer.registerTextFormat<uint32_t>(ulog_cpp::Logging::Level::Info,
+                                                 "process %u: " + std::to_string(index));
+      writer.headerComplete();
+      shared_id = writer.writeAddLoggedMessage("shared");
+      own_id = writer.writeAddLoggedMessage("own_" + std::to_string(index));
+    }
+    void writeSamples(uint64_t first_timestamp, uint32_t count)
+    {
+      for (uint32_t i = 0; i < count; ++i) {
+        writer.writeData(shared_id, Sample{first_timestamp + i * 10ULL, i});
+        writer.writeData(own_id, Sample{first_timestamp + i * 10ULL, i});
+      }
+    }
+    ulog_cpp::ShmLogProducer producer;
+    ulog_cpp::SimpleWriter writer;
+    ulog_cpp::DeferredFormat<uint32_t> text;
+    uint16_t shared_id;
+    uint16_t own_id;
+  };
+
+  CHECK_THROWS_AS(ulog_cpp::ShmLogProducer{transport_config}, ulog_cpp::ParsingException);
+  auto daemon = std::make_unique<ulog_cpp::ShmLogDaemon>(transport_config, config);
+
+  auto process0 = std::make_unique<Process>(transport_config, fields, 0);
+  auto process1 = std::make_unique<Process>(transport_config, fields, 1);
+  process0->writeSamples(0, 1000);
+  process1->writeSamples(5, 1000);
+  process0->writer.writeDeferredText(process0->text, 9'000, 0U);
+  process1->writer.writeDeferredText(process1->text, 9'005, 1U);
+  daemon->poll();
+  CHECK_EQ(daemon->stats().producers, 2);
+  CHECK(daemon->filename().empty());  // waiting for more producers
+
+  // A producer exiting writes its data
+  process1.reset();
+  daemon->poll();
+  CHECK_EQ(daemon->stats().producers, 1);
+  CHECK_EQ(daemon->stats().files, 1);
+  CHECK_EQ(daemon->filename(), config.filename);
+
+  // New formats start a new file, a conflicting format is rejected
+  transport_config.ring_size = 4096;
+  auto process2 = std::make_unique<Process>(transport_config, fields, 2);
+  const std::vector<ulog_cpp::Field> conflicting_fields{{"uint64_t", "timestamp"},
+                                                        {"float", "counter"}};
+  ulog_cpp::ShmLogProducer conflicting_producer(transport_config);
+  {
+    ulog_cpp::SimpleWriter writer(
+        [&](const uint8_t* data, int length) { conflicting_producer.write(data, length); }, 0);
+    writer.writeMessageFormat("shared", conflicting_fields);
+    writer.headerComplete();
+    writer.writeAddLoggedMessage("shared");
+  }
+  process0->writeSamples(10'000, 1000);
+  // The ring of process2 is too small: data is dropped instead of blocking
+  process2->writeSamples(10'005, 1000);
+  CHECK_GT(process2->producer.stats().dropped_messages, 0);
+  daemon->poll();
+  process2->writeSamples(20'005, 1);
+  daemon->poll();
+  CHECK_EQ(daemon->stats().files, 2);
+  CHECK_EQ(daemon->stats().rejected_producers, 1);
+  CHECK_EQ(daemon->errors().size(), 1);
+  const std::string second_filename = daemon->filename();
+  CHECK_EQ(second_filename, temp_directory / "shm_test.1.ulg");
+
+  process0.reset();
+  process2.reset();
+  daemon->poll();
+  CHECK_EQ(daemon->stats().producers, 1);  // the conflicting one
+
+  // Definitions that do not fit into the ring in time: the producer gives up and is removed
+  transport_config.blocking_timeout_ms = 10;
+  {
+    ulog_cpp::ShmLogProducer broken_producer(transport_config);
+    ulog_cpp::SimpleWriter writer(
+        [&](const uint8_t* data, int length) { broken_producer.write(data, length); }, 0);
+    for (int i = 0; i < 200; ++i) {
+      writer.writeMessageFormat("format_" + std::to_string(i), fields);
+    }
+    CHECK(broken_producer.broken());
+    CHECK_EQ(broken_producer.stats().dropped_messages, 1);
+    daemon->poll();
+    CHECK_EQ(daemon->stats().producers, 1);
+  }
+  daemon.reset();
+
+  const auto read_file = [](const std::string& filename) {
+    auto data_container =
+        std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+    ulog_cpp::Reader reader{data_container};
+    FILE* file = fopen(filename.c_str(), "rb");
+    REQUIRE(file);
+    uint8_t buffer[4096];
+    size_t bytes_read;
+    while ((bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+      reader.readChunk(buffer, bytes_read);
+    }
+    fclose(file);
+    CHECK(data_container->parsingErrors().empty());
+    return data_container;
+  };
+
+  // First file: processes 0 and 1, merged by time
+  const auto first = read_file(config.filename);
+  CHECK_EQ(first->messageFormats().size(), 3);
+  std::set<int> shared_multi_ids;
+  for (const auto& subscription_iter : first->subscriptions()) {
+    const auto& subscription = subscription_iter.second;
+    CHECK_EQ(subscription.data.size(), 1000);
+    if (subscription.add_logged_message.messageName() == "shared") {
+      shared_multi_ids.insert(subscription.add_logged_message.multiId());
+    }
+  }
+  CHECK(shared_multi_ids == std::set<int>({0, 1}));
+  REQUIRE_EQ(first->deferredLogging().size(), 2);
+  CHECK_EQ(first->deferredFormatter().format(first->deferredLogging()[0]), "process 0: 0");
+  CHECK_EQ(first->deferredFormatter().format(first->deferredLogging()[1]), "process 1: 1");
+
+  // Second file: all formats, the subscriptions of process 0 again, process 2 with a dropout
+  const auto second = read_file(second_filename);
+  CHECK_EQ(second->messageFormats().size(), 4);
+  CHECK_EQ(second->subscriptions().size(), 4);
+  CHECK_GE(second->dropouts().size(), 1);
+  shared_multi_ids.clear();
+  for (const auto& subscription_iter : second->subscriptions()) {
+    const auto& subscription = subscription_iter.second;
+    const std::string& name = subscription.add_logged_message.messageName();
+    if (name == "shared") {
+      shared_multi_ids.insert(subscription.add_logged_message.multiId());
+    }
+    if (name == "own_0") {
+      CHECK_EQ(subscription.data.size(), 1000);
+    } else if (name == "own_2") {
+      CHECK_LT(subscription.data.size(), 1000);
+      Sample sample;
+      memcpy(&sample, subscription.data[subscription.data.size() - 1].data().data(),
+             sizeof(sample));
+      CHECK_EQ(sample.timestamp, 20'005);
+    }
+  }
+  // process1 exited, so its multi_id is reused
+  CHECK(shared_multi_ids == std::set<int>({0, 1}));
+
+  std::filesystem::remove(config.filename);
+  std::filesystem::remove(second_filename);
+}
+
+TEST_CASE("ULog parsing - workload generator")
+{
+  std::istringstream spec_text(R"(
+      seed 7
+      duration 5  # seconds
+      logging_rate 2
+      topic attitude 100 float[4]:q float:rollspeed uint8_t:state
+      random_topics 20 1 50 1 10
+  )");
+  const ulog_cpp::WorkloadSpec spec = ulog_cpp::WorkloadSpec::parse(spec_text);
+  REQUIRE_EQ(spec.topics.size(), 21);
+  CHECK_EQ(spec.topics[0].fields.size(), 4);  // timestamp is added
+
+  auto generate = [](const ulog_cpp::WorkloadSpec& workload_spec, ulog_cpp::WorkloadStats& stats) {
+    std::vector<uint8_t> written_data;
+    stats = ulog_cpp::WorkloadGenerator(workload_spec)
+                .generate([&](const uint8_t* data, int length) {
+                  written_data.insert(written_data.end(), data, data + length);
+                });
+    return written_data;
+  };
+  auto read = [](const std::vector<uint8_t>& written_data) {
+    const auto data_container =
+        std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+    ulog_cpp::Reader reader{data_container};
+    for (size_t i = 0; i < written_data.size(); i += 100) {
+      reader.readChunk(written_data.data() + i, std::min<size_t>(100, written_data.size() - i));
+    }
+    return data_container;
+  };
+
+  // Deterministic
+  ulog_cpp::WorkloadStats stats;
+  const std::vector<uint8_t> written_data = generate(spec, stats);
+  ulog_cpp::WorkloadStats stats2;
+  CHECK_EQ(written_data, generate(spec, stats2));
+  CHECK_EQ(stats.num_bytes, written_data.size());
+  CHECK_EQ(stats.samples_per_topic[0], 500);
+  CHECK_EQ(stats.num_logging, 11);
+
+  auto data_container = read(written_data);
+  CHECK(data_container->parsingErrors().empty());
+  CHECK_EQ(data_container->logging().size(), stats.num_logging);
+  uint64_t num_samples = 0;
+  for (const auto& subscription : data_container->subscriptions()) {
+    CHECK_EQ(subscription.second.data.size(),
+             stats.samples_per_topic[subscription.second.add_logged_message.msgId()]);
+    num_samples += subscription.second.data.size();
+  }
+  CHECK_EQ(num_samples, stats.num_samples);
+
+  // Encoded data gives the same samples
+  ulog_cpp::WorkloadSpec encoded_spec = spec;
+  encoded_spec.encode_data = true;
+  ulog_cpp::WorkloadStats encoded_stats;
+  const auto encoded_container = read(generate(encoded_spec, encoded_stats));
+  CHECK_LT(encoded_stats.num_bytes, stats.num_bytes);
+  CHECK_EQ(encoded_container->subscriptions().at(0).data.size(), 500);
+  CHECK_EQ(encoded_container->subscriptions().at(0).data[499],
+           data_container->subscriptions().at(0).data[499]);
+
+  // Dropouts and corruption: the reader recovers
+  ulog_cpp::WorkloadSpec corrupted_spec = spec;
+  corrupted_spec.dropout_probability = 0.01;
+  corrupted_spec.corruption_probability = 0.01;
+  ulog_cpp::WorkloadStats corrupted_stats;
+  data_container = read(generate(corrupted_spec, corrupted_stats));
+  CHECK_GT(corrupted_stats.num_dropouts, 0);
+  CHECK_GT(corrupted_stats.num_corruptions, 0);
+  CHECK_FALSE(data_container->hadFatalError());
+  CHECK_FALSE(data_container->parsingErrors().empty());
+  num_samples = 0;
+  for (const auto& subscription : data_container->subscriptions()) {
+    num_samples += subscription.second.data.size();
+  }
+  CHECK_LE(num_samples, corrupted_stats.num_samples);
+
+  std::istringstream invalid_spec("topic a 10 float64:x\n");
+  CHECK_THROWS_AS(ulog_cpp::WorkloadSpec::parse(invalid_spec), ulog_cpp::UsageException);
+}
+
+TEST_CASE("ULog parsing - reader stats")
+{
+  std::vector<uint8_t> written_data;
+  ulog_cpp::Writer writer([&](const uint8_t* data, int length) {
+    written_data.insert(written_data.end(), data, data + length);
+  });
+  writer.fileHeader(ulog_cpp::FileHeader{});
+  writer.messageFormat(ulog_cpp::MessageFormat{"message_name", {{"uint64_t", "timestamp"}}});
+  writer.headerComplete();
+  writer.addLoggedMessage(ulog_cpp::AddLoggedMessage{0, 0, "message_name"});
+  writer.addLoggedMessage(ulog_cpp::AddLoggedMessage{0, 3, "message_name"});
+  for (int i = 0; i < 10; ++i) {
+    writer.data(ulog_cpp::Data{0, std::vector<uint8_t>(8)});
+  }
+  writer.data(ulog_cpp::Data{3, std::vector<uint8_t>(8)});
+  const size_t valid_size = written_data.size();
+  // Corruption: invalid message header, followed by a valid message
+  written_data.insert(written_data.end(), {0, 0, 0, 0, 0});
+  writer.data(ulog_cpp::Data{3, std::vector<uint8_t>(8)});
+
+  struct NullHandler final : public ulog_cpp::DataHandlerInterface {
+  };
+  NullHandler handler;
+  ulog_cpp::BasicReader<NullHandler> reader{handler};
+  reader.enableStats();
+  reader.readChunk(written_data.data(), written_data.size());
+
+  const ulog_cpp::ReaderStats& stats = reader.stats();
+  const auto data_type = static_cast<uint8_t>(ulog_cpp::ULogMessageType::DATA);
+  CHECK_EQ(stats.per_type[data_type].messages, 12);
+  CHECK_EQ(stats.per_type[data_type].bytes, 12 * (3 + 2 + 8));
+  REQUIRE_EQ(stats.per_msg_id.size(), 4);
+  CHECK_EQ(stats.per_msg_id[0].messages, 10);
+  CHECK_EQ(stats.per_msg_id[1].messages, 0);
+  CHECK_EQ(stats.per_msg_id[3].messages, 2);
+  CHECK_EQ(stats.per_type[static_cast<uint8_t>(ulog_cpp::ULogMessageType::ADD_LOGGED_MSG)].messages,
+           2);
+  CHECK_EQ(stats.largest_message, stats.per_type[static_cast<uint8_t>(
+                                                     ulog_cpp::ULogMessageType::FORMAT)]
+                                      .bytes);
+  CHECK_EQ(stats.recovery_events, 1);
+  CHECK_EQ(stats.discarded_bytes, 5);
+  CHECK_EQ(stats.file_header_bytes + stats.messageBytes() + stats.discarded_bytes,
+           written_data.size());
+  CHECK_LT(valid_size, written_data.size());
+
+  // Disabled by default
+  ulog_cpp::BasicReader<NullHandler> reader_without_stats{handler};
+  reader_without_stats.readChunk(written_data.data(), written_data.size());
+  CHECK_EQ(reader_without_stats.stats().per_type[data_type].messages, 0);
+}
+
+TEST_CASE("ULog writing - batches")
+{
+  struct Sample {
+    uint64_t timestamp;
+    float value;  // 4 bytes of padding at the end
+  };
+  struct Counter {
+    uint64_t timestamp;
+    uint32_t count;
+  };
+  std::vector<Sample> samples;
+  for (int i = 0; i < 64; ++i) {
+    samples.push_back({static_cast<uint64_t>(i), 0.25F * i});
+  }
+
+  for (const bool encode_data : {false, true}) {
+    std::vector<uint8_t> single_data;
+    std::vector<uint8_t> batch_data;
+    ulog_cpp::SimpleWriter single_writer(
+        [&](const uint8_t* data, int length) {
+          single_data.insert(single_data.end(), data, data + length);
+        },
+        0, encode_data);
+    ulog_cpp::SimpleWriter batch_writer(
+        [&](const uint8_t* data, int length) {
+          batch_data.insert(batch_data.end(), data, data + length);
+        },
+        0, encode_data);
+    for (auto* writer : {&single_writer, &batch_writer}) {
+      writer->writeMessageFormat("sample", {{"uint64_t", "timestamp"}, {"float", "value"}});
+      writer->writeMessageFormat("counter", {{"uint64_t", "timestamp"}, {"uint32_t", "count"}});
+      writer->headerComplete();
+      writer->writeAddLoggedMessage("sample");
+      writer->writeAddLoggedMessage("counter");
+    }
+
+    for (const auto& sample : samples) {
+      single_writer.writeData(0, sample);
+    }
+    batch_writer.writeDataBatch(0, samples);
+
+    ulog_cpp::DataBatch batch;
+    for (int i = 0; i < 8; ++i) {
+      single_writer.writeData(0, samples[i]);
+      single_writer.writeData(1, Counter{static_cast<uint64_t>(i), static_cast<uint32_t>(i)});
+      batch.add(0, samples[i]);
+      batch.add(1, Counter{static_cast<uint64_t>(i), static_cast<uint32_t>(i)});
+    }
+    batch_writer.writeDataBatch(batch);
+    batch.add(5, samples[0]);
+    CHECK_THROWS_AS(batch_writer.writeDataBatch(batch), ulog_cpp::UsageException);
+    batch_writer.writeDataBatch(0, samples.data(), 0);
+    single_writer.fsync();
+    batch_writer.fsync();
+
+    CHECK(batch_data == single_data);
+    const auto data_container =
+        std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+    ulog_cpp::Reader reader{data_container};
+    reader.readChunk(batch_data.data(), batch_data.size());
+    CHECK(data_container->parsingErrors().empty());
+    CHECK_EQ(data_container->subscriptions().at(0).data.size(), 64 + 8);
+  }
+}
+
+TEST_CASE("ULog writing - deferred text messages")
+{
+  std::vector<uint8_t> written_data;
+  ulog_cpp::SimpleWriter writer(
+      [&](const uint8_t* data, int length) {
+        written_data.insert(written_data.end(), data, data + length);
+      },
+      0);
+  const auto started = writer.registerTextFormat<>(ulog_cpp::Logging::Level::Info, "started");
+  writer.headerComplete();
+  const auto battery = writer.registerTextFormat<int, float, const char*>(
+      ulog_cpp::Logging::Level::Warning, "Battery %i: %.2f V (%s), 100%%");
+  const auto mixed = writer.registerTextFormat<uint64_t, std::string, char>(
+      ulog_cpp::Logging::Level::Error, "%08lx|%-6s|%c|%lu");
+  writer.writeDeferredText(started, 1);
+  writer.writeDeferredText(battery, 2, -3, 10.456F, "low");
+  writer.writeDeferredText(mixed, 3, 0xbeefU, "ab", 'x');
+  // Not registered in the log
+  writer.writeDeferredText(ulog_cpp::DeferredFormat<int>{42}, 4, 1);
+
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  reader.readChunk(written_data.data(), written_data.size());
+  CHECK(data_container->parsingErrors().empty());
+  CHECK(data_container->logging().empty());
+  const auto& messages = data_container->deferredLogging();
+  REQUIRE_EQ(messages.size(), 4);
+  const ulog_cpp::DeferredFormatter& formatter = data_container->deferredFormatter();
+  CHECK_EQ(formatter.format(messages[0]), "started");
+  const ulog_cpp::Logging battery_message = formatter.expand(messages[1]);
+  CHECK_EQ(battery_message.message(), "Battery -3: 10.46 V (low), 100%");
+  CHECK_EQ(battery_message.logLevel(), ulog_cpp::Logging::Level::Warning);
+  CHECK_EQ(battery_message.timestamp(), 2);
+  // A conversion without an argument is marked
+  CHECK_EQ(formatter.format(messages[2]), "0000beef|ab    |x|<?>");
+  CHECK_EQ(formatter.format(messages[3]), "<unknown format 42>");
+  CHECK_EQ(messages[1].args().size(), 8 + 8 + 2 + 3);
+}
+
+TEST_CASE("ULog parsing - file sinks")
+{
+  ulog_cpp::WorkloadSpec spec;
+  spec.seed = 3;
+  spec.duration_s = 20.;
+  spec.addRandomTopics(10, 10, 200, 1, 20);
+
+  const std::string filename =
+      (std::filesystem::temp_directory_path() / "file_sink_test.ulg").string();
+  for (const auto type : {ulog_cpp::FileSinkType::Stdio, ulog_cpp::FileSinkType::IoUring,
+                          ulog_cpp::FileSinkType::Direct, ulog_cpp::FileSinkType::Mmap}) {
+    ulog_cpp::FileSinkConfig config;
+    config.type = type;
+    config.buffer_size = 64 * 1024;  // several buffer switches
+    config.num_buffers = 2;
+    config.preallocate_size = 16 * 1024 * 1024;  // must be truncated on close
+
+    std::vector<uint8_t> expected_data;
+    {
+      auto sink = ulog_cpp::createFileSink(filename, config);
+      // io_uring, O_DIRECT or mmap might not be available, in which case stdio is used
+      CHECK((sink->type() == type || sink->type() == ulog_cpp::FileSinkType::Stdio));
+      int num_writes = 0;
+      ulog_cpp::WorkloadGenerator(spec).generate([&](const uint8_t* data, int length) {
+        expected_data.insert(expected_data.end(), data, data + length);
+        sink->write(data, length);
+        if (++num_writes % 1000 == 0) {
+          sink->sync();
+        } else if (num_writes % 100 == 0) {
+          sink->flush();
+        }
+      });
+    }
+    REQUIRE_GT(expected_data.size(), 2 * config.buffer_size * config.num_buffers);
+
+    std::ifstream file(filename, std::ios::binary);
+    const std::vector<uint8_t> file_data(std::istreambuf_iterator<char>(file), {});
+    CHECK_EQ(file_data.size(), expected_data.size());
+    CHECK(file_data == expected_data);
+
+    // Through the SimpleWriter
+    {
+      ulog_cpp::SimpleWriter writer(filename, 0, false, config);
+      writer.writeInfo("sys_name", "file_sink_test");
+      writer.writeMessageFormat("sample", {{"uint64_t", "timestamp"}, {"float", "value"}});
+      writer.headerComplete();
+      const uint16_t msg_id = writer.writeAddLoggedMessage("sample");
+      for (int i = 0; i < 10000; ++i) {
+        struct {
+          uint64_t timestamp;
+          float value;
+        } sample{static_cast<uint64_t>(i), 0.5F * i};
+        writer.writeData(msg_id, sample);
+      }
+      writer.fsync();
+    }
+    const auto data_container =
+        std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+    ulog_cpp::Reader reader{data_container};
+    std::ifstream log_file(filename, std::ios::binary);
+    const std::vector<uint8_t> log_data(std::istreambuf_iterator<char>(log_file), {});
+    reader.readChunk(log_data.data(), log_data.size());
+    CHECK(data_container->parsingErrors().empty());
+    CHECK_EQ(data_container->subscriptions().at(0).data.size(), 10000);
+  }
+  std::filesystem::remove(filename);
+}
+
+TEST_CASE("ULog parsing - log recovery")
+{
+  ulog_cpp::WorkloadSpec spec;
+  spec.seed = 4;
+  spec.duration_s = 5.;
+  spec.addRandomTopics(5, 10, 200, 1, 20);
+
+  const std::string filename =
+      (std::filesystem::temp_directory_path() / "log_recovery_test.ulg").string();
+  const std::string marker_filename = ulog_cpp::commitMarkerFilename(filename);
+
+  // The child process crashes in the middle of a message
+  std::vector<uint8_t> expected_data;
+  int num_writes = 0;
+  ulog_cpp::WorkloadGenerator(spec).generate([&](const uint8_t* data, int length) {
+    expected_data.insert(expected_data.end(), data, data + length);
+    ++num_writes;
+  });
+  const pid_t pid = fork();
+  REQUIRE_GE(pid, 0);
+  if (pid == 0) {
+    ulog_cpp::FileSinkConfig config;
+    config.type = ulog_cpp::FileSinkType::Mmap;
+    config.buffer_size = 64 * 1024;
+    auto sink = ulog_cpp::createFileSink(filename, config);
+    int write_index = 0;
+    ulog_cpp::WorkloadGenerator(spec).generate([&](const uint8_t* data, int length) {
+      if (++write_index == num_writes) {
+        sink->write(data, length / 2);
+        std::abort();
+      }
+      sink->write(data, length);
+    });
+    _exit(1);
+  }
+  int status = 0;
+  REQUIRE_EQ(waitpid(pid, &status, 0), pid);
+  REQUIRE(WIFSIGNALED(status));
+  REQUIRE(std::filesystem::exists(marker_filename));
+  // The file still contains the preallocated window
+  CHECK_GT(std::filesystem::file_size(filename), expected_data.size());
+
+  const ulog_cpp::RecoveryResult result = ulog_cpp::recoverLog(filename);
+  CHECK(result.commit_marker);
+  CHECK_EQ(result.valid_size, result.committed_size);
+  CHECK_LT(result.valid_size, expected_data.size());
+  CHECK_GT(result.valid_size, expected_data.size() - 1000);
+  CHECK_FALSE(std::filesystem::exists(marker_filename));
+  CHECK_EQ(std::filesystem::file_size(filename), result.valid_size);
+
+  std::vector<uint8_t> file_data;
+  {
+    std::ifstream file(filename, std::ios::binary);
+    file_data.assign(std::istreambuf_iterator<char>(file), {});
+  }
+  REQUIRE_EQ(file_data.size(), result.valid_size);
+  CHECK(std::equal(file_data.begin(), file_data.end(), expected_data.begin()));
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::Header);
+  ulog_cpp::Reader reader{data_container};
+  reader.readChunk(file_data.data(), file_data.size());
+  CHECK(data_container->parsingErrors().empty());
+  CHECK_FALSE(data_container->hadFatalError());
+
+  // Without a marker (e.g. written with stdio), the file is cut after the last complete message
+  {
+    std::ofstream file(filename, std::ios::binary | std::ios::app);
+    const uint8_t partial_message[] = {100, 0, 'D', 1, 0};
+    file.write(reinterpret_cast<const char*>(partial_message), sizeof(partial_message));
+  }
+  const ulog_cpp::RecoveryResult dry_run = ulog_cpp::recoverLog(filename, false);
+  CHECK_FALSE(dry_run.commit_marker);
+  CHECK_EQ(dry_run.file_size, result.valid_size + 5);
+  CHECK_EQ(dry_run.valid_size, result.valid_size);
+  CHECK_EQ(dry_run.num_messages, result.num_messages);
+  CHECK_EQ(std::filesystem::file_size(filename), result.valid_size + 5);
+  CHECK_EQ(ulog_cpp::recoverLog(filename).valid_size, result.valid_size);
+  CHECK_EQ(std::filesystem::file_size(filename), result.valid_size);
+  std::filesystem::remove(filename);
+}
+
+TEST_CASE("ULog parsing - follow a growing file")
+{
+  struct Sample {
+    uint64_t timestamp;
+    uint32_t counter;
+  };
+  const auto temp_directory = std::filesystem::temp_directory_path();
+  const std::string filename = (temp_directory / "follow_test.ulg").string();
+  const std::string next_filename = (temp_directory / "follow_test.1.ulg").string();
+  std::filesystem::remove(filename);
+  std::filesystem::remove(next_filename);
+
+  const auto create_log = [](uint64_t first_timestamp) {
+    std::vector<uint8_t> log_data;
+    ulog_cpp::SimpleWriter writer(
+        [&](const uint8_t* data, int length) { log_data.insert(log_data.end(), data, data + length); },
+        first_timestamp);
+    writer.writeMessageFormat("sample", {{"uint64_t", "timestamp"}, {"uint32_t", "counter"}});
+    writer.headerComplete();
+    const uint16_t id = writer.writeAddLoggedMessage("sample");
+    for (uint32_t i = 0; i < 1000; ++i) {
+      writer.writeData(id, Sample{first_timestamp + i, i});
+    }
+    return log_data;
+  };
+  const auto append = [](const std::string& filename, const uint8_t* data, size_t length) {
+    std::ofstream file(filename, std::ios::binary | std::ios::app);
+    file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(length));
+  };
+
+  struct Counter : public ulog_cpp::DataHandlerInterface {
+    void fileHeader(const ulog_cpp::FileHeader& header) override { ++num_headers; }
+    void data(const ulog_cpp::Data& data) override
+    {
+      memcpy(&last_sample, data.data().data(), sizeof(last_sample));
+      ++num_samples;
+    }
+    void error(const std::string& msg, bool is_recoverable) override { ++num_errors; }
+    int num_headers{0};
+    int num_samples{0};
+    int num_errors{0};
+    Sample last_sample{};
+  };
+  const auto counter = std::make_shared<Counter>();
+  ulog_cpp::LogFollower follower(filename, counter);
+  // The file does not exist yet
+  CHECK_EQ(follower.poll(std::chrono::milliseconds(0)), 0);
+
+  // A partially written message is kept until it is complete
+  const std::vector<uint8_t> first_log = create_log(0);
+  const size_t split = first_log.size() / 2 + 3;
+  append(filename, first_log.data(), split);
+  CHECK_EQ(follower.poll(std::chrono::milliseconds(0)), split);
+  const int num_samples = counter->num_samples;
+  CHECK_GT(num_samples, 0);
+  CHECK_LT(num_samples, 1000);
+
+  // A waiting poll() is woken up by the write, not by the timeout
+  std::thread writer_thread([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    append(filename, first_log.data() + split, first_log.size() - split);
+  });
+  const auto start = std::chrono::steady_clock::now();
+  size_t bytes_read = 0;
+  while (bytes_read < first_log.size() - split) {
+    bytes_read += follower.poll(std::chrono::seconds(10));
+  }
+  writer_thread.join();
+  CHECK_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  CHECK_EQ(counter->num_samples, 1000);
+  CHECK_EQ(counter->last_sample.counter, 999);
+  CHECK_EQ(follower.segment(), 0);
+
+  // Rotation to the next segment
+  const std::vector<uint8_t> second_log = create_log(1000);
+  append(next_filename, second_log.data(), second_log.size());
+  CHECK_EQ(follower.poll(std::chrono::milliseconds(0)), second_log.size());
+  CHECK_EQ(follower.segment(), 1);
+  CHECK_EQ(follower.filename(), next_filename);
+  CHECK_EQ(counter->num_headers, 2);
+  CHECK_EQ(counter->num_samples, 2000);
+  CHECK_EQ(counter->last_sample.timestamp, 1999);
+  CHECK_EQ(counter->num_errors, 0);
+  CHECK_EQ(follower.bytesRead(), first_log.size() + second_log.size());
+
+  // The writer closed the file
+  CHECK_EQ(follower.poll(std::chrono::milliseconds(10)), 0);
+  CHECK(follower.closed());
+
+  // The writer reopens the file and appends to it
+  {
+    std::ofstream file(next_filename, std::ios::binary | std::ios::app);
+    const Sample sample{2000, 1000};
+    const size_t payload_size = sizeof(sample.timestamp) + sizeof(sample.counter);
+    ulog_cpp::ulog_message_data_s header{};
+    header.msg_size = sizeof(header) - ULOG_MSG_HEADER_LEN + payload_size;
+    header.msg_id = 0;
+    std::vector<uint8_t> message(sizeof(header) + payload_size);
+    memcpy(message.data(), &header, sizeof(header));
+    memcpy(message.data() + sizeof(header), &sample, payload_size);
+    file.write(reinterpret_cast<const char*>(message.data()),
+               static_cast<std::streamsize>(message.size()));
+    file.flush();
+    CHECK_EQ(follower.poll(std::chrono::seconds(10)), message.size());
+    CHECK_FALSE(follower.closed());
+    CHECK_EQ(counter->last_sample.counter, 1000);
+  }
+  CHECK_EQ(follower.poll(std::chrono::seconds(10)), 0);
+  CHECK(follower.closed());
+  CHECK_EQ(counter->num_errors, 0);
+
+  // interrupt() ends a waiting poll()
+  std::thread interrupt_thread([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    follower.interrupt();
+  });
+  const auto interrupt_start = std::chrono::steady_clock::now();
+  CHECK_EQ(follower.poll(std::chrono::seconds(10)), 0);
+  interrupt_thread.join();
+  CHECK_LT(std::chrono::steady_clock::now() - interrupt_start, std::chrono::seconds(5));
+
+  std::filesystem::remove(filename);
+  std::filesystem::remove(next_filename);
+}
+
+TEST_CASE("ULog parsing - socket stream")
+{
+  struct Sample {
+    uint64_t timestamp;
+    uint32_t counter;
+  };
+  const std::vector<ulog_cpp::Field> fields{{"uint64_t", "timestamp"}, {"uint32_t", "counter"}};
+
+  // The reader handles any read size, down to single bytes (including the file header)
+  std::vector<uint8_t> log_data;
+  {
+    ulog_cpp::SimpleWriter writer(
+        [&](const uint8_t* data, int length) { log_data.insert(log_data.end(), data, data + length); },
+        0);
+    writer.writeMessageFormat("sample", fields);
+    writer.headerComplete();
+    const uint16_t id = writer.writeAddLoggedMessage("sample");
+    for (uint32_t i = 0; i < 100; ++i) {
+      writer.writeData(id, Sample{i, i});
+    }
+  }
+  const auto byte_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader byte_reader{byte_container};
+  for (const uint8_t byte : log_data) {
+    byte_reader.readChunk(&byte, 1);
+  }
+  CHECK(byte_container->parsingErrors().empty());
+  REQUIRE_EQ(byte_container->subscriptions().size(), 1);
+  CHECK_EQ(byte_container->subscriptions().begin()->second.data.size(), 100);
+
+  struct Counter : public ulog_cpp::DataHandlerInterface {
+    void fileHeader(const ulog_cpp::FileHeader& header) override { ++num_headers; }
+    void addLoggedMessage(const ulog_cpp::AddLoggedMessage& add_logged_message) override
+    {
+      ++num_subscriptions;
+    }
+    void data(const ulog_cpp::Data& data) override
+    {
+      memcpy(&last_sample, data.data().data(), sizeof(last_sample));
+      ++num_samples;
+    }
+    void dropout(const ulog_cpp::Dropout& dropout) override { ++num_dropouts; }
+    void error(const std::string& msg, bool is_recoverable) override { ++num_errors; }
+    int num_headers{0};
+    int num_subscriptions{0};
+    int num_samples{0};
+    int num_dropouts{0};
+    int num_errors{0};
+    Sample last_sample{};
+  };
+  const auto counter = std::make_shared<Counter>();
+  const auto receive = [&](ulog_cpp::SocketReceiver& receiver, int num_samples) {
+    while (counter->num_samples < num_samples && receiver.poll(std::chrono::seconds(5)) > 0) {
+    }
+    CHECK_EQ(counter->num_samples, num_samples);
+  };
+
+  ulog_cpp::SocketSinkConfig config;
+  config.path = (std::filesystem::temp_directory_path() / "ulog_socket_test").string();
+  config.reconnect_interval_ms = 0;
+  config.max_buffered = 4096;
+  ulog_cpp::SocketSink sink(config);
+  ulog_cpp::SimpleWriter writer([&](const uint8_t* data, int length) { sink.write(data, length); },
+                                0);
+  writer.writeMessageFormat("sample", fields);
+  CHECK_FALSE(sink.connected());  // no receiver yet
+
+  // The cached header is sent when a receiver appears
+  auto receiver = std::make_unique<ulog_cpp::SocketReceiver>(config.path, counter);
+  writer.headerComplete();
+  const uint16_t id = writer.writeAddLoggedMessage("sample");
+  CHECK(sink.connected());
+  for (uint32_t i = 0; i < 100; ++i) {
+    writer.writeData(id, Sample{i, i});
+  }
+  sink.flush();
+  receive(*receiver, 100);
+  CHECK_EQ(counter->num_headers, 1);
+  CHECK_EQ(counter->num_subscriptions, 1);
+
+  // A slow receiver: data is dropped instead of blocking the writer
+  for (uint32_t i = 100; i < 100'000; ++i) {
+    writer.writeData(id, Sample{i, i});
+  }
+  CHECK_GT(sink.stats().dropped_messages, 0);
+  while (receiver->poll(std::chrono::milliseconds(0)) > 0) {
+  }
+  sink.flush();
+  writer.writeData(id, Sample{100'000, 100'000});
+  sink.flush();
+  receive(*receiver, static_cast<int>(100'000 - sink.stats().dropped_messages + 1));
+  CHECK_EQ(counter->num_dropouts, 1);
+  CHECK_EQ(counter->last_sample.counter, 100'000);
+
+  // Reconnection: the new receiver gets the header and the subscription again
+  receiver.reset();
+  writer.writeData(id, Sample{100'001, 100'001});
+  sink.flush();
+  CHECK_FALSE(sink.connected());
+  receiver = std::make_unique<ulog_cpp::SocketReceiver>(config.path, counter);
+  const int num_samples = counter->num_samples;
+  writer.writeData(id, Sample{100'002, 100'002});
+  sink.flush();
+  receive(*receiver, num_samples + 1);
+  CHECK_EQ(sink.stats().connections, 2);
+  CHECK_EQ(receiver->connections(), 1);
+  CHECK_EQ(counter->num_headers, 2);
+  CHECK_EQ(counter->num_subscriptions, 2);
+  CHECK_EQ(counter->last_sample.counter, 100'002);
+  CHECK_EQ(counter->num_errors, 0);
+}
+
+TEST_CASE("ULog parsing - log cursor")
+{
+  struct Sample {
+    uint64_t timestamp;
+    float value;
+    uint32_t counter;
+  };
+  const std::vector<ulog_cpp::Field> fields{
+      {"uint64_t", "timestamp"}, {"float", "value"}, {"uint32_t", "counter"}};
+  const auto write_log = [&](const ulog_cpp::DataWriteCB& write_cb, bool encode_data) {
+    ulog_cpp::SimpleWriter writer(write_cb, 0, encode_data);
+    writer.writeInfo("sys_name", "cursor test");
+    writer.writeMessageFormat("topic_a", fields);
+    writer.writeMessageFormat("topic_b", fields);
+    writer.headerComplete();
+    const uint16_t id_a = writer.writeAddLoggedMessage("topic_a");
+    const uint16_t id_b = writer.writeAddLoggedMessage("topic_b");
+    for (uint32_t i = 0; i < 1000; ++i) {
+      writer.writeData(id_a, Sample{i * 1000ULL, 0.5F, i});
+      writer.writeData(id_b, Sample{i * 1000ULL + 1, 1.5F, i});
+      if (i % 100 == 0) {
+        writer.writeTextMessage(ulog_cpp::Logging::Level::Info, "text", i * 1000ULL);
+      }
+    }
+    writer.fsync();
+  };
+  std::vector<uint8_t> written_data;
+  write_log(
+      [&](const uint8_t* data, int length) {
+        written_data.insert(written_data.end(), data, data + length);
+      },
+      false);
+
+  // All messages: the data section unchanged, also with messages crossing chunk boundaries
+  {
+    ulog_cpp::LogCursorConfig config;
+    config.read_chunk_size = 100;
+    ulog_cpp::LogCursor cursor(written_data.data(), written_data.size(), config);
+    CHECK_EQ(cursor.header().messageFormats().size(), 2);
+    CHECK_EQ(cursor.header().messageInfo().at("sys_name").value().data(),
+             ulog_cpp::Value::ValueType{std::string("cursor test")});
+    std::vector<uint8_t> data_section;
+    int num_text = 0;
+    for (const auto& message : cursor) {
+      data_section.insert(data_section.end(), message.raw(), message.raw() + message.size());
+      if (message.type() == ulog_cpp::ULogMessageType::LOGGING) {
+        CHECK_EQ(ulog_cpp::Logging{message.raw()}.message(), "text");
+        ++num_text;
+      }
+    }
+    CHECK_EQ(num_text, 10);
+    REQUIRE_LT(data_section.size(), written_data.size());
+    CHECK(std::equal(data_section.begin(), data_section.end(),
+                     written_data.end() - data_section.size()));
+    CHECK(cursor.errors().empty());
+    CHECK_FALSE(cursor.next());
+  }
+
+  // Truncated messages without msg_id are skipped
+  {
+    std::vector<uint8_t> truncated_data = written_data;
+    truncated_data.insert(truncated_data.end(),
+                          {1, 0, static_cast<uint8_t>(ulog_cpp::ULogMessageType::DATA), 0});
+    ulog_cpp::LogCursor cursor(truncated_data.data(), truncated_data.size());
+    size_t num_messages = 0;
+    const uint8_t* last_message = nullptr;
+    for (const auto& message : cursor) {
+      ++num_messages;
+      last_message = message.raw();
+    }
+    REQUIRE(last_message);
+    CHECK_LT(last_message, truncated_data.data() + written_data.size());
+    CHECK_EQ(num_messages, 2 + 2000 + 10);
+  }
+
+  // Samples of one topic, read in steps
+  const auto read_samples = [](ulog_cpp::LogCursor& cursor, size_t max_samples) {
+    std::vector<Sample> samples;
+    while (samples.size() < max_samples && cursor.next()) {
+      const ulog_cpp::DataView data = cursor.message().data();
+      Sample sample;
+      REQUIRE_EQ(data.data().size(), sizeof(sample));
+      memcpy(&sample, data.data().data(), sizeof(sample));
+      samples.push_back(sample);
+    }
+    return samples;
+  };
+  const auto check_topic_b = [&](ulog_cpp::LogCursor& cursor) {
+    auto samples = read_samples(cursor, 300);
+    REQUIRE_EQ(samples.size(), 300);
+    CHECK_EQ(samples[0].counter, 0);
+    CHECK_EQ(samples[299].counter, 299);
+    CHECK_EQ(samples[299].timestamp, 299'001);
+    CHECK_EQ(cursor.subscription(cursor.message().msgId())->messageName(), "topic_b");
+    uint64_t timestamp = 0;
+    CHECK(cursor.message().timestamp(timestamp));
+    CHECK_EQ(timestamp, 299'001);
+    samples = read_samples(cursor, 1000);
+    REQUIRE_EQ(samples.size(), 700);
+    CHECK_EQ(samples[0].counter, 300);
+    CHECK_EQ(samples.back().counter, 999);
+    CHECK(cursor.errors().empty());
+  };
+  ulog_cpp::LogCursorConfig config;
+  config.topics = {"topic_b"};
+  config.data_only = true;
+  config.read_chunk_size = 1000;
+  {
+    ulog_cpp::LogCursor cursor(written_data.data(), written_data.size(), config);
+    check_topic_b(cursor);
+  }
+
+  // From a file
+  const auto filename = std::filesystem::temp_directory_path() / "cursor_test.ulg";
+  {
+    std::ofstream file(filename, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(written_data.data()),
+               static_cast<std::streamsize>(written_data.size()));
+  }
+  {
+    ulog_cpp::LogCursor cursor(filename, config);
+    check_topic_b(cursor);
+  }
+  std::filesystem::remove(filename);
+  CHECK_THROWS_AS(ulog_cpp::LogCursor{filename}, ulog_cpp::ParsingException);
+
+  // Encoded data is returned as DATA messages
+  std::vector<uint8_t> encoded_data;
+  write_log(
+      [&](const uint8_t* data, int length) {
+        encoded_data.insert(encoded_data.end(), data, data + length);
+      },
+      true);
+  CHECK_LT(encoded_data.size() * 2, written_data.size());
+  {
+    ulog_cpp::LogCursor cursor(encoded_data.data(), encoded_data.size(), config);
+    check_topic_b(cursor);
+  }
+}
+
 TEST_SUITE_END();
@@ -0,0 +1,590 @@
+/****************************************************************************
+ * Copyright (c) 2023 PX4 Development Team.
+ * SPDX-License-Identifier: BSD-3-Clause
+ ****************************************************************************/
+#include <doctest/doctest.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <set>
+#include <ulog_cpp/data_container.hpp>
+#include <ulog_cpp/reader.hpp>
+#include <ulog_cpp/shm_log_daemon.hpp>
+#include <ulog_cpp/struct_description.hpp>
+#include <ulog_cpp/zz_data_log.hpp>
+#include <vector>
+
+namespace {
+
+struct TestData1 {
+  uint64_t timestamp;
+  float values[4];
+  int32_t counter;
+
+  static std::string messageName() { return "test_data1"; }
+  static std::vector<ulog_cpp::Field> fields()
+  {
+    return {{"uint64_t", "timestamp"}, {"float", "values", 4}, {"int32_t", "counter"}};
+  }
+};
+
+struct TestData2 {
+  uint64_t timestamp;
+  double value;
+
+  static std::string messageName() { return "test_data2"; }
+  static std::vector<ulog_cpp::Field> fields()
+  {
+    return {{"uint64_t", "timestamp"}, {"double", "value"}};
+  }
+};
+
+struct UnknownData {
+  uint64_t timestamp;
+
+  static std::string messageName() { return "unknown_data"; }
+};
+
+// Padding after counter, values is aligned to 4 bytes
+struct DescribedData {
+  uint64_t timestamp;
+  int8_t counter;
+  float values[3];
+
+  static const std::string& messageName();
+  static const std::vector<ulog_cpp::Field>& fields();
+};
+
+// Same members listed in the wrong order
+struct ReorderedData {
+  uint64_t timestamp;
+  int8_t counter;
+  float values[3];
+};
+
+}  // namespace
+
+namespace ulog_cpp {
+template <>
+struct StructDescription<DescribedData> {
+  static constexpr const char* kName = "described_data";
+  static constexpr FieldDescription kFields[] = {
+      ULOG_CPP_FIELD(DescribedData, timestamp),
+      ULOG_CPP_FIELD(DescribedData, counter),
+      ULOG_CPP_FIELD(DescribedData, values),
+  };
+};
+template <>
+struct StructDescription<ReorderedData> {
+  static constexpr const char* kName = "reordered_data";
+  static constexpr FieldDescription kFields[] = {
+      ULOG_CPP_FIELD(ReorderedData, timestamp),
+      ULOG_CPP_FIELD(ReorderedData, values),
+      ULOG_CPP_FIELD(ReorderedData, counter),
+  };
+};
+}  // namespace ulog_cpp
+
+static_assert(ulog_cpp::hasValidLayout<DescribedData>(), "valid layout");
+static_assert(!ulog_cpp::hasValidLayout<ReorderedData>(), "detected at compile time");
+
+const std::string& DescribedData::messageName()
+{
+  return ulog_cpp::describedMessageName<DescribedData>();
+}
+const std::vector<ulog_cpp::Field>& DescribedData::fields()
+{
+  return ulog_cpp::describedFields<DescribedData>();
+}
+
+namespace {
+
+InitParams testInitParams()
+{
+  InitParams init_params;
+  init_params.key = "sys_name";
+  init_params.key_value = "zz_data_log_test";
+  init_params.all_structs.push_back({TestData1::messageName(), TestData1::fields()});
+  init_params.all_structs.push_back({TestData2::messageName(), TestData2::fields()});
+  return init_params;
+}
+
+std::shared_ptr<ulog_cpp::DataContainer> parse(const std::vector<uint8_t>& data)
+{
+  const auto data_container =
+      std::make_shared<ulog_cpp::DataContainer>(ulog_cpp::DataContainer::StorageConfig::FullLog);
+  ulog_cpp::Reader reader{data_container};
+  reader.readChunk(data.data(), data.size());
+  return data_container;
+}
+
+}  // namespace
+
+TEST_SUITE_BEGIN("[zz_data_log]");
+
+TEST_CASE("zz_data_log - stats")
+{
+  std::vector<uint8_t> written_data;
+  ulog_cpp::zz_data_log logger(
+      [&](const uint8_t* data, int length) {
+        written_data.insert(written_data.end(), data, data + length);
+      },
+      0);
+  logger.Init(testInitParams());
+
+  for (int i = 0; i < 30; ++i) {
+    logger.Write(TestData1{static_cast<uint64_t>(i), {}, i});
+  }
+  for (int i = 0; i < 5; ++i) {
+    logger.Write(TestData2{static_cast<uint64_t>(i), 1.5 * i});
+  }
+  CHECK_THROWS_AS(logger.Write(UnknownData{0}), ulog_cpp::UsageException);
+  CHECK_THROWS_AS(logger.writeData(7, TestData2{}), ulog_cpp::UsageException);
+
+  const ulog_cpp::DataLogStats stats = logger.stats();
+  CHECK_EQ(stats.messages_written, 35);
+  CHECK_EQ(stats.rejected_writes, 2);
+  CHECK_EQ(stats.dropped_writes, 0);
+  CHECK_EQ(stats.rotations, 0);
+  CHECK_EQ(stats.bytes_written, written_data.size());
+  CHECK_EQ(stats.file_size, written_data.size());
+  CHECK_EQ(stats.mutex_wait.count, 36);
+  CHECK_EQ(stats.waiting_writers, 0);
+  CHECK_EQ(stats.max_waiting_writers, 1);
+  CHECK_EQ(stats.fsync.count, 0);  // no file
+  REQUIRE_EQ(stats.topics.size(), 2);
+  CHECK_EQ(stats.topics[0].name, "test_data1");
+  CHECK_EQ(stats.topics[0].messages, 30);
+  CHECK_EQ(stats.topics[0].bytes, 30 * (3 + 2 + 28));
+  CHECK_EQ(stats.topics[1].name, "test_data2");
+  CHECK_EQ(stats.topics[1].messages, 5);
+
+  const auto data_container = parse(written_data);
+  CHECK(data_container->parsingErrors().empty());
+  CHECK_EQ(data_container->subscriptions().at(0).data.size(), 30);
+}
+
+TEST_CASE("zz_data_log - stats topic")
+{
+  std::vector<uint8_t> written_data;
+  ulog_cpp::zz_data_log logger(
+      [&](const uint8_t* data, int length) {
+        written_data.insert(written_data.end(), data, data + length);
+      },
+      0);
+  logger.enableStatsTopic(1);
+  logger.Init(testInitParams());
+  for (int i = 0; i < 20; ++i) {
+    logger.Write(TestData2{static_cast<uint64_t>(i), 0.});
+  }
+  CHECK_THROWS_AS(logger.enableStatsTopic(1), ulog_cpp::UsageException);
+
+  const auto data_container = parse(written_data);
+  CHECK(data_container->parsingErrors().empty());
+  const auto& formats = data_container->messageFormats();
+  REQUIRE(formats.find("zz_data_log_stats") != formats.end());
+  const auto& stats_subscription = data_container->subscriptions().at(2);
+  CHECK_EQ(stats_subscription.add_logged_message.messageName(), "zz_data_log_stats");
+  CHECK_GT(stats_subscription.data.size(), 0);
+  CHECK_LE(stats_subscription.data.size(), 20);
+  CHECK_EQ(logger.stats().messages_written, 20 + stats_subscription.data.size());
+}
+
+TEST_CASE("zz_data_log - file stats")
+{
+  const std::string filename =
+      (std::filesystem::temp_directory_path() / "zz_data_log_test.ulg").string();
+  {
+    ulog_cpp::zz_data_log logger(filename);
+    logger.Init(testInitParams());
+    for (int i = 0; i < 25; ++i) {
+      logger.Write(TestData2{static_cast<uint64_t>(i), 0.});
+    }
+    const ulog_cpp::DataLogStats stats = logger.stats();
+    CHECK_EQ(stats.fsync.count, 2);  // every 10 writes
+    CHECK_GT(stats.fsync.max_ns, 0);
+    CHECK_GE(stats.fsync.percentileNs(1.), stats.fsync.percentileNs(0.5));
+  }
+  std::filesystem::remove(filename);
+}
+
+TEST_CASE("zz_data_log - topic policies")
+{
+  std::vector<uint8_t> written_data;
+  ulog_cpp::zz_data_log logger(
+      [&](const uint8_t* data, int length) {
+        written_data.insert(written_data.end(), data, data + length);
+      },
+      0);
+  logger.Init(testInitParams());
+
+  ulog_cpp::TopicPolicy decimate;
+  decimate.keep_every_nth = 3;
+  logger.setTopicPolicy(TestData1::messageName(), decimate);
+  ulog_cpp::TopicPolicy rate_limit;
+  rate_limit.max_rate_hz = 100.;
+  logger.setTopicPolicy(TestData2::messageName(), rate_limit);
+
+  ulog_cpp::TopicPolicy invalid;
+  invalid.keep_every_nth = 0;
+  CHECK_THROWS_AS(logger.setTopicPolicy(TestData1::messageName(), invalid), ulog_cpp::UsageException);
+  CHECK_THROWS_AS(logger.setTopicPolicy(UnknownData::messageName(), decimate),
+                  ulog_cpp::UsageException);
+  invalid = {};
+  invalid.threshold_field = "values[4]";
+  CHECK_THROWS_AS(logger.setTopicPolicy(TestData1::messageName(), invalid), ulog_cpp::UsageException);
+
+  // 1 kHz input
+  for (int i = 0; i < 30; ++i) {
+    logger.Write(TestData1{static_cast<uint64_t>(i + 1) * 1000, {}, i});
+    logger.Write(TestData2{static_cast<uint64_t>(i + 1) * 1000, 0.});
+  }
+  ulog_cpp::DataLogStats stats = logger.stats();
+  REQUIRE_EQ(stats.topics.size(), 2);
+  CHECK_EQ(stats.topics[0].messages, 10);
+  CHECK_EQ(stats.topics[0].filtered, 20);
+  CHECK_EQ(stats.topics[1].messages, 3);
+  CHECK_EQ(stats.topics[1].filtered, 27);
+
+  ulog_cpp::TopicPolicy threshold;
+  threshold.threshold_field = "values[2]";
+  threshold.threshold = 0.5;
+  logger.setTopicPolicy(TestData1::messageName(), threshold);
+  logger.clearTopicPolicy(TestData2::messageName());
+  // kept: 0 (first), 0.6, 1.2, 0.4
+  for (const float value : {0.f, 0.2f, 0.4f, 0.6f, 1.f, 1.2f, 0.4f}) {
+    logger.Write(TestData1{40000, {0.f, 0.f, value, 0.f}, 0});
+  }
+  for (int i = 0; i < 5; ++i) {
+    logger.Write(TestData2{40000, 0.});
+  }
+  stats = logger.stats();
+  CHECK_EQ(stats.topics[0].messages, 10 + 4);
+  CHECK_EQ(stats.topics[1].messages, 3 + 5);
+  CHECK_EQ(stats.filtered_writes, 20 + 27 + 3);
+  CHECK_EQ(stats.messages_written, 14 + 8);
+
+  const auto data_container = parse(written_data);
+  CHECK(data_container->parsingErrors().empty());
+  CHECK_EQ(data_container->subscriptions().at(0).data.size(), 14);
+  CHECK_EQ(data_container->subscriptions().at(1).data.size(), 8);
+  // DataContainer keeps the first value of each key
+  const auto& info = data_container->messageInfo();
+  REQUIRE(info.find("zz_policy_test_data1") != info.end());
+  CHECK_EQ(std::get<std::string>(info.at("zz_policy_test_data1").value().data()),
+           "max_rate_hz=0 keep_every_nth=3");
+  REQUIRE(info.find("zz_policy_test_data2") != info.end());
+  CHECK_EQ(std::get<std::string>(info.at("zz_policy_test_data2").value().data()),
+           "max_rate_hz=100 keep_every_nth=1");
+}
+
+TEST_CASE("zz_data_log - flight recorder")
+{
+  const auto temp_dir = std::filesystem::temp_directory_path();
+  const std::string dump_filename = (temp_dir / "zz_flight_recorder.ulg").string();
+  const std::string second_dump_filename = (temp_dir / "zz_flight_recorder.1.ulg").string();
+  const auto read_file = [](const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+  };
+
+  ulog_cpp::FlightRecorder::Config config;
+  config.buffer_size = 4096;
+  config.pre_trigger_us = 100'000;
+  ulog_cpp::zz_data_log logger(config, dump_filename);
+  logger.Init(testInitParams());
+  // 10 s at 100 Hz, which does not fit into the buffer
+  for (int i = 0; i < 1000; ++i) {
+    logger.Write(TestData2{static_cast<uint64_t>(i) * 10'000, 0.5 * i});
+  }
+  CHECK_FALSE(std::filesystem::exists(dump_filename));
+  CHECK_EQ(logger.triggerFlightRecorder(), dump_filename);
+
+  auto data_container = parse(read_file(dump_filename));
+  CHECK(data_container->parsingErrors().empty());
+  const auto& samples = data_container->subscriptions().at(1).data;
+  REQUIRE_EQ(samples.size(), 11);
+  TestData2 sample{};
+  memcpy(&sample, samples[0].data().data(), sizeof(sample));
+  CHECK_EQ(sample.timestamp, 9'890'000);
+  memcpy(&sample, samples[10].data().data(), sizeof(sample));
+  CHECK_EQ(sample.value, 0.5 * 999);
+
+  // An error message triggers the next dump
+  logger.Write(TestData2{10'000'000, 1.});
+  logger.writeTextMessage(ulog_cpp::Logging::Level::Warning, "warning", 10'000'001);
+  CHECK_FALSE(std::filesystem::exists(second_dump_filename));
+  logger.writeTextMessage(ulog_cpp::Logging::Level::Error, "error", 10'000'002);
+  data_container = parse(read_file(second_dump_filename));
+  CHECK(data_container->parsingErrors().empty());
+  // latest timestamp is now the error message
+  CHECK_EQ(data_container->subscriptions().at(1).data.size(), 10);
+  REQUIRE_EQ(data_container->logging().size(), 2);
+  CHECK_EQ(data_container->logging().back().message(), "error");
+
+  std::filesystem::remove(dump_filename);
+  std::filesystem::remove(second_dump_filename);
+}
+
+TEST_CASE("zz_data_log - shared memory mode")
+{
+  ulog_cpp::ShmTransportConfig transport_config;
+  transport_config.name = "/zz_shm_test_" + std::to_string(getpid());
+  transport_config.ring_size = 64 * 1024;
+  CHECK_THROWS_AS(ulog_cpp::zz_data_log{transport_config}, ulog_cpp::ParsingException);
+
+  ulog_cpp::ShmLogDaemon::Config config;
+  config.filename = (std::filesystem::temp_directory_path() / "zz_shm.ulg").string();
+  ulog_cpp::ShmLogDaemon daemon(transport_config, config);
+  {
+    // Two processes logging the same topic
+    ulog_cpp::zz_data_log first(transport_config);
+    ulog_cpp::zz_data_log second(transport_config);
+    first.Init(testInitParams());
+    second.Init(testInitParams());
+    for (int i = 0; i < 100; ++i) {
+      first.Write(TestData2{static_cast<uint64_t>(i) * 2, 1.});
+      second.Write(TestData2{static_cast<uint64_t>(i) * 2 + 1, 2.});
+    }
+    second.writeTextMessage(ulog_cpp::Logging::Level::Info, "second", 1'000);
+    daemon.poll();
+  }
+  daemon.poll();
+  CHECK_EQ(daemon.stats().producers_total, 2);
+  CHECK_EQ(daemon.stats().producers, 0);
+  CHECK(daemon.errors().empty());
+
+  std::ifstream file(config.filename, std::ios::binary);
+  auto data_container = parse(std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {}));
+  CHECK(data_container->parsingErrors().empty());
+  // Both instances of the topic are kept apart
+  std::set<int> multi_ids;
+  for (const auto& subscription : data_container->subscriptions()) {
+    if (subscription.second.add_logged_message.messageName() == TestData2::messageName()) {
+      multi_ids.insert(subscription.second.add_logged_message.multiId());
+      CHECK_EQ(subscription.second.data.size(), 100);
+    }
+  }
+  CHECK(multi_ids == std::set<int>({0, 1}));
+  REQUIRE_EQ(data_container->logging().size(), 1);
+  CHECK_EQ(data_container->logging()[0].message(), "second");
+  std::filesystem::remove(config.filename);
+}
+
+TEST_CASE("zz_data_log - named instances and topic writers")
+{
+  std::vector<uint8_t> sensor_data;
+  std::vector<uint8_t> event_data;
+  const auto sensor_logger = std::make_shared<ulog_cpp::zz_data_log>(
+      [&](const uint8_t* data, int length) {
+        sensor_data.insert(sensor_data.end(), data, data + length);
+      },
+      0);
+  const auto event_logger = std::make_shared<ulog_cpp::zz_data_log>(
+      [&](const uint8_t* data, int length) {
+        event_data.insert(event_data.end(), data, data + length);
+      },
+      0);
+  ulog_cpp::zz_data_log::CreateNamedInstance("sensors", sensor_logger);
+  ulog_cpp::zz_data_log::CreateNamedInstance("events", event_logger);
+  CHECK_THROWS_AS(ulog_cpp::zz_data_log::CreateNamedInstance("events", sensor_logger),
+                  ulog_cpp::UsageException);
+  CHECK_EQ(ulog_cpp::zz_data_log::GetNamedInstance("sensors"), sensor_logger);
+  CHECK_THROWS_AS(ulog_cpp::zz_data_log::GetNamedInstance("unknown"), ulog_cpp::UsageException);
+
+  const auto sensors = ulog_cpp::zz_data_log::GetNamedInstance("sensors");
+  const auto events = ulog_cpp::zz_data_log::GetNamedInstance("events");
+  sensors->Init(testInitParams());
+  events->Init(testInitParams());
+  auto writer = sensors->topicWriter<TestData1>();
+  CHECK(writer.valid());
+  CHECK_EQ(writer.msgId(), 0);
+  CHECK_THROWS_AS(sensors->topicWriter<UnknownData>(), ulog_cpp::UsageException);
+
+  ulog_cpp::TopicPolicy decimate;
+  decimate.keep_every_nth = 2;
+  sensors->setTopicPolicy(TestData1::messageName(), decimate);
+  for (int i = 0; i < 20; ++i) {
+    writer.Write(TestData1{static_cast<uint64_t>(i), {}, i});
+  }
+  events->Write(TestData2{0, 1.});
+
+  CHECK_EQ(sensors->stats().messages_written, 10);
+  CHECK_EQ(sensors->stats().filtered_writes, 10);
+  CHECK_EQ(events->stats().messages_written, 1);
+  auto data_container = parse(sensor_data);
+  CHECK(data_container->parsingErrors().empty());
+  CHECK_EQ(data_container->subscriptions().at(0).data.size(), 10);
+  data_container = parse(event_data);
+  CHECK_EQ(data_container->subscriptions().at(0).data.size(), 0);
+  CHECK_EQ(data_container->subscriptions().at(1).data.size(), 1);
+
+  ulog_cpp::zz_data_log::RemoveNamedInstance("sensors");
+  ulog_cpp::zz_data_log::RemoveNamedInstance("events");
+  CHECK_THROWS_AS(ulog_cpp::zz_data_log::GetNamedInstance("sensors"), ulog_cpp::UsageException);
+}
+
+TEST_CASE("zz_data_log - batch writes")
+{
+  std::vector<uint8_t> single_data;
+  std::vector<uint8_t> batch_data;
+  ulog_cpp::zz_data_log single_logger(
+      [&](const uint8_t* data, int length) {
+        single_data.insert(single_data.end(), data, data + length);
+      },
+      0);
+  ulog_cpp::zz_data_log batch_logger(
+      [&](const uint8_t* data, int length) {
+        batch_data.insert(batch_data.end(), data, data + length);
+      },
+      0);
+  single_logger.Init(testInitParams());
+  batch_logger.Init(testInitParams());
+
+  std::vector<TestData1> fifo;
+  for (int i = 0; i < 32; ++i) {
+    fifo.push_back(TestData1{static_cast<uint64_t>(i), {0.5F * i}, i});
+  }
+  const std::vector<TestData2> other{{100, 1.}, {101, 2.}};
+
+  // Typed batch, through a handle and mixed topics
+  for (const auto& sample : fifo) {
+    single_logger.Write(sample);
+  }
+  batch_logger.WriteBatch(fifo);
+  for (const auto& sample : fifo) {
+    single_logger.Write(sample);
+  }
+  batch_logger.topicWriter<TestData1>().WriteBatch(fifo.data(), fifo.size());
+  ulog_cpp::DataBatch batch;
+  batch.add(0, fifo[0]);
+  batch.add(1, other[0]);
+  batch.add(1, other[1]);
+  single_logger.Write(fifo[0]);
+  single_logger.Write(other[0]);
+  single_logger.Write(other[1]);
+  batch_logger.WriteBatch(batch);
+  CHECK(batch_data == single_data);
+
+  // Invalid entries are rejected as a whole
+  batch.add(7, other[0]);
+  CHECK_THROWS_AS(batch_logger.WriteBatch(batch), ulog_cpp::UsageException);
+  CHECK(batch_data == single_data);
+
+  // Topic policies apply per sample
+  ulog_cpp::TopicPolicy decimate;
+  decimate.keep_every_nth = 3;
+  single_logger.setTopicPolicy(TestData1::messageName(), decimate);
+  batch_logger.setTopicPolicy(TestData1::messageName(), decimate);
+  for (const auto& sample : fifo) {
+    single_logger.Write(sample);
+  }
+  batch_logger.WriteBatch(fifo);
+  CHECK(batch_data == single_data);
+
+  const ulog_cpp::DataLogStats stats = batch_logger.stats();
+  CHECK_EQ(stats.messages_written, single_logger.stats().messages_written);
+  CHECK_EQ(stats.filtered_writes, 21);
+  CHECK_EQ(stats.rejected_writes, 1);
+  CHECK_EQ(stats.topics[0].messages, 2 * 32 + 1 + 11);
+  const auto data_container = parse(batch_data);
+  CHECK(data_container->parsingErrors().empty());
+  CHECK_EQ(data_container->subscriptions().at(0).data.size(), 2 * 32 + 1 + 11);
+}
+
+TEST_CASE("zz_data_log - deferred text messages")
+{
+  std::vector<uint8_t> written_data;
+  ulog_cpp::zz_data_log logger(
+      [&](const uint8_t* data, int length) {
+        written_data.insert(written_data.end(), data, data + length);
+      },
+      0);
+  const auto mode = logger.registerTextFormat<const char*>(ulog_cpp::Logging::Level::Info, "mode: %s");
+  logger.Init(testInitParams());
+  const auto limit = logger.registerTextFormat<uint32_t, double>(
+      ulog_cpp::Logging::Level::Warning, "limit %u reached: %.1f");
+  logger.writeDeferredText(mode, 10, "hover");
+  logger.writeDeferredText(limit, 11, 3U, 2.25);
+
+  auto data_container = parse(written_data);
+  CHECK(data_container->parsingErrors().empty());
+  REQUIRE_EQ(data_container->deferredLogging().size(), 2);
+  const auto& formatter = data_container->deferredFormatter();
+  CHECK_EQ(formatter.format(data_container->deferredLogging()[0]), "mode: hover");
+  CHECK_EQ(formatter.format(data_container->deferredLogging()[1]), "limit 3 reached: 2.2");
+
+  // In flight recorder mode, errors trigger a dump which includes the formats
+  const std::string dump_filename =
+      (std::filesystem::temp_directory_path() / "zz_deferred_text.ulg").string();
+  ulog_cpp::FlightRecorder::Config config;
+  config.buffer_size = 4096;
+  ulog_cpp::zz_data_log recorder(config, dump_filename);
+  recorder.Init(testInitParams());
+  const auto failure =
+      recorder.registerTextFormat<int>(ulog_cpp::Logging::Level::Error, "sensor %i failed");
+  recorder.writeDeferredText(failure, 20, 2);
+  std::ifstream file(dump_filename, std::ios::binary);
+  data_container = parse(std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {}));
+  CHECK(data_container->parsingErrors().empty());
+  REQUIRE_EQ(data_container->deferredLogging().size(), 1);
+  CHECK_EQ(data_container->deferredFormatter().format(data_container->deferredLogging()[0]),
+           "sensor 2 failed");
+  std::filesystem::remove(dump_filename);
+
+  // Format ids are not reused once they run out
+  ulog_cpp::zz_data_log many_formats([](const uint8_t* data, int length) {}, 0);
+  uint16_t last_id = 0;
+  for (uint32_t i = 0; i < std::numeric_limits<uint16_t>::max(); ++i) {
+    last_id = many_formats.registerTextFormat<>(ulog_cpp::Logging::Level::Info, "format").id;
+  }
+  CHECK_EQ(last_id, std::numeric_limits<uint16_t>::max() - 1);
+  CHECK_THROWS_AS(many_formats.registerTextFormat<>(ulog_cpp::Logging::Level::Info, "format"),
+                  ulog_cpp::UsageException);
+}
+
+TEST_CASE("zz_data_log - struct descriptions")
+{
+  const std::vector<ulog_cpp::Field> expected_fields{{"uint64_t", "timestamp"},
+                                                     {"int8_t", "counter"},
+                                                     {"uint8_t", "_padding0", 3},
+                                                     {"float", "values", 3}};
+  CHECK(DescribedData::fields() == expected_fields);
+  CHECK_EQ(DescribedData::messageName(), "described_data");
+  // Built once
+  CHECK_EQ(&DescribedData::fields(), &DescribedData::fields());
+  CHECK_EQ(&DescribedData::messageName(), &DescribedData::messageName());
+
+  std::vector<uint8_t> written_data;
+  ulog_cpp::zz_data_log logger(
+      [&](const uint8_t* data, int length) {
+        written_data.insert(written_data.end(), data, data + length);
+      },
+      0);
+  InitParams init_params = testInitParams();
+  init_params.all_structs.push_back({DescribedData::messageName(), DescribedData::fields()});
+  logger.Init(init_params);
+  logger.Write(DescribedData{1, -5, {1.5F, 2.5F, 3.5F}});
+
+  // The format describes the in-memory layout, so the values are read back at the right offsets
+  const auto data_container = parse(written_data);
+  REQUIRE(data_container->parsingErrors().empty());
+  const auto& format = data_container->messageFormats().at("described_data");
+  size_t values_offset = 0;
+  for (const auto& field : format.fields()) {
+    if (field.name == "values") {
+      break;
+    }
+    values_offset += ulog_cpp::Field::kBasicTypes.at(field.type) * std::max(field.array_length, 1);
+  }
+  CHECK_EQ(values_offset, offsetof(DescribedData, values));
+  const auto& samples = data_container->subscriptions().at(2).data;
+  REQUIRE_EQ(samples.size(), 1);
+  float values[3];
+  memcpy(values, samples[0].data().data() + values_offset, sizeof(values));
+  CHECK_EQ(values[2], 3.5F);
+}
+
+TEST_SUITE_END();
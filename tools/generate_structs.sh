@@ -1,4 +1,5 @@
 #!/bin/bash
 
-# Execute the Python script
-python3 generate_structs.py
+# The struct descriptions are generated next to the examples (examples/structs_definitions.hpp ->
+# examples/escape_structs.hpp)
+python3 "$(dirname "$0")/../examples/generate_structs.py"